@@ -0,0 +1,85 @@
+; Console Benchmark
+; Prints a 35-character line 250 times, one OUT per character, so the run
+; is dominated by port writes and console flushes (one per newline by default)
+
+main:
+    LOAD_IMM R3, 0          ; Zero, for comparisons
+    LOAD_IMM R6, 250        ; Lines
+
+line:
+    LOAD_IMM R0, 72         ; 'H'
+    OUT R0, 1
+    LOAD_IMM R0, 101        ; 'e'
+    OUT R0, 1
+    LOAD_IMM R0, 108        ; 'l'
+    OUT R0, 1
+    LOAD_IMM R0, 108        ; 'l'
+    OUT R0, 1
+    LOAD_IMM R0, 111        ; 'o'
+    OUT R0, 1
+    LOAD_IMM R0, 32         ; ' '
+    OUT R0, 1
+    LOAD_IMM R0, 102        ; 'f'
+    OUT R0, 1
+    LOAD_IMM R0, 114        ; 'r'
+    OUT R0, 1
+    LOAD_IMM R0, 111        ; 'o'
+    OUT R0, 1
+    LOAD_IMM R0, 109        ; 'm'
+    OUT R0, 1
+    LOAD_IMM R0, 32         ; ' '
+    OUT R0, 1
+    LOAD_IMM R0, 116        ; 't'
+    OUT R0, 1
+    LOAD_IMM R0, 104        ; 'h'
+    OUT R0, 1
+    LOAD_IMM R0, 101        ; 'e'
+    OUT R0, 1
+    LOAD_IMM R0, 32         ; ' '
+    OUT R0, 1
+    LOAD_IMM R0, 68         ; 'D'
+    OUT R0, 1
+    LOAD_IMM R0, 101        ; 'e'
+    OUT R0, 1
+    LOAD_IMM R0, 109        ; 'm'
+    OUT R0, 1
+    LOAD_IMM R0, 105        ; 'i'
+    OUT R0, 1
+    LOAD_IMM R0, 69         ; 'E'
+    OUT R0, 1
+    LOAD_IMM R0, 110        ; 'n'
+    OUT R0, 1
+    LOAD_IMM R0, 103        ; 'g'
+    OUT R0, 1
+    LOAD_IMM R0, 105        ; 'i'
+    OUT R0, 1
+    LOAD_IMM R0, 110        ; 'n'
+    OUT R0, 1
+    LOAD_IMM R0, 101        ; 'e'
+    OUT R0, 1
+    LOAD_IMM R0, 32         ; ' '
+    OUT R0, 1
+    LOAD_IMM R0, 99         ; 'c'
+    OUT R0, 1
+    LOAD_IMM R0, 111        ; 'o'
+    OUT R0, 1
+    LOAD_IMM R0, 110        ; 'n'
+    OUT R0, 1
+    LOAD_IMM R0, 115        ; 's'
+    OUT R0, 1
+    LOAD_IMM R0, 111        ; 'o'
+    OUT R0, 1
+    LOAD_IMM R0, 108        ; 'l'
+    OUT R0, 1
+    LOAD_IMM R0, 101        ; 'e'
+    OUT R0, 1
+    LOAD_IMM R0, 33         ; '!'
+    OUT R0, 1
+    LOAD_IMM R0, 10
+    OUT R0, 1
+    DEC R6
+    CMP R6, R3
+    JNZ line
+    HALT
+
+; Expected output: 250 lines of "Hello from the DemiEngine console!"
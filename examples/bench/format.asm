@@ -0,0 +1,68 @@
+; Format Benchmark
+; Converts every number 0..255 to three ASCII decimal digits at 0xE0..0xE2,
+; 40 times over, using the divide/multiply/subtract method of
+; decimal_output.asm, then prints the last one
+
+main:
+    LOAD_IMM R3, 0          ; Zero, for comparisons
+    LOAD_IMM R1, 40         ; Repetitions, kept in memory
+    STORE R1, 0xF0
+
+repeat:
+    LOAD_IMM R0, 0
+number_loop:
+    CALL format
+    LOAD_IMM R1, 255
+    CMP R0, R1
+    JZ numbers_done
+    INC R0
+    JMP number_loop
+numbers_done:
+    LOAD R1, 0xF0
+    DEC R1
+    STORE R1, 0xF0
+    CMP R1, R3
+    JNZ repeat
+
+    ; Print the last number formatted
+    LOAD R0, 0xE0
+    OUT R0, 1
+    LOAD R0, 0xE1
+    OUT R0, 1
+    LOAD R0, 0xE2
+    OUT R0, 1
+    LOAD_IMM R0, 10
+    OUT R0, 1
+    HALT
+
+; Write R0 as three decimal digits to 0xE0..0xE2 (R0 is preserved)
+format:
+    ; Hundreds digit: R0 / 100
+    LOAD_IMM R7, 100
+    MOV R1, R0
+    DIV R1, R7
+    MOV R2, R1
+    MUL R2, R7
+    MOV R6, R0
+    SUB R6, R2              ; R6 = R0 - hundreds * 100
+    LOAD_IMM R2, 48         ; ASCII '0'
+    ADD R1, R2
+    STORE R1, 0xE0
+
+    ; Tens digit: R6 / 10
+    LOAD_IMM R7, 10
+    MOV R1, R6
+    DIV R1, R7
+    MOV R2, R1
+    MUL R2, R7
+    SUB R6, R2              ; R6 = ones
+    LOAD_IMM R2, 48
+    ADD R1, R2
+    STORE R1, 0xE1
+
+    ; Ones digit
+    ADD R6, R2
+    STORE R6, 0xE2
+    RET
+
+; Expected output: "255" followed by newline
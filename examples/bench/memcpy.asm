@@ -0,0 +1,74 @@
+; Memcpy Benchmark
+; Copies an 8-byte buffer from 0xC0 to 0xD0 with unrolled LOAD/STORE pairs,
+; 250 x 60 times, then prints the destination
+
+main:
+    LOAD_IMM R3, 0          ; Zero, for comparisons
+
+    ; Fill the source with "ABCDEFGH"
+    LOAD_IMM R0, 65         ; 'A'
+    STORE R0, 0xC0
+    INC R0
+    STORE R0, 0xC1
+    INC R0
+    STORE R0, 0xC2
+    INC R0
+    STORE R0, 0xC3
+    INC R0
+    STORE R0, 0xC4
+    INC R0
+    STORE R0, 0xC5
+    INC R0
+    STORE R0, 0xC6
+    INC R0
+    STORE R0, 0xC7
+
+    LOAD_IMM R7, 60         ; Outer iterations
+outer:
+    LOAD_IMM R6, 250        ; Inner iterations
+copy:
+    LOAD R1, 0xC0
+    STORE R1, 0xD0
+    LOAD R2, 0xC1
+    STORE R2, 0xD1
+    LOAD R1, 0xC2
+    STORE R1, 0xD2
+    LOAD R2, 0xC3
+    STORE R2, 0xD3
+    LOAD R1, 0xC4
+    STORE R1, 0xD4
+    LOAD R2, 0xC5
+    STORE R2, 0xD5
+    LOAD R1, 0xC6
+    STORE R1, 0xD6
+    LOAD R2, 0xC7
+    STORE R2, 0xD7
+    DEC R6
+    CMP R6, R3
+    JNZ copy
+    DEC R7
+    CMP R7, R3
+    JNZ outer
+
+    ; Print the copy
+    LOAD R0, 0xD0
+    OUT R0, 1
+    LOAD R0, 0xD1
+    OUT R0, 1
+    LOAD R0, 0xD2
+    OUT R0, 1
+    LOAD R0, 0xD3
+    OUT R0, 1
+    LOAD R0, 0xD4
+    OUT R0, 1
+    LOAD R0, 0xD5
+    OUT R0, 1
+    LOAD R0, 0xD6
+    OUT R0, 1
+    LOAD R0, 0xD7
+    OUT R0, 1
+    LOAD_IMM R0, 10
+    OUT R0, 1
+    HALT
+
+; Expected output: "ABCDEFGH" followed by newline
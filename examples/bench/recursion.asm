@@ -0,0 +1,58 @@
+; Recursion Benchmark
+; Computes fib(13) with the naive doubly recursive definition, 200 times,
+; and prints the result. Every call saves its argument with PUSH/POP, so the
+; run is dominated by CALL/RET and stack traffic
+
+main:
+    LOAD_IMM R3, 0          ; Zero, for comparisons
+    LOAD_IMM R6, 200        ; Repetitions
+
+repeat:
+    LOAD_IMM R1, 0          ; Accumulator
+    LOAD_IMM R0, 13
+    CALL fib
+    DEC R6
+    CMP R6, R3
+    JNZ repeat
+
+    ; Print R1 (233) as three decimal digits
+    LOAD_IMM R7, 100
+    MOV R2, R1
+    DIV R2, R7              ; Hundreds
+    MOV R0, R2
+    MUL R0, R7
+    SUB R1, R0              ; Remainder
+    LOAD_IMM R0, 48
+    ADD R2, R0
+    OUT R2, 1
+    LOAD_IMM R7, 10
+    MOV R2, R1
+    DIV R2, R7              ; Tens
+    MOV R6, R2
+    MUL R6, R7
+    SUB R1, R6              ; Ones
+    ADD R2, R0
+    OUT R2, 1
+    ADD R1, R0
+    OUT R1, 1
+    LOAD_IMM R0, 10
+    OUT R0, 1
+    HALT
+
+; R1 += fib(R0); R0 is preserved
+fib:
+    LOAD_IMM R2, 2
+    CMP R0, R2
+    JGE fib_split
+    ADD R1, R0              ; fib(0) = 0, fib(1) = 1
+    RET
+fib_split:
+    PUSH R0
+    DEC R0
+    CALL fib                ; fib(n - 1)
+    DEC R0
+    CALL fib                ; fib(n - 2)
+    POP R0
+    RET
+
+; Expected output: "233" followed by newline
@@ -0,0 +1,91 @@
+; Sieve Benchmark
+; Sieve of Eratosthenes over 2..31, repeated 100 times
+; The composite set is a bitmask in R6; there is no indexed addressing, so
+; bit n is built by shifting (see the mask subroutine)
+
+main:
+    LOAD_IMM R3, 0          ; Zero, for comparisons
+    LOAD_IMM R1, 100        ; Repetitions, kept in memory
+    STORE R1, 0xF0
+
+repeat:
+    LOAD_IMM R6, 0          ; No composites yet
+    LOAD_IMM R0, 2          ; p = 2
+
+prime_loop:
+    MOV R2, R0
+    CALL mask               ; R1 = 1 << p
+    AND R1, R6
+    CMP R1, R3
+    JNZ next_p              ; p is composite; its multiples are already marked
+
+    MOV R2, R0
+    ADD R2, R0              ; m = 2p
+mark_loop:
+    LOAD_IMM R1, 32
+    CMP R2, R1
+    JGE next_p              ; m >= 32
+    PUSH R2
+    CALL mask               ; R1 = 1 << m
+    POP R2
+    OR R6, R1
+    ADD R2, R0              ; m += p
+    JMP mark_loop
+
+next_p:
+    INC R0
+    LOAD_IMM R1, 6          ; p * p < 32 for p <= 5
+    CMP R0, R1
+    JNZ prime_loop
+
+    ; Count the numbers in 2..31 that were never marked
+    LOAD_IMM R7, 0
+    LOAD_IMM R0, 2
+count_loop:
+    MOV R2, R0
+    CALL mask
+    AND R1, R6
+    CMP R1, R3
+    JNZ count_next
+    INC R7
+count_next:
+    INC R0
+    LOAD_IMM R1, 32
+    CMP R0, R1
+    JNZ count_loop
+
+    LOAD R1, 0xF0
+    DEC R1
+    STORE R1, 0xF0
+    CMP R1, R3
+    JNZ repeat
+
+    ; Print the prime count as two digits
+    LOAD_IMM R1, 10
+    MOV R2, R7
+    DIV R2, R1              ; Tens
+    MOV R0, R2
+    MUL R0, R1
+    SUB R7, R0              ; Ones
+    LOAD_IMM R0, 48
+    ADD R2, R0
+    ADD R7, R0
+    OUT R2, 1
+    OUT R7, 1
+    LOAD_IMM R0, 10
+    OUT R0, 1
+    HALT
+
+; R1 = 1 << R2 (R2 is consumed)
+mask:
+    LOAD_IMM R1, 1
+mask_loop:
+    CMP R2, R3
+    JZ mask_done
+    SHL R1, 1
+    DEC R2
+    JMP mask_loop
+mask_done:
+    RET
+
+; Expected output: "11" followed by newline
@@ -0,0 +1,96 @@
+; Sort Benchmark
+; Bubble sort of six pseudo-random bytes at 0xE0..0xE5, repeated 200 times
+; Each round refills the array from a linear congruential generator and
+; sorts it, stopping at the first pass that swaps nothing
+
+main:
+    LOAD_IMM R3, 0          ; Zero, for comparisons
+    LOAD_IMM R0, 1          ; Generator seed
+    LOAD_IMM R1, 200        ; Repetitions, kept in memory
+    STORE R1, 0xF0
+
+repeat:
+    CALL next
+    STORE R0, 0xE0
+    CALL next
+    STORE R0, 0xE1
+    CALL next
+    STORE R0, 0xE2
+    CALL next
+    STORE R0, 0xE3
+    CALL next
+    STORE R0, 0xE4
+    CALL next
+    STORE R0, 0xE5
+
+pass:
+    LOAD_IMM R6, 0          ; Nothing swapped in this pass yet
+    LOAD R1, 0xE0
+    LOAD R2, 0xE1
+    CMP R1, R2
+    JLE pair1
+    STORE R2, 0xE0
+    STORE R1, 0xE1
+    LOAD_IMM R6, 1
+pair1:
+    LOAD R1, 0xE1
+    LOAD R2, 0xE2
+    CMP R1, R2
+    JLE pair2
+    STORE R2, 0xE1
+    STORE R1, 0xE2
+    LOAD_IMM R6, 1
+pair2:
+    LOAD R1, 0xE2
+    LOAD R2, 0xE3
+    CMP R1, R2
+    JLE pair3
+    STORE R2, 0xE2
+    STORE R1, 0xE3
+    LOAD_IMM R6, 1
+pair3:
+    LOAD R1, 0xE3
+    LOAD R2, 0xE4
+    CMP R1, R2
+    JLE pair4
+    STORE R2, 0xE3
+    STORE R1, 0xE4
+    LOAD_IMM R6, 1
+pair4:
+    LOAD R1, 0xE4
+    LOAD R2, 0xE5
+    CMP R1, R2
+    JLE pair5
+    STORE R2, 0xE4
+    STORE R1, 0xE5
+    LOAD_IMM R6, 1
+pair5:
+    CMP R6, R3
+    JNZ pass                ; Repeat until a pass swaps nothing
+
+    LOAD R1, 0xF0
+    DEC R1
+    STORE R1, 0xF0
+    CMP R1, R3
+    JNZ repeat
+
+    ; The final pass swapped nothing, so the array is in order
+    LOAD_IMM R0, 79         ; 'O'
+    OUT R0, 1
+    LOAD_IMM R0, 75         ; 'K'
+    OUT R0, 1
+    LOAD_IMM R0, 10
+    OUT R0, 1
+    HALT
+
+; R0 = (R0 * 13 + 7) & 255
+next:
+    LOAD_IMM R7, 13
+    MUL R0, R7
+    LOAD_IMM R7, 7
+    ADD R0, R7
+    LOAD_IMM R7, 255
+    AND R0, R7
+    RET
+
+; Expected output: "OK" followed by newline
@@ -8,6 +8,17 @@ AssemblerEngine::AssemblerEngine() : current_address(0) {
     init_register_table();
 }
 
+std::string AssemblerEngine::mnemonic_for(uint8_t opcode) const {
+    // Several mnemonics may share an opcode; pick the same one every time
+    std::string best;
+    for (const auto& [mnemonic, value] : mnemonic_to_opcode) {
+        if (value == opcode && (best.empty() || mnemonic < best)) {
+            best = mnemonic;
+        }
+    }
+    return best;
+}
+
 void AssemblerEngine::init_opcode_table() {
     // Map mnemonics to opcodes based on DemiEngine CPU instruction set
     mnemonic_to_opcode["NOP"] = static_cast<uint8_t>(Opcode::NOP);
@@ -64,6 +75,12 @@ void AssemblerEngine::init_opcode_table() {
     mnemonic_to_opcode["DB"] = static_cast<uint8_t>(Opcode::DB);
     mnemonic_to_opcode["HALT"] = static_cast<uint8_t>(Opcode::HALT);
 
+    // Interrupt control
+    mnemonic_to_opcode["IRET"] = static_cast<uint8_t>(Opcode::IRET);
+    mnemonic_to_opcode["STI"] = static_cast<uint8_t>(Opcode::STI);
+    mnemonic_to_opcode["CLI"] = static_cast<uint8_t>(Opcode::CLI);
+    mnemonic_to_opcode["WAIT"] = static_cast<uint8_t>(Opcode::WAIT);
+
     // Extended operations
     mnemonic_to_opcode["ADD64"] = static_cast<uint8_t>(Opcode::ADD64);
     mnemonic_to_opcode["SUB64"] = static_cast<uint8_t>(Opcode::SUB64);
@@ -241,7 +258,9 @@ void AssemblerEngine::encode_instruction(const Instruction& instruction) {
     // Encode operands based on instruction type
     if (instruction.mnemonic == "NOP" || instruction.mnemonic == "HALT" ||
         instruction.mnemonic == "RET" || instruction.mnemonic == "PUSH_FLAG" ||
-        instruction.mnemonic == "POP_FLAG") {
+        instruction.mnemonic == "POP_FLAG" || instruction.mnemonic == "IRET" ||
+        instruction.mnemonic == "STI" || instruction.mnemonic == "CLI" ||
+        instruction.mnemonic == "WAIT") {
         // No operands
         return;
     }
@@ -494,7 +513,8 @@ void AssemblerEngine::emit_forward_ref(const std::string& symbol, size_t size, b
 size_t AssemblerEngine::get_instruction_size(const std::string& mnemonic, const std::vector<std::unique_ptr<Expression>>& /* operands */) {
     // Basic instruction size calculations for Demi Engine
     if (mnemonic == "NOP" || mnemonic == "HALT" || mnemonic == "RET" ||
-        mnemonic == "PUSH_FLAG" || mnemonic == "POP_FLAG") {
+        mnemonic == "PUSH_FLAG" || mnemonic == "POP_FLAG" || mnemonic == "IRET" ||
+        mnemonic == "STI" || mnemonic == "CLI" || mnemonic == "WAIT") {
         return 1;
     } else if (mnemonic == "LOAD_IMM") {
         return 3; // opcode + register + 1-byte immediate
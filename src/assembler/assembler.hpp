@@ -31,6 +31,9 @@ public:
     // Get symbol table for debugging
     const std::unordered_map<std::string, Symbol>& get_symbols() const { return symbol_table; }
 
+    // Reverse opcode lookup for disassembly (empty if the opcode has no mnemonic)
+    std::string mnemonic_for(uint8_t opcode) const;
+
 private:
     std::vector<std::string> errors;
     std::unordered_map<std::string, Symbol> symbol_table;
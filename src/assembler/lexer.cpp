@@ -78,6 +78,12 @@ void Lexer::init_tables() {
     mnemonics["OUTSTR"] = TokenType::MNEMONIC;
     mnemonics["DB"] = TokenType::MNEMONIC;
     mnemonics["HALT"] = TokenType::MNEMONIC;
+
+    // Interrupt control
+    mnemonics["IRET"] = TokenType::MNEMONIC;
+    mnemonics["STI"] = TokenType::MNEMONIC;
+    mnemonics["CLI"] = TokenType::MNEMONIC;
+    mnemonics["WAIT"] = TokenType::MNEMONIC;
     
     // Extended 64-bit operations
     mnemonics["ADD64"] = TokenType::MNEMONIC;
@@ -51,6 +51,11 @@ enum class Opcode : uint8_t {
     LEA = 0x20,         // Load Effective Address - load address into register
     SWAP = 0x21,        // Swap - swap values between register and memory
 
+    IRET = 0x29,        // Return from interrupt handler
+    STI  = 0x2A,        // Enable interrupts (after the next instruction)
+    CLI  = 0x2B,        // Disable interrupts
+    WAIT = 0x2C,        // Park until an interrupt is deliverable
+
     IN = 0x30,          // Input from port/device to register
     OUT = 0x31,         // Output from register to port/device
     INB = 0x32,         // Input byte from port/device to register
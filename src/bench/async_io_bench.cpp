@@ -0,0 +1,145 @@
+// Storage I/O benchmark: synchronous pread/pwrite vs the AsyncIo engines
+//
+// Usage: async_io_bench [file-size-MB] [block-KB] [queue-depth]
+// Runs against a temporary file in $TMPDIR (default /tmp) that is removed afterwards.
+
+#include "../engine/async_io.hpp"
+
+#include <fmt/format.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+    size_t fileBytes = 256ull << 20;
+    size_t blockBytes = 64 << 10;
+    unsigned depth = 16;
+};
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void report(const std::string& label, size_t bytes, double seconds) {
+    fmt::print("  {:<28} {:>9.1f} MB/s  ({:.3f}s)\n", label, bytes / seconds / (1 << 20), seconds);
+}
+
+double runSync(int fd, const Options& options, bool isWrite, std::vector<uint8_t>& buffer) {
+    auto start = Clock::now();
+    for (size_t offset = 0; offset < options.fileBytes; offset += options.blockBytes) {
+        ssize_t n = isWrite ? ::pwrite(fd, buffer.data(), options.blockBytes, static_cast<off_t>(offset))
+                            : ::pread(fd, buffer.data(), options.blockBytes, static_cast<off_t>(offset));
+        if (n != static_cast<ssize_t>(options.blockBytes)) {
+            fmt::print(stderr, "short transfer at offset {}\n", offset);
+            std::exit(1);
+        }
+    }
+    return secondsSince(start);
+}
+
+// Keeps `depth` requests in flight, each with its own buffer slot; a slot is
+// handed out again only after the request using it has completed
+double runAsync(vhw::AsyncIo& io, int fd, const Options& options, bool isWrite,
+                std::vector<uint8_t>& buffers) {
+    std::mutex mutex;
+    std::condition_variable slotFreed;
+    std::vector<unsigned> freeSlots;
+    for (unsigned i = 0; i < options.depth; ++i) {
+        freeSlots.push_back(i);
+    }
+    std::atomic<bool> failed{false};
+    size_t blocks = options.fileBytes / options.blockBytes;
+
+    auto start = Clock::now();
+    for (size_t block = 0; block < blocks; ++block) {
+        unsigned slot;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            slotFreed.wait(lock, [&] { return !freeSlots.empty(); });
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        auto done = [&, slot](bool ok) {
+            if (!ok) failed = true;
+            // Notify under the lock: once the last slot is back runAsync may return
+            std::lock_guard<std::mutex> lock(mutex);
+            freeSlots.push_back(slot);
+            slotFreed.notify_one();
+        };
+        uint8_t* buffer = buffers.data() + slot * options.blockBytes;
+        uint64_t offset = static_cast<uint64_t>(block) * options.blockBytes;
+        if (isWrite) {
+            io.submitWrite(fd, buffer, options.blockBytes, offset, done);
+        } else {
+            io.submitRead(fd, buffer, options.blockBytes, offset, done);
+        }
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        slotFreed.wait(lock, [&] { return freeSlots.size() == options.depth; });
+    }
+    double seconds = secondsSince(start);
+    if (failed) {
+        fmt::print(stderr, "{} transfer failed\n", io.name());
+        std::exit(1);
+    }
+    return seconds;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (argc > 1) options.fileBytes = std::strtoull(argv[1], nullptr, 10) << 20;
+    if (argc > 2) options.blockBytes = std::strtoull(argv[2], nullptr, 10) << 10;
+    if (argc > 3) options.depth = static_cast<unsigned>(std::strtoul(argv[3], nullptr, 10));
+    if (options.blockBytes == 0 || options.depth == 0 || options.fileBytes < options.blockBytes) {
+        fmt::print(stderr, "usage: {} [file-size-MB] [block-KB] [queue-depth]\n", argv[0]);
+        return 1;
+    }
+    options.fileBytes -= options.fileBytes % options.blockBytes;
+
+    const char* tmp = std::getenv("TMPDIR");
+    std::string path = std::string(tmp ? tmp : "/tmp") + "/demi-io-bench-XXXXXX";
+    int fd = ::mkstemp(path.data());
+    if (fd < 0) {
+        fmt::print(stderr, "cannot create temporary file in {}\n", tmp ? tmp : "/tmp");
+        return 1;
+    }
+    ::unlink(path.c_str());  // Removed as soon as the descriptor is closed
+
+    std::vector<uint8_t> buffers(options.blockBytes * options.depth, 0x5A);
+    auto uring = vhw::AsyncIo::create();
+    vhw::ThreadPoolIo pool;
+
+    fmt::print("{} MB file, {} KB blocks, queue depth {}, async engine: {}\n",
+               options.fileBytes >> 20, options.blockBytes >> 10, options.depth, uring->name());
+
+    fmt::print("write\n");
+    report("sync pwrite", options.fileBytes, runSync(fd, options, true, buffers));
+    report(fmt::format("async ({})", pool.name()), options.fileBytes, runAsync(pool, fd, options, true, buffers));
+    if (std::string(uring->name()) != pool.name()) {
+        report(fmt::format("async ({})", uring->name()), options.fileBytes, runAsync(*uring, fd, options, true, buffers));
+    }
+    fsync(fd);
+
+    fmt::print("read\n");
+    report("sync pread", options.fileBytes, runSync(fd, options, false, buffers));
+    report(fmt::format("async ({})", pool.name()), options.fileBytes, runAsync(pool, fd, options, false, buffers));
+    if (std::string(uring->name()) != pool.name()) {
+        report(fmt::format("async ({})", uring->name()), options.fileBytes, runAsync(*uring, fd, options, false, buffers));
+    }
+
+    ::close(fd);
+    return 0;
+}
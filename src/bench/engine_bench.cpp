@@ -0,0 +1,469 @@
+// Engine microbenchmarks: dispatch, opcode classes, registers, memory, port I/O,
+// serial latency and throughput, logger and assembler throughput
+//
+// Usage: engine_bench [--filter TEXT] [--repeat N] [--warmup N] [--out FILE]
+//                     [--baseline FILE] [--threshold PERCENT]
+//
+// Every benchmark runs `warmup` times unmeasured and then `repeat` times; the
+// median ns/op of the measured runs is reported (guest benchmarks also report
+// MIPS). Results go to stdout as JSON, or to --out. With --baseline, each
+// median is compared against a previous run's JSON and slowdowns beyond the
+// threshold (default 10%) are flagged; the exit status is then 2.
+
+#include "../assembler/assembler.hpp"
+#include "../assembler/lexer.hpp"
+#include "../assembler/parser.hpp"
+#include "../config.hpp"
+#include "../debug/logger.hpp"
+#include "../engine/cpu.hpp"
+#include "../engine/device_factory.hpp"
+#include "../engine/virtual_clock.hpp"
+
+#include <fmt/format.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+    std::string filter;
+    unsigned repeat = 7;
+    unsigned warmup = 2;
+    std::string out;
+    std::string baseline;
+    double threshold = 10.0;
+};
+
+struct Benchmark {
+    std::string name;
+    bool guest;                       // Ops are retired guest instructions; report MIPS
+    std::function<uint64_t()> run;    // Runs once, returns the number of ops performed
+};
+
+struct Result {
+    std::string name;
+    bool guest;
+    uint64_t ops;
+    double median;  // ns/op
+    double min;
+    double max;
+    double baseline = 0.0;
+    bool regressed = false;
+};
+
+// Guest registers used by the loop skeleton; R4/R5 are SP/FP and stay untouched
+constexpr uint8_t COUNTER = 0, OUTER = 7, ZERO = 6;
+constexpr uint8_t SCRATCH = 0xF8;  // Data address past the end of every program
+constexpr uint8_t INNER_ITERATIONS = 250;
+constexpr uint8_t OUTER_ITERATIONS = 40;
+
+/**
+ * Two nested counted loops around `body`, followed by HALT and `tail`
+ * (code reachable only through CALL). `body` receives its own start address
+ * and `tail`'s so it can encode jump and call targets.
+ */
+std::vector<uint8_t> loop_program(const std::function<std::vector<uint8_t>(uint8_t, uint8_t)>& body,
+                                  std::vector<uint8_t> tail = {}) {
+    std::vector<uint8_t> program = {
+        0x01, ZERO, 0x00,                  // LOAD_IMM zero, 0
+        0x01, 0x01, 0x05,                  // LOAD_IMM R1, 5
+        0x01, 0x02, 0x03,                  // LOAD_IMM R2, 3
+        0x01, 0x03, 0x01,                  // LOAD_IMM R3, 1
+        0x01, OUTER, OUTER_ITERATIONS,     // LOAD_IMM outer, n
+    };
+    uint8_t outer = static_cast<uint8_t>(program.size());
+    program.insert(program.end(), {0x01, COUNTER, INNER_ITERATIONS});  // outer: LOAD_IMM counter, n
+    uint8_t inner = static_cast<uint8_t>(program.size());
+
+    // The body's size doesn't depend on the addresses it is given
+    size_t body_size = body(0, 0).size();
+    uint8_t tail_start = static_cast<uint8_t>(inner + body_size + 15);
+    std::vector<uint8_t> code = body(inner, tail_start);
+    program.insert(program.end(), code.begin(), code.end());
+    program.insert(program.end(), {
+        0x13, COUNTER,                     // DEC counter
+        0x0A, COUNTER, ZERO,               // CMP counter, zero
+        0x0C, inner,                       // JNZ inner
+        0x13, OUTER,                       // DEC outer
+        0x0A, OUTER, ZERO,                 // CMP outer, zero
+        0x0C, outer,                       // JNZ outer
+        0xFF                               // HALT
+    });
+    program.insert(program.end(), tail.begin(), tail.end());
+    if (program.size() >= SCRATCH) {
+        fmt::print(stderr, "benchmark program overlaps the scratch address\n");
+        std::exit(1);
+    }
+    return program;
+}
+
+std::vector<uint8_t> repeated(std::vector<uint8_t> pattern, size_t times) {
+    std::vector<uint8_t> code;
+    for (size_t i = 0; i < times; ++i) {
+        code.insert(code.end(), pattern.begin(), pattern.end());
+    }
+    return code;
+}
+
+Benchmark guest(const std::string& name, std::vector<uint8_t> program) {
+    auto cpu = std::make_shared<CPU>();
+    return {name, true, [cpu, program]() {
+        cpu->reset();
+        auto& clock = vhw::VirtualClock::instance();
+        uint64_t start = clock.now();
+        cpu->execute(program);
+        return clock.now() - start;
+    }};
+}
+
+std::vector<Benchmark> guest_benchmarks() {
+    std::vector<Benchmark> benchmarks;
+    benchmarks.push_back(guest("dispatch.nop", loop_program([](uint8_t, uint8_t) {
+        return std::vector<uint8_t>(8, 0x00);                        // NOP x8
+    })));
+    benchmarks.push_back(guest("opcode.alu", loop_program([](uint8_t, uint8_t) {
+        return std::vector<uint8_t>{
+            0x02, 0x01, 0x02,  // ADD R1, R2
+            0x03, 0x01, 0x03,  // SUB R1, R3
+            0x14, 0x01, 0x02,  // AND R1, R2
+            0x15, 0x01, 0x03,  // OR R1, R3
+            0x16, 0x01, 0x02,  // XOR R1, R2
+            0x10, 0x01, 0x03,  // MUL R1, R3
+            0x18, 0x01, 0x01,  // SHL R1, 1
+            0x19, 0x01, 0x01,  // SHR R1, 1
+        };
+    })));
+    benchmarks.push_back(guest("opcode.mov", loop_program([](uint8_t, uint8_t) {
+        return repeated({0x04, 0x01, 0x02}, 8);                      // MOV R1, R2
+    })));
+    benchmarks.push_back(guest("opcode.branch", loop_program([](uint8_t at, uint8_t) {
+        std::vector<uint8_t> code = {0x0A, 0x01, 0x02};              // CMP R1, R2 (never equal)
+        for (int i = 0; i < 2; ++i) {
+            uint8_t next = static_cast<uint8_t>(at + code.size() + 2);
+            code.insert(code.end(), {0x0B, next});                   // JZ (not taken)
+            code.insert(code.end(), {0x0C, static_cast<uint8_t>(next + 2)});  // JNZ (taken)
+            code.insert(code.end(), {0x05, static_cast<uint8_t>(next + 4)});  // JMP
+        }
+        return code;
+    })));
+    benchmarks.push_back(guest("opcode.memory", loop_program([](uint8_t, uint8_t) {
+        return repeated({
+            0x07, 0x01, SCRATCH,                                     // STORE R1, scratch
+            0x06, 0x02, SCRATCH,                                     // LOAD R2, scratch
+        }, 4);
+    })));
+    benchmarks.push_back(guest("opcode.stack", loop_program([](uint8_t, uint8_t) {
+        return repeated({0x08, 0x01, 0x09, 0x02}, 4);               // PUSH R1; POP R2
+    })));
+    benchmarks.push_back(guest("opcode.call", loop_program([](uint8_t, uint8_t sub) {
+        return repeated({0x1A, sub}, 4);                             // CALL sub
+    }, {0x1B})));                                                    // sub: RET
+    benchmarks.push_back(guest("opcode.port_io", loop_program([](uint8_t, uint8_t) {
+        return repeated({
+            0x31, 0x01, 0x02,                                        // OUT R1, counter
+            0x30, 0x02, 0x02,                                        // IN R2, counter
+        }, 4);
+    })));
+    return benchmarks;
+}
+
+volatile uint64_t sink;  // Keeps host-side loops from being optimized away
+
+std::vector<Benchmark> host_benchmarks(const std::string& log_path) {
+    std::vector<Benchmark> benchmarks;
+
+    auto cpu = std::make_shared<CPU>();
+    benchmarks.push_back({"registers.get_set", false, [cpu]() {
+        constexpr uint64_t ROUNDS = 200000;
+        uint64_t sum = 0;
+        for (uint64_t i = 0; i < ROUNDS; ++i) {
+            Register reg = static_cast<Register>(i & 3);  // RAX..RBX, away from SP/FP
+            cpu->set_register(reg, cpu->get_register(reg) + i);
+            sum += cpu->get_register(reg);
+        }
+        sink = sum;
+        return ROUNDS * 3;
+    }});
+
+    benchmarks.push_back({"ports.write", false, []() {
+        constexpr uint64_t ROUNDS = 200000;
+        auto& devices = vhw::DeviceManager::instance();
+        for (uint64_t i = 0; i < ROUNDS; ++i) {
+            devices.writePort(0x02, static_cast<uint8_t>(i));
+        }
+        return ROUNDS;
+    }});
+    benchmarks.push_back({"ports.read", false, []() {
+        constexpr uint64_t ROUNDS = 200000;
+        auto& devices = vhw::DeviceManager::instance();
+        uint64_t sum = 0;
+        for (uint64_t i = 0; i < ROUNDS; ++i) {
+            sum += devices.readPort(0x02);
+        }
+        sink = sum;
+        return ROUNDS;
+    }});
+
+    // Host -> guest through a local pty pair: single bytes for the latency from
+    // the master's write to the guest seeing it, a stream for throughput
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    auto serial = master >= 0 && grantpt(master) == 0 && unlockpt(master) == 0
+        ? std::make_shared<vhw::SerialPortDevice>(ptsname(master)) : nullptr;
+    if (serial && serial->connect()) {
+        benchmarks.push_back({"serial.latency", false, [serial, master]() {
+            constexpr uint64_t ROUNDS = 200;
+            const char byte = 'a';
+            for (uint64_t i = 0; i < ROUNDS; ++i) {
+                if (::write(master, &byte, 1) != 1) {
+                    fmt::print(stderr, "serial benchmark: write to pty failed\n");
+                    std::exit(1);
+                }
+                while (serial->available() == 0) {
+                }
+                sink = serial->read();
+            }
+            return ROUNDS;
+        }});
+        benchmarks.push_back({"serial.throughput", false, [serial, master]() {
+            constexpr uint64_t BYTES = 256 * 1024;
+            constexpr size_t CHUNK = 1024;
+            const std::vector<char> chunk(CHUNK, 'a');
+            uint64_t sent = 0;
+            uint64_t received = 0;
+            while (received < BYTES) {
+                // Keep what is in flight within the RX ring so nothing is dropped
+                if (sent < BYTES && sent - received + CHUNK <= vhw::SerialPortDevice::RX_BUFFER_SIZE) {
+                    ssize_t n = ::write(master, chunk.data(), std::min<uint64_t>(CHUNK, BYTES - sent));
+                    if (n <= 0) {
+                        fmt::print(stderr, "serial benchmark: write to pty failed\n");
+                        std::exit(1);
+                    }
+                    sent += static_cast<uint64_t>(n);
+                }
+                while (serial->available() > 0) {
+                    sink = serial->read();
+                    ++received;
+                }
+            }
+            return BYTES;
+        }});
+    } else {
+        fmt::print(stderr, "no pty available, skipping serial benchmarks\n");
+    }
+
+    // The cost every handler pays for its debug line when debug is off
+    benchmarks.push_back({"logger.filtered", false, []() {
+        constexpr uint64_t ROUNDS = 100000;
+        for (uint64_t i = 0; i < ROUNDS; ++i) {
+            Logging::Logger::instance().debug() << fmt::format("[PC=0x{:04X}] [ADD] R{} = {}", i, i & 7, i) << std::endl;
+        }
+        return ROUNDS;
+    }});
+
+    // Lines that are written out; console output is discarded, the file is kept
+    auto written = [log_path](bool async) {
+        return [log_path, async]() {
+            constexpr uint64_t ROUNDS = 20000;
+            auto& logger = Logging::Logger::instance();
+            std::ostringstream discard;
+            auto* console = std::cout.rdbuf(discard.rdbuf());
+            Config::verbose = true;
+            logger.set_log_file(log_path);
+            logger.set_async(async);
+            for (uint64_t i = 0; i < ROUNDS; ++i) {
+                logger.info() << fmt::format("[PC=0x{:04X}] [ADD] R{} = {}", i, i & 7, i) << std::endl;
+            }
+            logger.set_async(false);  // Drains the writer thread
+            logger.flush();
+            Config::verbose = false;
+            std::cout.rdbuf(console);
+            return ROUNDS;
+        };
+    };
+    benchmarks.push_back({"logger.sync", false, written(false)});
+    benchmarks.push_back({"logger.async", false, written(true)});
+
+    // Ops are source lines taken through lexer, parser and code generator
+    std::string source;
+    uint64_t lines = 0;
+    for (int block = 0; block < 50; ++block) {
+        source += fmt::format("block{}:\n", block);
+        source += "    LOAD_IMM R0, 10\n    LOAD_IMM R1, 0\n";
+        source += fmt::format("loop{}:\n    DEC R0\n    ADD R2, R3\n    CMP R0, R1\n    JNZ loop{}\n", block, block);
+        lines += 8;
+    }
+    source += "    HALT\n";
+    ++lines;
+    benchmarks.push_back({"assembler.lines", false, [source, lines]() {
+        Assembler::Lexer lexer(source);
+        auto tokens = lexer.tokenize();
+        Assembler::Parser parser(tokens);
+        auto ast = parser.parse();
+        Assembler::AssemblerEngine assembler;
+        auto bytecode = assembler.assemble(*ast);
+        if (lexer.has_errors() || parser.has_errors() || assembler.has_errors() || bytecode.empty()) {
+            fmt::print(stderr, "assembler benchmark source failed to assemble\n");
+            std::exit(1);
+        }
+        return lines;
+    }});
+    return benchmarks;
+}
+
+Result measure(const Benchmark& benchmark, const Options& options) {
+    for (unsigned i = 0; i < options.warmup; ++i) {
+        benchmark.run();
+    }
+    std::vector<double> samples;
+    uint64_t ops = 0;
+    for (unsigned i = 0; i < options.repeat; ++i) {
+        auto start = Clock::now();
+        ops = benchmark.run();
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        samples.push_back(ns / static_cast<double>(std::max<uint64_t>(ops, 1)));
+    }
+    std::sort(samples.begin(), samples.end());
+    size_t mid = samples.size() / 2;
+    double median = samples.size() % 2 ? samples[mid] : (samples[mid - 1] + samples[mid]) / 2;
+    return {benchmark.name, benchmark.guest, ops, median, samples.front(), samples.back()};
+}
+
+// Reads the name -> median ns/op pairs of a previous run (one benchmark per line)
+std::map<std::string, double> load_baseline(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        fmt::print(stderr, "cannot read baseline {}\n", path);
+        std::exit(1);
+    }
+    std::map<std::string, double> baseline;
+    std::string line;
+    while (std::getline(in, line)) {
+        const std::string name_key = "\"name\": \"";
+        const std::string median_key = "\"ns_per_op\": ";
+        size_t name = line.find(name_key);
+        size_t median = line.find(median_key);
+        if (name == std::string::npos || median == std::string::npos) {
+            continue;
+        }
+        name += name_key.size();
+        baseline[line.substr(name, line.find('"', name) - name)] = std::strtod(line.c_str() + median + median_key.size(), nullptr);
+    }
+    return baseline;
+}
+
+void write_json(std::FILE* out, const std::vector<Result>& results, const Options& options) {
+    fmt::print(out, "{{\n  \"repeat\": {},\n  \"warmup\": {},\n", options.repeat, options.warmup);
+    if (!options.baseline.empty()) {
+        fmt::print(out, "  \"threshold_percent\": {},\n", options.threshold);
+    }
+    fmt::print(out, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::string extra = r.guest ? fmt::format(", \"mips\": {:.2f}", 1e3 / r.median) : "";
+        if (r.baseline > 0) {
+            extra += fmt::format(", \"baseline_ns_per_op\": {:.3f}, \"change_percent\": {:.1f}, \"regression\": {}",
+                r.baseline, (r.median / r.baseline - 1) * 100, r.regressed);
+        }
+        fmt::print(out, "    {{\"name\": \"{}\", \"ops\": {}, \"ns_per_op\": {:.3f}, \"min_ns_per_op\": {:.3f}, "
+            "\"max_ns_per_op\": {:.3f}{}}}{}\n",
+            r.name, r.ops, r.median, r.min, r.max, extra, i + 1 < results.size() ? "," : "");
+    }
+    fmt::print(out, "  ]\n}}\n");
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) {
+                return false;
+            }
+            std::string value = argv[++i];
+            if (arg == "--filter") options.filter = value;
+            else if (arg == "--repeat") options.repeat = static_cast<unsigned>(std::max(1ul, std::stoul(value)));
+            else if (arg == "--warmup") options.warmup = static_cast<unsigned>(std::stoul(value));
+            else if (arg == "--out") options.out = value;
+            else if (arg == "--baseline") options.baseline = value;
+            else if (arg == "--threshold") options.threshold = std::stod(value);
+            else return false;
+        }
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        fmt::print(stderr, "usage: engine_bench [--filter TEXT] [--repeat N] [--warmup N] [--out FILE] "
+            "[--baseline FILE] [--threshold PERCENT]\n");
+        return 1;
+    }
+    Config::debug_file = "";  // No debug.log; the logger benchmarks open their own file
+    std::map<std::string, double> baseline;
+    if (!options.baseline.empty()) {
+        baseline = load_baseline(options.baseline);
+    }
+
+    vhw::DeviceManager::instance().reset();
+    auto counter = vhw::DeviceFactory::createCounterDevice(0x02);
+    std::string log_path = (std::filesystem::temp_directory_path() / "engine_bench.log").string();
+
+    std::vector<Benchmark> benchmarks = guest_benchmarks();
+    for (Benchmark& benchmark : host_benchmarks(log_path)) {
+        benchmarks.push_back(std::move(benchmark));
+    }
+
+    std::vector<Result> results;
+    bool regressed = false;
+    for (const Benchmark& benchmark : benchmarks) {
+        if (benchmark.name.find(options.filter) == std::string::npos) {
+            continue;
+        }
+        Result result = measure(benchmark, options);
+        std::string rate = result.guest ? fmt::format("{:>8.2f} MIPS", 1e3 / result.median) : std::string(13, ' ');
+        std::string change;
+        auto it = baseline.find(result.name);
+        if (it != baseline.end() && it->second > 0) {
+            result.baseline = it->second;
+            double percent = (result.median / result.baseline - 1) * 100;
+            result.regressed = percent > options.threshold;
+            regressed |= result.regressed;
+            change = fmt::format("  {:+6.1f}%{}", percent, result.regressed ? "  REGRESSION" : "");
+        }
+        fmt::print(stderr, "  {:<20} {:>10.2f} ns/op {}{}\n", result.name, result.median, rate, change);
+        results.push_back(result);
+    }
+    std::remove(log_path.c_str());
+
+    if (options.out.empty()) {
+        write_json(stdout, results, options);
+    } else {
+        std::FILE* out = std::fopen(options.out.c_str(), "w");
+        if (!out) {
+            fmt::print(stderr, "cannot write {}\n", options.out);
+            return 1;
+        }
+        write_json(out, results, options);
+        std::fclose(out);
+    }
+    return regressed ? 2 : 0;
+}
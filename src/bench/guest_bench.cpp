@@ -0,0 +1,282 @@
+// Guest workload benchmark: runs assembly programs end to end under every
+// execution engine and reports instructions retired, wall time and MIPS
+//
+// Usage: guest_bench [--repeat N] [--json FILE] [--show-output] [program.asm ...]
+// Without programs, runs every .asm file in examples/bench. Guest console
+// output is captured and compared between engines; a mismatch is reported
+// and makes the exit status 2.
+
+#include "../assembler/assembler.hpp"
+#include "../assembler/lexer.hpp"
+#include "../assembler/parser.hpp"
+#include "../codegen/jit.hpp"
+#include "../config.hpp"
+#include "../engine/cpu.hpp"
+#include "../engine/device_factory.hpp"
+#include "../engine/virtual_clock.hpp"
+
+#include <fmt/format.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+    unsigned repeat = 5;
+    std::string json;
+    bool showOutput = false;
+    std::vector<std::string> programs;
+};
+
+struct Engine {
+    std::string name;
+    std::function<void(CPU&, const std::vector<uint8_t>&)> run;
+};
+
+struct Result {
+    std::string guest;
+    std::string engine;
+    uint64_t instructions;
+    double seconds;  // Median wall time of one run
+    bool outputMatches;
+};
+
+std::vector<Engine> engines() {
+    return {
+        {"interpreter", [](CPU& cpu, const std::vector<uint8_t>& program) {
+            cpu.execute(program);
+        }},
+        // Single-stepping ticks devices after every instruction, as the debugger and GUI do
+        {"step", [](CPU& cpu, const std::vector<uint8_t>& program) {
+            while (cpu.step(program)) {
+            }
+        }},
+        // Compile time is part of every run; "jit" tiers up hot blocks, "jit-eager" compiles all first
+        {"jit", [](CPU& cpu, const std::vector<uint8_t>& program) {
+            CodeGen::Jit jit(program, Config::jit_threshold);
+            cpu.set_jit(&jit);
+            cpu.execute(program);
+            cpu.set_jit(nullptr);
+        }},
+        {"jit-eager", [](CPU& cpu, const std::vector<uint8_t>& program) {
+            CodeGen::Jit jit(program, 0);
+            cpu.set_jit(&jit);
+            cpu.execute(program);
+            cpu.set_jit(nullptr);
+        }},
+    };
+}
+
+bool assemble(const std::string& path, std::vector<uint8_t>& bytecode) {
+    std::ifstream in(path);
+    if (!in) {
+        fmt::print(stderr, "{}: cannot open\n", path);
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    std::string source = buffer.str();  // The lexer keeps a reference
+
+    Assembler::Lexer lexer(source);
+    auto tokens = lexer.tokenize();
+    Assembler::Parser parser(tokens);
+    auto ast = parser.parse();
+    Assembler::AssemblerEngine assembler;
+    if (!lexer.has_errors() && !parser.has_errors()) {
+        bytecode = assembler.assemble(*ast);
+    }
+    if (lexer.has_errors() || parser.has_errors() || assembler.has_errors() || bytecode.empty()) {
+        fmt::print(stderr, "{}: does not assemble\n", path);
+        for (const auto* errors : {&lexer.get_errors(), &parser.get_errors(), &assembler.get_errors()}) {
+            for (const auto& error : *errors) {
+                fmt::print(stderr, "  {}\n", error);
+            }
+        }
+        return false;
+    }
+    if (bytecode.size() > 256) {
+        // Jump and call targets are one byte
+        fmt::print(stderr, "{}: {} bytes of code; programs must fit in 256\n", path, bytecode.size());
+        return false;
+    }
+    return true;
+}
+
+// Guest console output goes straight to fd 1; point that at a file while running
+class CapturedStdout {
+public:
+    CapturedStdout() : file(std::tmpfile()), saved(::dup(STDOUT_FILENO)) {
+        std::fflush(stdout);
+        ::dup2(::fileno(file), STDOUT_FILENO);
+    }
+
+    ~CapturedStdout() {
+        restore();
+        std::fclose(file);
+    }
+
+    std::string finish() {
+        restore();
+        std::string text;
+        std::rewind(file);
+        char buffer[4096];
+        size_t n;
+        while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            text.append(buffer, n);
+        }
+        return text;
+    }
+
+private:
+    void restore() {
+        if (saved >= 0) {
+            std::fflush(stdout);
+            ::dup2(saved, STDOUT_FILENO);
+            ::close(saved);
+            saved = -1;
+        }
+    }
+
+    std::FILE* file;
+    int saved;
+};
+
+Result measure(const std::string& guest, const Engine& engine, const std::vector<uint8_t>& program,
+               const Options& options, std::string& output) {
+    auto& clock = vhw::VirtualClock::instance();
+    auto& devices = vhw::DeviceManager::instance();
+    CPU cpu;
+    std::vector<double> samples;
+    uint64_t instructions = 0;
+
+    // One extra run up front warms caches and captures the output
+    for (unsigned i = 0; i <= options.repeat; ++i) {
+        cpu.reset();
+        CapturedStdout capture;
+        uint64_t start = clock.now();
+        auto began = Clock::now();
+        engine.run(cpu, program);
+        devices.flushAllDevices();
+        double seconds = std::chrono::duration<double>(Clock::now() - began).count();
+        instructions = (clock.now() - start) / vhw::VirtualClock::CYCLES_PER_INSTRUCTION;
+        std::string text = capture.finish();
+        if (i == 0) {
+            output = text;
+        } else {
+            samples.push_back(seconds);
+        }
+    }
+    std::sort(samples.begin(), samples.end());
+    return {guest, engine.name, instructions, samples[samples.size() / 2], true};
+}
+
+void write_json(const std::string& path, const std::vector<Result>& results, const Options& options) {
+    std::FILE* out = std::fopen(path.c_str(), "w");
+    if (!out) {
+        fmt::print(stderr, "cannot write {}\n", path);
+        return;
+    }
+    fmt::print(out, "{{\n  \"repeat\": {},\n  \"runs\": [\n", options.repeat);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        fmt::print(out, "    {{\"guest\": \"{}\", \"engine\": \"{}\", \"instructions\": {}, \"seconds\": {:.6f}, "
+            "\"mips\": {:.2f}, \"output_matches\": {}}}{}\n",
+            r.guest, r.engine, r.instructions, r.seconds, r.instructions / r.seconds / 1e6,
+            r.outputMatches, i + 1 < results.size() ? "," : "");
+    }
+    fmt::print(out, "  ]\n}}\n");
+    std::fclose(out);
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--show-output") {
+                options.showOutput = true;
+            } else if (arg == "--repeat" && i + 1 < argc) {
+                options.repeat = static_cast<unsigned>(std::max(1ul, std::stoul(argv[++i])));
+            } else if (arg == "--json" && i + 1 < argc) {
+                options.json = argv[++i];
+            } else if (arg.rfind("--", 0) == 0) {
+                return false;
+            } else {
+                options.programs.push_back(arg);
+            }
+        }
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        fmt::print(stderr, "usage: guest_bench [--repeat N] [--json FILE] [--show-output] [program.asm ...]\n");
+        return 1;
+    }
+    if (options.programs.empty()) {
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator("examples/bench", error)) {
+            if (entry.path().extension() == ".asm") {
+                options.programs.push_back(entry.path().string());
+            }
+        }
+        std::sort(options.programs.begin(), options.programs.end());
+        if (options.programs.empty()) {
+            fmt::print(stderr, "no programs given and none found in examples/bench\n");
+            return 1;
+        }
+    }
+
+    Config::debug_file = "";  // No debug.log
+    vhw::DeviceManager::instance().reset();
+    auto console = vhw::DeviceFactory::createConsoleDevice(0x01);
+
+    std::vector<Engine> available = engines();
+    std::vector<Result> results;
+    bool mismatch = false;
+    fmt::print("{:<12} {:<12} {:>12} {:>10} {:>9}\n", "guest", "engine", "instructions", "seconds", "MIPS");
+    for (const std::string& path : options.programs) {
+        std::vector<uint8_t> program;
+        if (!assemble(path, program)) {
+            return 1;
+        }
+        std::string guest = std::filesystem::path(path).stem().string();
+        std::string reference;
+        for (const Engine& engine : available) {
+            std::string output;
+            Result result = measure(guest, engine, program, options, output);
+            if (&engine == &available.front()) {
+                reference = output;  // The interpreter's output is the reference
+            }
+            result.outputMatches = output == reference;
+            mismatch |= !result.outputMatches;
+            fmt::print("{:<12} {:<12} {:>12} {:>10.4f} {:>9.2f}{}\n", result.guest, result.engine,
+                result.instructions, result.seconds, result.instructions / result.seconds / 1e6,
+                result.outputMatches ? "" : "  OUTPUT MISMATCH");
+            results.push_back(result);
+        }
+        if (options.showOutput) {
+            fmt::print("{}", reference);
+        }
+    }
+
+    if (!options.json.empty()) {
+        write_json(options.json, results, options);
+    }
+    return mismatch ? 2 : 0;
+}
@@ -0,0 +1,725 @@
+#include "aot_compiler.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <elf.h>
+#include <filesystem>
+#include <fstream>
+
+#include <fmt/core.h>
+
+namespace CodeGen {
+
+namespace {
+
+// Host registers the runtime keeps while it runs; all callee-saved, so
+// compiled code hands them back unchanged
+constexpr X86Register PC = X86Register::RBX;     // Guest pc
+constexpr X86Register DATA = X86Register::R12;   // RuntimeData
+constexpr X86Register TABLE = X86Register::R13;  // Handler address of every guest pc
+constexpr X86Register FAULT = X86Register::R14;  // Where a block that cannot start goes; scratch elsewhere
+constexpr X86Register VALUE = X86Register::R15;  // Port I/O in progress
+
+constexpr X86Register RAX = X86Register::RAX;
+constexpr X86Register RCX = X86Register::RCX;
+constexpr X86Register RDX = X86Register::RDX;
+constexpr X86Register RSI = X86Register::RSI;
+constexpr X86Register RDI = X86Register::RDI;
+
+constexpr int32_t SYS_WRITE = 1;
+constexpr int32_t SYS_EXIT_GROUP = 231;
+constexpr int32_t EINTR_RESULT = -4;
+
+constexpr int64_t FULL_BUDGET = INT64_MAX / 2;  // Compiled code never runs out in practice
+constexpr size_t OUTPUT_BUFFER = 4096;          // ConsoleDevice's default flush threshold
+constexpr size_t PAGE = 0x1000;
+
+// Everything writable, at DATA_BASE; guest memory follows
+struct RuntimeData {
+    JitState state;
+    int arg_offset;
+    uint32_t output_length;
+    uint32_t registers[DISAToX86Compiler::GUEST_REGISTERS];
+    uint64_t registers64[TOTAL_REGISTERS];
+    uint8_t counter;
+    uint8_t output[OUTPUT_BUFFER];
+};
+static_assert(offsetof(RuntimeData, state) == 0, "the runtime passes DATA as the JitState");
+static_assert(sizeof(void*) == sizeof(uint64_t), "RuntimeData is laid out as the target sees it");
+
+constexpr size_t MEMORY_OFFSET = (sizeof(RuntimeData) + 15) / 16 * 16;
+constexpr size_t HEADERS_SIZE = sizeof(Elf64_Ehdr) + 3 * sizeof(Elf64_Phdr);
+
+int32_t field(size_t offset) {
+    return static_cast<int32_t>(offset);
+}
+
+int32_t guest(uint8_t reg) {
+    return field(offsetof(RuntimeData, registers) + reg * sizeof(uint32_t));
+}
+
+size_t align(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool is_io(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::IN: case Opcode::OUT: case Opcode::INB: case Opcode::OUTB:
+        case Opcode::INW: case Opcode::OUTW: case Opcode::INL: case Opcode::OUTL:
+        case Opcode::INSTR: case Opcode::OUTSTR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// What the interpreter does when a compiled PUSH or POP cannot go on, the
+// runtime does too; the argument and flag forms are never compiled
+bool is_stack(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::PUSH: case Opcode::POP: case Opcode::PUSH_ARG: case Opcode::POP_ARG:
+        case Opcode::PUSH_FLAG: case Opcode::POP_FLAG:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// The opcode handlers check these against the eight legacy registers and skip
+// the instruction when an operand is past them; ADD, PUSH and POP do not check
+bool skips_extended(const std::vector<uint8_t>& program, uint32_t pc) {
+    auto extended = [&](size_t operand) { return program[pc + operand] >= DISAToX86Compiler::GUEST_REGISTERS; };
+    switch (static_cast<Opcode>(program[pc])) {
+        case Opcode::LOAD_IMM: case Opcode::LEA: case Opcode::LOAD: case Opcode::STORE: case Opcode::SWAP:
+        case Opcode::INC: case Opcode::DEC: case Opcode::NOT: case Opcode::SHL: case Opcode::SHR:
+            return extended(1);
+        case Opcode::MOV: case Opcode::SUB: case Opcode::MUL: case Opcode::DIV: case Opcode::CMP:
+        case Opcode::AND: case Opcode::OR: case Opcode::XOR:
+            return extended(1) || extended(2);
+        default:
+            return false;
+    }
+}
+
+int32_t slot(Register reg) {
+    return field(offsetof(RuntimeData, registers64) + static_cast<size_t>(reg) * sizeof(uint64_t));
+}
+
+// Ports an I/O instruction touches, as the CPU's port helpers split them
+unsigned port_width(Opcode opcode, uint8_t port) {
+    switch (opcode) {
+        case Opcode::INW: case Opcode::OUTW: return port > 254 ? 0 : 2;
+        case Opcode::INL: case Opcode::OUTL: return port > 252 ? 0 : 4;
+        default: return 1;
+    }
+}
+
+template <typename T>
+void put(std::vector<uint8_t>& image, size_t offset, const T& value) {
+    std::memcpy(image.data() + offset, &value, sizeof(value));
+}
+
+} // namespace
+
+std::vector<uint8_t> AotCompiler::compile(const std::vector<uint8_t>& program) {
+    auto began = std::chrono::steady_clock::now();
+    runtime_.clear();
+    messages_.clear();
+    warnings_.clear();
+    for (X86Encoder::Label* label : {&dispatch_, &run_block_, &halt_, &fail_, &flush_, &port_write_, &port_read_}) {
+        *label = runtime_.create_label();
+    }
+
+    DISAToX86Compiler compiler;
+    std::vector<uint8_t> blocks = compiler.compile_program(program);
+    std::vector<Handler> handlers = plan(program, compiler);
+
+    // Text: headers, compiled blocks, handler table, messages, runtime
+    size_t blocks_offset = align(HEADERS_SIZE, 16);
+    size_t table_offset = align(blocks_offset + blocks.size(), 4);
+    size_t messages_offset = table_offset + program.size() * sizeof(uint32_t);
+    size_t runtime_offset = align(messages_offset + messages_.size(), 16);
+    blocks_base_ = TEXT_BASE + blocks_offset;
+    table_base_ = TEXT_BASE + table_offset;
+    messages_base_ = TEXT_BASE + messages_offset;
+    runtime_base_ = TEXT_BASE + runtime_offset;
+
+    emit_runtime(static_cast<uint32_t>(program.size()));
+    std::vector<uint32_t> table(program.size());
+    for (uint32_t pc = 0; pc < program.size(); ++pc) {
+        const Handler& handler = handlers[pc];
+        if (handler.kind == HandlerKind::Halt) {
+            table[pc] = address(halt_);
+            continue;
+        }
+        uint32_t fallback = static_cast<uint32_t>(runtime_base_ + runtime_.size());
+        if (handler.kind == HandlerKind::Block) {
+            emit_fallback(program, pc, handler);
+        }
+        table[pc] = static_cast<uint32_t>(runtime_base_ + runtime_.size());
+        switch (handler.kind) {
+            case HandlerKind::Block:
+                runtime_.emit_mov_reg32_imm32(RSI, static_cast<uint32_t>(blocks_base_ + handler.block_offset));
+                runtime_.emit_mov_reg32_imm32(FAULT, fallback);
+                runtime_.emit_jmp_label(run_block_);
+                break;
+            case HandlerKind::Io: emit_io(program, pc); break;
+            case HandlerKind::Db: emit_db(program, pc); break;
+            case HandlerKind::Stack: emit_stack(program, pc); break;
+            case HandlerKind::Fault: emit_fallback(program, pc, handler); break;
+            case HandlerKind::Nop: emit_next(pc + static_cast<uint32_t>(instruction_length(program, pc))); break;
+            default: emit_stub(handler); break;
+        }
+    }
+
+    size_t text_size = runtime_offset + runtime_.size();
+    size_t data_offset = align(text_size, PAGE);
+    if (TEXT_BASE + data_offset > DATA_BASE) {
+        warnings_.push_back(fmt::format("{} bytes of code do not fit below the data segment", text_size));
+        return {};
+    }
+    std::vector<uint8_t> image(data_offset + MEMORY_OFFSET + program.size());
+
+    Elf64_Ehdr header{};
+    std::memcpy(header.e_ident, ELFMAG, SELFMAG);
+    header.e_ident[EI_CLASS] = ELFCLASS64;
+    header.e_ident[EI_DATA] = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+    header.e_type = ET_EXEC;
+    header.e_machine = EM_X86_64;
+    header.e_version = EV_CURRENT;
+    header.e_entry = runtime_base_;  // The runtime starts with _start
+    header.e_phoff = sizeof(Elf64_Ehdr);
+    header.e_ehsize = sizeof(Elf64_Ehdr);
+    header.e_phentsize = sizeof(Elf64_Phdr);
+    header.e_phnum = 3;
+    put(image, 0, header);
+
+    Elf64_Phdr text{};
+    text.p_type = PT_LOAD;
+    text.p_flags = PF_R | PF_X;
+    text.p_vaddr = text.p_paddr = TEXT_BASE;
+    text.p_filesz = text.p_memsz = text_size;
+    text.p_align = PAGE;
+    put(image, sizeof(Elf64_Ehdr), text);
+
+    Elf64_Phdr data{};
+    data.p_type = PT_LOAD;
+    data.p_flags = PF_R | PF_W;
+    data.p_offset = data_offset;
+    data.p_vaddr = data.p_paddr = DATA_BASE;
+    data.p_filesz = MEMORY_OFFSET + program.size();
+    data.p_memsz = MEMORY_OFFSET + MEMORY_SIZE;  // The rest of guest memory is zero-filled
+    data.p_align = PAGE;
+    put(image, sizeof(Elf64_Ehdr) + sizeof(Elf64_Phdr), data);
+
+    Elf64_Phdr stack{};
+    stack.p_type = PT_GNU_STACK;
+    stack.p_flags = PF_R | PF_W;
+    put(image, sizeof(Elf64_Ehdr) + 2 * sizeof(Elf64_Phdr), stack);
+
+    std::memcpy(image.data() + blocks_offset, blocks.data(), blocks.size());
+    std::memcpy(image.data() + table_offset, table.data(), table.size() * sizeof(uint32_t));
+    std::memcpy(image.data() + messages_offset, messages_.data(), messages_.size());
+    std::memcpy(image.data() + runtime_offset, runtime_.get_code().data(), runtime_.size());
+
+    // The state CPU::execute starts from: zeroed registers, SP and FP at the
+    // top of memory, the program at address 0
+    RuntimeData state{};
+    state.state.registers = reinterpret_cast<uint32_t*>(DATA_BASE + offsetof(RuntimeData, registers));
+    state.state.registers64 = reinterpret_cast<uint64_t*>(DATA_BASE + offsetof(RuntimeData, registers64));
+    state.state.memory = reinterpret_cast<uint8_t*>(DATA_BASE + MEMORY_OFFSET);
+    state.state.memory_size = MEMORY_SIZE;
+    state.state.arg_offset = reinterpret_cast<int*>(DATA_BASE + offsetof(RuntimeData, arg_offset));
+    state.registers64[static_cast<size_t>(Register::RSP)] = MEMORY_SIZE - 4;
+    state.registers64[static_cast<size_t>(Register::RBP)] = MEMORY_SIZE - 4;
+    state.counter = COUNTER_START;
+    put(image, data_offset, state);
+    std::memcpy(image.data() + data_offset + MEMORY_OFFSET, program.data(), program.size());
+
+    code_size_ = blocks.size() + runtime_.size();
+    image_size_ = image.size();
+    compile_seconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - began).count();
+    return image;
+}
+
+// Decide what every guest pc does. Jumps can land anywhere, so this covers
+// each byte, not just the instructions a linear sweep finds.
+std::vector<AotCompiler::Handler> AotCompiler::plan(const std::vector<uint8_t>& program,
+                                                    const DISAToX86Compiler& compiler) {
+    std::vector<Handler> handlers(program.size());
+    std::vector<bool> compiled(program.size(), false);
+    compiled_blocks_ = compiler.blocks().size();
+    compiled_instructions_ = 0;
+    for (const DISAToX86Compiler::Block& block : compiler.blocks()) {
+        for (uint32_t pc = block.start; pc < block.end; pc += static_cast<uint32_t>(instruction_length(program, pc))) {
+            compiled[pc] = true;
+        }
+        handlers[block.start].kind = HandlerKind::Block;
+        handlers[block.start].block_offset = block.offset;
+        compiled_instructions_ += block.instructions;
+    }
+
+    std::vector<bool> swept(program.size(), false);
+    program_instructions_ = 0;
+    for (size_t pc = 0; pc < program.size(); pc += instruction_length(program, pc)) {
+        swept[pc] = true;
+        ++program_instructions_;
+    }
+    runtime_instructions_ = 0;
+    unsupported_instructions_ = 0;
+
+    for (uint32_t pc = 0; pc < program.size(); ++pc) {
+        Handler& handler = handlers[pc];
+        Opcode opcode = static_cast<Opcode>(program[pc]);
+        std::string message;
+        if (compiled[pc]) {
+            // Compiled code only comes back here when the instruction cannot go on
+            switch (opcode) {
+                case Opcode::DIV:
+                    message = fmt::format("Error: division by zero at PC=0x{:04X}\n", pc);
+                    break;
+                case Opcode::CALL: case Opcode::RET:
+                    message = fmt::format("Error: stack access out of bounds at PC=0x{:04X}\n", pc);
+                    break;
+                default:
+                    message = fmt::format("Error: execution stopped at PC=0x{:04X}\n", pc);
+                    break;
+            }
+            if (handler.kind != HandlerKind::Block) {
+                handler.kind = HandlerKind::Fault;
+            }
+        } else {
+            // The interpreter stops at an instruction cut off by the end of the program
+            bool truncated = opcode == Opcode::DB ? pc + 2 >= program.size()
+                                                  : pc + instruction_length(program, pc) > program.size();
+            if (truncated || opcode == Opcode::HALT) {
+                handler.kind = HandlerKind::Halt;
+            } else if (is_io(opcode)) {
+                handler.kind = HandlerKind::Io;
+            } else if (opcode == Opcode::DB) {
+                handler.kind = HandlerKind::Db;
+            } else if (is_stack(opcode) && (instruction_length(program, pc) == 1
+                                            || program[pc + 1] < DISAToX86Compiler::GUEST_REGISTERS)) {
+                handler.kind = HandlerKind::Stack;
+            } else if (opcode == Opcode::NOP || opcode == Opcode::STI || opcode == Opcode::CLI) {
+                handler.kind = HandlerKind::Nop;  // Nothing raises interrupts here
+            } else if (skips_extended(program, pc)) {
+                handler.kind = HandlerKind::Nop;
+            } else {
+                handler.kind = HandlerKind::Unsupported;
+                message = fmt::format("Error: opcode 0x{:02X} at PC=0x{:04X} is not available in native builds\n",
+                    program[pc], pc);
+            }
+
+            if (swept[pc] && handler.kind == HandlerKind::Unsupported) {
+                ++unsupported_instructions_;
+                warnings_.push_back(fmt::format(
+                    "PC=0x{:04X}: opcode 0x{:02X} needs the engine; the executable stops with an error if it gets there",
+                    pc, program[pc]));
+            } else if (swept[pc]) {
+                ++runtime_instructions_;
+            }
+            if (swept[pc] && handler.kind == HandlerKind::Io && program[pc + 1] < DISAToX86Compiler::GUEST_REGISTERS) {
+                uint8_t port = program[pc + 2];
+                for (unsigned i = 0; i < port_width(opcode, port); ++i) {
+                    if (port + i != CONSOLE_PORT && port + i != COUNTER_PORT) {
+                        warnings_.push_back(fmt::format(
+                            "PC=0x{:04X}: port 0x{:02X} has no device in native builds; writes are dropped and reads return 0",
+                            pc, port + i));
+                    }
+                }
+            }
+        }
+        if (!message.empty()) {
+            handler.message = add_message(message);
+            handler.message_length = message.size();
+        }
+    }
+    return handlers;
+}
+
+size_t AotCompiler::add_message(const std::string& message) {
+    size_t offset = messages_.find(message);
+    if (offset == std::string::npos) {
+        offset = messages_.size();
+        messages_ += message;
+    }
+    return offset;
+}
+
+// _start, the dispatcher and the helpers handlers call
+void AotCompiler::emit_runtime(uint32_t program_size) {
+    X86Encoder& e = runtime_;
+
+    // _start: nothing from the kernel is needed but an aligned stack
+    e.emit_mov_reg_imm(DATA, DATA_BASE);
+    e.emit_mov_reg_imm(TABLE, table_base_);
+    e.emit_alu_reg32_reg32(AluOp::XOR, PC, PC);
+
+    // Like CPU::execute, run until pc leaves the program
+    e.bind_label(dispatch_);
+    e.emit_alu_reg32_imm32(AluOp::CMP, PC, static_cast<int32_t>(program_size));
+    e.emit_jcc_label(Condition::AE, halt_);
+    e.emit_mov_reg32_mem(RAX, MemOperand(TABLE, PC, 4));
+    e.emit_jmp_reg(RAX);
+
+    // Compiled block in ESI. A block that hands back its own pc with the
+    // budget untouched retired nothing: its first instruction failed.
+    X86Encoder::Label progressed = e.create_label();
+    e.bind_label(run_block_);
+    e.emit_mov_reg_imm64(RAX, static_cast<uint64_t>(FULL_BUDGET));
+    e.emit_mov_mem_reg(DATA, field(offsetof(JitState, budget)), RAX);
+    e.emit_mov_reg_reg(RDI, DATA);
+    e.emit_mov_reg32_imm32(RAX, static_cast<uint32_t>(blocks_base_));  // The entry trampoline
+    e.emit_call_reg(RAX);
+    e.emit_cmp_reg_reg(RAX, PC);
+    e.emit_jnz_label(progressed);
+    e.emit_mov_reg_imm64(RCX, static_cast<uint64_t>(FULL_BUDGET));
+    e.emit_alu_reg_mem(AluOp::CMP, RCX, DATA, field(offsetof(JitState, budget)));
+    e.emit_jnz_label(progressed);
+    e.emit_jmp_reg(FAULT);
+    e.bind_label(progressed);
+    e.emit_mov_reg32_reg32(PC, RAX);
+    e.emit_jmp_label(dispatch_);
+
+    e.bind_label(halt_);
+    e.emit_call_label(flush_);
+    e.emit_alu_reg32_reg32(AluOp::XOR, RDI, RDI);
+    e.emit_mov_reg32_imm32(RAX, SYS_EXIT_GROUP);
+    e.emit_syscall();
+
+    // Message in ESI, length in EDX
+    e.bind_label(fail_);
+    e.emit_mov_reg32_reg32(VALUE, RSI);
+    e.emit_mov_reg32_reg32(FAULT, RDX);
+    e.emit_call_label(flush_);
+    e.emit_mov_reg32_imm32(RAX, SYS_WRITE);
+    e.emit_mov_reg32_imm32(RDI, 2);
+    e.emit_mov_reg32_reg32(RSI, VALUE);
+    e.emit_mov_reg32_reg32(RDX, FAULT);
+    e.emit_syscall();
+    e.emit_mov_reg32_imm32(RDI, 1);
+    e.emit_mov_reg32_imm32(RAX, SYS_EXIT_GROUP);
+    e.emit_syscall();
+
+    // Write out buffered console output, retrying short and interrupted writes
+    X86Encoder::Label write = e.create_label();
+    X86Encoder::Label wrote = e.create_label();
+    X86Encoder::Label flushed = e.create_label();
+    e.bind_label(flush_);
+    e.emit_mov_reg32_mem(RDX, DATA, field(offsetof(RuntimeData, output_length)));
+    e.emit_test_reg32_reg32(RDX, RDX);
+    e.emit_jz_label(flushed);
+    e.emit_lea_reg_mem(RSI, MemOperand(DATA, field(offsetof(RuntimeData, output))));
+    e.bind_label(write);
+    e.emit_mov_reg32_imm32(RAX, SYS_WRITE);
+    e.emit_mov_reg32_imm32(RDI, 1);
+    e.emit_syscall();
+    e.emit_test_reg_reg(RAX, RAX);
+    e.emit_jcc_label(Condition::G, wrote);
+    e.emit_alu_reg_imm32(AluOp::CMP, RAX, EINTR_RESULT);
+    e.emit_jz_label(write);
+    e.emit_jmp_label(flushed);  // stdout is gone; nothing useful left to do
+    e.bind_label(wrote);
+    e.emit_add_reg_reg(RSI, RAX);
+    e.emit_sub_reg_reg(RDX, RAX);
+    e.emit_jnz_label(write);
+    e.bind_label(flushed);
+    e.emit_mov_mem_imm32(DATA, field(offsetof(RuntimeData, output_length)), 0);
+    e.emit_ret();
+
+    // Port in ESI, byte in EDI
+    X86Encoder::Label not_console = e.create_label();
+    X86Encoder::Label written = e.create_label();
+    e.bind_label(port_write_);
+    e.emit_alu_reg32_imm32(AluOp::CMP, RSI, CONSOLE_PORT);
+    e.emit_jnz_label(not_console);
+    e.emit_mov_reg32_mem(RCX, DATA, field(offsetof(RuntimeData, output_length)));
+    e.emit_mov_mem8_reg8(MemOperand(DATA, RCX, 1, field(offsetof(RuntimeData, output))), RDI);
+    e.emit_inc_reg32(RCX);
+    e.emit_mov_mem_reg32(DATA, field(offsetof(RuntimeData, output_length)), RCX);
+    e.emit_alu_reg32_imm32(AluOp::CMP, RDI, '\n');
+    e.emit_jz_label(flush_);
+    e.emit_alu_reg32_imm32(AluOp::CMP, RCX, static_cast<int32_t>(OUTPUT_BUFFER));
+    e.emit_jcc_label(Condition::AE, flush_);
+    e.emit_ret();
+    e.bind_label(not_console);
+    e.emit_alu_reg32_imm32(AluOp::CMP, RSI, COUNTER_PORT);
+    e.emit_jnz_label(written);
+    e.emit_movzx_reg32_mem8(RAX, DATA, field(offsetof(RuntimeData, counter)));
+    e.emit_add_reg_reg(RAX, RDI);
+    e.emit_mov_mem8_reg8(DATA, field(offsetof(RuntimeData, counter)), RAX);
+    e.bind_label(written);
+    e.emit_ret();
+
+    // Port in ESI, byte out in EAX. Nothing feeds the console's input in the
+    // engine either, so reading it only flushes output.
+    X86Encoder::Label not_console_read = e.create_label();
+    X86Encoder::Label read = e.create_label();
+    e.bind_label(port_read_);
+    e.emit_alu_reg32_imm32(AluOp::CMP, RSI, CONSOLE_PORT);
+    e.emit_jnz_label(not_console_read);
+    e.emit_call_label(flush_);
+    e.emit_alu_reg32_reg32(AluOp::XOR, RAX, RAX);
+    e.emit_ret();
+    e.bind_label(not_console_read);
+    e.emit_alu_reg32_reg32(AluOp::XOR, RAX, RAX);
+    e.emit_alu_reg32_imm32(AluOp::CMP, RSI, COUNTER_PORT);
+    e.emit_jnz_label(read);
+    e.emit_movzx_reg32_mem8(RAX, DATA, field(offsetof(RuntimeData, counter)));
+    e.bind_label(read);
+    e.emit_ret();
+}
+
+// Port I/O with the register and port known, following the opcode handlers
+// and the DeviceManager helpers they call
+void AotCompiler::emit_io(const std::vector<uint8_t>& program, uint32_t pc) {
+    X86Encoder& e = runtime_;
+    Opcode opcode = static_cast<Opcode>(program[pc]);
+    uint8_t reg = program[pc + 1];
+    uint8_t port = program[pc + 2];
+    unsigned width = port_width(opcode, port);
+    if (reg >= DISAToX86Compiler::GUEST_REGISTERS) {
+        emit_next(pc + 3);
+        return;
+    }
+    auto write_port = [&](uint8_t to) {
+        e.emit_mov_reg32_imm32(RSI, to);
+        e.emit_call_label(port_write_);
+    };
+    auto read_port = [&](uint8_t from) {
+        e.emit_mov_reg32_imm32(RSI, from);
+        e.emit_call_label(port_read_);
+    };
+    // VALUE's bytes to consecutive ports
+    auto write_bytes = [&]() {
+        for (unsigned i = 0; i < width; ++i) {
+            e.emit_mov_reg32_reg32(RDI, VALUE);
+            if (i) {
+                e.emit_shr_reg32_imm(RDI, static_cast<uint8_t>(8 * i));
+            }
+            e.emit_movzx_reg32_reg8(RDI, RDI);
+            write_port(static_cast<uint8_t>(port + i));
+        }
+    };
+    // Consecutive ports into VALUE's bytes, or 0 past the last port
+    auto read_bytes = [&]() {
+        e.emit_alu_reg32_reg32(AluOp::XOR, VALUE, VALUE);
+        for (unsigned i = 0; i < width; ++i) {
+            read_port(static_cast<uint8_t>(port + i));
+            if (i) {
+                e.emit_shl_reg32_imm(RAX, static_cast<uint8_t>(8 * i));
+            }
+            e.emit_alu_reg32_reg32(AluOp::OR, VALUE, RAX);
+        }
+    };
+    // VALUE's bytes to reg, reg + 1, ... while there are registers
+    auto store_bytes = [&](unsigned count) {
+        for (unsigned i = 0; i < count && reg + i < DISAToX86Compiler::GUEST_REGISTERS; ++i) {
+            e.emit_mov_reg32_reg32(RAX, VALUE);
+            if (i) {
+                e.emit_shr_reg32_imm(RAX, static_cast<uint8_t>(8 * i));
+            }
+            e.emit_movzx_reg32_reg8(RAX, RAX);
+            e.emit_mov_mem_reg32(DATA, guest(reg + i), RAX);
+        }
+    };
+
+    switch (opcode) {
+        case Opcode::OUT: case Opcode::OUTB:
+            e.emit_movzx_reg32_mem8(RDI, DATA, guest(reg));
+            write_port(port);
+            break;
+        case Opcode::OUTW: case Opcode::OUTL:
+            // The registers' values are ORed together at byte offsets, as uint32s
+            e.emit_mov_reg32_mem(VALUE, DATA, guest(reg));
+            for (unsigned i = 1; i < (opcode == Opcode::OUTW ? 2u : 4u) && reg + i < DISAToX86Compiler::GUEST_REGISTERS; ++i) {
+                e.emit_mov_reg32_mem(RAX, DATA, guest(reg + i));
+                e.emit_shl_reg32_imm(RAX, static_cast<uint8_t>(8 * i));
+                e.emit_alu_reg32_reg32(AluOp::OR, VALUE, RAX);
+            }
+            write_bytes();
+            break;
+        case Opcode::OUTSTR: {
+            // The string at the register's low byte, then its terminator
+            X86Encoder::Label next = e.create_label();
+            X86Encoder::Label end = e.create_label();
+            e.emit_movzx_reg32_mem8(VALUE, DATA, guest(reg));
+            e.bind_label(next);
+            e.emit_movzx_reg32_mem8(RDI, MemOperand(DATA, VALUE, 1, field(MEMORY_OFFSET)));
+            e.emit_test_reg32_reg32(RDI, RDI);
+            e.emit_jz_label(end);
+            write_port(port);
+            e.emit_inc_reg32(VALUE);
+            e.emit_alu_reg32_imm32(AluOp::CMP, VALUE, static_cast<int32_t>(MEMORY_SIZE));
+            e.emit_jcc_label(Condition::B, next);
+            e.bind_label(end);
+            e.emit_alu_reg32_reg32(AluOp::XOR, RDI, RDI);
+            write_port(port);
+            break;
+        }
+        case Opcode::IN: case Opcode::INB:
+            read_port(port);
+            e.emit_mov_mem_reg32(DATA, guest(reg), RAX);
+            break;
+        case Opcode::INW: case Opcode::INL:
+            read_bytes();
+            store_bytes(opcode == Opcode::INW ? 2 : 4);
+            break;
+        case Opcode::INSTR: {
+            // Up to the register's low byte of characters; the register gets the count
+            X86Encoder::Label next = e.create_label();
+            X86Encoder::Label end = e.create_label();
+            e.emit_movzx_reg32_mem8(FAULT, DATA, guest(reg));
+            e.emit_alu_reg32_reg32(AluOp::XOR, VALUE, VALUE);
+            e.bind_label(next);
+            e.emit_alu_reg32_reg32(AluOp::CMP, VALUE, FAULT);
+            e.emit_jcc_label(Condition::AE, end);
+            read_port(port);
+            e.emit_test_reg32_reg32(RAX, RAX);
+            e.emit_jz_label(end);
+            e.emit_inc_reg32(VALUE);
+            e.emit_jmp_label(next);
+            e.bind_label(end);
+            e.emit_mov_mem_reg32(DATA, guest(reg), VALUE);
+            break;
+        }
+        default:
+            break;
+    }
+    emit_next(pc + 3);
+}
+
+// DB copies bytes of the program, which never change, so they become immediates
+void AotCompiler::emit_db(const std::vector<uint8_t>& program, uint32_t pc) {
+    uint8_t target = program[pc + 1];
+    uint8_t length = program[pc + 2];
+    for (uint32_t i = 0; i < length && pc + 3 + i < program.size(); ++i) {
+        runtime_.emit_mov_reg32_imm32(RAX, program[pc + 3 + i]);
+        runtime_.emit_mov_mem8_reg8(DATA, field(MEMORY_OFFSET + target + i), RAX);
+    }
+    emit_next(pc + 3 + length);
+}
+
+// PUSH, POP and their argument and flag forms as the opcode handlers run
+// them: out of bounds, reads give 0 and writes are dropped
+void AotCompiler::emit_stack(const std::vector<uint8_t>& program, uint32_t pc) {
+    X86Encoder& e = runtime_;
+    Opcode opcode = static_cast<Opcode>(program[pc]);
+    uint8_t reg = program[pc + 1];
+    MemOperand stack_top(DATA, RCX, 1, field(MEMORY_OFFSET));
+    // Address in ECX
+    auto read = [&](X86Register dst) {
+        X86Encoder::Label outside = e.create_label();
+        e.emit_alu_reg32_reg32(AluOp::XOR, dst, dst);
+        e.emit_alu_reg32_imm32(AluOp::CMP, RCX, static_cast<int32_t>(MEMORY_SIZE - 4));
+        e.emit_jcc_label(Condition::A, outside);
+        e.emit_mov_reg32_mem(dst, stack_top);
+        e.bind_label(outside);
+    };
+    auto write = [&](X86Register src) {
+        X86Encoder::Label outside = e.create_label();
+        e.emit_alu_reg32_imm32(AluOp::CMP, RCX, static_cast<int32_t>(MEMORY_SIZE - 4));
+        e.emit_jcc_label(Condition::A, outside);
+        e.emit_mov_mem_reg32(stack_top, src);
+        e.bind_label(outside);
+    };
+    auto push = [&](int32_t value) {
+        e.emit_mov_reg32_mem(RCX, DATA, slot(Register::RSP));
+        e.emit_alu_reg32_imm32(AluOp::SUB, RCX, 4);
+        e.emit_mov_mem_reg(DATA, slot(Register::RSP), RCX);
+        e.emit_mov_reg32_mem(RAX, DATA, value);
+        write(RAX);
+    };
+    auto pop = [&](int32_t into, bool wide) {
+        e.emit_mov_reg32_mem(RCX, DATA, slot(Register::RSP));
+        read(RAX);
+        if (wide) {
+            e.emit_mov_mem_reg(DATA, into, RAX);
+        } else {
+            e.emit_mov_mem_reg32(DATA, into, RAX);
+        }
+        e.emit_alu_reg32_imm32(AluOp::ADD, RCX, 4);
+        e.emit_mov_mem_reg(DATA, slot(Register::RSP), RCX);
+    };
+
+    switch (opcode) {
+        case Opcode::PUSH: case Opcode::PUSH_ARG: push(guest(reg)); break;
+        case Opcode::PUSH_FLAG: push(slot(Register::RFLAGS)); break;
+        case Opcode::POP: pop(guest(reg), false); break;
+        case Opcode::POP_FLAG: pop(slot(Register::RFLAGS), true); break;
+        case Opcode::POP_ARG: {
+            // Inside a call (CALL sets the offset) arguments come from the frame
+            X86Encoder::Label outside_call = e.create_label();
+            X86Encoder::Label done = e.create_label();
+            int32_t arg_offset = field(offsetof(RuntimeData, arg_offset));
+            e.emit_mov_reg32_mem(RDX, DATA, arg_offset);
+            e.emit_test_reg32_reg32(RDX, RDX);
+            e.emit_jcc_label(Condition::LE, outside_call);
+            e.emit_mov_reg32_mem(RCX, DATA, slot(Register::RBP));
+            e.emit_alu_reg32_reg32(AluOp::ADD, RCX, RDX);
+            read(RAX);
+            e.emit_mov_mem_reg32(DATA, guest(reg), RAX);
+            e.emit_alu_reg32_imm32(AluOp::ADD, RDX, 4);
+            e.emit_mov_mem_reg32(DATA, arg_offset, RDX);
+            e.emit_jmp_label(done);
+            e.bind_label(outside_call);
+            pop(guest(reg), false);
+            e.bind_label(done);
+            break;
+        }
+        default:
+            break;
+    }
+    emit_next(pc + static_cast<uint32_t>(instruction_length(program, pc)));
+}
+
+// Where compiled code goes when the instruction at pc cannot go on
+void AotCompiler::emit_fallback(const std::vector<uint8_t>& program, uint32_t pc, const Handler& handler) {
+    if (is_stack(static_cast<Opcode>(program[pc]))) {
+        emit_stack(program, pc);
+    } else {
+        emit_stub(handler);
+    }
+}
+
+void AotCompiler::emit_stub(const Handler& handler) {
+    runtime_.emit_mov_reg32_imm32(RSI, static_cast<uint32_t>(messages_base_ + handler.message));
+    runtime_.emit_mov_reg32_imm32(RDX, static_cast<uint32_t>(handler.message_length));
+    runtime_.emit_jmp_label(fail_);
+}
+
+void AotCompiler::emit_next(uint32_t pc) {
+    runtime_.emit_mov_reg32_imm32(PC, pc);
+    runtime_.emit_jmp_label(dispatch_);
+}
+
+uint32_t AotCompiler::address(const X86Encoder::Label& label) const {
+    return static_cast<uint32_t>(runtime_base_ + label.position);
+}
+
+bool AotCompiler::write_executable(const std::string& path, const std::vector<uint8_t>& image) {
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size()))) {
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::permissions(path,
+        std::filesystem::perms::owner_exec | std::filesystem::perms::group_exec | std::filesystem::perms::others_exec,
+        std::filesystem::perm_options::add, error);
+    return !error;
+}
+
+void AotCompiler::write_stats(std::ostream& out) const {
+    out << fmt::format("Native build: {} of {} instructions compiled in {} blocks, {} run by the runtime, {} unsupported\n",
+        compiled_instructions_, program_instructions_, compiled_blocks_, runtime_instructions_, unsupported_instructions_);
+    out << fmt::format("  {} bytes of code, {} byte image, built in {:.3f} ms\n",
+        code_size_, image_size_, compile_seconds_ * 1e3);
+}
+
+} // namespace CodeGen
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "disa_compiler.hpp"
+#include "x86_encoder.hpp"
+
+namespace CodeGen {
+
+/**
+ * @brief Ahead-of-time compiler: a program as a standalone x86-64 Linux executable
+ *
+ * Every block DISAToX86Compiler understands becomes native code, exactly as
+ * the JIT compiles it with a threshold of 0. Around it goes a small runtime
+ * written straight to machine code: a dispatcher that looks the guest pc up
+ * in a table of handlers, and handlers for what compiled code hands back
+ * (port I/O, DB, HALT, the argument and flag stack operations, and
+ * instructions that cannot go on natively). The result is a static
+ * ELF with no interpreter, no libc and no host compiler involved; it talks to
+ * the kernel through system calls.
+ *
+ * The runtime carries the devices a program can reach without the engine:
+ * the console on port 0x01, buffered and flushed on newline, at 4 KiB, on
+ * input and at exit like ConsoleDevice, and the counter on port 0x02
+ * starting at 42 as initialize_devices() sets it up. Other ports behave as
+ * unregistered ones do in the engine (writes are dropped, reads return 0),
+ * and instructions that need the engine's machinery (interrupts, WAIT, the
+ * extended register set) exit with an error if they are reached. Both are
+ * reported as warnings when compiling. Instructions naming a register past
+ * R7 are skipped wherever the opcode handlers skip them.
+ */
+class AotCompiler {
+public:
+    static constexpr uint64_t TEXT_BASE = 0x400000;     ///< Headers, code, handler table and messages
+    static constexpr uint64_t DATA_BASE = 0x10000000;   ///< Guest state, device state and guest memory
+    static constexpr uint64_t MEMORY_SIZE = 1024 * 1024;  ///< The CPU's default
+    static constexpr uint8_t CONSOLE_PORT = 0x01;
+    static constexpr uint8_t COUNTER_PORT = 0x02;
+    static constexpr uint8_t COUNTER_START = 42;
+
+    /**
+     * @brief Translate a program into an ELF executable image
+     * @return The file contents; empty if the program cannot be laid out
+     */
+    std::vector<uint8_t> compile(const std::vector<uint8_t>& program);
+
+    /**
+     * @brief Write an image and make it executable
+     */
+    static bool write_executable(const std::string& path, const std::vector<uint8_t>& image);
+
+    // Things in the program the native build handles differently from the engine
+    const std::vector<std::string>& warnings() const { return warnings_; }
+
+    void write_stats(std::ostream& out) const;
+
+private:
+    // What runs when the dispatcher reaches a guest pc
+    enum class HandlerKind { Block, Fault, Io, Db, Stack, Nop, Halt, Unsupported };
+
+    struct Handler {
+        HandlerKind kind = HandlerKind::Unsupported;
+        size_t block_offset = 0;  ///< Compiled code of the block (Block)
+        size_t message = 0;       ///< Offset into messages_ (Block, Fault, Unsupported)
+        size_t message_length = 0;
+    };
+
+    X86Encoder runtime_;
+    uint64_t runtime_base_ = 0;  // Addresses of what the runtime refers to
+    uint64_t blocks_base_ = 0;
+    uint64_t table_base_ = 0;
+    uint64_t messages_base_ = 0;
+    std::string messages_;
+    std::vector<std::string> warnings_;
+
+    // Runtime entry points, bound while emitting it
+    X86Encoder::Label dispatch_;
+    X86Encoder::Label run_block_;
+    X86Encoder::Label halt_;
+    X86Encoder::Label fail_;
+    X86Encoder::Label flush_;
+    X86Encoder::Label port_write_;
+    X86Encoder::Label port_read_;
+
+    // Statistics
+    size_t program_instructions_ = 0;
+    size_t compiled_blocks_ = 0;
+    size_t compiled_instructions_ = 0;
+    size_t runtime_instructions_ = 0;
+    size_t unsupported_instructions_ = 0;
+    size_t code_size_ = 0;
+    size_t image_size_ = 0;
+    double compile_seconds_ = 0.0;
+
+    std::vector<Handler> plan(const std::vector<uint8_t>& program, const DISAToX86Compiler& compiler);
+    size_t add_message(const std::string& message);
+
+    void emit_runtime(uint32_t program_size);
+    void emit_io(const std::vector<uint8_t>& program, uint32_t pc);
+    void emit_db(const std::vector<uint8_t>& program, uint32_t pc);
+    void emit_stack(const std::vector<uint8_t>& program, uint32_t pc);
+    void emit_fallback(const std::vector<uint8_t>& program, uint32_t pc, const Handler& handler);
+    void emit_stub(const Handler& handler);
+    void emit_next(uint32_t pc);
+    uint32_t address(const X86Encoder::Label& label) const;
+};
+
+} // namespace CodeGen
@@ -0,0 +1,680 @@
+#include "disa_compiler.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <set>
+
+#include <fmt/core.h>
+
+#include "../engine/cpu_flags.hpp"
+
+namespace CodeGen {
+
+namespace {
+
+// Host registers pinned while compiled code runs; all callee-saved, so the
+// entry trampoline saves them and nothing else has to
+constexpr X86Register STATE = X86Register::RBX;        // JitState*
+constexpr X86Register REGISTERS64 = X86Register::RBP;  // Full register file
+constexpr X86Register GUEST = X86Register::R12;        // R0-R7
+constexpr X86Register MEMORY = X86Register::R13;       // Guest memory
+constexpr X86Register BUDGET = X86Register::R14;       // Instructions left
+constexpr X86Register FLAGS = X86Register::R15;        // Guest FLAGS
+constexpr X86Register SAVED[] = {STATE, REGISTERS64, GUEST, MEMORY, BUDGET, FLAGS};
+
+// Scratch: RAX, RCX and RDX. Everything else left over holds guest registers.
+constexpr X86Register RAX = X86Register::RAX;
+constexpr X86Register RCX = X86Register::RCX;
+constexpr X86Register RDX = X86Register::RDX;
+constexpr X86Register RSI = X86Register::RSI;
+constexpr X86Register RDI = X86Register::RDI;
+const std::vector<X86Register> ALLOCATABLE = {
+    X86Register::RSI, X86Register::RDI, X86Register::R8, X86Register::R9, X86Register::R10, X86Register::R11
+};
+
+int32_t guest(uint8_t reg) {
+    return reg * static_cast<int32_t>(sizeof(uint32_t));
+}
+
+int32_t slot(Register reg) {
+    return static_cast<int32_t>(reg) * static_cast<int32_t>(sizeof(uint64_t));
+}
+
+int32_t field(size_t offset) {
+    return static_cast<int32_t>(offset);
+}
+
+uint8_t bit_index(uint32_t flag) {
+    uint8_t index = 0;
+    while (!(flag & 1)) {
+        flag >>= 1;
+        ++index;
+    }
+    return index;
+}
+
+// Guest registers an instruction reads and writes
+void register_operands(const std::vector<uint8_t>& program, size_t pc, RegisterAllocator::Instruction& instruction) {
+    uint8_t a = program[pc + 1 < program.size() ? pc + 1 : pc];
+    uint8_t b = program[pc + 2 < program.size() ? pc + 2 : pc];
+    switch (static_cast<Opcode>(program[pc])) {
+        case Opcode::LOAD_IMM: case Opcode::LEA: case Opcode::LOAD: case Opcode::POP:
+            instruction.defs = {a};
+            break;
+        case Opcode::MOV:
+            instruction.uses = {b};
+            instruction.defs = {a};
+            break;
+        case Opcode::ADD: case Opcode::SUB: case Opcode::MUL: case Opcode::DIV:
+        case Opcode::AND: case Opcode::OR: case Opcode::XOR:
+            instruction.uses = {a, b};
+            instruction.defs = {a};
+            break;
+        case Opcode::INC: case Opcode::DEC: case Opcode::NOT:
+        case Opcode::SHL: case Opcode::SHR: case Opcode::SWAP:
+            instruction.uses = {a};
+            instruction.defs = {a};
+            break;
+        case Opcode::CMP:
+            instruction.uses = {a, b};
+            break;
+        case Opcode::STORE: case Opcode::PUSH:
+            instruction.uses = {a};
+            break;
+        default:
+            break;
+    }
+}
+
+} // namespace
+
+DISAToX86Compiler::DISAToX86Compiler() : allocator(ALLOCATABLE, GUEST_REGISTERS) {}
+
+bool DISAToX86Compiler::is_supported(const std::vector<uint8_t>& program, size_t pc) {
+    Opcode opcode = static_cast<Opcode>(program[pc]);
+    size_t length = instruction_length(program, pc);
+    if (pc + length > program.size()) {
+        return false;
+    }
+    auto reg = [&](size_t operand) { return program[pc + operand] < GUEST_REGISTERS; };
+    switch (opcode) {
+        case Opcode::NOP:
+        case Opcode::RET:
+            return true;
+        case Opcode::LOAD_IMM: case Opcode::LEA:
+        case Opcode::LOAD: case Opcode::STORE: case Opcode::SWAP:
+        case Opcode::INC: case Opcode::DEC: case Opcode::NOT:
+        case Opcode::PUSH: case Opcode::POP:
+            return reg(1);
+        case Opcode::MOV: case Opcode::ADD: case Opcode::SUB: case Opcode::MUL: case Opcode::DIV:
+        case Opcode::AND: case Opcode::OR: case Opcode::XOR: case Opcode::CMP:
+            return reg(1) && reg(2);
+        case Opcode::SHL: case Opcode::SHR:
+            return reg(1) && program[pc + 2] < 32;  // Wider shifts are undefined in the interpreter
+        case Opcode::CALL:
+            return true;
+        default:
+            // The interpreter reports jumps out of the program
+            return is_jump(opcode) && program[pc + 1] < program.size();
+    }
+}
+
+std::vector<uint8_t> DISAToX86Compiler::compile_program(const std::vector<uint8_t>& disa_bytecode) {
+    scan_for_jump_targets(disa_bytecode);
+    compiled_blocks = program_blocks;
+    return compile_blocks(disa_bytecode);
+}
+
+std::vector<uint8_t> DISAToX86Compiler::compile_program(const std::vector<uint8_t>& disa_bytecode,
+                                                        const std::set<uint32_t>& hot) {
+    scan_for_jump_targets(disa_bytecode);
+    compiled_blocks.clear();
+    for (const Block& block : program_blocks) {
+        if (hot.count(block.start)) {
+            compiled_blocks.push_back(block);
+        }
+    }
+    return compile_blocks(disa_bytecode);
+}
+
+std::vector<uint8_t> DISAToX86Compiler::compile_blocks(const std::vector<uint8_t>& disa_bytecode) {
+    encoder.clear();
+    jump_targets.clear();
+    exit_stubs.clear();
+    exit_label = encoder.create_label();
+    current_program = &disa_bytecode;
+    for (const Block& block : compiled_blocks) {
+        get_or_create_label(block.start);
+    }
+    allocate_registers();
+
+    emit_entry();
+    emit_exit();
+    current_position = 0;
+    for (size_t i = 0; i < compiled_blocks.size(); ++i) {
+        bool falls_into_next = i + 1 < compiled_blocks.size()
+            && compiled_blocks[i + 1].start == compiled_blocks[i].end;
+        compile_block(compiled_blocks[i], falls_into_next);
+    }
+    emit_block_entries();
+    emit_exit_stubs();
+    current_program = nullptr;
+    return encoder.get_code();
+}
+
+// Cut the program into blocks: at address 0, at jump and call targets, after
+// control transfers, around instructions that stay with the interpreter and
+// every MAX_BLOCK_INSTRUCTIONS. Backward jumps mark loops.
+void DISAToX86Compiler::scan_for_jump_targets(const std::vector<uint8_t>& bytecode) {
+    // The same blocks the block profiler reports, also cut after instructions
+    // that stay with the interpreter
+    ControlFlow flow = scan_control_flow(bytecode);
+    for (uint32_t pc : flow.starts) {
+        if (!is_supported(bytecode, pc)) {
+            flow.leaders.insert(pc + static_cast<uint32_t>(instruction_length(bytecode, pc)));
+        }
+    }
+    program_instructions = flow.starts.size();
+
+    program_blocks.clear();
+    Block* block = nullptr;
+    for (uint32_t pc : flow.starts) {
+        if (!is_supported(bytecode, pc)) {
+            block = nullptr;
+            continue;
+        }
+        if (!block || flow.leaders.count(pc) || block->instructions == MAX_BLOCK_INSTRUCTIONS) {
+            program_blocks.push_back({pc, pc, 0, 0});
+            block = &program_blocks.back();
+        }
+        block->end = pc + static_cast<uint32_t>(instruction_length(bytecode, pc));
+        ++block->instructions;
+    }
+
+    program_loops.clear();
+    for (const auto& [header, end] : flow.loop_ends) {
+        program_loops.push_back({header, end});
+    }
+}
+
+// Describe the compiled blocks to the allocator as one region: control moves
+// between positions by falling through and by branches to compiled blocks;
+// anything else leaves the region
+void DISAToX86Compiler::allocate_registers() {
+    const std::vector<uint8_t>& program = *current_program;
+    std::vector<RegisterAllocator::Instruction> region;
+    block_positions.clear();
+    for (const Block& block : compiled_blocks) {
+        block_positions[block.start] = static_cast<uint32_t>(region.size());
+        for (uint32_t pc = block.start; pc < block.end; pc += static_cast<uint32_t>(instruction_length(program, pc))) {
+            region.emplace_back();
+            register_operands(program, pc, region.back());
+        }
+    }
+
+    auto edge = [&](RegisterAllocator::Instruction& instruction, uint32_t target) {
+        auto position = block_positions.find(target);
+        if (position != block_positions.end()) {
+            instruction.successors.push_back(position->second);
+        }
+    };
+    uint32_t position = 0;
+    for (const Block& block : compiled_blocks) {
+        for (uint32_t pc = block.start; pc < block.end; ++position) {
+            RegisterAllocator::Instruction& instruction = region[position];
+            Opcode opcode = static_cast<Opcode>(program[pc]);
+            uint32_t next = pc + static_cast<uint32_t>(instruction_length(program, pc));
+            if (opcode == Opcode::JMP || opcode == Opcode::CALL) {
+                edge(instruction, program[pc + 1]);
+            } else if (is_jump(opcode)) {
+                edge(instruction, program[pc + 1]);
+                edge(instruction, next);
+            } else if (opcode != Opcode::RET) {
+                if (next < block.end) {
+                    instruction.successors.push_back(position + 1);
+                } else {
+                    edge(instruction, next);
+                }
+            }
+            pc = next;
+        }
+    }
+    allocator.allocate(region);
+}
+
+X86Encoder::Label& DISAToX86Compiler::get_or_create_label(uint32_t bytecode_address) {
+    auto it = jump_targets.find(bytecode_address);
+    if (it == jump_targets.end()) {
+        it = jump_targets.emplace(bytecode_address, encoder.create_label()).first;
+    }
+    return it->second;
+}
+
+// A compiled block's label, or a stub that hands pc to the dispatcher
+X86Encoder::Label& DISAToX86Compiler::branch_to(uint32_t pc) {
+    auto target = jump_targets.find(pc);
+    return target != jump_targets.end() ? target->second : exit_to(pc, 0);
+}
+
+// A stub that gives back refund instructions of budget and hands pc to the dispatcher
+X86Encoder::Label& DISAToX86Compiler::exit_to(uint32_t pc, uint32_t refund) {
+    auto it = exit_stubs.find({pc, refund});
+    if (it == exit_stubs.end()) {
+        it = exit_stubs.emplace(std::make_pair(pc, refund), encoder.create_label()).first;
+    }
+    return it->second;
+}
+
+// uint32_t entry(JitState* state (RDI), const void* block (RSI))
+void DISAToX86Compiler::emit_entry() {
+    for (X86Register reg : SAVED) {
+        encoder.emit_push_reg(reg);
+    }
+    encoder.emit_mov_reg_reg(STATE, RDI);
+    encoder.emit_mov_reg_mem(REGISTERS64, STATE, field(offsetof(JitState, registers64)));
+    encoder.emit_mov_reg_mem(GUEST, STATE, field(offsetof(JitState, registers)));
+    encoder.emit_mov_reg_mem(MEMORY, STATE, field(offsetof(JitState, memory)));
+    encoder.emit_mov_reg_mem(BUDGET, STATE, field(offsetof(JitState, budget)));
+    encoder.emit_mov_reg32_mem(FLAGS, REGISTERS64, slot(Register::RFLAGS));
+    encoder.emit_jmp_reg(RSI);
+}
+
+// Guest pc in EAX
+void DISAToX86Compiler::emit_exit() {
+    encoder.bind_label(exit_label);
+    encoder.emit_mov_mem_reg(STATE, field(offsetof(JitState, budget)), BUDGET);
+    encoder.emit_mov_mem_reg(REGISTERS64, slot(Register::RFLAGS), FLAGS);
+    for (size_t i = std::size(SAVED); i-- > 0;) {
+        encoder.emit_pop_reg(SAVED[i]);
+    }
+    encoder.emit_ret();
+}
+
+void DISAToX86Compiler::emit_exit_stubs() {
+    for (auto& [exit, label] : exit_stubs) {
+        encoder.bind_label(label);
+        if (exit.second) {
+            encoder.emit_alu_reg_imm32(AluOp::ADD, BUDGET, static_cast<int32_t>(exit.second));
+        }
+        encoder.emit_mov_reg32_imm32(RAX, exit.first);
+        encoder.emit_jmp_label(exit_label);
+    }
+}
+
+// Entry points for the dispatcher: load the block's live-in guest registers
+// into their host registers, then join the block. Branches within compiled
+// code go to the block itself.
+void DISAToX86Compiler::emit_block_entries() {
+    for (Block& block : compiled_blocks) {
+        uint32_t position = block_positions.at(block.start);
+        bool loads = false;
+        for (uint8_t reg = 0; reg < GUEST_REGISTERS; ++reg) {
+            auto host = allocator.get_physical_register(reg, position);
+            if (host && allocator.live_in(position).test(reg)) {
+                if (!loads) {
+                    block.offset = encoder.size();
+                    loads = true;
+                }
+                encoder.emit_mov_reg32_mem(*host, GUEST, guest(reg));
+            }
+        }
+        if (loads) {
+            encoder.emit_jmp_label(jump_targets.at(block.start));
+        }
+    }
+}
+
+void DISAToX86Compiler::compile_block(Block& block, bool falls_into_next) {
+    // Binding first lets a jump from the previous block shrink before the offset is taken
+    encoder.bind_label(get_or_create_label(block.start));
+    block.offset = encoder.size();
+
+    // Run only if the whole block fits before the next device tick
+    encoder.emit_alu_reg_imm32(AluOp::CMP, BUDGET, static_cast<int32_t>(block.instructions));
+    encoder.emit_jcc_label(Condition::L, exit_to(block.start, 0));
+    encoder.emit_alu_reg_imm32(AluOp::SUB, BUDGET, static_cast<int32_t>(block.instructions));
+
+    const std::vector<uint8_t>& program = *current_program;
+    uint32_t pc = block.start;
+    bool falls_through = true;
+    for (uint32_t retired = 0; retired < block.instructions; ++retired) {
+        current_pc = pc;
+        current_refund = block.instructions - retired;
+        falls_through = translate_instruction(pc);
+        pc += static_cast<uint32_t>(instruction_length(program, pc));
+        ++current_position;
+    }
+    if (falls_through && !falls_into_next) {
+        encoder.emit_jmp_label(branch_to(block.end));
+    }
+}
+
+bool DISAToX86Compiler::translate_instruction(uint32_t pc) {
+    const std::vector<uint8_t>& program = *current_program;
+    Opcode opcode = static_cast<Opcode>(program[pc]);
+    uint8_t a = pc + 1 < program.size() ? program[pc + 1] : 0;
+    uint8_t b = pc + 2 < program.size() ? program[pc + 2] : 0;
+    switch (opcode) {
+        case Opcode::NOP: break;
+        case Opcode::LOAD_IMM: translate_load_imm(a, b); break;
+        case Opcode::LEA: translate_load_imm(a, b); break;  // The address itself
+        case Opcode::MOV: translate_mov(a, b); break;
+        case Opcode::ADD: translate_add(a, b); break;
+        case Opcode::SUB: translate_sub(a, b); break;
+        case Opcode::MUL: translate_mul(a, b); break;
+        case Opcode::DIV: translate_div(a, b); break;
+        case Opcode::AND: translate_logic(AluOp::AND, a, b); break;
+        case Opcode::OR: translate_logic(AluOp::OR, a, b); break;
+        case Opcode::XOR: translate_logic(AluOp::XOR, a, b); break;
+        case Opcode::INC: case Opcode::DEC: case Opcode::NOT: translate_unary(opcode, a); break;
+        case Opcode::SHL: case Opcode::SHR: translate_shift(opcode, a, b); break;
+        case Opcode::CMP: translate_cmp(a, b); break;
+        case Opcode::LOAD: translate_load(a, b); break;
+        case Opcode::STORE: translate_store(a, b); break;
+        case Opcode::SWAP: translate_swap(a, b); break;
+        case Opcode::PUSH: translate_push(a); break;
+        case Opcode::POP: translate_pop(a); break;
+        case Opcode::JMP:
+            translate_jmp(a);
+            return false;
+        case Opcode::CALL:
+            translate_call(a);
+            return false;
+        case Opcode::RET:
+            translate_ret();
+            return false;
+        default:
+            translate_jcc(opcode, a, pc + 2);
+            return false;
+    }
+    return true;
+}
+
+X86Register DISAToX86Compiler::use(uint8_t reg, X86Register scratch) {
+    if (auto host = allocator.get_physical_register(reg, current_position)) {
+        return *host;
+    }
+    encoder.emit_mov_reg32_mem(scratch, GUEST, guest(reg));
+    return scratch;
+}
+
+X86Register DISAToX86Compiler::def(uint8_t reg, X86Register scratch) {
+    return allocator.get_physical_register(reg, current_position).value_or(scratch);
+}
+
+void DISAToX86Compiler::commit(uint8_t reg, X86Register value) {
+    encoder.emit_mov_mem_reg32(GUEST, guest(reg), value);
+}
+
+void DISAToX86Compiler::translate_load_imm(uint8_t reg, uint32_t immediate) {
+    X86Register dst = def(reg, RAX);
+    if (dst == RAX) {
+        encoder.emit_mov_mem_imm32(GUEST, guest(reg), immediate);
+        return;
+    }
+    encoder.emit_mov_reg32_imm32(dst, immediate);
+    commit(reg, dst);
+}
+
+void DISAToX86Compiler::translate_mov(uint8_t dst_reg, uint8_t src_reg) {
+    X86Register src = use(src_reg, RAX);
+    X86Register dst = def(dst_reg, src);
+    if (dst != src) {
+        encoder.emit_mov_reg32_reg32(dst, src);
+    }
+    commit(dst_reg, dst);
+}
+
+// FLAGS |= byte_reg ? flag : 0, for a SETcc result
+void DISAToX86Compiler::emit_merge_flag(X86Register byte_reg, uint32_t flag) {
+    encoder.emit_movzx_reg32_reg8(byte_reg, byte_reg);
+    encoder.emit_shl_reg32_imm(byte_reg, bit_index(flag));
+    encoder.emit_alu_reg32_reg32(AluOp::OR, FLAGS, byte_reg);
+}
+
+// ADD and SUB set CARRY and OVERFLOW exactly as x86 does and leave ZERO and SIGN alone
+void DISAToX86Compiler::translate_add(uint8_t dst_reg, uint8_t src_reg) {
+    X86Register dst = use(dst_reg, RAX);
+    X86Register src = use(src_reg, RCX);
+    encoder.emit_alu_reg32_reg32(AluOp::ADD, dst, src);
+    encoder.emit_setcc(Condition::B, RCX);
+    encoder.emit_setcc(Condition::O, RDX);
+    commit(dst_reg, dst);
+    encoder.emit_alu_reg32_imm32(AluOp::AND, FLAGS, static_cast<int32_t>(~(FLAG_CARRY | FLAG_OVERFLOW)));
+    emit_merge_flag(RCX, FLAG_CARRY);
+    emit_merge_flag(RDX, FLAG_OVERFLOW);
+}
+
+void DISAToX86Compiler::translate_sub(uint8_t dst_reg, uint8_t src_reg) {
+    X86Register dst = use(dst_reg, RAX);
+    X86Register src = use(src_reg, RCX);
+    encoder.emit_alu_reg32_reg32(AluOp::SUB, dst, src);
+    encoder.emit_setcc(Condition::B, RCX);
+    encoder.emit_setcc(Condition::O, RDX);
+    commit(dst_reg, dst);
+    encoder.emit_alu_reg32_imm32(AluOp::AND, FLAGS, static_cast<int32_t>(~(FLAG_CARRY | FLAG_OVERFLOW)));
+    emit_merge_flag(RCX, FLAG_CARRY);
+    emit_merge_flag(RDX, FLAG_OVERFLOW);
+}
+
+// CARRY when the unsigned product needs more than 32 bits, OVERFLOW when the
+// signed one does: MUL and IMUL report exactly those
+void DISAToX86Compiler::translate_mul(uint8_t dst_reg, uint8_t src_reg) {
+    X86Register src = use(src_reg, RCX);
+    X86Register value = use(dst_reg, RAX);
+    if (value != RAX) {
+        encoder.emit_mov_reg32_reg32(RAX, value);
+    }
+    encoder.emit_alu_reg32_imm32(AluOp::AND, FLAGS, static_cast<int32_t>(~(FLAG_CARRY | FLAG_OVERFLOW)));
+    encoder.emit_mov_reg32_reg32(RDX, RAX);
+    encoder.emit_imul_reg32_reg32(RDX, src);
+    encoder.emit_setcc(Condition::O, RDX);
+    emit_merge_flag(RDX, FLAG_OVERFLOW);
+    encoder.emit_mul_reg32(src);
+    encoder.emit_setcc(Condition::B, RDX);
+    emit_merge_flag(RDX, FLAG_CARRY);
+    X86Register dst = def(dst_reg, RAX);
+    if (dst != RAX) {
+        encoder.emit_mov_reg32_reg32(dst, RAX);
+    }
+    commit(dst_reg, dst);
+}
+
+void DISAToX86Compiler::translate_div(uint8_t dst_reg, uint8_t src_reg) {
+    X86Register src = use(src_reg, RCX);
+    encoder.emit_alu_reg32_imm32(AluOp::CMP, src, 0);
+    encoder.emit_jcc_label(Condition::E, side_exit());  // The interpreter reports it
+    X86Register value = use(dst_reg, RAX);
+    if (value != RAX) {
+        encoder.emit_mov_reg32_reg32(RAX, value);
+    }
+    encoder.emit_alu_reg32_reg32(AluOp::XOR, RDX, RDX);
+    encoder.emit_div_reg32(src);
+    X86Register dst = def(dst_reg, RAX);
+    if (dst != RAX) {
+        encoder.emit_mov_reg32_reg32(dst, RAX);
+    }
+    commit(dst_reg, dst);
+}
+
+void DISAToX86Compiler::translate_logic(AluOp op, uint8_t dst_reg, uint8_t src_reg) {
+    X86Register dst = use(dst_reg, RAX);
+    X86Register src = use(src_reg, RCX);
+    encoder.emit_alu_reg32_reg32(op, dst, src);
+    commit(dst_reg, dst);
+}
+
+// INC, DEC and NOT leave FLAGS alone
+void DISAToX86Compiler::translate_unary(Opcode opcode, uint8_t reg) {
+    X86Register value = use(reg, RAX);
+    if (opcode == Opcode::NOT) {
+        encoder.emit_not_reg32(value);
+    } else if (opcode == Opcode::INC) {
+        encoder.emit_inc_reg32(value);
+    } else {
+        encoder.emit_dec_reg32(value);
+    }
+    commit(reg, value);
+}
+
+void DISAToX86Compiler::translate_shift(Opcode opcode, uint8_t reg, uint8_t count) {
+    X86Register value = use(reg, RAX);
+    if (opcode == Opcode::SHL) {
+        encoder.emit_shl_reg32_imm(value, count);
+    } else {
+        encoder.emit_shr_reg32_imm(value, count);
+    }
+    commit(reg, value);
+}
+
+// CMP replaces FLAGS with ZERO and SIGN of the 32-bit difference
+void DISAToX86Compiler::translate_cmp(uint8_t reg1, uint8_t reg2) {
+    X86Register lhs = use(reg1, RAX);
+    X86Register rhs = use(reg2, RCX);
+    encoder.emit_alu_reg32_reg32(AluOp::CMP, lhs, rhs);
+    encoder.emit_setcc(Condition::E, RAX);
+    encoder.emit_setcc(Condition::S, RCX);
+    encoder.emit_movzx_reg32_reg8(FLAGS, RAX);
+    emit_merge_flag(RCX, FLAG_SIGN);
+}
+
+void DISAToX86Compiler::translate_jmp(uint32_t target_address) {
+    encoder.emit_jmp_label(branch_to(target_address));
+}
+
+void DISAToX86Compiler::translate_jcc(Opcode opcode, uint32_t target_address, uint32_t next_address) {
+    Condition taken;
+    switch (opcode) {
+        case Opcode::JZ: case Opcode::JNZ:
+            encoder.emit_test_reg32_imm32(FLAGS, FLAG_ZERO);
+            taken = opcode == Opcode::JZ ? Condition::NE : Condition::E;
+            break;
+        case Opcode::JS: case Opcode::JNS:
+            encoder.emit_test_reg32_imm32(FLAGS, FLAG_SIGN);
+            taken = opcode == Opcode::JS ? Condition::NE : Condition::E;
+            break;
+        case Opcode::JC: case Opcode::JNC:
+            encoder.emit_test_reg32_imm32(FLAGS, FLAG_CARRY);
+            taken = opcode == Opcode::JC ? Condition::NE : Condition::E;
+            break;
+        case Opcode::JO: case Opcode::JNO:
+            encoder.emit_test_reg32_imm32(FLAGS, FLAG_OVERFLOW);
+            taken = opcode == Opcode::JO ? Condition::NE : Condition::E;
+            break;
+        case Opcode::JG: case Opcode::JLE:
+            // JG: neither SIGN nor ZERO; JLE: either
+            encoder.emit_test_reg32_imm32(FLAGS, FLAG_SIGN | FLAG_ZERO);
+            taken = opcode == Opcode::JG ? Condition::E : Condition::NE;
+            break;
+        default:
+            // JL: SIGN without ZERO; JGE: anything else
+            encoder.emit_mov_reg32_reg32(RAX, FLAGS);
+            encoder.emit_alu_reg32_imm32(AluOp::AND, RAX, FLAG_SIGN | FLAG_ZERO);
+            encoder.emit_alu_reg32_imm32(AluOp::CMP, RAX, FLAG_SIGN);
+            taken = opcode == Opcode::JL ? Condition::E : Condition::NE;
+            break;
+    }
+    encoder.emit_jcc_label(taken, branch_to(target_address));
+    encoder.emit_jmp_label(branch_to(next_address));
+}
+
+void DISAToX86Compiler::translate_load(uint8_t dst_reg, uint8_t address) {
+    X86Register dst = def(dst_reg, RAX);
+    encoder.emit_movzx_reg32_mem8(dst, MEMORY, address);
+    commit(dst_reg, dst);
+}
+
+// Memory is at least 256 bytes, so one-byte addresses need no bounds check
+void DISAToX86Compiler::translate_store(uint8_t src_reg, uint8_t address) {
+    encoder.emit_mov_mem8_reg8(MEMORY, address, use(src_reg, RAX));
+}
+
+void DISAToX86Compiler::translate_swap(uint8_t reg, uint8_t address) {
+    X86Register value = use(reg, RAX);
+    encoder.emit_movzx_reg32_mem8(RCX, MEMORY, address);
+    encoder.emit_mov_mem8_reg8(MEMORY, address, value);
+    X86Register dst = def(reg, RCX);
+    if (dst != RCX) {
+        encoder.emit_mov_reg32_reg32(dst, RCX);
+    }
+    commit(reg, dst);
+}
+
+// The interpreter skips 32-bit stack accesses that run past the end of memory
+// (addr + 3 >= size, in 32-bit arithmetic); leave those to it
+void DISAToX86Compiler::emit_stack_check(int32_t offset) {
+    encoder.emit_lea_reg32_mem(RDX, RCX, offset + 3);
+    encoder.emit_alu_reg_mem(AluOp::CMP, RDX, STATE, field(offsetof(JitState, memory_size)));
+    encoder.emit_jcc_label(Condition::AE, side_exit());
+}
+
+void DISAToX86Compiler::translate_push(uint8_t reg) {
+    encoder.emit_mov_reg32_mem(RCX, REGISTERS64, slot(Register::RSP));
+    emit_stack_check(-4);
+    encoder.emit_lea_reg32_mem(RCX, RCX, -4);
+    encoder.emit_mov_mem_reg(REGISTERS64, slot(Register::RSP), RCX);
+    encoder.emit_mov_mem_reg32(MemOperand(MEMORY, RCX, 1), use(reg, RAX));
+}
+
+void DISAToX86Compiler::translate_pop(uint8_t reg) {
+    encoder.emit_mov_reg32_mem(RCX, REGISTERS64, slot(Register::RSP));
+    emit_stack_check(0);
+    X86Register dst = def(reg, RAX);
+    encoder.emit_mov_reg32_mem(dst, MemOperand(MEMORY, RCX, 1));
+    commit(reg, dst);
+    encoder.emit_lea_reg32_mem(RCX, RCX, 4);
+    encoder.emit_mov_mem_reg(REGISTERS64, slot(Register::RSP), RCX);
+}
+
+// Pushes FP and the return address, then continues at the target read from
+// guest memory, as the interpreter does
+void DISAToX86Compiler::translate_call(uint32_t target_address) {
+    encoder.emit_mov_reg32_mem(RCX, REGISTERS64, slot(Register::RSP));
+    emit_stack_check(-4);
+    emit_stack_check(-8);
+    encoder.emit_mov_reg32_mem(RAX, REGISTERS64, slot(Register::RBP));
+    encoder.emit_mov_mem_reg32(MemOperand(MEMORY, RCX, 1, -4), RAX);
+    encoder.emit_mov_mem_imm32(MemOperand(MEMORY, RCX, 1, -8), current_pc + 2);
+    encoder.emit_lea_reg32_mem(RCX, RCX, -8);
+    encoder.emit_mov_mem_reg(REGISTERS64, slot(Register::RSP), RCX);
+    encoder.emit_mov_mem_reg(REGISTERS64, slot(Register::RBP), RCX);
+    encoder.emit_mov_reg_mem(RDX, STATE, field(offsetof(JitState, arg_offset)));
+    encoder.emit_mov_mem_imm32(RDX, 0, 8);
+
+    encoder.emit_movzx_reg32_mem8(RAX, MEMORY, field(current_pc + 1));
+    if (jump_targets.count(target_address)) {
+        encoder.emit_alu_reg32_imm32(AluOp::CMP, RAX, static_cast<int32_t>(target_address));
+        encoder.emit_jcc_label(Condition::NE, exit_label);  // Code was overwritten
+        encoder.emit_jmp_label(jump_targets.at(target_address));
+    } else {
+        encoder.emit_jmp_label(exit_label);
+    }
+}
+
+// Return addresses are only known at run time; the dispatcher looks them up
+void DISAToX86Compiler::translate_ret() {
+    encoder.emit_mov_reg32_mem(RCX, REGISTERS64, slot(Register::RSP));
+    emit_stack_check(0);
+    emit_stack_check(4);
+    encoder.emit_mov_reg32_mem(RAX, MemOperand(MEMORY, RCX, 1));
+    encoder.emit_mov_reg32_mem(RDX, MemOperand(MEMORY, RCX, 1, 4));
+    encoder.emit_lea_reg32_mem(RCX, RCX, 8);
+    encoder.emit_mov_mem_reg(REGISTERS64, slot(Register::RSP), RCX);
+    encoder.emit_mov_mem_reg(REGISTERS64, slot(Register::RBP), RDX);
+    encoder.emit_mov_reg_mem(RCX, STATE, field(offsetof(JitState, arg_offset)));
+    encoder.emit_mov_mem_imm32(RCX, 0, 0);
+    encoder.emit_jmp_label(exit_label);
+}
+
+void DISAToX86Compiler::print_compilation_stats(std::ostream& out) const {
+    size_t compiled = 0;
+    for (const Block& block : compiled_blocks) {
+        compiled += block.instructions;
+    }
+    out << fmt::format("Compiled {} of {} blocks: {} of {} instructions, {} bytes of code\n",
+        compiled_blocks.size(), program_blocks.size(), compiled, program_instructions, encoder.size());
+    allocator.print_allocation_state(out);
+}
+
+} // namespace CodeGen
@@ -1,100 +1,168 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <set>
+#include <utility>
 #include <vector>
-#include <unordered_map>
-#include "x86_encoder.hpp"
 #include "register_allocator.hpp"
+#include "x86_encoder.hpp"
 #include "../engine/cpu.hpp"
 
 namespace CodeGen {
 
+/**
+ * @brief Guest state handed to compiled code
+ *
+ * Compiled code reads the pointers once on entry, keeps FLAGS in a host
+ * register and writes FLAGS and the remaining budget back on exit. Nothing
+ * else is cached across instructions, so the CPU sees exact state after
+ * every exit.
+ */
+struct JitState {
+    uint32_t* registers;    ///< R0-R7 (the CPU's legacy register file)
+    uint64_t* registers64;  ///< Full register file; SP, FP and FLAGS live here
+    uint8_t* memory;
+    uint64_t memory_size;
+    int* arg_offset;
+    int64_t budget;         ///< Instructions that may retire before devices are due; what is left on exit
+};
+
 // Translates D-ISA bytecode to native x86-64 machine code
+//
+// The program is cut into basic blocks like Profiling::BlockProfiler does, and
+// every block whose instructions the compiler understands can become native
+// code, either all of them or a chosen (hot) set. The result is position
+// independent: it starts with an entry trampoline,
+//
+//     uint32_t entry(JitState* state, const void* block);
+//
+// which runs from the given block until the budget runs out or control
+// reaches something that was not compiled, and returns the guest pc to
+// continue at. Instructions are only ever retired whole: a block checks the
+// budget before running, and an instruction that needs the interpreter (a
+// division by zero, a stack access out of bounds) exits before it changes
+// anything and refunds the rest of its block.
+//
+// R0-R7 are allocated host registers by linear scan over everything being
+// compiled, so a hot loop keeps its working set in registers. Writes go
+// through to the register file as well, which keeps every exit free of
+// spill code; a block entered from the dispatcher first loads whatever is
+// live into its registers.
 class DISAToX86Compiler {
-private:
-    X86Encoder encoder;
-    RegisterAllocator reg_alloc;
-    
-    // Jump target resolution
-    struct JumpTarget {
-        size_t bytecode_address;
-        X86Encoder::Label x86_label;
+public:
+    static constexpr uint8_t GUEST_REGISTERS = 8;
+    static constexpr uint32_t MAX_BLOCK_INSTRUCTIONS = 64;  // Must stay below the clock's batch size
+
+    struct Block {
+        uint32_t start;         ///< Address of the first instruction
+        uint32_t end;           ///< Address just past the last instruction
+        uint32_t instructions;
+        size_t offset;          ///< Start of the block's code (compiled blocks only)
     };
-    std::unordered_map<size_t, JumpTarget> jump_targets;
-    
-    // Function call management
-    std::vector<size_t> function_addresses;
-    std::unordered_map<size_t, X86Encoder::Label> function_labels;
-    
-    // Current compilation state
-    size_t current_bytecode_pos;
-    const std::vector<uint8_t>* current_program;
 
-public:
-    DISAToX86Compiler() = default;
-    
+    struct Loop {
+        uint32_t header;  ///< Target of the backward jump
+        uint32_t end;     ///< Address just past the furthest backward jump to header
+    };
+
+    DISAToX86Compiler();
+
     // Main compilation interface
     std::vector<uint8_t> compile_program(const std::vector<uint8_t>& disa_bytecode);
-    
-    // Instruction translation methods
-    void translate_instruction(Opcode opcode, const uint8_t* operands);
-    
-    // Individual instruction handlers
-    void translate_nop();
-    void translate_load_imm(uint8_t reg, uint64_t immediate);
+    // Only the blocks starting at these addresses; jumps anywhere else exit to the dispatcher
+    std::vector<uint8_t> compile_program(const std::vector<uint8_t>& disa_bytecode, const std::set<uint32_t>& hot);
+    const std::vector<Block>& blocks() const { return compiled_blocks; }
+
+    /**
+     * @brief Find the compilable blocks and the loops of a program without compiling
+     */
+    void scan_for_jump_targets(const std::vector<uint8_t>& bytecode);
+    const std::vector<Block>& candidate_blocks() const { return program_blocks; }
+    const std::vector<Loop>& loops() const { return program_loops; }
+
+    /**
+     * @brief Whether the instruction at pc can be compiled
+     *
+     * Port I/O, interrupts, HALT and the extended-register opcodes stay with
+     * the interpreter, as does anything malformed (operands past the end of
+     * the program, registers past R7, jumps out of the program).
+     */
+    static bool is_supported(const std::vector<uint8_t>& program, size_t pc);
+
+    // Debug and analysis
+    void print_compilation_stats(std::ostream& out) const;
+    size_t get_code_size() const { return encoder.size(); }
+    const RegisterAllocator& register_allocator() const { return allocator; }
+
+private:
+    X86Encoder encoder;
+    RegisterAllocator allocator;
+
+    // Labels of compiled blocks, by bytecode address
+    std::map<size_t, X86Encoder::Label> jump_targets;
+
+    // Exits back to the dispatcher: (pc, instructions to refund) -> stub
+    std::map<std::pair<uint32_t, uint32_t>, X86Encoder::Label> exit_stubs;
+    X86Encoder::Label exit_label;
+
+    std::vector<Block> program_blocks;
+    std::vector<Loop> program_loops;
+    std::vector<Block> compiled_blocks;
+    size_t program_instructions = 0;
+
+    // Current compilation state
+    const std::vector<uint8_t>* current_program = nullptr;
+    std::map<uint32_t, uint32_t> block_positions;  // Block start -> position of its first instruction
+    uint32_t current_pc = 0;
+    uint32_t current_position = 0;                 // Instruction index within what is being compiled
+    uint32_t current_refund = 0;  // Instructions of the block not yet retired when this one starts
+
+    // Jump target management
+    X86Encoder::Label& get_or_create_label(uint32_t bytecode_address);
+    X86Encoder::Label& branch_to(uint32_t pc);
+    X86Encoder::Label& exit_to(uint32_t pc, uint32_t refund);
+    X86Encoder::Label& side_exit() { return exit_to(current_pc, current_refund); }
+
+    std::vector<uint8_t> compile_blocks(const std::vector<uint8_t>& disa_bytecode);
+    void emit_entry();
+    void emit_exit();
+    void emit_exit_stubs();
+    void emit_block_entries();
+    void allocate_registers();
+    void compile_block(Block& block, bool falls_into_next);
+
+    // Instruction translation; returns false when control never falls through
+    bool translate_instruction(uint32_t pc);
+    void translate_load_imm(uint8_t reg, uint32_t immediate);
+    void translate_mov(uint8_t dst_reg, uint8_t src_reg);
     void translate_add(uint8_t dst_reg, uint8_t src_reg);
     void translate_sub(uint8_t dst_reg, uint8_t src_reg);
-    void translate_mov(uint8_t dst_reg, uint8_t src_reg);
+    void translate_mul(uint8_t dst_reg, uint8_t src_reg);
+    void translate_div(uint8_t dst_reg, uint8_t src_reg);
+    void translate_logic(AluOp op, uint8_t dst_reg, uint8_t src_reg);
+    void translate_unary(Opcode opcode, uint8_t reg);
+    void translate_shift(Opcode opcode, uint8_t reg, uint8_t count);
     void translate_cmp(uint8_t reg1, uint8_t reg2);
     void translate_jmp(uint32_t target_address);
-    void translate_jz(uint32_t target_address);
-    void translate_jnz(uint32_t target_address);
-    void translate_load(uint8_t dst_reg, uint8_t addr_reg, int32_t offset);
-    void translate_store(uint8_t addr_reg, int32_t offset, uint8_t src_reg);
+    void translate_jcc(Opcode opcode, uint32_t target_address, uint32_t next_address);
+    void translate_load(uint8_t dst_reg, uint8_t address);
+    void translate_store(uint8_t src_reg, uint8_t address);
+    void translate_swap(uint8_t reg, uint8_t address);
     void translate_push(uint8_t reg);
     void translate_pop(uint8_t reg);
     void translate_call(uint32_t target_address);
     void translate_ret();
-    void translate_halt();
-    
-    // Memory and stack management
-    void setup_function_prologue();
-    void setup_function_epilogue();
-    void emit_stack_frame_setup(size_t local_vars_size);
-    void emit_stack_frame_teardown();
-    
-    // Jump target management
-    void scan_for_jump_targets(const std::vector<uint8_t>& bytecode);
-    void resolve_jump_targets();
-    X86Encoder::Label& get_or_create_label(size_t bytecode_address);
-    
-    // Runtime support (for complex operations)
-    void emit_runtime_call(const char* function_name);
-    void emit_device_io_call(uint16_t device_id, bool is_input);
-    
-    // Optimization passes
-    void optimize_register_usage();
-    void eliminate_redundant_moves();
-    void fold_constant_operations();
-    
-    // Debug and analysis
-    void print_compilation_stats() const;
-    size_t get_code_size() const { return encoder.size(); }
-    
-private:
-    // Helper methods
-    uint8_t read_uint8(size_t& pos) const;
-    uint16_t read_uint16(size_t& pos) const;
-    uint32_t read_uint32(size_t& pos) const;
-    uint64_t read_uint64(size_t& pos) const;
-    
-    // Instruction format parsing
-    struct InstructionFormat {
-        uint8_t opcode;
-        uint8_t reg1;
-        uint8_t reg2;
-        uint64_t immediate;
-        bool has_immediate;
-    };
-    InstructionFormat decode_instruction(size_t& pos) const;
+
+    // Guest register access at the current position
+    X86Register use(uint8_t reg, X86Register scratch);  // Host register holding it, or scratch loaded with it
+    X86Register def(uint8_t reg, X86Register scratch);  // Where to put a new value
+    void commit(uint8_t reg, X86Register value);        // Write the new value through
+
+    // Helpers
+    void emit_stack_check(int32_t offset);  // SP in ECX, clobbers EDX; side exit unless [SP + offset, +4) is in memory
+    void emit_merge_flag(X86Register byte_reg, uint32_t flag);
 };
 
 } // namespace CodeGen
@@ -0,0 +1,129 @@
+#include "jit.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include "../debug/logger.hpp"
+#include "../engine/virtual_clock.hpp"
+
+using Logging::Logger;
+
+namespace CodeGen {
+
+Jit::Jit(const std::vector<uint8_t>& program, uint32_t threshold)
+    : program_(program), threshold_(threshold), counts_(program.size(), NOT_COUNTED),
+      entries_(program.size(), nullptr) {
+    for (size_t pc = 0; pc < program.size(); pc += instruction_length(program, pc)) {
+        ++program_instructions_;
+    }
+    compiler_.scan_for_jump_targets(program);
+    for (const DISAToX86Compiler::Loop& loop : compiler_.loops()) {
+        loop_ends_[loop.header] = loop.end;
+    }
+
+    if (threshold_ == 0) {
+        for (const DISAToX86Compiler::Block& block : compiler_.candidate_blocks()) {
+            hot_.insert(block.start);
+        }
+        install();
+        return;
+    }
+    for (const DISAToX86Compiler::Block& block : compiler_.candidate_blocks()) {
+        counts_[block.start] = 0;
+    }
+}
+
+Jit::~Jit() {
+    if (code_) {
+        ::munmap(code_, mapped_);
+    }
+}
+
+// Called from the dispatcher, never from compiled code, so the old mapping
+// can go as soon as the new one is in place
+const void* Jit::promote(uint32_t pc) {
+    auto loop = loop_ends_.find(pc);
+    Transition transition{pc, pc, loop != loop_ends_.end(), 0, vhw::VirtualClock::instance().now()};
+    uint32_t end = transition.loop ? loop->second : pc + 1;
+    for (const DISAToX86Compiler::Block& block : compiler_.candidate_blocks()) {
+        if (block.start >= pc && block.start < end && hot_.insert(block.start).second) {
+            counts_[block.start] = NOT_COUNTED;
+            transition.end = std::max(transition.end, block.end);
+            ++transition.blocks;
+        }
+    }
+    transitions_.push_back(transition);
+    install();
+    return entries_[pc];
+}
+
+void Jit::install() {
+    if (failed_) {
+        return;
+    }
+    auto began = std::chrono::steady_clock::now();
+    std::vector<uint8_t> code = compiler_.compile_program(program_, hot_);
+    ++compilations_;
+
+#if !defined(__x86_64__)
+    Logger::instance().warn() << "JIT: host is not x86-64; interpreting" << std::endl;
+    failed_ = true;
+    return;
+#endif
+    size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    size_t length = (code.size() + page - 1) / page * page;
+    void* memory = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        Logger::instance().warn() << "JIT: cannot map code memory; interpreting" << std::endl;
+        failed_ = true;
+        return;
+    }
+    std::memcpy(memory, code.data(), code.size());
+    if (::mprotect(memory, length, PROT_READ | PROT_EXEC) != 0) {
+        Logger::instance().warn() << "JIT: cannot make code executable; interpreting" << std::endl;
+        ::munmap(memory, length);
+        failed_ = true;
+        return;
+    }
+    if (code_) {
+        ::munmap(code_, mapped_);
+    }
+    code_ = memory;
+    mapped_ = length;
+    code_size_ = code.size();
+    entry_ = reinterpret_cast<Entry>(code_);  // The entry trampoline is at offset 0
+
+    std::fill(entries_.begin(), entries_.end(), nullptr);
+    compiled_instructions_ = 0;
+    for (const DISAToX86Compiler::Block& block : compiler_.blocks()) {
+        entries_[block.start] = static_cast<const uint8_t*>(code_) + block.offset;
+        compiled_instructions_ += block.instructions;
+    }
+    blocks_ = compiler_.blocks().size();
+    compile_seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - began).count();
+}
+
+void Jit::write_stats(std::ostream& out) const {
+    out << fmt::format("JIT: {} of {} blocks, {} of {} instructions compiled, {} bytes of code\n",
+        blocks_, compiler_.candidate_blocks().size(), compiled_instructions_, program_instructions_, code_size_);
+    out << fmt::format("  {} compilations took {:.3f} ms\n", compilations_, compile_seconds_ * 1e3);
+    const RegisterAllocator& allocator = compiler_.register_allocator();
+    out << fmt::format("  {} guest register intervals in host registers, {} spilled\n",
+        allocator.get_allocation_count(), allocator.get_spill_count());
+    if (threshold_ == 0) {
+        out << "  every block compiled up front\n";
+    } else {
+        out << fmt::format("  {} tier-ups at {} entries:\n", transitions_.size(), threshold_);
+        for (const Transition& transition : transitions_) {
+            out << fmt::format("    cycle {:>10}  {} 0x{:04X}-0x{:04X}, {} blocks\n", transition.cycle,
+                transition.loop ? "loop " : "block", transition.start, transition.end, transition.blocks);
+        }
+    }
+    out << fmt::format("  {} entries ran {} instructions natively\n", runs_, instructions_);
+}
+
+} // namespace CodeGen
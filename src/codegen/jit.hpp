@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <set>
+#include <vector>
+
+#include "disa_compiler.hpp"
+
+namespace CodeGen {
+
+/**
+ * @brief Baseline JIT: a program's basic blocks as native code
+ *
+ * Blocks start out interpreted. Every time the CPU arrives at the start of a
+ * block that is not compiled yet, the block's counter goes up, and when it
+ * reaches the threshold the block is promoted; a loop header promotes its
+ * whole loop. Promotion recompiles every hot block with DISAToX86Compiler
+ * into a fresh mapping that is made executable once written (W^X), so hot
+ * blocks branch to each other directly, and the block is entered straight
+ * away. Compiled code works on the guest state in place, so a loop that
+ * turns hot while running carries on natively from its header with nothing
+ * to transfer. A threshold of 0 compiles everything up front.
+ *
+ * The CPU runs a block with a budget of instructions left until the next
+ * device tick and interprets whatever was not compiled: port I/O,
+ * interrupts, HALT, cold code, and instructions that fail at run time.
+ * Device and interrupt timing is unchanged; interrupts are polled between
+ * entries.
+ */
+class Jit {
+public:
+    // A promotion from the interpreter to compiled code
+    struct Transition {
+        uint32_t start;     ///< Block whose counter reached the threshold
+        uint32_t end;       ///< End of the promoted range (the loop, for a loop header)
+        bool loop;
+        uint32_t blocks;    ///< Blocks compiled by this promotion
+        uint64_t cycle;     ///< Virtual time of the promotion
+    };
+
+    /**
+     * @brief Prepare a program; if code cannot be mapped, every lookup misses
+     * @param threshold Entries before a block is compiled; 0 compiles every block now
+     */
+    explicit Jit(const std::vector<uint8_t>& program, uint32_t threshold = 0);
+    ~Jit();
+    Jit(const Jit&) = delete;
+    Jit& operator=(const Jit&) = delete;
+
+    /**
+     * @brief Whether this code was compiled from exactly this program
+     */
+    bool compiled_for(const std::vector<uint8_t>& program) const { return program == program_; }
+
+    /**
+     * @brief Native code of the block starting at pc, or nullptr to interpret
+     *
+     * Counts the entry of a block that is still interpreted and promotes it
+     * when the count reaches the threshold.
+     */
+    const void* block_at(uint32_t pc) {
+        if (pc >= entries_.size() || entries_[pc] || counts_[pc] == NOT_COUNTED) {
+            return pc < entries_.size() ? entries_[pc] : nullptr;
+        }
+        return ++counts_[pc] >= threshold_ ? promote(pc) : nullptr;
+    }
+
+    /**
+     * @brief Run compiled code from a block until the budget is spent or control leaves it
+     * @return The guest pc to continue at; state.budget holds what is left
+     */
+    uint32_t run(JitState& state, const void* block) {
+        ++runs_;
+        uint64_t budget = static_cast<uint64_t>(state.budget);
+        uint32_t pc = entry_(&state, block);
+        instructions_ += budget - static_cast<uint64_t>(state.budget);
+        return pc;
+    }
+
+    uint32_t threshold() const { return threshold_; }
+    size_t blocks() const { return blocks_; }
+    size_t code_size() const { return code_size_; }
+    uint64_t runs() const { return runs_; }
+    uint64_t instructions() const { return instructions_; }
+    const std::vector<Transition>& transitions() const { return transitions_; }
+
+    /**
+     * @brief Print what was compiled, when it was promoted and how much of the run it covered
+     */
+    void write_stats(std::ostream& out) const;
+
+private:
+    using Entry = uint32_t (*)(JitState*, const void*);
+    static constexpr uint32_t NOT_COUNTED = UINT32_MAX;  // Not a block start, or already promoted
+
+    const void* promote(uint32_t pc);
+    void install();  // Compile the hot blocks and switch to the new code
+
+    std::vector<uint8_t> program_;
+    uint32_t threshold_;
+    DISAToX86Compiler compiler_;
+    std::map<uint32_t, uint32_t> loop_ends_;  // Loop header -> end
+    std::set<uint32_t> hot_;                  // Starts of the blocks to compile
+    std::vector<uint32_t> counts_;            // Indexed by address; entries while interpreted
+    std::vector<const void*> entries_;        // Indexed by address
+    std::vector<Transition> transitions_;
+    void* code_ = nullptr;
+    size_t mapped_ = 0;
+    size_t code_size_ = 0;
+    size_t blocks_ = 0;
+    size_t compiled_instructions_ = 0;
+    size_t program_instructions_ = 0;
+    unsigned compilations_ = 0;
+    double compile_seconds_ = 0;
+    bool failed_ = false;
+    Entry entry_ = nullptr;
+    uint64_t runs_ = 0;
+    uint64_t instructions_ = 0;
+};
+
+} // namespace CodeGen
@@ -0,0 +1,182 @@
+#include "register_allocator.hpp"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include <fmt/core.h>
+
+namespace CodeGen {
+
+namespace {
+
+const char* register_name(X86Register reg) {
+    static const char* const names[] = {
+        "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+        "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"
+    };
+    return names[static_cast<uint8_t>(reg)];
+}
+
+} // namespace
+
+RegisterAllocator::RegisterAllocator(std::vector<X86Register> allocatable, size_t homed)
+    : allocatable_regs(std::move(allocatable)), homed_regs(homed) {}
+
+void RegisterAllocator::allocate(const std::vector<Instruction>& region) {
+    compute_liveness(region);
+    build_intervals(region);
+    linear_scan();
+}
+
+std::optional<X86Register> RegisterAllocator::get_physical_register(uint8_t virt_reg, uint32_t position) const {
+    int index = interval_of[virt_reg];
+    if (index < 0) {
+        return std::nullopt;
+    }
+    const Interval& interval = allocated_intervals[index];
+    if (position < interval.start || position > interval.end) {
+        return std::nullopt;
+    }
+    return interval.reg;
+}
+
+// Backward dataflow to a fixed point: live_in = uses | (live_out & ~defs)
+void RegisterAllocator::compute_liveness(const std::vector<Instruction>& region) {
+    live_in_sets.assign(region.size(), RegisterSet());
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t position = region.size(); position-- > 0;) {
+            const Instruction& instruction = region[position];
+            RegisterSet live;
+            for (uint32_t successor : instruction.successors) {
+                live |= live_in_sets[successor];
+            }
+            for (uint8_t reg : instruction.defs) {
+                live.reset(reg);
+            }
+            for (uint8_t reg : instruction.uses) {
+                live.set(reg);
+            }
+            if (live != live_in_sets[position]) {
+                live_in_sets[position] = live;
+                changed = true;
+            }
+        }
+    }
+}
+
+// One interval per virtual register, from the first to the last position
+// where it is live or written. Any edge that carries a value stays inside
+// its interval, so host registers never need fixing up between positions.
+void RegisterAllocator::build_intervals(const std::vector<Instruction>& region) {
+    allocated_intervals.clear();
+    interval_of.assign(MAX_VIRTUAL_REGISTERS, -1);
+    auto cover = [this](uint8_t reg, uint32_t position) {
+        int& index = interval_of[reg];
+        if (index < 0) {
+            index = static_cast<int>(allocated_intervals.size());
+            allocated_intervals.push_back({reg, position, position, std::nullopt, -1});
+        }
+        Interval& interval = allocated_intervals[index];
+        interval.start = std::min(interval.start, position);
+        interval.end = std::max(interval.end, position);
+    };
+    for (uint32_t position = 0; position < region.size(); ++position) {
+        for (size_t reg = 0; reg < MAX_VIRTUAL_REGISTERS; ++reg) {
+            if (live_in_sets[position].test(reg)) {
+                cover(static_cast<uint8_t>(reg), position);
+            }
+        }
+        for (uint8_t reg : region[position].defs) {
+            cover(reg, position);
+        }
+    }
+}
+
+void RegisterAllocator::linear_scan() {
+    spill_count = 0;
+    allocation_count = 0;
+    spill_slot_count = 0;
+
+    std::vector<size_t> order(allocated_intervals.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return allocated_intervals[a].start < allocated_intervals[b].start;
+    });
+
+    std::vector<X86Register> free_regs(allocatable_regs.rbegin(), allocatable_regs.rend());
+    std::vector<int32_t> free_slots;
+    std::vector<size_t> active;    // Intervals holding a host register
+    std::vector<size_t> in_slots;  // Spilled intervals holding a spill slot
+
+    auto spill = [&](size_t index) {
+        Interval& interval = allocated_intervals[index];
+        interval.reg.reset();
+        ++spill_count;
+        if (interval.virt_reg >= homed_regs) {
+            if (free_slots.empty()) {
+                interval.spill_slot = static_cast<int32_t>(spill_slot_count++);
+            } else {
+                interval.spill_slot = free_slots.back();
+                free_slots.pop_back();
+            }
+            in_slots.push_back(index);
+        }
+    };
+
+    for (size_t index : order) {
+        Interval& current = allocated_intervals[index];
+
+        // Expire whatever ended before this interval starts
+        auto expired = [&](size_t other) { return allocated_intervals[other].end < current.start; };
+        for (size_t other : active) {
+            if (expired(other)) {
+                free_regs.push_back(*allocated_intervals[other].reg);
+            }
+        }
+        active.erase(std::remove_if(active.begin(), active.end(), expired), active.end());
+        for (size_t other : in_slots) {
+            if (expired(other)) {
+                free_slots.push_back(allocated_intervals[other].spill_slot);
+            }
+        }
+        in_slots.erase(std::remove_if(in_slots.begin(), in_slots.end(), expired), in_slots.end());
+
+        if (!free_regs.empty()) {
+            current.reg = free_regs.back();
+            free_regs.pop_back();
+            active.push_back(index);
+            continue;
+        }
+        auto furthest = std::max_element(active.begin(), active.end(), [this](size_t a, size_t b) {
+            return allocated_intervals[a].end < allocated_intervals[b].end;
+        });
+        if (furthest != active.end() && allocated_intervals[*furthest].end > current.end) {
+            current.reg = allocated_intervals[*furthest].reg;
+            spill(*furthest);
+            *furthest = index;
+        } else {
+            spill(index);
+        }
+    }
+
+    for (const Interval& interval : allocated_intervals) {
+        allocation_count += interval.reg.has_value();
+    }
+}
+
+void RegisterAllocator::print_allocation_state(std::ostream& out) const {
+    out << fmt::format("Register allocation: {} intervals, {} in host registers, {} spilled, {} spill slots\n",
+        allocated_intervals.size(), allocation_count, spill_count, spill_slot_count);
+    for (const Interval& interval : allocated_intervals) {
+        std::string where = interval.reg ? register_name(*interval.reg)
+            : interval.spill_slot >= 0 ? fmt::format("slot {}", interval.spill_slot) : std::string("memory");
+        out << fmt::format("  v{:<3} [{:>3}, {:>3}] {}\n", interval.virt_reg, interval.start, interval.end, where);
+    }
+}
+
+} // namespace CodeGen
@@ -1,72 +1,83 @@
 #pragma once
-#include <unordered_map>
-#include <unordered_set>
-#include <vector>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
 #include <optional>
+#include <ostream>
+#include <vector>
 #include "x86_encoder.hpp"
-#include "../engine/cpu_registers.hpp"
 
 namespace CodeGen {
 
-// Maps DemiEngine's 134 registers to x86-64's 16 registers
+// Liveness-driven linear-scan register allocation over a block or region
+//
+// The region is a sequence of instructions, each naming the virtual
+// registers it reads and writes and the positions control can go to next
+// (leaving the region is not a successor). Liveness is solved over that
+// graph, and every virtual register gets one interval covering each
+// position where it is live or written. Intervals are handed host registers
+// in order of their start (Poletto and Sarkar's linear scan); when none is
+// free, whichever of the new interval and the active ones ends last is
+// spilled, so a register used throughout a hot loop keeps its host register
+// for the whole loop.
+//
+// Virtual registers below `homed` already live in memory (the guest
+// register file) and are spilled there. Any others get a spill slot, and a
+// slot is reused once the interval holding it has ended.
 class RegisterAllocator {
-private:
-    // Physical x86 registers available for allocation
-    static constexpr X86Register ALLOCATABLE_REGS[] = {
-        X86Register::RAX, X86Register::RCX, X86Register::RDX, X86Register::RBX,
-        X86Register::RSI, X86Register::RDI, X86Register::R8,  X86Register::R9,
-        X86Register::R10, X86Register::R11, X86Register::R12, X86Register::R13,
-        X86Register::R14, X86Register::R15
-        // RSP and RBP reserved for stack operations
-    };
-
-    // Current allocation state
-    std::unordered_map<uint8_t, X86Register> virt_to_phys;  // DemiEngine reg → x86 reg
-    std::unordered_set<X86Register> used_regs;              // Currently allocated x86 regs
-    std::unordered_map<uint8_t, bool> dirty_regs;           // Registers that need spilling
+public:
+    static constexpr size_t MAX_VIRTUAL_REGISTERS = 256;
+    using RegisterSet = std::bitset<MAX_VIRTUAL_REGISTERS>;
 
-    // Spill management
-    std::unordered_map<uint8_t, int32_t> spill_slots;       // DemiEngine reg → stack offset
-    int32_t next_spill_offset;
+    struct Instruction {
+        std::vector<uint8_t> uses;
+        std::vector<uint8_t> defs;
+        std::vector<uint32_t> successors;  ///< Positions within the region
+    };
 
-    // Statistics
-    size_t spill_count;
-    size_t allocation_count;
+    struct Interval {
+        uint8_t virt_reg;
+        uint32_t start;                  ///< First position, inclusive
+        uint32_t end;                    ///< Last position, inclusive
+        std::optional<X86Register> reg;  ///< Empty when spilled
+        int32_t spill_slot = -1;         ///< Spilled registers without a home only
+    };
 
-public:
-    RegisterAllocator();
+    RegisterAllocator(std::vector<X86Register> allocatable, size_t homed);
 
     // Core allocation interface
-    X86Register allocate_register(uint8_t virt_reg);
-    void free_register(uint8_t virt_reg);
-    bool is_allocated(uint8_t virt_reg) const;
+    void allocate(const std::vector<Instruction>& region);
 
-    // Get physical register for virtual register (may cause spill/reload)
-    X86Register get_physical_register(uint8_t virt_reg, X86Encoder& encoder);
+    // Host register holding virt_reg at a position, or empty if it is in memory there
+    std::optional<X86Register> get_physical_register(uint8_t virt_reg, uint32_t position) const;
 
-    // Spill management
-    void spill_register(uint8_t virt_reg, X86Encoder& encoder);
-    void reload_register(uint8_t virt_reg, X86Encoder& encoder);
-    void spill_all_dirty(X86Encoder& encoder);
+    // Virtual registers live on entry to a position
+    const RegisterSet& live_in(uint32_t position) const { return live_in_sets[position]; }
 
-    // Register pressure management
-    void mark_dirty(uint8_t virt_reg);
-    void mark_clean(uint8_t virt_reg);
-    X86Register evict_least_recently_used();
-
-    // Function boundaries
-    void reset_for_new_function();
-    void save_caller_saved_regs(X86Encoder& encoder);
-    void restore_caller_saved_regs(X86Encoder& encoder);
+    const std::vector<Interval>& intervals() const { return allocated_intervals; }
 
     // Debug and statistics
-    void print_allocation_state() const;
+    void print_allocation_state(std::ostream& out) const;
     size_t get_spill_count() const { return spill_count; }
     size_t get_allocation_count() const { return allocation_count; }
+    size_t get_spill_slot_count() const { return spill_slot_count; }
 
 private:
-    std::optional<X86Register> find_free_register();
-    int32_t allocate_spill_slot();
+    std::vector<X86Register> allocatable_regs;
+    size_t homed_regs;
+
+    std::vector<RegisterSet> live_in_sets;  // By position
+    std::vector<Interval> allocated_intervals;
+    std::vector<int> interval_of;           // By virtual register; -1 if it has none
+
+    // Statistics
+    size_t spill_count = 0;
+    size_t allocation_count = 0;
+    size_t spill_slot_count = 0;
+
+    void compute_liveness(const std::vector<Instruction>& region);
+    void build_intervals(const std::vector<Instruction>& region);
+    void linear_scan();
 };
 
 } // namespace CodeGen
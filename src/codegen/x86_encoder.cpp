@@ -24,6 +24,23 @@ void X86Encoder::emit_rex_if_needed(X86Register reg1, X86Register reg2) {
     }
 }
 
+void X86Encoder::emit_rex_optional(bool w, X86Register reg, X86Register rm, bool byte_regs) {
+    bool r = static_cast<uint8_t>(reg) >= 8;
+    bool b = static_cast<uint8_t>(rm) >= 8;
+    if (w || r || b || byte_regs) {
+        emit_rex(w, r, false, b);
+    }
+}
+
+void X86Encoder::emit_rex_optional(bool w, X86Register reg, const MemOperand& mem, bool byte_regs) {
+    bool r = static_cast<uint8_t>(reg) >= 8;
+    bool x = static_cast<uint8_t>(mem.index) >= 8;
+    bool b = static_cast<uint8_t>(mem.base) >= 8;
+    if (w || r || x || b || byte_regs) {
+        emit_rex(w, r, x, b);
+    }
+}
+
 void X86Encoder::emit_modrm(uint8_t mod, uint8_t reg, uint8_t rm) {
     uint8_t modrm = (mod << 6) | ((reg & 0x7) << 3) | (rm & 0x7);
     code_buffer.push_back(modrm);
@@ -33,6 +50,18 @@ uint8_t X86Encoder::reg_to_modrm(X86Register reg) {
     return static_cast<uint8_t>(reg) & 0x7;  // Lower 3 bits
 }
 
+void X86Encoder::emit_imm32(uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        code_buffer.push_back((value >> (i * 8)) & 0xFF);
+    }
+}
+
+void X86Encoder::emit_group_reg(uint8_t opcode, uint8_t digit, bool w, X86Register reg) {
+    emit_rex_optional(w, X86Register::RAX, reg);
+    code_buffer.push_back(opcode);
+    emit_modrm(0b11, digit, reg_to_modrm(reg));
+}
+
 // Basic MOV reg, reg
 void X86Encoder::emit_mov_reg_reg(X86Register dst, X86Register src) {
     emit_rex_if_needed(src, dst);  // REX.R for src, REX.B for dst
@@ -54,6 +83,22 @@ void X86Encoder::emit_mov_reg_imm64(X86Register dst, uint64_t imm) {
     }
 }
 
+// MOV r32, imm32 zero-extends, MOV r/m64, imm32 sign-extends; MOVABS otherwise
+void X86Encoder::emit_mov_reg_imm(X86Register dst, uint64_t imm) {
+    if (imm <= UINT32_MAX) {
+        emit_mov_reg32_imm32(dst, static_cast<uint32_t>(imm));
+    } else if (static_cast<int64_t>(imm) >= INT32_MIN && static_cast<int64_t>(imm) < 0) {
+        emit_mov_reg_imm32(dst, static_cast<int32_t>(imm));
+    } else {
+        emit_mov_reg_imm64(dst, imm);
+    }
+}
+
+void X86Encoder::emit_mov_reg_imm32(X86Register dst, int32_t imm) {
+    emit_group_reg(0xC7, 0, true, dst);  // MOV r/m64, imm32
+    emit_imm32(static_cast<uint32_t>(imm));
+}
+
 // ADD reg, reg
 void X86Encoder::emit_add_reg_reg(X86Register dst, X86Register src) {
     emit_rex_if_needed(src, dst);
@@ -75,42 +120,321 @@ void X86Encoder::emit_cmp_reg_reg(X86Register left, X86Register right) {
     emit_modrm(0b11, reg_to_modrm(right), reg_to_modrm(left));
 }
 
+// ALU op reg, reg (64-bit)
+void X86Encoder::emit_alu_reg_reg(AluOp op, X86Register dst, X86Register src) {
+    emit_rex_optional(true, src, dst);
+    code_buffer.push_back(static_cast<uint8_t>(op) * 8 + 1);  // op r/m64, r64
+    emit_modrm(0b11, reg_to_modrm(src), reg_to_modrm(dst));
+}
+
+// ALU op reg, imm (64-bit); sign-extended imm8 form when it fits
+void X86Encoder::emit_alu_reg_imm32(AluOp op, X86Register dst, int32_t imm) {
+    emit_rex(true, false, false, static_cast<uint8_t>(dst) >= 8);
+    if (imm >= -128 && imm <= 127) {
+        code_buffer.push_back(0x83);   // op r/m64, imm8
+        emit_modrm(0b11, static_cast<uint8_t>(op), reg_to_modrm(dst));
+        code_buffer.push_back(static_cast<uint8_t>(imm));
+    } else {
+        code_buffer.push_back(0x81);   // op r/m64, imm32
+        emit_modrm(0b11, static_cast<uint8_t>(op), reg_to_modrm(dst));
+        emit_imm32(static_cast<uint32_t>(imm));
+    }
+}
+
+// ALU op reg, [mem] (64-bit)
+void X86Encoder::emit_alu_reg_mem(AluOp op, X86Register dst, X86Register base, int32_t offset) {
+    emit_alu_reg_mem(op, dst, MemOperand(base, offset));
+}
+
+void X86Encoder::emit_alu_reg_mem(AluOp op, X86Register dst, const MemOperand& mem) {
+    emit_rex_optional(true, dst, mem);
+    code_buffer.push_back(static_cast<uint8_t>(op) * 8 + 3);  // op r64, r/m64
+    emit_mem_operand(reg_to_modrm(dst), mem);
+}
+
+void X86Encoder::emit_test_reg_reg(X86Register left, X86Register right) {
+    emit_rex_optional(true, right, left);
+    code_buffer.push_back(0x85);   // TEST r/m64, r64
+    emit_modrm(0b11, reg_to_modrm(right), reg_to_modrm(left));
+}
+
+// Shifts by 1 have their own opcode
+void X86Encoder::emit_shift_reg_imm(ShiftOp op, X86Register reg, uint8_t count) {
+    emit_group_reg(count == 1 ? 0xD1 : 0xC1, static_cast<uint8_t>(op), true, reg);
+    if (count != 1) {
+        code_buffer.push_back(count);
+    }
+}
+
+void X86Encoder::emit_shift_reg_cl(ShiftOp op, X86Register reg) {
+    emit_group_reg(0xD3, static_cast<uint8_t>(op), true, reg);  // op r/m64, CL
+}
+
+void X86Encoder::emit_imul_reg_reg(X86Register dst, X86Register src) {
+    emit_rex_optional(true, dst, src);
+    code_buffer.push_back(0x0F);
+    code_buffer.push_back(0xAF);   // IMUL r64, r/m64
+    emit_modrm(0b11, reg_to_modrm(dst), reg_to_modrm(src));
+}
+
+void X86Encoder::emit_inc_reg(X86Register reg) {
+    emit_group_reg(0xFF, 0, true, reg);  // INC r/m64
+}
+
+void X86Encoder::emit_dec_reg(X86Register reg) {
+    emit_group_reg(0xFF, 1, true, reg);  // DEC r/m64
+}
+
+void X86Encoder::emit_neg_reg(X86Register reg) {
+    emit_group_reg(0xF7, 3, true, reg);  // NEG r/m64
+}
+
+void X86Encoder::emit_cmov_reg_reg(Condition cc, X86Register dst, X86Register src) {
+    emit_rex_optional(true, dst, src);
+    code_buffer.push_back(0x0F);
+    code_buffer.push_back(0x40 + static_cast<uint8_t>(cc));  // CMOVcc r64, r/m64
+    emit_modrm(0b11, reg_to_modrm(dst), reg_to_modrm(src));
+}
+
+// 32-bit operations
+void X86Encoder::emit_mov_reg32_reg32(X86Register dst, X86Register src) {
+    emit_rex_optional(false, src, dst);
+    code_buffer.push_back(0x89);   // MOV r/m32, r32
+    emit_modrm(0b11, reg_to_modrm(src), reg_to_modrm(dst));
+}
+
+void X86Encoder::emit_mov_reg32_imm32(X86Register dst, uint32_t imm) {
+    emit_rex_optional(false, X86Register::RAX, dst);
+    code_buffer.push_back(0xB8 + reg_to_modrm(dst));  // MOV r32, imm32
+    emit_imm32(imm);
+}
+
+void X86Encoder::emit_alu_reg32_reg32(AluOp op, X86Register dst, X86Register src) {
+    emit_rex_optional(false, src, dst);
+    code_buffer.push_back(static_cast<uint8_t>(op) * 8 + 1);  // op r/m32, r32
+    emit_modrm(0b11, reg_to_modrm(src), reg_to_modrm(dst));
+}
+
+void X86Encoder::emit_alu_reg32_imm32(AluOp op, X86Register dst, int32_t imm) {
+    emit_rex_optional(false, X86Register::RAX, dst);
+    if (imm >= -128 && imm <= 127) {
+        code_buffer.push_back(0x83);   // op r/m32, imm8
+        emit_modrm(0b11, static_cast<uint8_t>(op), reg_to_modrm(dst));
+        code_buffer.push_back(static_cast<uint8_t>(imm));
+    } else {
+        code_buffer.push_back(0x81);   // op r/m32, imm32
+        emit_modrm(0b11, static_cast<uint8_t>(op), reg_to_modrm(dst));
+        emit_imm32(static_cast<uint32_t>(imm));
+    }
+}
+
+void X86Encoder::emit_test_reg32_reg32(X86Register left, X86Register right) {
+    emit_rex_optional(false, right, left);
+    code_buffer.push_back(0x85);   // TEST r/m32, r32
+    emit_modrm(0b11, reg_to_modrm(right), reg_to_modrm(left));
+}
+
+void X86Encoder::emit_test_reg32_imm32(X86Register reg, uint32_t imm) {
+    emit_group_reg(0xF7, 0, false, reg);  // TEST r/m32, imm32
+    emit_imm32(imm);
+}
+
+void X86Encoder::emit_shift_reg32_imm(ShiftOp op, X86Register reg, uint8_t count) {
+    emit_group_reg(count == 1 ? 0xD1 : 0xC1, static_cast<uint8_t>(op), false, reg);
+    if (count != 1) {
+        code_buffer.push_back(count);
+    }
+}
+
+void X86Encoder::emit_shift_reg32_cl(ShiftOp op, X86Register reg) {
+    emit_group_reg(0xD3, static_cast<uint8_t>(op), false, reg);  // op r/m32, CL
+}
+
+void X86Encoder::emit_not_reg32(X86Register reg) {
+    emit_group_reg(0xF7, 2, false, reg);  // NOT r/m32
+}
+
+void X86Encoder::emit_neg_reg32(X86Register reg) {
+    emit_group_reg(0xF7, 3, false, reg);  // NEG r/m32
+}
+
+void X86Encoder::emit_inc_reg32(X86Register reg) {
+    emit_group_reg(0xFF, 0, false, reg);  // INC r/m32
+}
+
+void X86Encoder::emit_dec_reg32(X86Register reg) {
+    emit_group_reg(0xFF, 1, false, reg);  // DEC r/m32
+}
+
+void X86Encoder::emit_imul_reg32_reg32(X86Register dst, X86Register src) {
+    emit_rex_optional(false, dst, src);
+    code_buffer.push_back(0x0F);
+    code_buffer.push_back(0xAF);   // IMUL r32, r/m32
+    emit_modrm(0b11, reg_to_modrm(dst), reg_to_modrm(src));
+}
+
+void X86Encoder::emit_imul_reg32_reg32_imm32(X86Register dst, X86Register src, int32_t imm) {
+    bool short_imm = imm >= -128 && imm <= 127;
+    emit_rex_optional(false, dst, src);
+    code_buffer.push_back(short_imm ? 0x6B : 0x69);  // IMUL r32, r/m32, imm8/imm32
+    emit_modrm(0b11, reg_to_modrm(dst), reg_to_modrm(src));
+    if (short_imm) {
+        code_buffer.push_back(static_cast<uint8_t>(imm));
+    } else {
+        emit_imm32(static_cast<uint32_t>(imm));
+    }
+}
+
+void X86Encoder::emit_mul_reg32(X86Register src) {
+    emit_group_reg(0xF7, 4, false, src);  // MUL r/m32
+}
+
+void X86Encoder::emit_div_reg32(X86Register src) {
+    emit_group_reg(0xF7, 6, false, src);  // DIV r/m32
+}
+
+void X86Encoder::emit_idiv_reg32(X86Register src) {
+    emit_group_reg(0xF7, 7, false, src);  // IDIV r/m32
+}
+
+void X86Encoder::emit_cdq() {
+    code_buffer.push_back(0x99);   // CDQ
+}
+
+void X86Encoder::emit_movzx_reg32_reg8(X86Register dst, X86Register src) {
+    emit_rex_optional(false, dst, src, static_cast<uint8_t>(src) >= 4);
+    code_buffer.push_back(0x0F);
+    code_buffer.push_back(0xB6);   // MOVZX r32, r/m8
+    emit_modrm(0b11, reg_to_modrm(dst), reg_to_modrm(src));
+}
+
+void X86Encoder::emit_setcc(Condition cc, X86Register dst) {
+    emit_rex_optional(false, X86Register::RAX, dst, static_cast<uint8_t>(dst) >= 4);
+    code_buffer.push_back(0x0F);
+    code_buffer.push_back(0x90 + static_cast<uint8_t>(cc));  // SETcc r/m8
+    emit_modrm(0b11, 0, reg_to_modrm(dst));
+}
+
+void X86Encoder::emit_cmov_reg32_reg32(Condition cc, X86Register dst, X86Register src) {
+    emit_rex_optional(false, dst, src);
+    code_buffer.push_back(0x0F);
+    code_buffer.push_back(0x40 + static_cast<uint8_t>(cc));  // CMOVcc r32, r/m32
+    emit_modrm(0b11, reg_to_modrm(dst), reg_to_modrm(src));
+}
+
 // Memory operations
-void X86Encoder::emit_mov_reg_mem(X86Register dst, X86Register base, int32_t offset) {
-    emit_rex_if_needed(dst, base);
-    code_buffer.push_back(0x8B);   // MOV r64, r/m64
-    
-    if (offset == 0 && base != X86Register::RBP) {
-        // [reg] - no displacement
-        emit_modrm(0b00, reg_to_modrm(dst), reg_to_modrm(base));
-    } else if (offset >= -128 && offset <= 127) {
-        // [reg + disp8]
-        emit_modrm(0b01, reg_to_modrm(dst), reg_to_modrm(base));
-        code_buffer.push_back(static_cast<uint8_t>(offset));
+void X86Encoder::emit_mem_operand(uint8_t reg, const MemOperand& mem) {
+    assert(mem.scale == 1 || mem.scale == 2 || mem.scale == 4 || mem.scale == 8);
+    uint8_t base = reg_to_modrm(mem.base);
+    // RSP/R12 as base, or any index, needs a SIB byte
+    bool sib = mem.index != X86Register::RSP || base == 4;
+    bool disp8 = mem.disp >= -128 && mem.disp <= 127;
+    uint8_t mod;
+    if (mem.disp == 0 && base != 5) {
+        mod = 0b00;  // No displacement (RBP/R13 in this slot mean RIP-relative or none)
+    } else if (disp8) {
+        mod = 0b01;
     } else {
-        // [reg + disp32]
-        emit_modrm(0b10, reg_to_modrm(dst), reg_to_modrm(base));
-        for (int i = 0; i < 4; i++) {
-            code_buffer.push_back((offset >> (i * 8)) & 0xFF);
-        }
+        mod = 0b10;
+    }
+    emit_modrm(mod, reg, sib ? 4 : base);
+    if (sib) {
+        uint8_t scale = mem.scale == 8 ? 3 : mem.scale == 4 ? 2 : mem.scale == 2 ? 1 : 0;
+        code_buffer.push_back(static_cast<uint8_t>((scale << 6) | (reg_to_modrm(mem.index) << 3) | base));
+    }
+    if (mod == 0b01) {
+        code_buffer.push_back(static_cast<uint8_t>(mem.disp));
+    } else if (mod == 0b10) {
+        emit_imm32(static_cast<uint32_t>(mem.disp));
     }
 }
 
+void X86Encoder::emit_mov_reg_mem(X86Register dst, X86Register base, int32_t offset) {
+    emit_mov_reg_mem(dst, MemOperand(base, offset));
+}
+
 void X86Encoder::emit_mov_mem_reg(X86Register base, int32_t offset, X86Register src) {
-    emit_rex_if_needed(src, base);
+    emit_mov_mem_reg(MemOperand(base, offset), src);
+}
+
+void X86Encoder::emit_mov_reg32_mem(X86Register dst, X86Register base, int32_t offset) {
+    emit_mov_reg32_mem(dst, MemOperand(base, offset));
+}
+
+void X86Encoder::emit_mov_mem_reg32(X86Register base, int32_t offset, X86Register src) {
+    emit_mov_mem_reg32(MemOperand(base, offset), src);
+}
+
+void X86Encoder::emit_mov_mem_imm32(X86Register base, int32_t offset, uint32_t imm) {
+    emit_mov_mem_imm32(MemOperand(base, offset), imm);
+}
+
+void X86Encoder::emit_movzx_reg32_mem8(X86Register dst, X86Register base, int32_t offset) {
+    emit_movzx_reg32_mem8(dst, MemOperand(base, offset));
+}
+
+void X86Encoder::emit_mov_mem8_reg8(X86Register base, int32_t offset, X86Register src) {
+    emit_mov_mem8_reg8(MemOperand(base, offset), src);
+}
+
+void X86Encoder::emit_lea_reg32_mem(X86Register dst, X86Register base, int32_t offset) {
+    emit_lea_reg32_mem(dst, MemOperand(base, offset));
+}
+
+void X86Encoder::emit_mov_reg_mem(X86Register dst, const MemOperand& mem) {
+    emit_rex_optional(true, dst, mem);
+    code_buffer.push_back(0x8B);   // MOV r64, r/m64
+    emit_mem_operand(reg_to_modrm(dst), mem);
+}
+
+void X86Encoder::emit_mov_mem_reg(const MemOperand& mem, X86Register src) {
+    emit_rex_optional(true, src, mem);
     code_buffer.push_back(0x89);   // MOV r/m64, r64
-    
-    if (offset == 0 && base != X86Register::RBP) {
-        emit_modrm(0b00, reg_to_modrm(src), reg_to_modrm(base));
-    } else if (offset >= -128 && offset <= 127) {
-        emit_modrm(0b01, reg_to_modrm(src), reg_to_modrm(base));
-        code_buffer.push_back(static_cast<uint8_t>(offset));
-    } else {
-        emit_modrm(0b10, reg_to_modrm(src), reg_to_modrm(base));
-        for (int i = 0; i < 4; i++) {
-            code_buffer.push_back((offset >> (i * 8)) & 0xFF);
-        }
-    }
+    emit_mem_operand(reg_to_modrm(src), mem);
+}
+
+void X86Encoder::emit_mov_reg32_mem(X86Register dst, const MemOperand& mem) {
+    emit_rex_optional(false, dst, mem);
+    code_buffer.push_back(0x8B);   // MOV r32, r/m32
+    emit_mem_operand(reg_to_modrm(dst), mem);
+}
+
+void X86Encoder::emit_mov_mem_reg32(const MemOperand& mem, X86Register src) {
+    emit_rex_optional(false, src, mem);
+    code_buffer.push_back(0x89);   // MOV r/m32, r32
+    emit_mem_operand(reg_to_modrm(src), mem);
+}
+
+void X86Encoder::emit_mov_mem_imm32(const MemOperand& mem, uint32_t imm) {
+    emit_rex_optional(false, X86Register::RAX, mem);
+    code_buffer.push_back(0xC7);   // MOV r/m32, imm32
+    emit_mem_operand(0, mem);
+    emit_imm32(imm);
+}
+
+void X86Encoder::emit_movzx_reg32_mem8(X86Register dst, const MemOperand& mem) {
+    emit_rex_optional(false, dst, mem);
+    code_buffer.push_back(0x0F);
+    code_buffer.push_back(0xB6);   // MOVZX r32, r/m8
+    emit_mem_operand(reg_to_modrm(dst), mem);
+}
+
+void X86Encoder::emit_mov_mem8_reg8(const MemOperand& mem, X86Register src) {
+    emit_rex_optional(false, src, mem, static_cast<uint8_t>(src) >= 4);
+    code_buffer.push_back(0x88);   // MOV r/m8, r8
+    emit_mem_operand(reg_to_modrm(src), mem);
+}
+
+void X86Encoder::emit_lea_reg_mem(X86Register dst, const MemOperand& mem) {
+    emit_rex_optional(true, dst, mem);
+    code_buffer.push_back(0x8D);   // LEA r64, m
+    emit_mem_operand(reg_to_modrm(dst), mem);
+}
+
+void X86Encoder::emit_lea_reg32_mem(X86Register dst, const MemOperand& mem) {
+    emit_rex_optional(false, dst, mem);
+    code_buffer.push_back(0x8D);   // LEA r32, m
+    emit_mem_operand(reg_to_modrm(dst), mem);
 }
 
 // Stack operations
@@ -129,6 +453,16 @@ void X86Encoder::emit_pop_reg(X86Register reg) {
 }
 
 // Control flow
+void X86Encoder::emit_jmp_rel8(int8_t offset) {
+    code_buffer.push_back(0xEB);   // JMP rel8
+    code_buffer.push_back(static_cast<uint8_t>(offset));
+}
+
+void X86Encoder::emit_jcc_rel8(Condition cc, int8_t offset) {
+    code_buffer.push_back(0x70 + static_cast<uint8_t>(cc));  // Jcc rel8
+    code_buffer.push_back(static_cast<uint8_t>(offset));
+}
+
 void X86Encoder::emit_jmp_rel32(int32_t offset) {
     code_buffer.push_back(0xE9);   // JMP rel32
     for (int i = 0; i < 4; i++) {
@@ -137,19 +471,23 @@ void X86Encoder::emit_jmp_rel32(int32_t offset) {
 }
 
 void X86Encoder::emit_jz_rel32(int32_t offset) {
-    code_buffer.push_back(0x0F);   // Two-byte opcode prefix
-    code_buffer.push_back(0x84);   // JZ rel32
-    for (int i = 0; i < 4; i++) {
-        code_buffer.push_back((offset >> (i * 8)) & 0xFF);
-    }
+    emit_jcc_rel32(Condition::E, offset);
 }
 
 void X86Encoder::emit_jnz_rel32(int32_t offset) {
-    code_buffer.push_back(0x0F);   // Two-byte opcode prefix  
-    code_buffer.push_back(0x85);   // JNZ rel32
-    for (int i = 0; i < 4; i++) {
-        code_buffer.push_back((offset >> (i * 8)) & 0xFF);
-    }
+    emit_jcc_rel32(Condition::NE, offset);
+}
+
+void X86Encoder::emit_jcc_rel32(Condition cc, int32_t offset) {
+    code_buffer.push_back(0x0F);   // Two-byte opcode prefix
+    code_buffer.push_back(0x80 + static_cast<uint8_t>(cc));  // Jcc rel32
+    emit_imm32(static_cast<uint32_t>(offset));
+}
+
+void X86Encoder::emit_jmp_reg(X86Register target) {
+    emit_rex_optional(false, X86Register::RAX, target);
+    code_buffer.push_back(0xFF);   // JMP r/m64
+    emit_modrm(0b11, 4, reg_to_modrm(target));
 }
 
 void X86Encoder::emit_call_rel32(int32_t offset) {
@@ -159,10 +497,21 @@ void X86Encoder::emit_call_rel32(int32_t offset) {
     }
 }
 
+void X86Encoder::emit_call_reg(X86Register target) {
+    emit_rex_optional(false, X86Register::RAX, target);
+    code_buffer.push_back(0xFF);   // CALL r/m64
+    emit_modrm(0b11, 2, reg_to_modrm(target));
+}
+
 void X86Encoder::emit_ret() {
     code_buffer.push_back(0xC3);   // RET
 }
 
+void X86Encoder::emit_syscall() {
+    code_buffer.push_back(0x0F);   // SYSCALL
+    code_buffer.push_back(0x05);
+}
+
 // Utility
 void X86Encoder::emit_nop() {
     code_buffer.push_back(0x90);   // NOP
@@ -172,12 +521,27 @@ void X86Encoder::emit_int3() {
     code_buffer.push_back(0xCC);   // INT 3 (breakpoint)
 }
 
-// Label management (simplified for now)
+// Label management
 X86Encoder::Label X86Encoder::create_label() {
     return Label{0, false, {}};
 }
 
 void X86Encoder::bind_label(Label& label) {
+    // Nothing after the last forward jump depends on where it lands yet, so
+    // it can still become rel8; the code after it just moves up
+    if (!label.unresolved_jumps.empty() && label.unresolved_jumps.back() == relaxable_jump) {
+        size_t field = relaxable_jump;
+        size_t distance = code_buffer.size() - (field + 4);
+        if (distance <= 127) {
+            bool is_jmp = code_buffer[field - 1] == 0xE9;
+            size_t start = is_jmp ? field - 1 : field - 2;
+            code_buffer[start] = is_jmp ? 0xEB : 0x70 + (code_buffer[field - 1] & 0x0F);
+            code_buffer[start + 1] = static_cast<uint8_t>(distance);
+            code_buffer.erase(code_buffer.begin() + start + 2, code_buffer.begin() + field + 4);
+            label.unresolved_jumps.pop_back();
+        }
+    }
+    relaxable_jump = NO_RELAXABLE_JUMP;
     label.position = code_buffer.size();
     label.bound = true;
     
@@ -193,33 +557,55 @@ void X86Encoder::bind_label(Label& label) {
 }
 
 void X86Encoder::emit_jmp_label(Label& label) {
+    relaxable_jump = NO_RELAXABLE_JUMP;
     if (label.bound) {
+        int64_t short_offset = static_cast<int64_t>(label.position) - static_cast<int64_t>(code_buffer.size() + 2);
+        if (short_offset >= -128) {
+            emit_jmp_rel8(static_cast<int8_t>(short_offset));
+            return;
+        }
         int32_t offset = static_cast<int32_t>(label.position - (code_buffer.size() + 5));
         emit_jmp_rel32(offset);
     } else {
         // Forward reference - save position for later patching
         label.unresolved_jumps.push_back(code_buffer.size() + 1);  // +1 to skip opcode
         emit_jmp_rel32(0);  // Placeholder offset
+        relaxable_jump = label.unresolved_jumps.back();
     }
 }
 
 void X86Encoder::emit_jz_label(Label& label) {
+    emit_jcc_label(Condition::E, label);
+}
+
+void X86Encoder::emit_jnz_label(Label& label) {
+    emit_jcc_label(Condition::NE, label);
+}
+
+void X86Encoder::emit_jcc_label(Condition cc, Label& label) {
+    relaxable_jump = NO_RELAXABLE_JUMP;
     if (label.bound) {
+        int64_t short_offset = static_cast<int64_t>(label.position) - static_cast<int64_t>(code_buffer.size() + 2);
+        if (short_offset >= -128) {
+            emit_jcc_rel8(cc, static_cast<int8_t>(short_offset));
+            return;
+        }
         int32_t offset = static_cast<int32_t>(label.position - (code_buffer.size() + 6));
-        emit_jz_rel32(offset);
+        emit_jcc_rel32(cc, offset);
     } else {
         label.unresolved_jumps.push_back(code_buffer.size() + 2);  // +2 for two-byte opcode
-        emit_jz_rel32(0);
+        emit_jcc_rel32(cc, 0);
+        relaxable_jump = label.unresolved_jumps.back();
     }
 }
 
-void X86Encoder::emit_jnz_label(Label& label) {
+void X86Encoder::emit_call_label(Label& label) {
+    relaxable_jump = NO_RELAXABLE_JUMP;
     if (label.bound) {
-        int32_t offset = static_cast<int32_t>(label.position - (code_buffer.size() + 6));
-        emit_jnz_rel32(offset);
+        emit_call_rel32(static_cast<int32_t>(label.position - (code_buffer.size() + 5)));
     } else {
-        label.unresolved_jumps.push_back(code_buffer.size() + 2);
-        emit_jnz_rel32(0);
+        label.unresolved_jumps.push_back(code_buffer.size() + 1);
+        emit_call_rel32(0);
     }
 }
 
@@ -13,52 +13,157 @@ enum class X86Register : uint8_t {
     R12 = 12, R13 = 13, R14 = 14, R15 = 15
 };
 
+// Condition codes shared by Jcc and SETcc (the low nibble of their opcodes)
+enum class Condition : uint8_t {
+    O = 0x0, NO = 0x1, B = 0x2, AE = 0x3,  // B/AE: carry set/clear
+    E = 0x4, NE = 0x5, BE = 0x6, A = 0x7,  // E/NE: zero set/clear
+    S = 0x8, NS = 0x9, P = 0xA, NP = 0xB,
+    L = 0xC, GE = 0xD, LE = 0xE, G = 0xF
+};
+
+// Two-operand ALU group; the value is the /digit of the immediate forms
+enum class AluOp : uint8_t {
+    ADD = 0, OR = 1, ADC = 2, SBB = 3, AND = 4, SUB = 5, XOR = 6, CMP = 7
+};
+
+// Shift and rotate group; the value is the /digit
+enum class ShiftOp : uint8_t {
+    ROL = 0, ROR = 1, SHL = 4, SHR = 5, SAR = 7
+};
+
+// Memory operand [base + index * scale + disp]
+struct MemOperand {
+    X86Register base;
+    X86Register index = X86Register::RSP;  // RSP cannot be an index; it means none
+    uint8_t scale = 1;                     // 1, 2, 4 or 8
+    int32_t disp = 0;
+
+    MemOperand(X86Register base, int32_t disp = 0) : base(base), disp(disp) {}
+    MemOperand(X86Register base, X86Register index, uint8_t scale, int32_t disp = 0)
+        : base(base), index(index), scale(scale), disp(disp) {}
+};
+
 // x86-64 Instruction encoder
 class X86Encoder {
 private:
     std::vector<uint8_t> code_buffer;
+    // rel32 field of the last forward label jump, while no code after it has
+    // been measured or referenced; bind_label may still shrink that jump
+    static constexpr size_t NO_RELAXABLE_JUMP = SIZE_MAX;
+    mutable size_t relaxable_jump = NO_RELAXABLE_JUMP;
 
     // REX prefix helpers
     void emit_rex(bool w, bool r, bool x, bool b);
     void emit_rex_if_needed(X86Register reg1, X86Register reg2 = X86Register::RAX);
 
+    // REX prefix only when something needs it: 64-bit operands, R8-R15, or
+    // SPL/BPL/SIL/DIL as byte registers (byte_regs)
+    void emit_rex_optional(bool w, X86Register reg, X86Register rm, bool byte_regs = false);
+    void emit_rex_optional(bool w, X86Register reg, const MemOperand& mem, bool byte_regs = false);
+
     // ModR/M and SIB helpers
     void emit_modrm(uint8_t mod, uint8_t reg, uint8_t rm);
     uint8_t reg_to_modrm(X86Register reg);
+    // ModR/M, SIB when needed, and the shortest displacement
+    void emit_mem_operand(uint8_t reg, const MemOperand& mem);
+    void emit_imm32(uint32_t value);
+    void emit_group_reg(uint8_t opcode, uint8_t digit, bool w, X86Register reg);  // opcode /digit on a register
 
 public:
     X86Encoder() = default;
 
     // Basic instruction emission
     void emit_mov_reg_reg(X86Register dst, X86Register src);
-    void emit_mov_reg_imm64(X86Register dst, uint64_t imm);
+    void emit_mov_reg_imm64(X86Register dst, uint64_t imm);  // Always the 10-byte MOVABS
+    void emit_mov_reg_imm(X86Register dst, uint64_t imm);    // Shortest form that yields imm
+    void emit_mov_reg_imm32(X86Register dst, int32_t imm);   // Sign-extended to 64 bits
     void emit_add_reg_reg(X86Register dst, X86Register src);
     void emit_sub_reg_reg(X86Register dst, X86Register src);
     void emit_cmp_reg_reg(X86Register left, X86Register right);
+    void emit_alu_reg_reg(AluOp op, X86Register dst, X86Register src);
+    void emit_alu_reg_imm32(AluOp op, X86Register dst, int32_t imm);
+    void emit_alu_reg_mem(AluOp op, X86Register dst, X86Register base, int32_t offset);
+    void emit_alu_reg_mem(AluOp op, X86Register dst, const MemOperand& mem);
+    void emit_test_reg_reg(X86Register left, X86Register right);
+    void emit_shift_reg_imm(ShiftOp op, X86Register reg, uint8_t count);
+    void emit_shift_reg_cl(ShiftOp op, X86Register reg);
+    void emit_imul_reg_reg(X86Register dst, X86Register src);
+    void emit_inc_reg(X86Register reg);
+    void emit_dec_reg(X86Register reg);
+    void emit_neg_reg(X86Register reg);
+    void emit_cmov_reg_reg(Condition cc, X86Register dst, X86Register src);
+
+    // 32-bit operations; writing a 32-bit register clears its upper half
+    void emit_mov_reg32_reg32(X86Register dst, X86Register src);
+    void emit_mov_reg32_imm32(X86Register dst, uint32_t imm);
+    void emit_alu_reg32_reg32(AluOp op, X86Register dst, X86Register src);
+    void emit_alu_reg32_imm32(AluOp op, X86Register dst, int32_t imm);
+    void emit_test_reg32_reg32(X86Register left, X86Register right);
+    void emit_test_reg32_imm32(X86Register reg, uint32_t imm);
+    void emit_shift_reg32_imm(ShiftOp op, X86Register reg, uint8_t count);
+    void emit_shift_reg32_cl(ShiftOp op, X86Register reg);
+    void emit_shl_reg32_imm(X86Register reg, uint8_t count) { emit_shift_reg32_imm(ShiftOp::SHL, reg, count); }
+    void emit_shr_reg32_imm(X86Register reg, uint8_t count) { emit_shift_reg32_imm(ShiftOp::SHR, reg, count); }
+    void emit_not_reg32(X86Register reg);
+    void emit_neg_reg32(X86Register reg);
+    void emit_inc_reg32(X86Register reg);
+    void emit_dec_reg32(X86Register reg);
+    void emit_imul_reg32_reg32(X86Register dst, X86Register src);
+    void emit_imul_reg32_reg32_imm32(X86Register dst, X86Register src, int32_t imm);
+    void emit_mul_reg32(X86Register src);   // EDX:EAX = EAX * src
+    void emit_div_reg32(X86Register src);   // EAX = EDX:EAX / src, EDX = remainder
+    void emit_idiv_reg32(X86Register src);  // Signed; EDX:EAX from CDQ
+    void emit_cdq();                        // EDX = sign of EAX
+    void emit_movzx_reg32_reg8(X86Register dst, X86Register src);
+    void emit_setcc(Condition cc, X86Register dst);  // Low byte of dst = cc ? 1 : 0
+    void emit_cmov_reg32_reg32(Condition cc, X86Register dst, X86Register src);
 
-    // Memory operations
+    // Memory operations; the (base, offset) forms are [base + offset]
     void emit_mov_reg_mem(X86Register dst, X86Register base, int32_t offset = 0);
     void emit_mov_mem_reg(X86Register base, int32_t offset, X86Register src);
+    void emit_mov_reg32_mem(X86Register dst, X86Register base, int32_t offset);
+    void emit_mov_mem_reg32(X86Register base, int32_t offset, X86Register src);
+    void emit_mov_mem_imm32(X86Register base, int32_t offset, uint32_t imm);
+    void emit_movzx_reg32_mem8(X86Register dst, X86Register base, int32_t offset);
+    void emit_mov_mem8_reg8(X86Register base, int32_t offset, X86Register src);
+    void emit_lea_reg32_mem(X86Register dst, X86Register base, int32_t offset);
+
+    void emit_mov_reg_mem(X86Register dst, const MemOperand& mem);
+    void emit_mov_mem_reg(const MemOperand& mem, X86Register src);
+    void emit_mov_reg32_mem(X86Register dst, const MemOperand& mem);
+    void emit_mov_mem_reg32(const MemOperand& mem, X86Register src);
+    void emit_mov_mem_imm32(const MemOperand& mem, uint32_t imm);
+    void emit_movzx_reg32_mem8(X86Register dst, const MemOperand& mem);
+    void emit_mov_mem8_reg8(const MemOperand& mem, X86Register src);
+    void emit_lea_reg_mem(X86Register dst, const MemOperand& mem);
+    void emit_lea_reg32_mem(X86Register dst, const MemOperand& mem);
 
     // Stack operations
     void emit_push_reg(X86Register reg);
     void emit_pop_reg(X86Register reg);
 
-    // Control flow
+    // Control flow; offsets are from the end of the instruction
+    void emit_jmp_rel8(int8_t offset);
+    void emit_jcc_rel8(Condition cc, int8_t offset);
     void emit_jmp_rel32(int32_t offset);
     void emit_jz_rel32(int32_t offset);
     void emit_jnz_rel32(int32_t offset);
+    void emit_jcc_rel32(Condition cc, int32_t offset);
+    void emit_jmp_reg(X86Register target);
     void emit_call_rel32(int32_t offset);
+    void emit_call_reg(X86Register target);
     void emit_ret();
+    void emit_syscall();  // Clobbers RCX and R11
 
     // Program structure
     void emit_nop();
     void emit_int3();  // Breakpoint for debugging
 
     // Code buffer management
-    const std::vector<uint8_t>& get_code() const { return code_buffer; }
-    void clear() { code_buffer.clear(); }
-    size_t size() const { return code_buffer.size(); }
+    // Reading the code or its size fixes everything emitted so far in place
+    const std::vector<uint8_t>& get_code() const { relaxable_jump = NO_RELAXABLE_JUMP; return code_buffer; }
+    void clear() { code_buffer.clear(); relaxable_jump = NO_RELAXABLE_JUMP; }
+    size_t size() const { relaxable_jump = NO_RELAXABLE_JUMP; return code_buffer.size(); }
 
     // Label/jump management for forward references
     struct Label {
@@ -67,11 +172,19 @@ public:
         std::vector<size_t> unresolved_jumps;
     };
 
+    // Jumps to a bound label use rel8 when it reaches. Jumps to a label not
+    // bound yet are emitted as rel32 and patched by bind_label, which shrinks
+    // the most recent one to rel8 when it reaches and nothing emitted since
+    // has been measured (size, get_code) or refers to a label. Other forward
+    // jumps stay rel32: shrinking them would move code whose offsets are
+    // already recorded.
     Label create_label();
     void bind_label(Label& label);
     void emit_jmp_label(Label& label);
     void emit_jz_label(Label& label);
     void emit_jnz_label(Label& label);
+    void emit_jcc_label(Condition cc, Label& label);
+    void emit_call_label(Label& label);  // Always rel32
 };
 
 } // namespace CodeGen
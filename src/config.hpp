@@ -9,9 +9,27 @@ public:    inline static bool debug = false;
     inline static bool extended_registers = false;  // Show extended register output
     inline static bool assembly_mode = false;  // Assembly mode enabled
     inline static std::string debug_file = "debug.log";
+    inline static bool async_log = false;  // Format and write log output on a background thread
+    inline static std::string trace_file = "";  // Record a binary execution trace here
+    inline static std::string trace_decode = "";  // Print this binary trace instead of running anything
+    inline static std::string trace_filter = "";  // Decoder filter: symbol name or PC range (0xA-0xB)
+    inline static std::string profile_file = "";  // Sample guest stacks; folded stacks go here, flat profile to stdout
+    inline static unsigned long long profile_interval = 1000;  // Virtual cycles between profiler samples
+    inline static bool instruction_stats = false;  // Count executions per opcode and print the instruction mix
+    inline static std::string stats_json = "";  // Also export the instruction mix as JSON here
+    inline static std::string stats_prometheus = "";  // Also export the instruction mix in Prometheus text format here
+    inline static unsigned hot_blocks = 0;  // Count basic-block executions and list this many hot blocks (0 = off)
+    inline static bool jit = false;  // Run compiled basic blocks as native code
+    inline static unsigned jit_threshold = 100;  // Entries before a block is compiled (0 = compile everything up front)
+    inline static std::string record_input = "";  // Journal every device read and interrupt to this file
+    inline static std::string replay_input = "";  // Feed device reads and interrupts from this journal instead
     inline static std::string program_file = "";
     inline static std::string assembly_file = "";  // Assembly source file
     inline static std::string output_name = "";  // Output name for compiled executable
+    inline static bool mmap_storage = false;  // Map virtual_storage files instead of loading them
+    inline static std::string block_image = "";  // Backing file for the block device (empty = sparse memory)
+    inline static std::string block_base = "";  // Shared base image; block_image becomes its copy-on-write overlay
+    inline static std::string console_flush = "newline";  // Console flush policy: newline, threshold or halt
     inline static int error_count = 0;
 };
 
@@ -0,0 +1,108 @@
+#include "block_profiler.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+#include <fmt/core.h>
+
+#include "../engine/cpu.hpp"
+
+namespace Profiling {
+
+BlockProfiler::BlockProfiler(const std::vector<uint8_t>& program)
+    : block_at_start_(program.size(), NO_BLOCK) {
+    // Cut the instruction stream at every leader
+    ControlFlow flow = scan_control_flow(program);
+    for (uint32_t pc : flow.starts) {
+        if (blocks_.empty() || flow.leaders.count(pc)) {
+            block_at_start_[pc] = static_cast<uint32_t>(blocks_.size());
+            blocks_.push_back({pc, pc, 0, 0, NO_BLOCK, 0});
+        }
+        Block& block = blocks_.back();
+        block.end = pc + static_cast<uint32_t>(instruction_length(program, pc));
+        ++block.instructions;
+    }
+
+    // Loops in header order; outer loops come first and contain later ones
+    for (const auto& [header, end] : flow.loop_ends) {
+        uint32_t depth = 1;
+        for (const Loop& outer : loops_) {
+            if (outer.header <= header && header < outer.end) ++depth;
+        }
+        loops_.push_back({header, end, depth});
+    }
+    for (Block& block : blocks_) {
+        for (const Loop& loop : loops_) {
+            if (loop.header <= block.start && block.start < loop.end) {
+                ++block.loop_depth;
+                block.loop_header = loop.header;  // Later headers are further in
+            }
+        }
+    }
+}
+
+const BlockProfiler::Block* BlockProfiler::block_containing(uint32_t pc) const {
+    auto it = std::upper_bound(blocks_.begin(), blocks_.end(), pc,
+        [](uint32_t address, const Block& block) { return address < block.start; });
+    if (it == blocks_.begin()) {
+        return nullptr;
+    }
+    const Block& block = *std::prev(it);
+    return pc < block.end ? &block : nullptr;
+}
+
+std::vector<const BlockProfiler::Block*> BlockProfiler::hot_blocks(size_t limit) const {
+    std::vector<const Block*> hot;
+    for (const Block& block : blocks_) {
+        if (block.count) hot.push_back(&block);
+    }
+    std::stable_sort(hot.begin(), hot.end(), [](const Block* a, const Block* b) {
+        return a->count * a->instructions > b->count * b->instructions;
+    });
+    if (hot.size() > limit) {
+        hot.resize(limit);
+    }
+    return hot;
+}
+
+void BlockProfiler::set_symbols(std::map<uint32_t, std::string> symbols) {
+    symbols_ = std::move(symbols);
+}
+
+void BlockProfiler::reset() {
+    for (Block& block : blocks_) {
+        block.count = 0;
+    }
+}
+
+std::string BlockProfiler::location(uint32_t pc) const {
+    auto it = symbols_.upper_bound(pc);
+    if (it == symbols_.begin()) {
+        return "";
+    }
+    --it;
+    uint32_t offset = pc - it->first;
+    return offset == 0 ? it->second : fmt::format("{}+0x{:X}", it->second, offset);
+}
+
+void BlockProfiler::write_hot(std::ostream& out, size_t limit) const {
+    uint64_t executed = 0;
+    for (const Block& block : blocks_) {
+        executed += block.count * block.instructions;
+    }
+    double scale = executed ? 100.0 / static_cast<double>(executed) : 0.0;
+
+    out << fmt::format("Hot blocks: {} blocks, {} loops, {} instructions executed\n",
+        blocks_.size(), loops_.size(), executed);
+    out << fmt::format("  {:<13} {:>5} {:>10} {:>7} {:>5} {:>6}  {}\n",
+        "block", "insns", "entries", "share", "depth", "loop", "symbol");
+    for (const Block* block : hot_blocks(limit)) {
+        out << fmt::format("  0x{:04X}-0x{:04X} {:>5} {:>10} {:>6.2f}% {:>5} {:>6}  {}\n",
+            block->start, block->end, block->instructions, block->count,
+            static_cast<double>(block->count * block->instructions) * scale, block->loop_depth,
+            block->loop_header == NO_BLOCK ? std::string("-") : fmt::format("0x{:04X}", block->loop_header),
+            location(block->start));
+    }
+}
+
+} // namespace Profiling
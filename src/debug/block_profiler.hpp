@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Profiling {
+
+/**
+ * @brief Counts executions per basic block and finds the hot loops
+ *
+ * The program is split into basic blocks once, up front: a block starts at
+ * address 0, at every jump or call target and after every instruction that
+ * transfers control (jumps, CALL, RET, IRET, HALT). While attached to a CPU,
+ * entering a block costs a table lookup and an increment.
+ *
+ * Loops are found from backward jumps: a jump from inside [header, end) back
+ * to header makes that range a loop, and a block's loop depth is the number
+ * of loops containing it. That is exact for the structured loops the
+ * assembler produces and a good approximation otherwise.
+ */
+class BlockProfiler {
+public:
+    static constexpr uint32_t NO_BLOCK = UINT32_MAX;
+
+    struct Block {
+        uint32_t start;         ///< Address of the first instruction
+        uint32_t end;           ///< Address just past the last instruction
+        uint32_t instructions;  ///< Instructions in the block
+        uint32_t loop_depth;    ///< Number of loops containing the block (0 = straight-line code)
+        uint32_t loop_header;   ///< Header of the innermost containing loop, or NO_BLOCK
+        uint64_t count;         ///< Times the block was entered
+    };
+
+    struct Loop {
+        uint32_t header;  ///< Target of the backward jump
+        uint32_t end;     ///< Address just past the furthest backward jump to header
+        uint32_t depth;   ///< 1 for outermost loops
+    };
+
+    /**
+     * @brief Find the blocks and loops of a program
+     */
+    explicit BlockProfiler(const std::vector<uint8_t>& program);
+
+    /**
+     * @brief Called by the CPU before each instruction; counts the block if pc starts one
+     */
+    void enter(uint32_t pc) {
+        if (pc < block_at_start_.size()) {
+            uint32_t id = block_at_start_[pc];
+            if (id != NO_BLOCK) {
+                ++blocks_[id].count;
+            }
+        }
+    }
+
+    const std::vector<Block>& blocks() const { return blocks_; }
+    const std::vector<Loop>& loops() const { return loops_; }
+
+    /**
+     * @brief Find the block containing an address
+     * @return The block, or nullptr if pc is outside the program
+     */
+    const Block* block_containing(uint32_t pc) const;
+
+    /**
+     * @brief Blocks that ran the most instructions (entries x length), hottest first
+     * @param limit Maximum number of blocks to return; blocks never entered are left out
+     */
+    std::vector<const Block*> hot_blocks(size_t limit) const;
+
+    /**
+     * @brief Symbols used to name blocks in reports
+     */
+    void set_symbols(std::map<uint32_t, std::string> symbols);
+
+    /**
+     * @brief Print the hottest blocks with their share of executed instructions and loop nesting
+     */
+    void write_hot(std::ostream& out, size_t limit) const;
+
+    void reset();
+
+private:
+    std::string location(uint32_t pc) const;
+
+    std::vector<Block> blocks_;
+    std::vector<Loop> loops_;
+    std::vector<uint32_t> block_at_start_;  // Indexed by address; block id or NO_BLOCK
+    std::map<uint32_t, std::string> symbols_;
+};
+
+} // namespace Profiling
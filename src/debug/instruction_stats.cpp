@@ -0,0 +1,145 @@
+#include "instruction_stats.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "../assembler/assembler.hpp"
+#include "../engine/cpu.hpp"
+
+namespace Profiling {
+
+namespace {
+
+std::array<std::string, 256> opcode_names() {
+    std::array<std::string, 256> names;
+    Assembler::AssemblerEngine assembler;
+    for (unsigned opcode = 0; opcode < names.size(); ++opcode) {
+        names[opcode] = assembler.mnemonic_for(static_cast<uint8_t>(opcode));
+        if (names[opcode].empty()) {
+            names[opcode] = fmt::format("OP_{:02X}", opcode);
+        }
+    }
+    return names;
+}
+
+} // namespace
+
+bool InstructionStats::is_conditional_branch(uint8_t opcode) {
+    return is_conditional_jump(static_cast<Opcode>(opcode));
+}
+
+bool InstructionStats::is_load(uint8_t opcode) {
+    switch (static_cast<Opcode>(opcode)) {
+        case Opcode::LOAD: case Opcode::POP: case Opcode::POP_ARG: case Opcode::POP_FLAG:
+        case Opcode::RET: case Opcode::IRET: case Opcode::SWAP: case Opcode::OUTSTR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void InstructionStats::reset() {
+    opcodes_.fill({});
+    instructions_ = 0;
+    branches_taken_ = 0;
+    branches_not_taken_ = 0;
+    loads_ = 0;
+    stores_ = 0;
+    ports_ = {};
+}
+
+void InstructionStats::write_summary(std::ostream& out) const {
+    auto names = opcode_names();
+    std::vector<unsigned> used;
+    for (unsigned opcode = 0; opcode < opcodes_.size(); ++opcode) {
+        if (opcodes_[opcode].count) used.push_back(opcode);
+    }
+    std::sort(used.begin(), used.end(), [this](unsigned a, unsigned b) {
+        return opcodes_[a].count != opcodes_[b].count ? opcodes_[a].count > opcodes_[b].count : a < b;
+    });
+
+    double scale = instructions_ ? 100.0 / static_cast<double>(instructions_) : 0.0;
+    out << fmt::format("Instruction mix: {} instructions\n", instructions_);
+    out << fmt::format("  {:<12} {:>10} {:>7} {:>12} {:>9}\n", "opcode", "count", "share", "host ns", "ns/op");
+    for (unsigned opcode : used) {
+        const OpcodeCounters& counters = opcodes_[opcode];
+        out << fmt::format("  {:<12} {:>10} {:>6.2f}% {:>12} {:>9.1f}\n",
+            names[opcode], counters.count, counters.count * scale, counters.host_ns,
+            static_cast<double>(counters.host_ns) / static_cast<double>(counters.count));
+    }
+    out << fmt::format("  branches: {} taken, {} not taken\n", branches_taken_, branches_not_taken_);
+    out << fmt::format("  memory:   {} loads, {} stores\n", loads_, stores_);
+    for (unsigned port = 0; port < ports_.reads.size(); ++port) {
+        if (ports_.reads[port] || ports_.writes[port]) {
+            out << fmt::format("  port {:>3}: {} reads, {} writes\n", port, ports_.reads[port], ports_.writes[port]);
+        }
+    }
+}
+
+void InstructionStats::write_json(std::ostream& out) const {
+    auto names = opcode_names();
+    out << "{\n";
+    out << fmt::format("  \"instructions\": {},\n", instructions_);
+    out << "  \"opcodes\": {";
+    const char* separator = "\n";
+    for (unsigned opcode = 0; opcode < opcodes_.size(); ++opcode) {
+        if (!opcodes_[opcode].count) continue;
+        out << separator << fmt::format("    \"{}\": {{\"opcode\": {}, \"count\": {}, \"host_ns\": {}}}",
+            names[opcode], opcode, opcodes_[opcode].count, opcodes_[opcode].host_ns);
+        separator = ",\n";
+    }
+    out << "\n  },\n";
+    out << fmt::format("  \"branches\": {{\"taken\": {}, \"not_taken\": {}}},\n", branches_taken_, branches_not_taken_);
+    out << fmt::format("  \"memory\": {{\"loads\": {}, \"stores\": {}}},\n", loads_, stores_);
+    out << "  \"ports\": {";
+    separator = "\n";
+    for (unsigned port = 0; port < ports_.reads.size(); ++port) {
+        if (!ports_.reads[port] && !ports_.writes[port]) continue;
+        out << separator << fmt::format("    \"{}\": {{\"reads\": {}, \"writes\": {}}}",
+            port, ports_.reads[port], ports_.writes[port]);
+        separator = ",\n";
+    }
+    out << "\n  }\n}\n";
+}
+
+void InstructionStats::write_prometheus(std::ostream& out) const {
+    auto names = opcode_names();
+    out << "# HELP demi_instructions_total Instructions executed, by opcode.\n";
+    out << "# TYPE demi_instructions_total counter\n";
+    for (unsigned opcode = 0; opcode < opcodes_.size(); ++opcode) {
+        if (opcodes_[opcode].count) {
+            out << fmt::format("demi_instructions_total{{opcode=\"{}\"}} {}\n", names[opcode], opcodes_[opcode].count);
+        }
+    }
+    out << "# HELP demi_instruction_host_seconds_total Host time spent in opcode handlers.\n";
+    out << "# TYPE demi_instruction_host_seconds_total counter\n";
+    for (unsigned opcode = 0; opcode < opcodes_.size(); ++opcode) {
+        if (opcodes_[opcode].count) {
+            out << fmt::format("demi_instruction_host_seconds_total{{opcode=\"{}\"}} {:.9f}\n",
+                names[opcode], static_cast<double>(opcodes_[opcode].host_ns) / 1e9);
+        }
+    }
+    out << "# HELP demi_branches_total Conditional branches, by outcome.\n";
+    out << "# TYPE demi_branches_total counter\n";
+    out << fmt::format("demi_branches_total{{outcome=\"taken\"}} {}\n", branches_taken_);
+    out << fmt::format("demi_branches_total{{outcome=\"not_taken\"}} {}\n", branches_not_taken_);
+    out << "# HELP demi_memory_instructions_total Instructions that read or wrote guest memory.\n";
+    out << "# TYPE demi_memory_instructions_total counter\n";
+    out << fmt::format("demi_memory_instructions_total{{access=\"load\"}} {}\n", loads_);
+    out << fmt::format("demi_memory_instructions_total{{access=\"store\"}} {}\n", stores_);
+    out << "# HELP demi_port_io_total Port reads and writes, by port.\n";
+    out << "# TYPE demi_port_io_total counter\n";
+    for (unsigned port = 0; port < ports_.reads.size(); ++port) {
+        if (ports_.reads[port]) {
+            out << fmt::format("demi_port_io_total{{port=\"{}\",direction=\"read\"}} {}\n", port, ports_.reads[port]);
+        }
+        if (ports_.writes[port]) {
+            out << fmt::format("demi_port_io_total{{port=\"{}\",direction=\"write\"}} {}\n", port, ports_.writes[port]);
+        }
+    }
+}
+
+} // namespace Profiling
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#include "../engine/device_manager.hpp"
+
+namespace Profiling {
+
+/**
+ * @brief Instruction-mix counters collected around dispatch_opcode
+ *
+ * While attached to a CPU every dispatched instruction is counted per
+ * opcode together with the host time its handler took, conditional
+ * branches are split into taken and not taken, and instructions that read
+ * or write guest memory are counted. Port reads and writes are counted per
+ * port by the DeviceManager. A CPU without stats attached takes its normal
+ * dispatch path, so the counters cost nothing when off.
+ */
+class InstructionStats {
+public:
+    struct OpcodeCounters {
+        uint64_t count = 0;
+        uint64_t host_ns = 0;
+    };
+
+    /**
+     * @brief Account for one dispatched instruction
+     * @param opcode Opcode byte
+     * @param pc Address of the instruction
+     * @param next_pc PC after the handler ran
+     * @param stored Whether the instruction wrote guest memory
+     * @param host_ns Host time spent in the handler
+     */
+    void record(uint8_t opcode, uint32_t pc, uint32_t next_pc, bool stored, uint64_t host_ns) {
+        OpcodeCounters& counters = opcodes_[opcode];
+        ++counters.count;
+        counters.host_ns += host_ns;
+        ++instructions_;
+        if (is_conditional_branch(opcode)) {
+            // Every conditional jump is opcode + target byte
+            ++(next_pc != pc + 2 ? branches_taken_ : branches_not_taken_);
+        }
+        if (is_load(opcode)) ++loads_;
+        if (stored) ++stores_;
+    }
+
+    /**
+     * @brief Start or stop counting port I/O (the CPU calls this when stats are attached)
+     */
+    void attach_ports(bool enabled) {
+        vhw::DeviceManager::instance().setPortCounters(enabled ? &ports_ : nullptr);
+    }
+
+    const OpcodeCounters& opcode(uint8_t opcode) const { return opcodes_[opcode]; }
+    uint64_t instructions() const { return instructions_; }
+    uint64_t branches_taken() const { return branches_taken_; }
+    uint64_t branches_not_taken() const { return branches_not_taken_; }
+    uint64_t loads() const { return loads_; }
+    uint64_t stores() const { return stores_; }
+    uint64_t port_reads(uint8_t port) const { return ports_.reads[port]; }
+    uint64_t port_writes(uint8_t port) const { return ports_.writes[port]; }
+
+    void reset();
+
+    /**
+     * @brief Print a human-readable summary, busiest opcodes first
+     */
+    void write_summary(std::ostream& out) const;
+
+    /**
+     * @brief Export all counters as a JSON object
+     */
+    void write_json(std::ostream& out) const;
+
+    /**
+     * @brief Export all counters in the Prometheus text exposition format
+     */
+    void write_prometheus(std::ostream& out) const;
+
+    static bool is_conditional_branch(uint8_t opcode);
+    static bool is_load(uint8_t opcode);
+
+private:
+    std::array<OpcodeCounters, 256> opcodes_{};
+    uint64_t instructions_ = 0;
+    uint64_t branches_taken_ = 0;
+    uint64_t branches_not_taken_ = 0;
+    uint64_t loads_ = 0;
+    uint64_t stores_ = 0;
+    vhw::PortCounters ports_;
+};
+
+} // namespace Profiling
@@ -1,5 +1,7 @@
 #include "logger.hpp"
 
+#include <algorithm>
+#include <array>
 #include <chrono>
 #include <cstring>
 #include <ctime>
@@ -11,6 +13,51 @@
 
 namespace Logging {
 
+// ============================================================================
+// Per-thread Record Ring
+// ============================================================================
+
+/**
+ * Single-producer single-consumer ring of records
+ *
+ * The owning thread pushes, the writer thread drains; the two indices are
+ * the only shared state, so neither side ever takes a lock.
+ */
+class Logger::RecordRing {
+public:
+    bool push(Record&& record) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == ASYNC_RING_CAPACITY) {
+            return false;
+        }
+        slots_[tail & (ASYNC_RING_CAPACITY - 1)] = std::move(record);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    void drain(std::vector<Record>& out) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        for (; head != tail; ++head) {
+            out.push_back(std::move(slots_[head & (ASYNC_RING_CAPACITY - 1)]));
+        }
+        head_.store(head, std::memory_order_release);
+    }
+
+    bool full() const {
+        return tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_acquire) == ASYNC_RING_CAPACITY;
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    std::array<Record, ASYNC_RING_CAPACITY> slots_;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
 // ============================================================================
 // Singleton Access
 // ============================================================================
@@ -25,9 +72,7 @@ Logger& Logger::instance() {
 // ============================================================================
 
 Logger::Logger()
-    : current_level_(LogLevel::INFO)
-    , force_next_(false)
-    , file_logging_enabled_(true) {
+    : file_logging_enabled_(true) {
 
     // Initialize log file if specified in config
     if (!Config::debug_file.empty()) {
@@ -36,6 +81,7 @@ Logger::Logger()
 }
 
 Logger::~Logger() {
+    set_async(false);
     if (log_file_.is_open()) {
         log_file_.close();
     }
@@ -46,41 +92,56 @@ Logger::~Logger() {
 // ============================================================================
 
 Logger& Logger::level(LogLevel lvl) {
-    current_level_ = lvl;
-    buffer_.str(""); // Clear buffer
-    buffer_.clear(); // Clear any error flags
+    staging_.level = lvl;
+    staging_.buffer.str(""); // Clear buffer
+    staging_.buffer.clear(); // Clear any error flags
     return *this;
 }
 
 Logger& Logger::force() {
-    force_next_ = true;
+    staging_.force = true;
     return *this;
 }
 
 Logger& Logger::operator<<(std::ostream& (*manip)(std::ostream&)) {
     if (manip == static_cast<std::ostream& (*)(std::ostream&)>(std::endl)) {
-        log(current_level_, buffer_.str());
-        buffer_.str("");
-        buffer_.clear();
+        // The only point where a message leaves its thread
+        log(staging_.level, staging_.buffer.str());
+        staging_.buffer.str("");
+        staging_.buffer.clear();
     }
     return *this;
 }
 
-void Logger::log(LogLevel level, const std::string& message) {
-    std::lock_guard<std::recursive_mutex> lock(console_mutex_);
+void Logger::log(LogLevel level, std::string message) {
+    // Check if message should be filtered (thread-local, so no lock needed)
+    bool filtered = should_filter_message(level);
 
-    // Check if message should be filtered
-    if (should_filter_message(level)) {
-        force_next_ = false; // Reset force flag
+    // Reset force flag after checking
+    staging_.force = false;
+    if (filtered) {
         return;
     }
 
-    // Reset force flag after checking
-    force_next_ = false;
+    // Counted while choosing, so set_async(false) can wait out callers that
+    // chose the queue before it stops the writer
+    producers_.fetch_add(1);
+    if (async_.load()) {
+        enqueue(level, std::move(message));
+        producers_.fetch_sub(1);
+        return;
+    }
+    producers_.fetch_sub(1);
 
-    // Generate timestamp
-    std::string timestamp = generate_timestamp();
+    std::lock_guard<std::mutex> lock(console_mutex_);
+    emit(level, message, generate_timestamp());
+    (level == LogLevel::ERROR ? std::cerr : std::cout).flush();
+    if (log_file_.is_open()) {
+        log_file_.flush();
+    }
+}
 
+void Logger::emit(LogLevel level, const std::string& message, const std::string& timestamp) {
     // Format the complete log line
     std::string formatted_message = format_log_line(level, message, timestamp);
 
@@ -115,10 +176,11 @@ Logger& Logger::warn() {
 Logger& Logger::error(const std::string& extra_info) {
     Config::error_count++;
 
+    level(LogLevel::ERROR);
     if (!extra_info.empty()) {
-        buffer_ << " (" << extra_info << ")";
+        staging_.buffer << " (" << extra_info << ")";
     }
-    return level(LogLevel::ERROR);
+    return *this;
 }
 
 Logger& Logger::debug() {
@@ -138,17 +200,17 @@ Logger& Logger::demiengine() {
 // ============================================================================
 
 std::vector<std::string> Logger::get_gui_log_buffer() const {
-    std::lock_guard<std::recursive_mutex> lock(gui_mutex_);
+    std::lock_guard<std::mutex> lock(gui_mutex_);
     return gui_log_buffer_;
 }
 
 void Logger::clear_gui_log_buffer() {
-    std::lock_guard<std::recursive_mutex> lock(gui_mutex_);
+    std::lock_guard<std::mutex> lock(gui_mutex_);
     gui_log_buffer_.clear();
 }
 
 size_t Logger::get_gui_buffer_size() const {
-    std::lock_guard<std::recursive_mutex> lock(gui_mutex_);
+    std::lock_guard<std::mutex> lock(gui_mutex_);
     return gui_log_buffer_.size();
 }
 
@@ -157,17 +219,17 @@ size_t Logger::get_gui_buffer_size() const {
 // ============================================================================
 
 void Logger::set_file_logging_enabled(bool enabled) {
-    std::lock_guard<std::recursive_mutex> lock(console_mutex_);
+    std::lock_guard<std::mutex> lock(console_mutex_);
     file_logging_enabled_ = enabled;
 }
 
 bool Logger::is_file_logging_enabled() const {
-    std::lock_guard<std::recursive_mutex> lock(console_mutex_);
+    std::lock_guard<std::mutex> lock(console_mutex_);
     return file_logging_enabled_;
 }
 
 bool Logger::set_log_file(const std::string& file_path) {
-    std::lock_guard<std::recursive_mutex> lock(console_mutex_);
+    std::lock_guard<std::mutex> lock(console_mutex_);
 
     // Close existing file if open
     if (log_file_.is_open()) {
@@ -189,6 +251,156 @@ bool Logger::set_log_file(const std::string& file_path) {
     return false;
 }
 
+// ============================================================================
+// Asynchronous Output
+// ============================================================================
+
+void Logger::set_async(bool enabled) {
+    if (enabled == async_.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    if (enabled) {
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex_);
+            stop_writer_ = false;
+        }
+        writer_ = std::thread(&Logger::writer_loop, this);
+        async_.store(true, std::memory_order_release);
+        return;
+    }
+
+    // New messages go inline from here on. Callers that already chose the
+    // queue finish pushing before the writer is told to stop.
+    async_.store(false);
+    while (producers_.load() != 0) {
+        std::this_thread::yield();
+    }
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        stop_writer_ = true;
+    }
+    writer_cv_.notify_one();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+
+    // Nothing can be queued any more; write out whatever is left
+    std::vector<Record> batch;
+    collect(batch);
+    if (!batch.empty()) {
+        std::lock_guard<std::mutex> lock(console_mutex_);
+        write_batch(batch);
+    }
+}
+
+bool Logger::is_async() const {
+    return async_.load(std::memory_order_acquire);
+}
+
+void Logger::flush() {
+    if (!async_.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(console_mutex_);
+        std::cout.flush();
+        if (log_file_.is_open()) {
+            log_file_.flush();
+        }
+        return;
+    }
+
+    uint64_t target = next_sequence_.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(writer_mutex_);
+    flush_requested_ = true;
+    writer_cv_.notify_one();
+    flushed_cv_.wait(lock, [&] { return written_count_ >= target || stop_writer_; });
+}
+
+void Logger::enqueue(LogLevel level, std::string&& message) {
+    Record record;
+    record.sequence = next_sequence_.fetch_add(1, std::memory_order_relaxed);
+    record.level = level;
+    record.time = std::chrono::system_clock::now();
+    record.message = std::move(message);
+
+    RecordRing& ring = thread_ring();
+    while (!ring.push(std::move(record))) {
+        // Ring full: request a batch (the writer's wait only ends on a
+        // request) and sleep until one has been written
+        std::unique_lock<std::mutex> lock(writer_mutex_);
+        flush_requested_ = true;
+        writer_cv_.notify_one();
+        flushed_cv_.wait(lock, [&] { return !ring.full(); });
+    }
+}
+
+Logger::RecordRing& Logger::thread_ring() {
+    thread_local std::shared_ptr<RecordRing> ring;
+    if (!ring) {
+        ring = std::make_shared<RecordRing>();
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        rings_.push_back(ring);
+    }
+    return *ring;
+}
+
+void Logger::collect(std::vector<Record>& batch) {
+    batch.clear();
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    for (auto& ring : rings_) {
+        ring->drain(batch);
+    }
+
+    // Rings whose thread has exited (only our reference left) can go once empty
+    rings_.erase(std::remove_if(rings_.begin(), rings_.end(), [](const std::shared_ptr<RecordRing>& ring) {
+        return ring.use_count() == 1 && ring->empty();
+    }), rings_.end());
+
+    // Each ring is in order; restore the global order across threads
+    std::sort(batch.begin(), batch.end(), [](const Record& a, const Record& b) {
+        return a.sequence < b.sequence;
+    });
+}
+
+void Logger::writer_loop() {
+    std::vector<Record> batch;
+    while (true) {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(writer_mutex_);
+            writer_cv_.wait_for(lock, ASYNC_WRITE_INTERVAL, [this] { return stop_writer_ || flush_requested_; });
+            flush_requested_ = false;
+            stopping = stop_writer_;
+        }
+
+        collect(batch);
+        if (!batch.empty()) {
+            std::lock_guard<std::mutex> lock(console_mutex_);
+            write_batch(batch);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex_);
+            written_count_ += batch.size();
+        }
+        flushed_cv_.notify_all();
+
+        if (stopping && batch.empty()) {
+            return;
+        }
+    }
+}
+
+void Logger::write_batch(const std::vector<Record>& batch) {
+    for (const Record& record : batch) {
+        emit(record.level, record.message, generate_timestamp(record.time));
+    }
+    // One flush per batch instead of one per line
+    std::cout.flush();
+    if (log_file_.is_open()) {
+        log_file_.flush();
+    }
+}
+
 // ============================================================================
 // Helper Methods
 // ============================================================================
@@ -222,7 +434,10 @@ std::string Logger::level_to_color(LogLevel level) const {
 }
 
 std::string Logger::generate_timestamp() const {
-    auto now = std::chrono::system_clock::now();
+    return generate_timestamp(std::chrono::system_clock::now());
+}
+
+std::string Logger::generate_timestamp(std::chrono::system_clock::time_point now) const {
     auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
         now.time_since_epoch()) % 1000;
     std::time_t t = std::chrono::system_clock::to_time_t(now);
@@ -267,7 +482,7 @@ std::string Logger::format_log_line(LogLevel level, const std::string& message,
 
 bool Logger::should_filter_message(LogLevel level) const {
     // If force flag is set, never filter
-    if (force_next_) {
+    if (staging_.force) {
         return false;
     }
 
@@ -319,26 +534,25 @@ void Logger::write_to_console(LogLevel level, const std::string& formatted_messa
             // Output with purple timestamp, colored level, and normal message
             out << purple_color << timestamp_part << RESET_COLOR
                 << remaining_before << level_color << level_pattern << RESET_COLOR
-                << after_level << std::endl;
+                << after_level << '\n';
         } else {
             // Fallback: just color the level if no timestamp found
-            out << before_level << level_color << level_pattern << RESET_COLOR << after_level << std::endl;
+            out << before_level << level_color << level_pattern << RESET_COLOR << after_level << '\n';
         }
     } else {
         // Fallback: output without color if we can't find the level pattern
-        out << formatted_message << std::endl;
+        out << formatted_message << '\n';
     }
 }
 
 void Logger::write_to_file(const std::string& formatted_message) {
     if (log_file_.is_open()) {
-        log_file_ << formatted_message << std::endl;
-        log_file_.flush();
+        log_file_ << formatted_message << '\n';
     }
 }
 
 void Logger::add_to_gui_buffer(const std::string& formatted_message) {
-    std::lock_guard<std::recursive_mutex> lock(gui_mutex_);
+    std::lock_guard<std::mutex> lock(gui_mutex_);
 
     gui_log_buffer_.push_back(formatted_message);
 
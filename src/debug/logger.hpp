@@ -1,10 +1,15 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace Logging {
@@ -34,8 +39,12 @@ enum class LogLevel {
  * - Multiple log levels with color-coded console output
  * - File logging with automatic timestamping
  * - GUI buffer for in-application log display
- * - Thread-safe operations with mutex protection
+ * - Thread-safe operations: each thread stages its message in thread-local
+ *   state and only hands the finished line over at std::endl
  * - Configurable filtering based on debug and verbose modes
+ * - Optional asynchronous mode: callers only queue a record into a
+ *   per-thread lock-free ring and a writer thread formats and writes
+ *   records in batches
  *
  * Usage examples:
  * @code
@@ -49,6 +58,8 @@ public:
     // Constants
     static constexpr size_t GUI_LOG_BUFFER_MAX = 500;
     static constexpr size_t DATETIME_BUFFER_SIZE = 64;
+    static constexpr size_t ASYNC_RING_CAPACITY = 1024;  ///< Records per thread ring (power of two)
+    static constexpr auto ASYNC_WRITE_INTERVAL = std::chrono::milliseconds(5);
 
     /**
      * @brief Get the singleton instance of the Logger
@@ -85,7 +96,7 @@ public:
      */
     template<typename T>
     Logger& operator<<(const T& val) {
-        buffer_ << val;
+        staging_.buffer << val;
         return *this;
     }
 
@@ -99,9 +110,9 @@ public:
     /**
      * @brief Core logging function that handles message output
      * @param level The log level of the message
-     * @param message The message content to log
+     * @param message The message content to log (moved into the queue in async mode)
      */
-    void log(LogLevel level, const std::string& message);
+    void log(LogLevel level, std::string message);
 
     // ============================================================================
     // Convenience Methods
@@ -194,7 +205,45 @@ public:
      */
     bool set_log_file(const std::string& file_path);
 
+    // ============================================================================
+    // Asynchronous Output
+    // ============================================================================
+
+    /**
+     * @brief Switch between inline and background output
+     *
+     * In async mode filtering still happens on the calling thread, but
+     * timestamp formatting and console/file/GUI output move to a writer
+     * thread. Switching back waits for callers still queueing, then drains
+     * every queued record before output goes inline again.
+     * @param enabled Whether output should be asynchronous
+     */
+    void set_async(bool enabled);
+
+    /**
+     * @brief Check if asynchronous output is enabled
+     * @return True if records are written by the background thread
+     */
+    bool is_async() const;
+
+    /**
+     * @brief Block until every record queued so far has been written
+     */
+    void flush();
+
 private:
+    /**
+     * @brief Compact log record queued by the calling thread in async mode
+     */
+    struct Record {
+        uint64_t sequence = 0;                          ///< Global order across threads
+        LogLevel level = LogLevel::INFO;
+        std::chrono::system_clock::time_point time;     ///< Formatted later by the writer
+        std::string message;                            ///< The staged message, moved in rather than copied
+    };
+
+    class RecordRing;
+
     /**
      * @brief Private constructor for singleton pattern
      */
@@ -229,6 +278,13 @@ private:
      */
     std::string generate_timestamp() const;
 
+    /**
+     * @brief Generate formatted timestamp string for a given time
+     * @param time The time to format
+     * @return Formatted timestamp string
+     */
+    std::string generate_timestamp(std::chrono::system_clock::time_point time) const;
+
     /**
      * @brief Format log message with appropriate styling
      * @param level The log level
@@ -265,20 +321,81 @@ private:
      */
     void add_to_gui_buffer(const std::string& formatted_message);
 
+    /**
+     * @brief Format and output one message to every target (without flushing)
+     * @param level The log level
+     * @param message The message content
+     * @param timestamp The timestamp string
+     */
+    void emit(LogLevel level, const std::string& message, const std::string& timestamp);
+
+    /**
+     * @brief Queue a record on the calling thread's ring, waiting for the
+     *        writer if it is full
+     * @param level The log level
+     * @param message The message content, moved into the record
+     */
+    void enqueue(LogLevel level, std::string&& message);
+
+    /**
+     * @brief Get (registering on first use) the calling thread's ring
+     * @return The ring owned by the calling thread
+     */
+    RecordRing& thread_ring();
+
+    /**
+     * @brief Writer thread body: drain all rings in batches until stopped
+     */
+    void writer_loop();
+
+    /**
+     * @brief Move every queued record into batch, oldest first
+     * @param batch Vector to fill (cleared first)
+     */
+    void collect(std::vector<Record>& batch);
+
+    /**
+     * @brief Output a collected batch with one flush (caller holds console_mutex_)
+     * @param batch Records to write, oldest first
+     */
+    void write_batch(const std::vector<Record>& batch);
+
     // ============================================================================
     // Member Variables
     // ============================================================================
 
-    std::ostringstream buffer_;              ///< Buffer for building log messages
-    LogLevel current_level_;                 ///< Current log level for next message
-    bool force_next_;                        ///< Flag to bypass filtering for next message
+    /**
+     * @brief Message being built by one thread
+     */
+    struct Staging {
+        Staging() : level(LogLevel::INFO), force(false) {}
+
+        std::ostringstream buffer;               ///< Buffer for building log messages
+        LogLevel level;                          ///< Current log level for next message
+        bool force;                              ///< Flag to bypass filtering for next message
+    };
+
+    inline static thread_local Staging staging_; ///< Per-thread staging; shared state is only touched at std::endl
 
     std::ofstream log_file_;                 ///< Output file stream for file logging
     bool file_logging_enabled_;              ///< Whether file logging is enabled
-    mutable std::recursive_mutex console_mutex_; ///< Mutex for console output synchronization
+    mutable std::mutex console_mutex_;       ///< Mutex for console/file output synchronization
 
     std::vector<std::string> gui_log_buffer_; ///< Buffer for GUI log display
-    mutable std::recursive_mutex gui_mutex_;  ///< Mutex for GUI buffer synchronization
+    mutable std::mutex gui_mutex_;            ///< Mutex for GUI buffer synchronization
+
+    std::atomic<bool> async_{false};          ///< Whether records go to the writer thread
+    std::atomic<int> producers_{0};           ///< Threads inside log() that may be queueing
+    std::atomic<uint64_t> next_sequence_{0};  ///< Sequence number for the next queued record
+    std::thread writer_;                      ///< Background writer (async mode only)
+    std::mutex rings_mutex_;                  ///< Guards rings_ (taken once per thread and per batch)
+    std::vector<std::shared_ptr<RecordRing>> rings_; ///< One ring per producing thread
+    std::mutex writer_mutex_;                 ///< Guards the writer state below
+    std::condition_variable writer_cv_;       ///< Wakes the writer early (flush, full ring, stop)
+    std::condition_variable flushed_cv_;      ///< Signalled after every written batch (flush, full ring)
+    uint64_t written_count_ = 0;              ///< Records written by the writer so far
+    bool flush_requested_ = false;
+    bool stop_writer_ = false;
 
     // ANSI color codes
     static constexpr const char* RESET_COLOR = "\033[0m";
@@ -0,0 +1,105 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <fmt/core.h>
+
+#include "../engine/cpu.hpp"
+
+namespace Profiling {
+
+SamplingProfiler::SamplingProfiler(uint64_t interval)
+    : interval_(std::max<uint64_t>(1, interval)), next_sample_(interval_) {}
+
+void SamplingProfiler::set_symbols(std::map<uint32_t, std::string> symbols) {
+    symbols_ = std::move(symbols);
+}
+
+void SamplingProfiler::reset() {
+    next_sample_ = interval_;
+    samples_ = 0;
+    stacks_.clear();
+}
+
+void SamplingProfiler::sample(const CPU& cpu) {
+    std::vector<uint32_t> stack;
+    stack.push_back(cpu.get_pc());
+
+    // Follow the frame pointer chain; caller frames always sit higher on the stack
+    size_t memory_size = cpu.get_memory_size();
+    uint32_t fp = cpu.get_fp();
+    while (stack.size() < MAX_DEPTH && static_cast<size_t>(fp) + 8 <= memory_size) {
+        stack.push_back(cpu.read_mem32(fp));
+        uint32_t caller_fp = cpu.read_mem32(fp + 4);
+        if (caller_fp <= fp) {
+            break;
+        }
+        fp = caller_fp;
+    }
+
+    ++stacks_[stack];
+    ++samples_;
+}
+
+std::string SamplingProfiler::symbol_name(uint32_t pc) const {
+    auto it = symbols_.upper_bound(pc);
+    if (it == symbols_.begin()) {
+        return fmt::format("0x{:04X}", pc);
+    }
+    return std::prev(it)->second;
+}
+
+void SamplingProfiler::write_flat(std::ostream& out) const {
+    struct Counts {
+        uint64_t self = 0;
+        uint64_t total = 0;
+    };
+    std::unordered_map<std::string, Counts> counts;
+    for (const auto& [stack, hits] : stacks_) {
+        counts[symbol_name(stack.front())].self += hits;
+        // Recursive frames count once towards total
+        std::unordered_set<std::string> seen;
+        for (uint32_t pc : stack) {
+            std::string name = symbol_name(pc);
+            if (seen.insert(name).second) {
+                counts[name].total += hits;
+            }
+        }
+    }
+
+    std::vector<std::pair<std::string, Counts>> rows(counts.begin(), counts.end());
+    std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+        if (a.second.self != b.second.self) return a.second.self > b.second.self;
+        if (a.second.total != b.second.total) return a.second.total > b.second.total;
+        return a.first < b.first;
+    });
+
+    double scale = samples_ ? 100.0 / static_cast<double>(samples_) : 0.0;
+    out << fmt::format("{} samples, one every {} cycles\n", samples_, interval_);
+    out << fmt::format("{:>7} {:>8} {:>7} {:>8}  {}\n", "self%", "self", "total%", "total", "symbol");
+    for (const auto& [name, count] : rows) {
+        out << fmt::format("{:>6.2f}% {:>8} {:>6.2f}% {:>8}  {}\n",
+            count.self * scale, count.self, count.total * scale, count.total, name);
+    }
+}
+
+void SamplingProfiler::write_folded(std::ostream& out) const {
+    // Distinct PC stacks can name the same symbols, so merge after symbolizing
+    std::map<std::string, uint64_t> folded;
+    for (const auto& [stack, hits] : stacks_) {
+        std::string line;
+        for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+            if (!line.empty()) line += ';';
+            line += symbol_name(*it);
+        }
+        folded[line] += hits;
+    }
+    for (const auto& [line, hits] : folded) {
+        out << line << ' ' << hits << '\n';
+    }
+}
+
+} // namespace Profiling
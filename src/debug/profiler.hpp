@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../engine/virtual_clock.hpp"
+
+class CPU;
+
+namespace Profiling {
+
+/**
+ * @brief Statistical profiler for guest code
+ *
+ * Every `interval` virtual cycles the profiler records the guest PC and the
+ * return addresses found by walking the frame pointer chain that CALL
+ * builds ([FP] = return address, [FP+4] = caller's FP). Samples are taken
+ * from the CPU's device-tick path at a deadline on the VirtualClock, so
+ * instructions between samples run exactly as they would unprofiled.
+ *
+ * Stacks are kept as raw PCs and only symbolized when a report is written,
+ * as a flat profile (self/total per symbol) or as folded stacks
+ * ("outer;inner count") for flamegraph.pl and compatible tools.
+ */
+class SamplingProfiler {
+public:
+    static constexpr uint64_t DEFAULT_INTERVAL = 1000;
+    static constexpr size_t MAX_DEPTH = 64;
+
+    /**
+     * @param interval Virtual cycles between samples (0 is treated as 1)
+     */
+    explicit SamplingProfiler(uint64_t interval = DEFAULT_INTERVAL);
+
+    /**
+     * @brief Symbols used to name PCs in reports
+     * @param symbols Map from address to symbol name (e.g. from the assembler's get_symbols())
+     */
+    void set_symbols(std::map<uint32_t, std::string> symbols);
+
+    /**
+     * @brief Called by the CPU after every device tick; samples once the interval has elapsed
+     */
+    void tick(const CPU& cpu) {
+        uint64_t now = vhw::VirtualClock::instance().now();
+        if (now >= next_sample_) {
+            sample(cpu);
+            next_sample_ = now + interval_;
+        }
+        schedule();
+    }
+
+    /**
+     * @brief Ask the clock for a device tick at the next sample; the CPU calls this before running
+     */
+    void schedule() const {
+        vhw::VirtualClock::instance().requestTickAt(next_sample_);
+    }
+
+    /**
+     * @brief Record the current PC and call stack
+     */
+    void sample(const CPU& cpu);
+
+    /**
+     * @brief Print self and total samples per symbol, hottest first
+     */
+    void write_flat(std::ostream& out) const;
+
+    /**
+     * @brief Print one "root;...;leaf count" line per distinct stack
+     */
+    void write_folded(std::ostream& out) const;
+
+    /**
+     * @brief Name a PC after the nearest preceding symbol
+     * @return The symbol name, or the address in hex if no symbol precedes it
+     */
+    std::string symbol_name(uint32_t pc) const;
+
+    size_t sample_count() const { return samples_; }
+    uint64_t interval() const { return interval_; }
+    void reset();
+
+private:
+    uint64_t interval_;
+    uint64_t next_sample_;
+    size_t samples_ = 0;
+    std::map<std::vector<uint32_t>, uint64_t> stacks_;  // Leaf first
+    std::map<uint32_t, std::string> symbols_;
+};
+
+} // namespace Profiling
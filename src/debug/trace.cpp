@@ -0,0 +1,265 @@
+#include "trace.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include "../assembler/assembler.hpp"
+
+namespace Tracing {
+
+namespace {
+
+constexpr char TRACE_MAGIC[4] = {'D', 'T', 'R', 'C'};
+
+bool write_all(int fd, const void* data, size_t length, off_t offset) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    while (length > 0) {
+        ssize_t written = ::pwrite(fd, bytes, length, offset);
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        length -= static_cast<size_t>(written);
+        offset += written;
+    }
+    return true;
+}
+
+} // namespace
+
+// ============================================================================
+// TraceWriter
+// ============================================================================
+
+TraceWriter::TraceWriter(const std::string& path) : path_(path) {
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot create trace file: " + path);
+    }
+    map(INITIAL_RECORDS);
+}
+
+TraceWriter::~TraceWriter() {
+    try {
+        close();
+    } catch (const std::exception&) {
+        // Nothing sensible to do with a half-written trace during teardown
+    }
+}
+
+void TraceWriter::map(size_t records) {
+    size_t bytes = sizeof(TraceFileHeader) + records * sizeof(TraceRecord);
+    if (::ftruncate(fd_, static_cast<off_t>(bytes)) != 0) {
+        throw std::runtime_error("Cannot size trace file: " + path_);
+    }
+    if (mapping_) {
+        ::munmap(mapping_, mapped_bytes_);
+    }
+    mapping_ = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mapping_ == MAP_FAILED) {
+        mapping_ = nullptr;
+        throw std::runtime_error("Cannot map trace file: " + path_);
+    }
+    mapped_bytes_ = bytes;
+    records_ = reinterpret_cast<TraceRecord*>(static_cast<uint8_t*>(mapping_) + sizeof(TraceFileHeader));
+    capacity_ = records;
+}
+
+void TraceWriter::grow() {
+    map(capacity_ * 2);
+}
+
+void TraceWriter::set_symbols(std::map<uint32_t, std::string> symbols) {
+    symbols_ = std::move(symbols);
+}
+
+void TraceWriter::close() {
+    if (fd_ < 0) {
+        return;
+    }
+
+    TraceFileHeader header{};
+    std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TraceFileHeader::VERSION;
+    header.record_size = sizeof(TraceRecord);
+    header.record_count = count_;
+
+    // Symbol table goes after the last record, so trim the unused tail first
+    ::munmap(mapping_, mapped_bytes_);
+    mapping_ = nullptr;
+    records_ = nullptr;
+    off_t end = static_cast<off_t>(sizeof(TraceFileHeader) + count_ * sizeof(TraceRecord));
+    bool ok = ::ftruncate(fd_, end) == 0;
+
+    if (!symbols_.empty()) {
+        std::vector<uint8_t> table;
+        for (const auto& [address, name] : symbols_) {
+            uint16_t length = static_cast<uint16_t>(std::min<size_t>(name.size(), UINT16_MAX));
+            const auto* addressBytes = reinterpret_cast<const uint8_t*>(&address);
+            const auto* lengthBytes = reinterpret_cast<const uint8_t*>(&length);
+            table.insert(table.end(), addressBytes, addressBytes + sizeof(address));
+            table.insert(table.end(), lengthBytes, lengthBytes + sizeof(length));
+            table.insert(table.end(), name.begin(), name.begin() + length);
+        }
+        header.symbol_offset = static_cast<uint64_t>(end);
+        header.symbol_count = static_cast<uint32_t>(symbols_.size());
+        ok = ok && write_all(fd_, table.data(), table.size(), end);
+    }
+
+    ok = ok && write_all(fd_, &header, sizeof(header), 0);
+    ::close(fd_);
+    fd_ = -1;
+    if (!ok) {
+        throw std::runtime_error("Cannot finish trace file: " + path_);
+    }
+}
+
+// ============================================================================
+// TraceReader
+// ============================================================================
+
+TraceReader::TraceReader(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open trace file: " + path);
+    }
+    struct stat info{};
+    if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(TraceFileHeader)) {
+        ::close(fd);
+        throw std::runtime_error("Not a trace file: " + path);
+    }
+    mapped_bytes_ = static_cast<size_t>(info.st_size);
+    mapping_ = ::mmap(nullptr, mapped_bytes_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping_ == MAP_FAILED) {
+        mapping_ = nullptr;
+        throw std::runtime_error("Cannot map trace file: " + path);
+    }
+
+    const auto* base = static_cast<const uint8_t*>(mapping_);
+    TraceFileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    size_t recordBytes = header.record_count * sizeof(TraceRecord);
+    if (std::memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0
+        || header.version != TraceFileHeader::VERSION
+        || header.record_size != sizeof(TraceRecord)
+        || recordBytes > mapped_bytes_ - sizeof(TraceFileHeader)) {
+        ::munmap(mapping_, mapped_bytes_);
+        mapping_ = nullptr;
+        throw std::runtime_error("Not a trace file (or not finished): " + path);
+    }
+    records_ = reinterpret_cast<const TraceRecord*>(base + sizeof(TraceFileHeader));
+    count_ = header.record_count;
+
+    size_t offset = header.symbol_offset;
+    for (uint32_t i = 0; offset != 0 && i < header.symbol_count; ++i) {
+        uint32_t address;
+        uint16_t length;
+        if (offset + sizeof(address) + sizeof(length) > mapped_bytes_) break;
+        std::memcpy(&address, base + offset, sizeof(address));
+        std::memcpy(&length, base + offset + sizeof(address), sizeof(length));
+        offset += sizeof(address) + sizeof(length);
+        if (offset + length > mapped_bytes_) break;
+        symbols_[address] = std::string(reinterpret_cast<const char*>(base + offset), length);
+        offset += length;
+    }
+}
+
+TraceReader::~TraceReader() {
+    if (mapping_) {
+        ::munmap(mapping_, mapped_bytes_);
+    }
+}
+
+const std::pair<const uint32_t, std::string>* TraceReader::symbol_for(uint32_t pc) const {
+    auto it = symbols_.upper_bound(pc);
+    if (it == symbols_.begin()) {
+        return nullptr;
+    }
+    return &*std::prev(it);
+}
+
+std::string TraceReader::symbolize(uint32_t pc) const {
+    const auto* symbol = symbol_for(pc);
+    if (!symbol) {
+        return "";
+    }
+    uint32_t offset = pc - symbol->first;
+    return offset == 0 ? symbol->second : fmt::format("{}+0x{:X}", symbol->second, offset);
+}
+
+// ============================================================================
+// Decoder
+// ============================================================================
+
+size_t decode_trace(const std::string& path, const std::string& filter, std::ostream& out) {
+    TraceReader trace(path);
+
+    // Filter: symbol name or PC range
+    uint32_t low = 0;
+    uint32_t high = UINT32_MAX;
+    std::string symbol;
+    if (!filter.empty()) {
+        auto dash = filter.find('-');
+        if (filter.rfind("0x", 0) == 0 || filter.rfind("0X", 0) == 0) {
+            try {
+                low = static_cast<uint32_t>(std::stoul(filter.substr(0, dash), nullptr, 16));
+                high = dash == std::string::npos ? low
+                    : static_cast<uint32_t>(std::stoul(filter.substr(dash + 1), nullptr, 16));
+            } catch (const std::exception&) {
+                throw std::runtime_error("Invalid trace filter: " + filter);
+            }
+        } else {
+            symbol = filter;
+        }
+    }
+
+    std::array<std::string, 256> mnemonics;
+    Assembler::AssemblerEngine assembler;
+    for (unsigned opcode = 0; opcode < mnemonics.size(); ++opcode) {
+        mnemonics[opcode] = assembler.mnemonic_for(static_cast<uint8_t>(opcode));
+        if (mnemonics[opcode].empty()) {
+            mnemonics[opcode] = fmt::format("OP_{:02X}", opcode);
+        }
+    }
+
+    size_t printed = 0;
+    for (size_t i = 0; i < trace.size(); ++i) {
+        const TraceRecord& record = trace[i];
+        if (record.pc < low || record.pc > high) {
+            continue;
+        }
+        if (!symbol.empty()) {
+            const auto* containing = trace.symbol_for(record.pc);
+            if (!containing || containing->second != symbol) {
+                continue;
+            }
+        }
+
+        std::string line = fmt::format("{:>10} 0x{:04X} {:<20} {:<10}",
+            record.cycle, record.pc, trace.symbolize(record.pc), mnemonics[record.opcode]);
+        if (record.reg != TraceRecord::NO_REGISTER) {
+            line += fmt::format(" R{}=0x{:X}", record.reg, record.reg_value);
+        }
+        if (record.mem_addr != TraceRecord::NO_ADDRESS) {
+            line += fmt::format(" [0x{:X}]=0x{:X}", record.mem_addr, record.mem_value);
+        }
+        line += fmt::format(" FLAGS=0x{:X}", record.flags);
+        out << line << '\n';
+        ++printed;
+    }
+    return printed;
+}
+
+} // namespace Tracing
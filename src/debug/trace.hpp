@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+
+namespace Tracing {
+
+/**
+ * @brief One retired instruction as stored in a binary trace (32 bytes)
+ */
+struct TraceRecord {
+    uint64_t cycle;      ///< Virtual time at which the instruction started
+    uint32_t pc;         ///< Address of the instruction
+    uint32_t flags;      ///< FLAGS after the instruction
+    uint32_t reg_value;  ///< New value of reg (valid if reg != NO_REGISTER)
+    uint32_t mem_addr;   ///< Address of the last memory store (NO_ADDRESS if none)
+    uint32_t mem_value;  ///< Value of the last memory store
+    uint8_t opcode;      ///< Opcode byte
+    uint8_t reg;         ///< Lowest general purpose register the instruction changed
+    uint16_t reserved;
+
+    static constexpr uint8_t NO_REGISTER = 0xFF;
+    static constexpr uint32_t NO_ADDRESS = 0xFFFFFFFF;
+};
+
+static_assert(sizeof(TraceRecord) == 32, "Trace records must stay fixed-size");
+
+/**
+ * @brief Fixed header at the start of every trace file (64 bytes)
+ *
+ * Records follow the header directly; the optional symbol table (address,
+ * name length, name bytes per entry) follows the last record.
+ */
+struct TraceFileHeader {
+    char magic[4];           ///< "DTRC"
+    uint16_t version;
+    uint16_t record_size;
+    uint64_t record_count;
+    uint64_t symbol_offset;  ///< File offset of the symbol table, 0 if none
+    uint32_t symbol_count;
+    uint8_t reserved[36];
+
+    static constexpr uint16_t VERSION = 1;
+};
+
+static_assert(sizeof(TraceFileHeader) == 64, "Trace header layout is part of the file format");
+
+/**
+ * @brief Appends trace records to a memory-mapped file
+ *
+ * append() only bumps an index into the mapping, so tracing costs a few
+ * stores per instruction; the mapping grows geometrically when full. The
+ * header and symbol table are written by close() (or the destructor).
+ */
+class TraceWriter {
+public:
+    static constexpr size_t INITIAL_RECORDS = 64 * 1024;
+
+    /**
+     * @brief Create (truncating) a trace file
+     * @param path Trace file path
+     * @throws std::runtime_error if the file cannot be created or mapped
+     */
+    explicit TraceWriter(const std::string& path);
+    ~TraceWriter();
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    /**
+     * @brief Reserve the next record
+     * @return Reference to the record to fill in
+     */
+    TraceRecord& append() {
+        if (count_ == capacity_) {
+            grow();
+        }
+        return records_[count_++];
+    }
+
+    /**
+     * @brief Symbols to embed so the decoder can name PCs
+     * @param symbols Map from address to symbol name
+     */
+    void set_symbols(std::map<uint32_t, std::string> symbols);
+
+    /**
+     * @brief Finish the file: write header and symbols, trim to size
+     */
+    void close();
+
+    size_t size() const { return count_; }
+    const std::string& path() const { return path_; }
+
+private:
+    void map(size_t records);
+    void grow();
+
+    std::string path_;
+    int fd_ = -1;
+    void* mapping_ = nullptr;
+    size_t mapped_bytes_ = 0;
+    TraceRecord* records_ = nullptr;
+    size_t capacity_ = 0;
+    size_t count_ = 0;
+    std::map<uint32_t, std::string> symbols_;
+};
+
+/**
+ * @brief Read-only view of a trace file
+ */
+class TraceReader {
+public:
+    /**
+     * @brief Map a trace file for reading
+     * @param path Trace file path
+     * @throws std::runtime_error if the file is missing or not a trace
+     */
+    explicit TraceReader(const std::string& path);
+    ~TraceReader();
+
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    size_t size() const { return count_; }
+    const TraceRecord& operator[](size_t index) const { return records_[index]; }
+    const std::map<uint32_t, std::string>& symbols() const { return symbols_; }
+
+    /**
+     * @brief Name a PC as symbol+offset using the nearest preceding symbol
+     * @param pc Address to name
+     * @return "symbol" or "symbol+0xN", or an empty string if no symbol precedes pc
+     */
+    std::string symbolize(uint32_t pc) const;
+
+    /**
+     * @brief Find the symbol containing pc
+     * @param pc Address to look up
+     * @return Pointer to the symbol entry, or nullptr
+     */
+    const std::pair<const uint32_t, std::string>* symbol_for(uint32_t pc) const;
+
+private:
+    void* mapping_ = nullptr;
+    size_t mapped_bytes_ = 0;
+    const TraceRecord* records_ = nullptr;
+    size_t count_ = 0;
+    std::map<uint32_t, std::string> symbols_;
+};
+
+/**
+ * @brief Print a trace as text, one instruction per line
+ * @param path Trace file path
+ * @param filter Empty for everything, a symbol name to show only
+ *               instructions inside that symbol, or a PC range "0xA-0xB"
+ * @param out Stream to print to
+ * @return Number of records printed
+ * @throws std::runtime_error if the trace cannot be read or the filter is invalid
+ */
+size_t decode_trace(const std::string& path, const std::string& filter, std::ostream& out);
+
+} // namespace Tracing
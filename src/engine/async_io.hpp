@@ -0,0 +1,416 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <condition_variable>
+#include <unistd.h>
+#include <errno.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define VHW_HAVE_IO_URING 1
+#endif
+
+namespace vhw {
+
+/**
+ * Asynchronous I/O for storage devices
+ *
+ * Requests are submitted from the CPU thread and complete on a host thread,
+ * which runs the completion callback with the result. Positional reads and
+ * writes on a file descriptor go through io_uring when the kernel allows it;
+ * everything else (and every request when io_uring is unavailable or
+ * blocked) runs on a small thread pool.
+ *
+ * Completion callbacks run on an I/O thread. They should not report errors
+ * through the logger: Logger::error() bumps Config::error_count, a plain
+ * counter the CPU thread reads and resets, so failures are recorded and
+ * reported from the device's own thread instead.
+ */
+class AsyncIo {
+public:
+    using Completion = std::function<void(bool ok)>;
+
+    virtual ~AsyncIo() = default;
+
+    virtual void submitRead(int fd, uint8_t* buffer, size_t length, uint64_t offset, Completion done) = 0;
+    virtual void submitWrite(int fd, const uint8_t* buffer, size_t length, uint64_t offset, Completion done) = 0;
+
+    /**
+     * Run an arbitrary blocking job (backends without a plain file descriptor)
+     */
+    virtual void submitJob(std::function<bool()> job, Completion done) = 0;
+
+    virtual const char* name() const = 0;
+
+    /**
+     * Create the best available engine: io_uring, or a thread pool
+     */
+    static std::unique_ptr<AsyncIo> create(unsigned workers = 2);
+
+    /**
+     * Process-wide engine shared by all storage devices
+     */
+    static AsyncIo& shared() {
+        static std::unique_ptr<AsyncIo> instance = create();
+        return *instance;
+    }
+};
+
+/**
+ * Thread pool fallback: each request is a blocking pread/pwrite or job
+ */
+class ThreadPoolIo : public AsyncIo {
+public:
+    explicit ThreadPoolIo(unsigned workers = 2) {
+        for (unsigned i = 0; i < std::max(1u, workers); ++i) {
+            threads.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPoolIo() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    void submitRead(int fd, uint8_t* buffer, size_t length, uint64_t offset, Completion done) override {
+        submitJob([=] { return transfer(fd, buffer, length, offset, false); }, std::move(done));
+    }
+
+    void submitWrite(int fd, const uint8_t* buffer, size_t length, uint64_t offset, Completion done) override {
+        submitJob([=] { return transfer(fd, const_cast<uint8_t*>(buffer), length, offset, true); },
+                  std::move(done));
+    }
+
+    void submitJob(std::function<bool()> job, Completion done) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back({std::move(job), std::move(done)});
+        }
+        cv.notify_one();
+    }
+
+    const char* name() const override {
+        return "thread pool";
+    }
+
+private:
+    struct Task {
+        std::function<bool()> job;
+        Completion done;
+    };
+
+    static bool transfer(int fd, uint8_t* buffer, size_t length, uint64_t offset, bool isWrite) {
+        while (length > 0) {
+            ssize_t n = isWrite ? ::pwrite(fd, buffer, length, static_cast<off_t>(offset))
+                                : ::pread(fd, buffer, length, static_cast<off_t>(offset));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            buffer += n;
+            offset += static_cast<uint64_t>(n);
+            length -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            cv.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return;  // Stopping, and everything submitted has completed
+            }
+            Task task = std::move(queue.front());
+            queue.pop_front();
+            lock.unlock();
+
+            bool ok = task.job();
+            if (task.done) task.done(ok);
+
+            lock.lock();
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::deque<Task> queue;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+};
+
+#ifdef VHW_HAVE_IO_URING
+/**
+ * io_uring engine driven through the raw syscalls (no liburing dependency)
+ *
+ * The CPU thread fills submission entries under a lock; a reaper thread
+ * blocks in io_uring_enter for completions. Short transfers are resubmitted
+ * for the remainder. Jobs that are not plain fd transfers use the pool.
+ */
+class UringIo : public AsyncIo {
+public:
+    static constexpr unsigned QUEUE_DEPTH = 64;
+
+    /**
+     * @return nullptr if the kernel (or a seccomp policy) refuses io_uring
+     */
+    static std::unique_ptr<UringIo> tryCreate(unsigned workers) {
+        std::unique_ptr<UringIo> io(new UringIo(workers));
+        if (!io->setup()) {
+            return nullptr;
+        }
+        io->reaper = std::thread([raw = io.get()] { raw->reapLoop(); });
+        return io;
+    }
+
+    ~UringIo() override {
+        if (reaper.joinable()) {
+            // Completions are not ordered, so wait for every request to finish
+            // before the NOP tagged with the stop token wakes the reaper for good
+            {
+                std::unique_lock<std::mutex> lock(outstandingMutex);
+                idle.wait(lock, [this] { return outstanding == 0; });
+            }
+            submit(IORING_OP_NOP, -1, nullptr, 0, 0, STOP_TOKEN);
+            reaper.join();
+        }
+        if (sqRing) munmap(sqRing, sqRingSize);
+        if (cqRing && cqRing != sqRing) munmap(cqRing, cqRingSize);
+        if (sqes) munmap(sqes, QUEUE_DEPTH * sizeof(io_uring_sqe));
+        if (ringFd >= 0) ::close(ringFd);
+    }
+
+    void submitRead(int fd, uint8_t* buffer, size_t length, uint64_t offset, Completion done) override {
+        track();
+        queueTransfer(new Request{fd, buffer, length, offset, false, std::move(done)});
+    }
+
+    void submitWrite(int fd, const uint8_t* buffer, size_t length, uint64_t offset, Completion done) override {
+        track();
+        queueTransfer(new Request{fd, const_cast<uint8_t*>(buffer), length, offset, true, std::move(done)});
+    }
+
+    void submitJob(std::function<bool()> job, Completion done) override {
+        pool.submitJob(std::move(job), std::move(done));
+    }
+
+    const char* name() const override {
+        return "io_uring";
+    }
+
+private:
+    static constexpr uint64_t STOP_TOKEN = ~0ull;
+
+    struct Request {
+        int fd;
+        uint8_t* buffer;
+        size_t length;
+        uint64_t offset;
+        bool isWrite;
+        Completion done;
+    };
+
+    explicit UringIo(unsigned workers) : pool(workers) {}
+
+    static int sysSetup(unsigned entries, io_uring_params* params) {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int sysEnter(unsigned toSubmit, unsigned minComplete, unsigned flags) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+
+    bool setup() {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ringFd = sysSetup(QUEUE_DEPTH, &params);
+        if (ringFd < 0) {
+            return false;
+        }
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) {
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        }
+
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) {
+            sqRing = nullptr;
+            return false;
+        }
+        cqRing = single ? sqRing
+                        : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            cqRing = nullptr;
+            return false;
+        }
+        void* entries = mmap(nullptr, QUEUE_DEPTH * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+        if (entries == MAP_FAILED) {
+            return false;
+        }
+        sqes = static_cast<io_uring_sqe*>(entries);
+
+        auto* sq = static_cast<uint8_t*>(sqRing);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        sqEntries = params.sq_entries;
+
+        auto* cq = static_cast<uint8_t*>(cqRing);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        // Probe with a NOP: seccomp policies may allow setup but reject enter
+        return submit(IORING_OP_NOP, -1, nullptr, 0, 0, 0) && waitForProbe();
+    }
+
+    bool waitForProbe() {
+        if (sysEnter(0, 1, IORING_ENTER_GETEVENTS) < 0) {
+            return false;
+        }
+        unsigned head = *cqHead;
+        bool ok = head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE) && cqes[head & cqMask].res == 0;
+        __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+        return ok;
+    }
+
+    void queueTransfer(Request* request) {
+        if (!submit(request->isWrite ? IORING_OP_WRITE : IORING_OP_READ, request->fd, request->buffer,
+                    static_cast<uint32_t>(std::min<size_t>(request->length, UINT32_MAX)),
+                    request->offset, reinterpret_cast<uint64_t>(request))) {
+            finish(request, false);
+        }
+    }
+
+    bool submit(uint8_t opcode, int fd, void* buffer, uint32_t length, uint64_t offset, uint64_t userData) {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        unsigned tail = *sqTail;
+        // Wait for room if the kernel has not consumed earlier entries yet
+        while (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries) {
+            std::this_thread::yield();
+        }
+
+        unsigned index = tail & sqMask;
+        io_uring_sqe& sqe = sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = opcode;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<uint64_t>(buffer);
+        sqe.len = length;
+        sqe.off = offset;
+        sqe.user_data = userData;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+        int submitted;
+        do {
+            submitted = sysEnter(1, 0, 0);
+        } while (submitted < 0 && errno == EINTR);
+        return submitted >= 0;
+    }
+
+    void reapLoop() {
+        while (true) {
+            if (sysEnter(0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+                return;
+            }
+            unsigned head = *cqHead;
+            while (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+                io_uring_cqe cqe = cqes[head & cqMask];
+                __atomic_store_n(cqHead, ++head, __ATOMIC_RELEASE);
+                if (cqe.user_data == STOP_TOKEN) {
+                    return;
+                }
+                complete(reinterpret_cast<Request*>(cqe.user_data), cqe.res);
+            }
+        }
+    }
+
+    void complete(Request* request, int result) {
+        if (result <= 0) {
+            finish(request, request->length == 0);
+            return;
+        }
+        size_t done = static_cast<size_t>(result);
+        if (done >= request->length) {
+            finish(request, true);
+            return;
+        }
+        // Short transfer: continue with the remainder
+        request->buffer += done;
+        request->offset += done;
+        request->length -= done;
+        queueTransfer(request);
+    }
+
+    void track() {
+        std::lock_guard<std::mutex> lock(outstandingMutex);
+        ++outstanding;
+    }
+
+    void finish(Request* request, bool ok) {
+        if (request->done) request->done(ok);
+        delete request;
+        std::lock_guard<std::mutex> lock(outstandingMutex);
+        if (--outstanding == 0) {
+            idle.notify_all();
+        }
+    }
+
+    ThreadPoolIo pool;
+    std::thread reaper;
+    std::mutex submitMutex;
+    std::mutex outstandingMutex;
+    std::condition_variable idle;
+    size_t outstanding = 0;  // Transfers submitted whose completion has not run yet
+
+    int ringFd = -1;
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    io_uring_sqe* sqes = nullptr;
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned sqMask = 0;
+    unsigned sqEntries = 0;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+};
+#endif
+
+inline std::unique_ptr<AsyncIo> AsyncIo::create(unsigned workers) {
+#ifdef VHW_HAVE_IO_URING
+    if (auto uring = UringIo::tryCreate(workers)) {
+        return uring;
+    }
+#endif
+    return std::make_unique<ThreadPoolIo>(workers);
+}
+
+} // namespace vhw
@@ -1,15 +1,24 @@
+#include <algorithm>
 #include <iomanip>
 #include <chrono>
 #include <thread>
 #include <ctime>
 #include <sstream>
 #include <unordered_set>
+#include <array>
 #include <fmt/core.h>
 
 #include "cpu.hpp"
 #include "cpu_flags.hpp"
 #include "cpu_registers.hpp"  // Include the new register system
 #include "opcodes/opcode_dispatcher.hpp"
+#include "virtual_clock.hpp"
+#include "input_journal.hpp"
+#include "../debug/trace.hpp"
+#include "../debug/profiler.hpp"
+#include "../debug/instruction_stats.hpp"
+#include "../debug/block_profiler.hpp"
+#include "../codegen/jit.hpp"
 
 using namespace DemiEngine_Registers;
 
@@ -21,107 +30,157 @@ constexpr size_t CPU_MIN_MEMORY_SIZE = 256; // Allow 256 bytes minimum for test
 constexpr size_t CPU_MAX_MEMORY_SIZE = 64 * 1024 * 1024; // 64MB maximum for performance
 const uint32_t INVALID_ADDR = static_cast<uint32_t>(-1);
 
+// Encoded size of the instruction at pc, matching how far each handler advances PC
+size_t instruction_length(const std::vector<uint8_t>& program, size_t pc) {
+    switch (static_cast<Opcode>(program[pc])) {
+        case Opcode::LOAD_IMM:
+        case Opcode::ADD:
+        case Opcode::SUB:
+        case Opcode::MOV:
+        case Opcode::LOAD:
+        case Opcode::STORE:
+        case Opcode::LEA:
+        case Opcode::SWAP:
+        case Opcode::CMP:
+        case Opcode::MUL:
+        case Opcode::DIV:
+        case Opcode::AND:
+        case Opcode::OR:
+        case Opcode::XOR:
+        case Opcode::SHL:
+        case Opcode::SHR:
+        case Opcode::IN:
+        case Opcode::OUT:
+        case Opcode::INB:
+        case Opcode::OUTB:
+        case Opcode::INW:
+        case Opcode::OUTW:
+        case Opcode::INL:
+        case Opcode::OUTL:
+        case Opcode::INSTR:
+        case Opcode::OUTSTR:
+        case Opcode::ADD64:
+        case Opcode::SUB64:
+        case Opcode::MOV64:
+        case Opcode::MUL64:
+        case Opcode::DIV64:
+        case Opcode::AND64:
+        case Opcode::OR64:
+        case Opcode::XOR64:
+        case Opcode::SHL64:
+        case Opcode::SHR64:
+        case Opcode::CMP64:
+        case Opcode::MOVEX:
+        case Opcode::ADDEX:
+        case Opcode::SUBEX:
+        case Opcode::MULEX:
+        case Opcode::DIVEX:
+        case Opcode::CMPEX:
+        case Opcode::LOADEX:
+        case Opcode::STOREX:
+        case Opcode::PUSHEX:
+        case Opcode::POPEX:
+            return 3;
+        case Opcode::JMP:
+        case Opcode::JZ:
+        case Opcode::JNZ:
+        case Opcode::JS:
+        case Opcode::JNS:
+        case Opcode::JC:
+        case Opcode::JNC:
+        case Opcode::JO:
+        case Opcode::JNO:
+        case Opcode::JG:
+        case Opcode::JL:
+        case Opcode::JGE:
+        case Opcode::JLE:
+        case Opcode::PUSH:
+        case Opcode::POP:
+        case Opcode::INC:
+        case Opcode::DEC:
+        case Opcode::NOT:
+        case Opcode::CALL:
+        case Opcode::PUSH_ARG:
+        case Opcode::POP_ARG:
+            return 2;
+        case Opcode::HALT:
+        case Opcode::NOP:
+        case Opcode::RET:
+        case Opcode::PUSH_FLAG:
+        case Opcode::POP_FLAG:
+        case Opcode::MODE32:
+        case Opcode::MODE64:
+        case Opcode::IRET:
+        case Opcode::STI:
+        case Opcode::CLI:
+        case Opcode::WAIT:
+            return 1;
+        case Opcode::LOAD_IMM64:
+            return 10; // opcode + reg + 8-byte immediate
+        case Opcode::MODECMP:
+            return 2; // opcode + mode value
+        case Opcode::DB:
+            return pc + 2 < program.size() ? 3 + static_cast<size_t>(program[pc + 2]) : 1;
+        default:
+            return 1;
+    }
+}
+
+bool is_conditional_jump(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::JZ: case Opcode::JNZ: case Opcode::JS: case Opcode::JNS:
+        case Opcode::JC: case Opcode::JNC: case Opcode::JO: case Opcode::JNO:
+        case Opcode::JG: case Opcode::JL: case Opcode::JGE: case Opcode::JLE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool is_jump(Opcode opcode) {
+    return opcode == Opcode::JMP || is_conditional_jump(opcode);
+}
+
+bool ends_block(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::CALL: case Opcode::RET: case Opcode::IRET: case Opcode::HALT:
+            return true;
+        default:
+            return is_jump(opcode);
+    }
+}
+
+// Leaders are address 0, jump and call targets and whatever follows a control
+// transfer; a jump back to or before itself closes a loop
+ControlFlow scan_control_flow(const std::vector<uint8_t>& program) {
+    ControlFlow flow;
+    flow.leaders.insert(0);
+    for (size_t pc = 0; pc < program.size(); pc += instruction_length(program, pc)) {
+        flow.starts.push_back(static_cast<uint32_t>(pc));
+        Opcode opcode = static_cast<Opcode>(program[pc]);
+        size_t next = pc + instruction_length(program, pc);
+        if ((is_jump(opcode) || opcode == Opcode::CALL) && pc + 1 < program.size()) {
+            uint32_t target = program[pc + 1];
+            flow.leaders.insert(target);
+            if (is_jump(opcode) && target <= pc) {
+                uint32_t& end = flow.loop_ends[target];
+                end = std::max(end, static_cast<uint32_t>(next));
+            }
+        }
+        if (ends_block(opcode)) {
+            flow.leaders.insert(static_cast<uint32_t>(next));
+        }
+    }
+    return flow;
+}
+
 // Standalone function to compute valid instruction starts
 std::unordered_set<size_t> compute_valid_instruction_starts(const std::vector<uint8_t>& program) {
     std::unordered_set<size_t> starts;
     size_t pc = 0;
     while (pc < program.size()) {
         starts.insert(static_cast<size_t>(pc));
-        Opcode opcode = static_cast<Opcode>(program[pc]);
-        switch (opcode) {
-            case Opcode::LOAD_IMM:
-            case Opcode::ADD:
-            case Opcode::SUB:
-            case Opcode::MOV:
-            case Opcode::LOAD:
-            case Opcode::STORE:
-            case Opcode::CMP:
-            case Opcode::MUL:
-            case Opcode::DIV:
-            case Opcode::AND:
-            case Opcode::OR:
-            case Opcode::XOR:
-            case Opcode::SHL:
-            case Opcode::SHR:
-            case Opcode::IN:
-            case Opcode::OUT:
-            case Opcode::INB:
-            case Opcode::OUTB:
-            case Opcode::INW:
-            case Opcode::OUTW:
-            case Opcode::INL:
-            case Opcode::OUTL:
-            case Opcode::INSTR:
-            case Opcode::OUTSTR:
-            case Opcode::ADD64:
-            case Opcode::SUB64:
-            case Opcode::MOV64:
-            case Opcode::MUL64:
-            case Opcode::DIV64:
-            case Opcode::AND64:
-            case Opcode::OR64:
-            case Opcode::XOR64:
-            case Opcode::SHL64:
-            case Opcode::SHR64:
-            case Opcode::CMP64:
-            case Opcode::MOVEX:
-            case Opcode::ADDEX:
-            case Opcode::SUBEX:
-            case Opcode::MULEX:
-            case Opcode::DIVEX:
-            case Opcode::CMPEX:
-            case Opcode::LOADEX:
-            case Opcode::STOREX:
-            case Opcode::PUSHEX:
-            case Opcode::POPEX:
-                pc += 3;
-                break;
-            case Opcode::JMP:
-            case Opcode::JZ:
-            case Opcode::JNZ:
-            case Opcode::JS:
-            case Opcode::JNS:
-            case Opcode::JC:
-            case Opcode::JNC:
-            case Opcode::JO:
-            case Opcode::JNO:
-            case Opcode::PUSH:
-            case Opcode::POP:
-            case Opcode::INC:
-            case Opcode::DEC:
-            case Opcode::NOT:
-            case Opcode::CALL:
-            case Opcode::PUSH_ARG:
-            case Opcode::POP_ARG:
-                pc += 2;
-                break;
-            case Opcode::HALT:
-            case Opcode::NOP:
-            case Opcode::RET:
-            case Opcode::PUSH_FLAG:
-            case Opcode::POP_FLAG:
-            case Opcode::MODE32:
-            case Opcode::MODE64:
-                pc += 1;
-                break;
-            case Opcode::LOAD_IMM64:
-                pc += 10; // opcode + reg + 8-byte immediate
-                break;
-            case Opcode::MODECMP:
-                pc += 2; // opcode + mode value
-                break;
-            case Opcode::DB:
-                if (pc + 2 < program.size()) {
-                    uint8_t length = program[pc + 2];
-                    pc += 3 + length;
-                } else {
-                    pc += 1;
-                }
-                break;
-            default:
-                pc += 1;
-                break;
-        }
+        pc += instruction_length(program, pc);
     }
     return starts;
 }
@@ -171,7 +230,10 @@ CPU::CPU(size_t memory_size)
         memory.size(), memory.size() / (1024.0 * 1024.0), TOTAL_REGISTERS) << std::endl;
 }
 
-CPU::~CPU() = default;
+CPU::~CPU() {
+    // Make sure devices never see memory that outlives this CPU
+    vhw::DeviceManager::instance().detachMemory(&memory);
+}
 
 // Extended register access methods
 uint64_t CPU::get_register(Register reg) const {
@@ -238,7 +300,14 @@ void CPU::resize_memory(size_t new_size) {
     }
 
     size_t old_size = memory.size();
+    // Growing may move the buffer; let devices finish with the old one first
+    auto& devices = vhw::DeviceManager::instance();
+    bool attached = devices.getMemory() == &memory;
+    devices.detachMemory(&memory);
     memory.resize(new_size, 0); // Initialize new memory to zero
+    if (attached) {
+        devices.attachMemory(&memory);
+    }
 
     // Adjust stack pointer if it's now out of bounds
     auto current_sp = static_cast<size_t>(registers[static_cast<size_t>(Register::RSP)]);
@@ -269,6 +338,9 @@ void CPU::reset() {
     registers[static_cast<size_t>(Register::RFLAGS)] = 0;
 
     arg_offset = 0; // Initialize arg_offset for PUSH_ARG/POP_ARG operations
+    interrupts_enabled = false;
+    interrupt_shadow = false;
+    vhw::DeviceManager::instance().resetClock();
     last_accessed_addr = INVALID_ADDR; // Clear highlight
     last_modified_addr = INVALID_ADDR; // Clear highlight
 
@@ -344,6 +416,7 @@ void CPU::write_mem32(uint32_t addr, uint32_t value) {
         return;
     }
     last_modified_addr = addr;
+    note_store(addr, value);
     memory[addr    ] = static_cast<uint8_t>(value      );
     memory[addr + 1] = static_cast<uint8_t>(value >> 8 );
     memory[addr + 2] = static_cast<uint8_t>(value >> 16);
@@ -356,12 +429,153 @@ void CPU::execute(const std::vector<uint8_t>& program) {
     set_pc(0);
     registers[static_cast<size_t>(Register::RSP)] = memory.size() - 4; // Stack pointer starts at the end of memory
     registers[static_cast<size_t>(Register::RBP)] = get_sp();
+    vhw::DeviceManager::instance().attachMemory(&memory);
     bool running = true;
 
+    // Devices are ticked once per batch of retired instructions rather than
+    // per instruction; the batch ends early at the next device deadline
+    auto& devices = vhw::DeviceManager::instance();
+    auto& clock = vhw::VirtualClock::instance();
+    if (profiler) {
+        profiler->schedule();
+    }
+
+    // Compiled blocks run until the next device tick is due; anything not
+    // compiled, or a block longer than what is left of the batch, is
+    // interpreted. Looking a block up counts it, so a loop turning hot is
+    // entered natively at its header on the next iteration.
+    CodeGen::Jit* native = jit && !observed && !Config::debug && jit->compiled_for(program) ? jit : nullptr;
+    CodeGen::JitState state{legacy_registers.data(), registers.data(), memory.data(), memory.size(), &arg_offset, 0};
+
     while (get_pc() < program.size() && running) {
+        poll_interrupts();
+        const void* block = native ? native->block_at(get_pc()) : nullptr;
+        if (block) {
+            uint64_t budget = clock.budget();
+            state.budget = static_cast<int64_t>(budget);
+            set_pc(native->run(state, block));
+            uint64_t retired = budget - static_cast<uint64_t>(state.budget);
+            if (retired > 0) {
+                if (clock.retire(retired)) {
+                    devices.tickDevices();
+                    if (profiler) {
+                        profiler->tick(*this);
+                    }
+                }
+                continue;
+            }
+        }
+
         // Use the new opcode dispatcher
+        if (observed) {
+            dispatch_observed(program, running);
+        } else {
+            dispatch_opcode(*this, program, running);
+        }
+
+        if (clock.retire()) {
+            devices.tickDevices();
+            if (profiler) {
+                profiler->tick(*this);
+            }
+        }
+    }
+    if (clock.pendingCycles() > 0) {
+        devices.tickDevices();
+    }
+
+    // Program halted or ran off the end; make buffered device output visible
+    devices.flushAllDevices();
+}
+
+void CPU::set_stats(Profiling::InstructionStats* counters) {
+    if (stats) {
+        stats->attach_ports(false);
+    }
+    stats = counters;
+    if (stats) {
+        stats->attach_ports(true);
+    }
+    update_observed();
+}
+
+void CPU::dispatch_observed(const std::vector<uint8_t>& program, bool& running) {
+    uint32_t pc = get_pc();
+    if (blocks) {
+        blocks->enter(pc);
+    }
+    if (!stats) {
+        if (tracer) {
+            dispatch_traced(program, running);
+        } else {
+            dispatch_opcode(*this, program, running);
+        }
+        return;
+    }
+
+    uint8_t opcode = pc < program.size() ? program[pc] : 0;
+    store_addr = INVALID_ADDR;
+    auto start = std::chrono::steady_clock::now();
+    if (tracer) {
+        dispatch_traced(program, running);
+    } else {
         dispatch_opcode(*this, program, running);
     }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    stats->record(opcode, pc, get_pc(), store_addr != INVALID_ADDR, static_cast<uint64_t>(elapsed.count()));
+}
+
+void CPU::dispatch_traced(const std::vector<uint8_t>& program, bool& running) {
+    uint32_t pc = get_pc();
+    uint64_t cycle = vhw::VirtualClock::instance().now();
+    std::array<uint32_t, CPU_LEGACY_REGISTER_COUNT> before;
+    std::copy_n(legacy_registers.begin(), std::min(before.size(), legacy_registers.size()), before.begin());
+    store_addr = INVALID_ADDR;
+
+    dispatch_opcode(*this, program, running);
+
+    Tracing::TraceRecord& record = tracer->append();
+    record.cycle = cycle;
+    record.pc = pc;
+    record.flags = get_flags();
+    record.opcode = pc < program.size() ? program[pc] : 0;
+    record.reg = Tracing::TraceRecord::NO_REGISTER;
+    record.reg_value = 0;
+    for (size_t i = 0; i < std::min(before.size(), legacy_registers.size()); ++i) {
+        if (legacy_registers[i] != before[i]) {
+            record.reg = static_cast<uint8_t>(i);
+            record.reg_value = legacy_registers[i];
+            break;
+        }
+    }
+    record.mem_addr = store_addr;
+    record.mem_value = store_addr == INVALID_ADDR ? 0 : store_value;
+    record.reserved = 0;
+}
+
+void CPU::service_interrupt() {
+    auto& controller = vhw::InterruptController::instance();
+    int line = controller.acknowledge();
+    if (line < 0) return;
+    auto& journal = vhw::InputJournal::instance();
+    if (journal.isRecording()) {
+        journal.recordInterrupt(static_cast<uint8_t>(line));
+    }
+
+    uint32_t handler = read_mem32(controller.getVectorBase() + 4 * static_cast<uint32_t>(line));
+    Logger::instance().debug() << fmt::format(
+        "[PC=0x{:04X}] [IRQ] Line {} -> handler 0x{:04X}",
+        get_pc(), line, handler
+    ) << std::endl;
+
+    // Frame popped by IRET: SP = return address, SP+4 = flags
+    set_sp(get_sp() - 4);
+    write_mem32(get_sp(), get_flags() | FLAG_INTERRUPT);
+    set_sp(get_sp() - 4);
+    write_mem32(get_sp(), get_pc());
+
+    interrupts_enabled = false;
+    set_pc(handler);
 }
 
 void CPU::print_registers() const {
@@ -458,9 +672,27 @@ bool CPU::step(const std::vector<uint8_t>& program) {
         return false; // Program ended
     }
 
+    vhw::DeviceManager::instance().attachMemory(&memory);
+    poll_interrupts();
+    if (get_pc() >= program.size()) {
+        return false; // Interrupt vector points outside the program
+    }
+
     bool running = true;
-    dispatch_opcode(*this, program, running);
+    if (observed) {
+        dispatch_observed(program, running);
+    } else {
+        dispatch_opcode(*this, program, running);
+    }
+    vhw::VirtualClock::instance().retire();
+    vhw::DeviceManager::instance().tickDevices();
+    if (profiler) {
+        profiler->tick(*this);
+    }
 
+    if (!running || get_pc() >= program.size()) {
+        vhw::DeviceManager::instance().flushAllDevices();
+    }
     return running;
 }
 
@@ -1,12 +1,19 @@
 #pragma once
 #include <vector>
 #include <cstdint>
+#include <map>
+#include <set>
 #include <string>
 
 #include "../config.hpp"
 #include "../debug/logger.hpp"
 #include "cpu_registers.hpp"  // New extended register architecture
 #include "device_manager.hpp"
+#include "interrupt_controller.hpp"
+
+namespace Tracing { class TraceWriter; }
+namespace Profiling { class SamplingProfiler; class InstructionStats; class BlockProfiler; }
+namespace CodeGen { class Jit; }
 
 using Logging::Logger;
 using DemiEngine_Registers::Register;
@@ -46,6 +53,11 @@ enum class Opcode : uint8_t {
     JGE = 0x27,         // Jump if greater or equal (signed)
     JLE = 0x28,         // Jump if less or equal (signed)
 
+    IRET = 0x29,        // Return from interrupt handler
+    STI  = 0x2A,        // Enable interrupts (after the next instruction)
+    CLI  = 0x2B,        // Disable interrupts
+    WAIT = 0x2C,        // Park until an interrupt is deliverable
+
     MUL = 0x10,         // Multiply reg1, reg2
     DIV = 0x11,         // Divide reg1, reg2
     INC = 0x12,         // Increment reg
@@ -393,6 +405,19 @@ public:
     uint32_t get_sp() const { return static_cast<uint32_t>(registers[static_cast<size_t>(Register::RSP)]); }
     uint32_t get_fp() const { return static_cast<uint32_t>(registers[static_cast<size_t>(Register::RBP)]); }
     int get_arg_offset() const { return arg_offset; }
+
+    // Interrupt state
+    bool get_interrupts_enabled() const { return interrupts_enabled; }
+    void set_interrupts_enabled(bool enabled) {
+        interrupts_enabled = enabled;
+        interrupt_shadow = enabled; // STI takes effect after the next instruction
+    }
+    // Checked between instructions; only touches the controller when interrupts are enabled
+    void poll_interrupts() {
+        if (!interrupts_enabled) return;
+        if (interrupt_shadow) { interrupt_shadow = false; return; }
+        if (vhw::InterruptController::instance().deliverable()) service_interrupt();
+    }
     void set_arg_offset(int value) { arg_offset = value; }
 
     void set_pc(uint32_t value) { registers[static_cast<size_t>(Register::RIP)] = value; }
@@ -408,6 +433,25 @@ public:
     uint32_t get_last_accessed_addr() const { return last_accessed_addr; }
     uint32_t get_last_modified_addr() const { return last_modified_addr; }
 
+    // Binary execution trace (nullptr = off); the writer must outlive execution
+    void set_tracer(Tracing::TraceWriter* writer) { tracer = writer; update_observed(); }
+    Tracing::TraceWriter* get_tracer() const { return tracer; }
+    // Sampling profiler (nullptr = off); sampled on the device-tick path only
+    void set_profiler(Profiling::SamplingProfiler* sampler) { profiler = sampler; }
+    Profiling::SamplingProfiler* get_profiler() const { return profiler; }
+    // Per-opcode instruction-mix counters (nullptr = off); also counts port I/O while attached
+    void set_stats(Profiling::InstructionStats* counters);
+    Profiling::InstructionStats* get_stats() const { return stats; }
+    // Basic-block execution counts (nullptr = off); must be built from the program being run
+    void set_block_profiler(Profiling::BlockProfiler* counter) { blocks = counter; update_observed(); }
+    Profiling::BlockProfiler* get_block_profiler() const { return blocks; }
+    // Compiled code for the program (nullptr = interpret); used by execute() unless
+    // instrumentation or debug output needs to see every instruction
+    void set_jit(CodeGen::Jit* compiled) { jit = compiled; }
+    CodeGen::Jit* get_jit() const { return jit; }
+    // Handlers that write guest memory directly report the store for the trace
+    void note_store(uint32_t addr, uint32_t value) { store_addr = addr; store_value = value; }
+
     // I/O operations for opcode handlers
     uint8_t read_port(uint8_t port) { return readPort(port); }
     void write_port(uint8_t port, uint8_t value) { writePort(port, value); }
@@ -432,9 +476,29 @@ private:
 
     std::vector<uint8_t> memory;
     int arg_offset; // Offset for arguments
+    bool interrupts_enabled = false;
+    bool interrupt_shadow = false;
     mutable uint32_t last_accessed_addr = static_cast<uint32_t>(-1);
     uint32_t last_modified_addr = static_cast<uint32_t>(-1);
 
+    Tracing::TraceWriter* tracer = nullptr;
+    Profiling::SamplingProfiler* profiler = nullptr;
+    Profiling::InstructionStats* stats = nullptr;
+    Profiling::BlockProfiler* blocks = nullptr;
+    CodeGen::Jit* jit = nullptr;
+    bool observed = false;  // Any instrumentation attached: take the slow dispatch path
+    void update_observed() { observed = tracer || stats || blocks; }
+    uint32_t store_addr = static_cast<uint32_t>(-1);
+    uint32_t store_value = 0;
+
+    // dispatch_opcode() wrapped in whichever instrumentation is attached
+    void dispatch_observed(const std::vector<uint8_t>& program, bool& running);
+    // dispatch_opcode() plus a trace record describing what the instruction did
+    void dispatch_traced(const std::vector<uint8_t>& program, bool& running);
+
+    // Push FLAGS and PC and vector to the handler of the highest priority line
+    void service_interrupt();
+
     // Internal register synchronization
     void sync_legacy_registers();
     void sync_from_legacy_registers();
@@ -443,4 +507,24 @@ private:
     void writePort(uint8_t port, uint8_t value);
     std::string readPortString(uint8_t port, uint8_t maxLength = 255);
     void writePortString(uint8_t port, const std::string& str);
-};
\ No newline at end of file
+};
+
+// Encoded size in bytes of the instruction at pc (at least 1)
+size_t instruction_length(const std::vector<uint8_t>& program, size_t pc);
+
+// Jumps to the address in their operand; the conditional ones may fall through
+bool is_jump(Opcode opcode);
+bool is_conditional_jump(Opcode opcode);
+
+// Instructions after which the next address starts a new basic block
+bool ends_block(Opcode opcode);
+
+// Where basic blocks start and loops are, from one linear sweep of a program.
+// The block profiler and the JIT both cut blocks from this.
+struct ControlFlow {
+    std::vector<uint32_t> starts;            // Every instruction, in program order
+    std::set<uint32_t> leaders;              // 0, jump and call targets, and addresses after ends_block()
+    std::map<uint32_t, uint32_t> loop_ends;  // Loop header -> end of its furthest back edge
+};
+
+ControlFlow scan_control_flow(const std::vector<uint8_t>& program);
@@ -6,3 +6,7 @@ constexpr uint32_t FLAG_ZERO = 1 << 0;
 constexpr uint32_t FLAG_SIGN = 1 << 1;
 constexpr uint32_t FLAG_CARRY = 1 << 2;
 constexpr uint32_t FLAG_OVERFLOW = 1 << 3;
+
+// Interrupt enable state. The CPU keeps it outside RFLAGS (CMP and POP_FLAG
+// overwrite the whole word); it only appears in the flags saved on interrupt entry.
+constexpr uint32_t FLAG_INTERRUPT = 1 << 9;
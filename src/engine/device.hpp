@@ -1,9 +1,12 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <memory>
 
+#include "device_mutex.hpp"
+
 namespace vhw {
 
 /**
@@ -27,6 +30,33 @@ public:
 
     // Reset the device to its initial state
     virtual void reset() = 0;
+
+    // Push any buffered output to its destination (called at HALT)
+    virtual void flush() {}
+
+    // Called on the owning thread before another thread first accesses the
+    // device; devices with a DeviceMutex switch it to real locking
+    virtual void markShared() {}
+
+    // Called before the attached guest memory is detached or freed; devices
+    // holding pointers into it must be done with them when this returns
+    virtual void releaseMemory() {}
+
+    // Whether a host thread may still raise an interrupt for this device
+    // without the guest doing anything more (a transfer in flight, a reader
+    // attached to an input)
+    virtual bool mayInterrupt() const { return false; }
+
+    // Whether the device wants tick() calls (checked once, at registration)
+    virtual bool isTicking() const { return false; }
+
+    // Advance the device by the given number of virtual cycles; called in
+    // batches by DeviceManager::tickDevices(), see VirtualClock
+    virtual void tick(uint64_t cycles) { (void)cycles; }
+
+    // The virtual clock was reset to 0 from the given time; ticking devices
+    // that schedule against it rebase their deadlines
+    virtual void clockReset(uint64_t previous) { (void)previous; }
 };
 
 /**
@@ -55,4 +85,22 @@ public:
     virtual bool isConnected() const = 0;
 };
 
+/**
+ * Interface for devices that expose their contents for bulk transfers (e.g. DMA)
+ * Offsets are in bytes from the start of the device's storage
+ */
+class BlockStorage {
+public:
+    virtual ~BlockStorage() = default;
+
+    // Copy up to length bytes starting at offset into dest, returns bytes copied
+    virtual size_t readBlock(size_t offset, uint8_t* dest, size_t length) = 0;
+
+    // Copy length bytes from src to offset, returns bytes written
+    virtual size_t writeBlock(size_t offset, const uint8_t* src, size_t length) = 0;
+
+    // Number of bytes currently addressable
+    virtual size_t capacity() const = 0;
+};
+
 } // namespace vhw
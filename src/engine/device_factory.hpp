@@ -6,6 +6,11 @@
 #include "devices/serial_port_device.hpp"
 #include "devices/file_device.hpp"
 #include "devices/ramdisk_device.hpp"
+#include "devices/dma_device.hpp"
+#include "devices/pic_device.hpp"
+#include "devices/block_device.hpp"
+#include "devices/disk_image.hpp"
+#include "devices/timer_device.hpp"
 
 #include <memory>
 
@@ -64,13 +69,15 @@ public:
      * Create and register a file device
      * @param filepath The path to the file
      * @param port The port to register the device at
+     * @param mode Buffered (load the whole file) or Mapped (mmap the file)
      * @return The created device
      */
     static std::shared_ptr<FileDevice> createFileDevice(
         const std::string& filepath,
-        uint8_t port = FileDevice::DEFAULT_PORT
+        uint8_t port = FileDevice::DEFAULT_PORT,
+        FileDevice::Mode mode = FileDevice::Mode::Buffered
     ) {
-        auto device = std::make_shared<FileDevice>(filepath);
+        auto device = std::make_shared<FileDevice>(filepath, mode);
         DeviceManager::instance().registerDevice(port, device);
         return device;
     }
@@ -102,6 +109,110 @@ public:
         
         return device;  // Return the control instance
     }
+
+    /**
+     * Create and register a DMA controller
+     * @param dataPort The port to register the data interface at
+     * @param ctrlPort The port to register the control/status interface at
+     * @return The created controller
+     */
+    static std::shared_ptr<DmaDevice> createDmaDevice(
+        uint8_t dataPort = DmaDevice::DEFAULT_DATA_PORT,
+        uint8_t ctrlPort = DmaDevice::DEFAULT_CTRL_PORT
+    ) {
+        auto device = std::make_shared<DmaDevice>();
+        DeviceManager::instance().registerDevice(ctrlPort, device);
+        DeviceManager::instance().registerDevice(dataPort, device->dataPort());
+        return device;
+    }
+
+    /**
+     * Create and register the interrupt controller ports
+     * @param dataPort The port to register the data interface at
+     * @param ctrlPort The port to register the control/status interface at
+     * @return The created device (control instance)
+     */
+    static std::shared_ptr<PicDevice> createPicDevice(
+        uint8_t dataPort = PicDevice::DEFAULT_DATA_PORT,
+        uint8_t ctrlPort = PicDevice::DEFAULT_CTRL_PORT
+    ) {
+        auto device = std::make_shared<PicDevice>();
+        DeviceManager::instance().registerDevice(ctrlPort, device);
+        DeviceManager::instance().registerDevice(dataPort, device->dataPort());
+        return device;
+    }
+
+    /**
+     * Create and register a sector-addressed block device
+     * @param backend The host storage behind the disk
+     * @param dataPort The port to register the data interface at
+     * @param ctrlPort The port to register the control/status interface at
+     * @return The created device (control instance)
+     */
+    static std::shared_ptr<BlockDevice> createBlockDevice(
+        std::unique_ptr<BlockBackend> backend,
+        uint8_t dataPort = BlockDevice::DEFAULT_DATA_PORT,
+        uint8_t ctrlPort = BlockDevice::DEFAULT_CTRL_PORT
+    ) {
+        auto device = std::make_shared<BlockDevice>(std::move(backend));
+        DeviceManager::instance().registerDevice(ctrlPort, device);
+        DeviceManager::instance().registerDevice(dataPort, device->dataPort());
+        return device;
+    }
+
+    /**
+     * Create a block device over a disk image, or over sparse memory if path is empty
+     * @param path The image file path; raw images are created and sized on first use,
+     *             overlay and compressed images are detected by their header
+     * @param sectors The disk size in 512-byte sectors
+     */
+    static std::shared_ptr<BlockDevice> createBlockDevice(
+        const std::string& path,
+        uint64_t sectors,
+        uint8_t dataPort = BlockDevice::DEFAULT_DATA_PORT,
+        uint8_t ctrlPort = BlockDevice::DEFAULT_CTRL_PORT
+    ) {
+        std::unique_ptr<BlockBackend> backend;
+        if (path.empty()) {
+            backend = std::make_unique<SparseMemoryBackend>(sectors);
+        } else {
+            backend = DiskImage::open(path, sectors);
+        }
+        return createBlockDevice(std::move(backend), dataPort, ctrlPort);
+    }
+
+    /**
+     * Create a block device over a copy-on-write overlay of a shared base image
+     * @param overlayPath The per-VM overlay; created over basePath if it does not exist
+     * @param basePath The read-only base image (raw or compressed)
+     */
+    static std::shared_ptr<BlockDevice> createOverlayBlockDevice(
+        const std::string& overlayPath,
+        const std::string& basePath,
+        uint8_t dataPort = BlockDevice::DEFAULT_DATA_PORT,
+        uint8_t ctrlPort = BlockDevice::DEFAULT_CTRL_PORT
+    ) {
+        if (!std::filesystem::exists(overlayPath) && !OverlayBackend::create(overlayPath, basePath)) {
+            throw std::runtime_error("Failed to create overlay '" + overlayPath + "' over '" + basePath + "'");
+        }
+        return createBlockDevice(std::make_unique<OverlayBackend>(overlayPath), dataPort, ctrlPort);
+    }
+
+    /**
+     * Create and register a programmable timer bank
+     * @param dataPort The port to register the data interface at
+     * @param ctrlPort The port to register the control/status interface at
+     * @return The created device (control instance)
+     */
+    static std::shared_ptr<TimerDevice> createTimerDevice(
+        uint8_t dataPort = TimerDevice::DEFAULT_DATA_PORT,
+        uint8_t ctrlPort = TimerDevice::DEFAULT_CTRL_PORT
+    ) {
+        auto device = std::make_shared<TimerDevice>();
+        DeviceManager::instance().registerDevice(ctrlPort, device);
+        DeviceManager::instance().registerDevice(dataPort, device->dataPort());
+        return device;
+    }
 };
 
 } // namespace vhw
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "device.hpp"
+#include "virtual_clock.hpp"
+#include "input_journal.hpp"
 #include "../debug/logger.hpp"
 
 #include <fmt/format.h>
@@ -10,11 +12,21 @@
 #include <string>
 #include <stdexcept>
 #include <vector>
+#include <algorithm>
+#include <array>
 
 using Logging::Logger;
 
 namespace vhw {
 
+/**
+ * Per-port I/O counts, filled in by the DeviceManager while attached
+ */
+struct PortCounters {
+    std::array<uint64_t, 256> reads{};
+    std::array<uint64_t, 256> writes{};
+};
+
 /**
  * Manages all I/O devices and handles mapping between ports and devices
  */
@@ -40,6 +52,10 @@ public:
         }
 
         devices[port] = device;
+        // Two-port devices are registered twice but must only tick once
+        if (device->isTicking() && std::find(tickers.begin(), tickers.end(), device) == tickers.end()) {
+            tickers.push_back(device);
+        }
         Logger::instance().info() << fmt::format(
             "Device '{}' registered at port {}",
             device->getName(), port
@@ -68,7 +84,13 @@ public:
             realDevice->disconnect();
         }
 
+        std::shared_ptr<Device> removed = it->second;
         devices.erase(it);
+        bool stillRegistered = std::any_of(devices.begin(), devices.end(),
+            [&](const auto& entry) { return entry.second == removed; });
+        if (!stillRegistered) {
+            tickers.erase(std::remove(tickers.begin(), tickers.end(), removed), tickers.end());
+        }
         return true;
     }
 
@@ -87,35 +109,23 @@ public:
 
     /**
      * Read a value from a device at a specific port
+     * While an input journal is recording the value is logged; while one is
+     * replaying the recorded value is returned and the device is not touched.
      * @param port The port to read from
      * @return The value read from the device, or 0 if no device is registered
      */
     uint8_t readPort(uint8_t port) {
-        auto device = getDevice(port);
-        if (!device) {
-            Logger::instance().warn() << fmt::format(
-                "Attempted to read from unregistered port {}, returning 0",
-                port
-            ) << std::endl;
-            return 0;
+        if (portCounters) {
+            ++portCounters->reads[port];
         }
-
-        // For real devices, check if they're connected
-        auto realDevice = std::dynamic_pointer_cast<RealDevice>(device);
-        if (realDevice && !realDevice->isConnected()) {
-            Logger::instance().warn() << fmt::format(
-                "Real device '{}' at port {} is not connected, returning 0",
-                realDevice->getName(), port
-            ) << std::endl;
-            return 0;
+        auto& journal = InputJournal::instance();
+        if (journal.isReplaying()) {
+            return journal.replayRead(port);
+        }
+        uint8_t value = readDevice(port);
+        if (journal.isRecording()) {
+            journal.recordRead(port, value);
         }
-
-        uint8_t value = device->read();
-        Logger::instance().debug() << fmt::format(
-            "{:>23}│ Input from port {} ({}): {}",
-            "", port, device->getName(), value
-        ) << std::endl;
-
         return value;
     }
 
@@ -125,6 +135,9 @@ public:
      * @param value The value to write
      */
     void writePort(uint8_t port, uint8_t value) {
+        if (portCounters) {
+            ++portCounters->writes[port];
+        }
         auto device = getDevice(port);
         if (!device) {
             Logger::instance().warn() << fmt::format(
@@ -162,6 +175,49 @@ public:
         }
     }
 
+    /**
+     * Flush buffered output on all registered devices
+     */
+    void flushAllDevices() {
+        for (auto& [port, device] : devices) {
+            device->flush();
+        }
+    }
+
+    /**
+     * Commit the cycles retired since the last call and let ticking devices catch up
+     */
+    void tickDevices() {
+        uint64_t cycles = VirtualClock::instance().commit();
+        for (auto& device : tickers) {
+            device->tick(cycles);
+        }
+        auto& journal = InputJournal::instance();
+        if (journal.isReplaying()) {
+            journal.tick();
+        }
+    }
+
+    /**
+     * Restart virtual time at 0 and let ticking devices rebase onto it
+     */
+    void resetClock() {
+        auto& clock = VirtualClock::instance();
+        uint64_t previous = clock.now();
+        clock.reset();
+        for (auto& device : tickers) {
+            device->clockReset(previous);
+        }
+    }
+
+    /**
+     * Check whether any device may still raise an interrupt from a host thread
+     */
+    bool interruptsPossible() const {
+        return std::any_of(devices.begin(), devices.end(),
+            [](const auto& entry) { return entry.second->mayInterrupt(); });
+    }
+
     /**
      * Get all registered device ports
      * @return A vector of port numbers that have registered devices
@@ -174,10 +230,50 @@ public:
         return ports;
     }
 
+    /**
+     * Attach guest memory so bus-mastering devices (DMA) can access it
+     * @param memory The CPU's memory, or nullptr to detach
+     */
+    void attachMemory(std::vector<uint8_t>* memory) {
+        guestMemory = memory;
+    }
+
+    /**
+     * Detach guest memory if it is the currently attached buffer
+     * Transfers already in flight are finished first, so the caller may free
+     * the buffer once this returns.
+     */
+    void detachMemory(const std::vector<uint8_t>* memory) {
+        if (guestMemory != memory) {
+            return;
+        }
+        guestMemory = nullptr;
+        for (auto& [port, device] : devices) {
+            device->releaseMemory();
+        }
+    }
+
+    /**
+     * Count port reads and writes into the given counters
+     * @param counters The counters to fill, or nullptr to stop counting
+     */
+    void setPortCounters(PortCounters* counters) {
+        portCounters = counters;
+    }
+
+    /**
+     * Get the attached guest memory
+     * @return The guest memory, or nullptr if no CPU has attached one
+     */
+    std::vector<uint8_t>* getMemory() const {
+        return guestMemory;
+    }
+
     void reset() {
         Logger::instance().info() << "Resetting DeviceManager..." << std::endl;
         resetAllDevices();
         devices.clear();
+        tickers.clear();
         Logger::instance().info() << "DeviceManager reset complete." << std::endl;
     }
 
@@ -196,6 +292,37 @@ public:
 
 private:
     DeviceManager() = default;
+
+    // The actual device read behind readPort(), bypassing the input journal
+    uint8_t readDevice(uint8_t port) {
+        auto device = getDevice(port);
+        if (!device) {
+            Logger::instance().warn() << fmt::format(
+                "Attempted to read from unregistered port {}, returning 0",
+                port
+            ) << std::endl;
+            return 0;
+        }
+
+        // For real devices, check if they're connected
+        auto realDevice = std::dynamic_pointer_cast<RealDevice>(device);
+        if (realDevice && !realDevice->isConnected()) {
+            Logger::instance().warn() << fmt::format(
+                "Real device '{}' at port {} is not connected, returning 0",
+                realDevice->getName(), port
+            ) << std::endl;
+            return 0;
+        }
+
+        uint8_t value = device->read();
+        Logger::instance().debug() << fmt::format(
+            "{:>23}│ Input from port {} ({}): {}",
+            "", port, device->getName(), value
+        ) << std::endl;
+
+        return value;
+    }
+
     ~DeviceManager() {
         // Ensure all real devices are disconnected
         for (auto& [port, device] : devices) {
@@ -211,6 +338,9 @@ private:
     DeviceManager& operator=(const DeviceManager&) = delete;
 
     std::unordered_map<uint8_t, std::shared_ptr<Device>> devices;
+    std::vector<std::shared_ptr<Device>> tickers;  // Devices with isTicking(), each once
+    std::vector<uint8_t>* guestMemory = nullptr;
+    PortCounters* portCounters = nullptr;
 };
 
 } // namespace vhw
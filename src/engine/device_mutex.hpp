@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+
+namespace vhw {
+
+/**
+ * How a device synchronises access to its state
+ */
+enum class ThreadingPolicy {
+    SingleThreaded,  // Only the CPU thread touches the device; no locking
+    Shared           // Other threads (DMA worker, GUI, I/O) may touch it too
+};
+
+/**
+ * Mutex that only locks once its device is shared with another thread
+ *
+ * Devices start out SingleThreaded, so byte-at-a-time port I/O from the CPU
+ * thread never pays for a lock. Before another thread first reaches into the
+ * device, the thread that owns it calls share() (normally through
+ * Device::markShared()); from then on every lock() is a real lock.
+ *
+ * share() is one-way and must be called while the mutex is not held, since
+ * lock() and unlock() check the policy independently.
+ */
+class DeviceMutex {
+public:
+    explicit DeviceMutex(ThreadingPolicy policy = ThreadingPolicy::SingleThreaded)
+        : shared(policy == ThreadingPolicy::Shared) {}
+
+    DeviceMutex(const DeviceMutex&) = delete;
+    DeviceMutex& operator=(const DeviceMutex&) = delete;
+
+    void lock() {
+        if (shared.load(std::memory_order_acquire)) {
+            mutex.lock();
+        }
+    }
+
+    void unlock() {
+        if (shared.load(std::memory_order_relaxed)) {
+            mutex.unlock();
+        }
+    }
+
+    bool try_lock() {
+        return !shared.load(std::memory_order_acquire) || mutex.try_lock();
+    }
+
+    /**
+     * Switch to real locking (idempotent)
+     */
+    void share() {
+        shared.store(true, std::memory_order_release);
+    }
+
+    bool isShared() const {
+        return shared.load(std::memory_order_acquire);
+    }
+
+private:
+    std::atomic<bool> shared;
+    std::mutex mutex;
+};
+
+} // namespace vhw
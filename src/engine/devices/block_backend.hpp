@@ -0,0 +1,208 @@
+#pragma once
+
+#include "../../debug/logger.hpp"
+
+#include <fmt/format.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+using Logging::Logger;
+
+namespace vhw {
+
+/**
+ * Host storage behind a BlockDevice, addressed in fixed-size sectors
+ *
+ * Backends only see whole-sector requests that the device has already
+ * bounds-checked against sectorCount().
+ */
+class BlockBackend {
+public:
+    static constexpr uint32_t SECTOR_SIZE = 512;
+
+    virtual ~BlockBackend() = default;
+
+    virtual uint64_t sectorCount() const = 0;
+    virtual bool readSectors(uint64_t lba, uint8_t* dest, uint32_t count) = 0;
+    virtual bool writeSectors(uint64_t lba, const uint8_t* src, uint32_t count) = 0;
+    virtual bool flush() { return true; }
+    virtual std::string describe() const = 0;
+
+    /**
+     * File descriptor that sector N lives at offset N * SECTOR_SIZE of, or -1
+     * Lets asynchronous I/O bypass the backend for plain image files.
+     */
+    virtual int nativeHandle() const { return -1; }
+};
+
+/**
+ * In-memory backend that allocates fixed-size chunks on first write
+ * Unwritten chunks read back as zeros, so a multi-terabyte disk costs
+ * nothing until the guest touches it.
+ */
+class SparseMemoryBackend : public BlockBackend {
+public:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+    static constexpr uint32_t SECTORS_PER_CHUNK = CHUNK_SIZE / SECTOR_SIZE;
+
+    explicit SparseMemoryBackend(uint64_t sectors) : sectors(sectors) {}
+
+    uint64_t sectorCount() const override {
+        return sectors;
+    }
+
+    bool readSectors(uint64_t lba, uint8_t* dest, uint32_t count) override {
+        forEachChunk(lba, count, [&](uint64_t chunk, size_t offset, size_t bytes) {
+            auto it = chunks.find(chunk);
+            if (it == chunks.end()) {
+                std::memset(dest, 0, bytes);
+            } else {
+                std::memcpy(dest, it->second.get() + offset, bytes);
+            }
+            dest += bytes;
+        });
+        return true;
+    }
+
+    bool writeSectors(uint64_t lba, const uint8_t* src, uint32_t count) override {
+        forEachChunk(lba, count, [&](uint64_t chunk, size_t offset, size_t bytes) {
+            auto& data = chunks[chunk];
+            if (!data) {
+                data.reset(new uint8_t[CHUNK_SIZE]());
+            }
+            std::memcpy(data.get() + offset, src, bytes);
+            src += bytes;
+        });
+        return true;
+    }
+
+    std::string describe() const override {
+        return fmt::format("sparse memory, {} of {} chunks allocated",
+                           chunks.size(), (sectors + SECTORS_PER_CHUNK - 1) / SECTORS_PER_CHUNK);
+    }
+
+    /**
+     * Number of host bytes actually allocated for written data
+     */
+    size_t allocatedBytes() const {
+        return chunks.size() * CHUNK_SIZE;
+    }
+
+private:
+    // Split a sector range into per-chunk pieces: fn(chunk, offsetInChunk, bytes)
+    template <typename Fn>
+    static void forEachChunk(uint64_t lba, uint32_t count, Fn&& fn) {
+        uint64_t offset = lba * SECTOR_SIZE;
+        uint64_t remaining = static_cast<uint64_t>(count) * SECTOR_SIZE;
+        while (remaining > 0) {
+            uint64_t chunk = offset / CHUNK_SIZE;
+            size_t inChunk = static_cast<size_t>(offset % CHUNK_SIZE);
+            size_t bytes = static_cast<size_t>(std::min<uint64_t>(remaining, CHUNK_SIZE - inChunk));
+            fn(chunk, inChunk, bytes);
+            offset += bytes;
+            remaining -= bytes;
+        }
+    }
+
+    uint64_t sectors;
+    std::unordered_map<uint64_t, std::unique_ptr<uint8_t[]>> chunks;
+};
+
+/**
+ * Backend over a host file sized with ftruncate, so the host filesystem
+ * keeps it sparse; sectors are moved with pread/pwrite.
+ */
+class SparseFileBackend : public BlockBackend {
+public:
+    /**
+     * Open (or create) the image file
+     * @param sectors The disk size; an existing larger file keeps its size
+     */
+    SparseFileBackend(const std::string& path, uint64_t sectors) : path(path) {
+        std::filesystem::path p(path);
+        if (p.has_parent_path()) {
+            std::error_code ec;
+            std::filesystem::create_directories(p.parent_path(), ec);
+        }
+
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0644);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            if (fd >= 0) ::close(fd);
+            throw std::runtime_error("Cannot open block image: " + path);
+        }
+
+        uint64_t existing = static_cast<uint64_t>(st.st_size) / SECTOR_SIZE;
+        this->sectors = std::max(existing, sectors);
+        if (existing < sectors && ftruncate(fd, static_cast<off_t>(sectors * SECTOR_SIZE)) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot size block image: " + path);
+        }
+    }
+
+    ~SparseFileBackend() override {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    uint64_t sectorCount() const override {
+        return sectors;
+    }
+
+    bool readSectors(uint64_t lba, uint8_t* dest, uint32_t count) override {
+        return transfer(lba, dest, count, false);
+    }
+
+    bool writeSectors(uint64_t lba, const uint8_t* src, uint32_t count) override {
+        return transfer(lba, const_cast<uint8_t*>(src), count, true);
+    }
+
+    bool flush() override {
+        return fsync(fd) == 0;
+    }
+
+    std::string describe() const override {
+        return fmt::format("sparse file '{}'", path);
+    }
+
+    int nativeHandle() const override {
+        return fd;
+    }
+
+private:
+    bool transfer(uint64_t lba, uint8_t* buffer, uint32_t count, bool isWrite) {
+        size_t remaining = static_cast<size_t>(count) * SECTOR_SIZE;
+        off_t offset = static_cast<off_t>(lba * SECTOR_SIZE);
+        while (remaining > 0) {
+            ssize_t done = isWrite ? ::pwrite(fd, buffer, remaining, offset)
+                                   : ::pread(fd, buffer, remaining, offset);
+            if (done < 0 && errno == EINTR) {
+                continue;
+            }
+            if (done <= 0) {
+                return false;
+            }
+            buffer += done;
+            offset += done;
+            remaining -= static_cast<size_t>(done);
+        }
+        return true;
+    }
+
+    std::string path;
+    uint64_t sectors = 0;
+    int fd = -1;
+};
+
+} // namespace vhw
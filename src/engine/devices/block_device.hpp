@@ -0,0 +1,450 @@
+#pragma once
+
+#include "../device.hpp"
+#include "../device_manager.hpp"
+#include "../interrupt_controller.hpp"
+#include "../async_io.hpp"
+#include "block_backend.hpp"
+#include "../../debug/logger.hpp"
+
+#include <fmt/format.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+using Logging::Logger;
+
+namespace vhw {
+
+/**
+ * A sector-addressed virtual disk with burst transfers into guest memory
+ *
+ * This device uses two ports: one for control/status and one for data.
+ * The guest selects a register with a control command and then writes its
+ * value to the data port one byte at a time, little-endian.
+ *
+ * Control commands:
+ *   0x00: Select LBA register (64-bit starting sector)
+ *   0x01: Select sector count register (32-bit)
+ *   0x02: Select buffer register (32-bit guest memory address)
+ *   0x03: Select capacity register (read-only, 64-bit sector count)
+ *   0x10: Read sectors into guest memory
+ *   0x11: Write sectors from guest memory
+ *   0x12: Flush the backend to stable storage
+ *   0x13: Acknowledge completion (clears DONE, ERROR and IRQ)
+ *   0x14: Enable completion interrupt (raises InterruptController::IRQ_STORAGE)
+ *   0x15: Disable completion interrupt
+ *   0x16: Wait until the current request has finished
+ *
+ * Reading the control port returns the status byte (see STATUS_* bits).
+ * Reading the data port returns the next capacity byte when the capacity
+ * register is selected, otherwise the last error code (see ERR_* constants).
+ * A whole request is moved with one backend call, so a guest can transfer
+ * megabytes with a handful of OUT instructions.
+ *
+ * With an AsyncIo engine attached, READ and WRITE return immediately with
+ * STATUS_BUSY set and the guest keeps executing while the host performs the
+ * I/O; completion sets STATUS_DONE and optionally raises IRQ_STORAGE. One
+ * request may be in flight at a time.
+ */
+class BlockDevice : public VirtualDevice, public BlockStorage {
+public:
+    static constexpr uint8_t DEFAULT_DATA_PORT = 0x0B;
+    static constexpr uint8_t DEFAULT_CTRL_PORT = 0x0C;
+    static constexpr uint32_t SECTOR_SIZE = BlockBackend::SECTOR_SIZE;
+
+    // Commands
+    static constexpr uint8_t CMD_SELECT_LBA = 0x00;
+    static constexpr uint8_t CMD_SELECT_COUNT = 0x01;
+    static constexpr uint8_t CMD_SELECT_BUFFER = 0x02;
+    static constexpr uint8_t CMD_SELECT_CAPACITY = 0x03;
+    static constexpr uint8_t CMD_READ = 0x10;
+    static constexpr uint8_t CMD_WRITE = 0x11;
+    static constexpr uint8_t CMD_FLUSH = 0x12;
+    static constexpr uint8_t CMD_ACK = 0x13;
+    static constexpr uint8_t CMD_IRQ_ENABLE = 0x14;
+    static constexpr uint8_t CMD_IRQ_DISABLE = 0x15;
+    static constexpr uint8_t CMD_WAIT = 0x16;
+
+    // Status bits
+    static constexpr uint8_t STATUS_BUSY = 0x01;
+    static constexpr uint8_t STATUS_DONE = 0x02;
+    static constexpr uint8_t STATUS_ERROR = 0x04;
+    static constexpr uint8_t STATUS_IRQ_PENDING = 0x80;
+
+    // Error codes
+    static constexpr uint8_t ERR_NONE = 0x00;
+    static constexpr uint8_t ERR_NO_MEMORY = 0x01;
+    static constexpr uint8_t ERR_OUT_OF_BOUNDS = 0x02;
+    static constexpr uint8_t ERR_BAD_BUFFER = 0x03;
+    static constexpr uint8_t ERR_IO = 0x04;
+    static constexpr uint8_t ERR_BUSY = 0x05;
+
+    /**
+     * Facade registered at the data port; forwards to the owning controller
+     */
+    class DataPort : public VirtualDevice {
+    public:
+        explicit DataPort(BlockDevice* owner) : owner(owner) {}
+
+        uint8_t read() override {
+            return owner ? owner->readData() : 0;
+        }
+
+        void write(uint8_t value) override {
+            if (owner) owner->writeData(value);
+        }
+
+        std::string getName() const override {
+            return "Block Device (data)";
+        }
+
+        void reset() override {}
+
+    private:
+        friend class BlockDevice;
+        BlockDevice* owner;
+    };
+
+    explicit BlockDevice(std::unique_ptr<BlockBackend> backend)
+        : backend(std::move(backend)), dataPort_(std::make_shared<DataPort>(this)) {
+        Logger::instance().info() << fmt::format(
+            "Block device: {} sectors ({})", this->backend->sectorCount(), this->backend->describe()
+        ) << std::endl;
+    }
+
+    ~BlockDevice() override {
+        waitIdle();
+        dataPort_->owner = nullptr;
+        syncBackend();
+    }
+
+    uint8_t read() override {
+        return status.load(std::memory_order_acquire);
+    }
+
+    void write(uint8_t value) override {
+        switch (value) {
+            case CMD_SELECT_LBA:
+            case CMD_SELECT_COUNT:
+            case CMD_SELECT_BUFFER:
+            case CMD_SELECT_CAPACITY:
+                selected = value;
+                byteIndex = 0;
+                break;
+            case CMD_READ:
+            case CMD_WRITE:
+                transfer(value == CMD_WRITE);
+                break;
+            case CMD_FLUSH:
+                waitIdle();
+                complete(syncBackend() ? ERR_NONE : ERR_IO);
+                break;
+            case CMD_ACK:
+                status.fetch_and(STATUS_BUSY, std::memory_order_acq_rel);
+                break;
+            case CMD_IRQ_ENABLE:
+                irqEnabled.store(true, std::memory_order_release);
+                break;
+            case CMD_IRQ_DISABLE:
+                irqEnabled.store(false, std::memory_order_release);
+                break;
+            case CMD_WAIT:
+                waitIdle();
+                break;
+            default:
+                Logger::instance().warn() << fmt::format(
+                    "Block device: Unknown control command 0x{:02X}", value
+                ) << std::endl;
+                break;
+        }
+    }
+
+    std::string getName() const override {
+        return fmt::format("Block Device ({} sectors)", backend->sectorCount());
+    }
+
+    // Disk contents survive a reset, like a real disk across a CPU reset
+    void reset() override {
+        waitIdle();
+        lba = 0;
+        count = 0;
+        buffer = 0;
+        selected = CMD_SELECT_LBA;
+        byteIndex = 0;
+        lastError = ERR_NONE;
+        irqEnabled.store(false, std::memory_order_release);
+        status.store(0, std::memory_order_release);
+    }
+
+    void flush() override {
+        syncBackend();
+    }
+
+    /**
+     * Get the device to register at the data port
+     */
+    std::shared_ptr<DataPort> dataPort() const {
+        return dataPort_;
+    }
+
+    /**
+     * Program a transfer from the host side (equivalent to the guest's port writes)
+     */
+    void program(uint64_t startLba, uint32_t sectors, uint32_t guestAddress) {
+        lba = startLba;
+        count = sectors;
+        buffer = guestAddress;
+    }
+
+    uint8_t getLastError() const {
+        return lastError;
+    }
+
+    /**
+     * Perform READ/WRITE asynchronously on the given engine (nullptr = synchronously)
+     */
+    void setAsyncIo(AsyncIo* io) {
+        waitIdle();
+        asyncIo = io;
+    }
+
+    // Async completions write through raw pointers into guest memory
+    void releaseMemory() override {
+        waitIdle();
+    }
+
+    bool mayInterrupt() const override {
+        return (status.load(std::memory_order_acquire) & STATUS_BUSY) &&
+               irqEnabled.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Block the calling thread until no request is in flight
+     */
+    void waitIdle() {
+        std::unique_lock<std::mutex> lock(idleMutex);
+        idleCv.wait(lock, [this] { return !inFlight; });
+    }
+
+    BlockBackend& getBackend() {
+        return *backend;
+    }
+
+    /**
+     * Byte-granular access for the DMA controller and host tools
+     */
+    size_t readBlock(size_t offset, uint8_t* dest, size_t length) override {
+        return accessBytes(offset, dest, length, false);
+    }
+
+    size_t writeBlock(size_t offset, const uint8_t* src, size_t length) override {
+        return accessBytes(offset, const_cast<uint8_t*>(src), length, true);
+    }
+
+    size_t capacity() const override {
+        return static_cast<size_t>(backend->sectorCount() * SECTOR_SIZE);
+    }
+
+private:
+    uint8_t readData() {
+        if (selected != CMD_SELECT_CAPACITY) {
+            return lastError;
+        }
+        uint8_t value = static_cast<uint8_t>(backend->sectorCount() >> (8 * byteIndex));
+        byteIndex = (byteIndex + 1) & 7;
+        return value;
+    }
+
+    void writeData(uint8_t value) {
+        uint32_t shift = 8 * byteIndex;
+        switch (selected) {
+            case CMD_SELECT_LBA:
+                lba = (byteIndex == 0 ? 0 : lba) | (static_cast<uint64_t>(value) << shift);
+                byteIndex = (byteIndex + 1) & 7;
+                return;
+            case CMD_SELECT_COUNT:
+                count = (byteIndex == 0 ? 0 : count) | (static_cast<uint32_t>(value) << shift);
+                break;
+            case CMD_SELECT_BUFFER:
+                buffer = (byteIndex == 0 ? 0 : buffer) | (static_cast<uint32_t>(value) << shift);
+                break;
+            default:
+                return;  // Capacity is read-only
+        }
+        byteIndex = (byteIndex + 1) & 3;
+    }
+
+    void transfer(bool isWrite) {
+        if (status.load(std::memory_order_acquire) & STATUS_BUSY) {
+            // Leave the in-flight request's status alone
+            lastError = ERR_BUSY;
+            Logger::instance().warn() << "Block device: Request ignored, previous request still in flight" << std::endl;
+            return;
+        }
+
+        std::vector<uint8_t>* memory = DeviceManager::instance().getMemory();
+        if (!memory) {
+            complete(ERR_NO_MEMORY);
+            return;
+        }
+
+        uint64_t sectors = backend->sectorCount();
+        if (lba > sectors || count > sectors - lba) {
+            Logger::instance().warn() << fmt::format(
+                "Block device: Sectors {}+{} exceed disk size ({} sectors)", lba, count, sectors
+            ) << std::endl;
+            complete(ERR_OUT_OF_BOUNDS);
+            return;
+        }
+
+        uint64_t bytes = static_cast<uint64_t>(count) * SECTOR_SIZE;
+        if (buffer + bytes > memory->size()) {
+            Logger::instance().warn() << fmt::format(
+                "Block device: Buffer 0x{:X}+{} exceeds guest memory ({} bytes)",
+                buffer, bytes, memory->size()
+            ) << std::endl;
+            complete(ERR_BAD_BUFFER);
+            return;
+        }
+
+        Logger::instance().debug() << fmt::format(
+            "{:22} │ Block: {} {} sectors at LBA {} {} 0x{:X}{}",
+            "", isWrite ? "Writing" : "Reading", count, lba, isWrite ? "from" : "into", buffer,
+            asyncIo ? fmt::format(" ({})", asyncIo->name()) : ""
+        ) << std::endl;
+
+        status.store(STATUS_BUSY, std::memory_order_release);
+        uint8_t* guest = memory->data() + buffer;
+        if (asyncIo) {
+            submitAsync(isWrite, guest, static_cast<size_t>(bytes));
+            return;
+        }
+
+        bool ok;
+        {
+            std::lock_guard<std::mutex> lock(backendMutex);
+            ok = isWrite ? backend->writeSectors(lba, guest, count)
+                         : backend->readSectors(lba, guest, count);
+        }
+        complete(ok ? ERR_NONE : ERR_IO);
+    }
+
+    void submitAsync(bool isWrite, uint8_t* guest, size_t length) {
+        {
+            std::lock_guard<std::mutex> lock(idleMutex);
+            inFlight = true;
+        }
+
+        auto done = [this](bool ok) { complete(ok ? ERR_NONE : ERR_IO); };
+        int fd = backend->nativeHandle();
+        if (fd >= 0) {
+            // Plain image files go straight to the engine (io_uring when available)
+            uint64_t offset = lba * SECTOR_SIZE;
+            if (isWrite) {
+                asyncIo->submitWrite(fd, guest, length, offset, done);
+            } else {
+                asyncIo->submitRead(fd, guest, length, offset, done);
+            }
+            return;
+        }
+
+        uint64_t startLba = lba;
+        uint32_t sectors = count;
+        asyncIo->submitJob([this, isWrite, guest, startLba, sectors] {
+            std::lock_guard<std::mutex> lock(backendMutex);
+            return isWrite ? backend->writeSectors(startLba, guest, sectors)
+                           : backend->readSectors(startLba, guest, sectors);
+        }, done);
+    }
+
+    // May run on an I/O completion thread
+    void complete(uint8_t error) {
+        lastError = error;
+        bool interrupt = irqEnabled.load(std::memory_order_acquire);
+        uint8_t newStatus = STATUS_DONE;
+        if (error != ERR_NONE) {
+            newStatus |= STATUS_ERROR;
+        }
+        if (interrupt) {
+            newStatus |= STATUS_IRQ_PENDING;
+        }
+        status.store(newStatus, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(idleMutex);
+            inFlight = false;
+        }
+        idleCv.notify_all();
+        if (interrupt) {
+            InterruptController::instance().raise(InterruptController::IRQ_STORAGE);
+        }
+    }
+
+    bool syncBackend() {
+        std::lock_guard<std::mutex> lock(backendMutex);
+        return backend->flush();
+    }
+
+    // Unaligned byte access goes through a bounce buffer for partial sectors
+    size_t accessBytes(size_t offset, uint8_t* data, size_t length, bool isWrite) {
+        std::lock_guard<std::mutex> lock(backendMutex);
+        size_t total = capacity();
+        if (offset >= total) {
+            return 0;
+        }
+        length = std::min(length, total - offset);
+
+        size_t done = 0;
+        uint8_t bounce[SECTOR_SIZE];
+        while (done < length) {
+            uint64_t sector = (offset + done) / SECTOR_SIZE;
+            size_t inSector = (offset + done) % SECTOR_SIZE;
+            size_t remaining = length - done;
+
+            if (inSector == 0 && remaining >= SECTOR_SIZE) {
+                uint32_t whole = static_cast<uint32_t>(std::min<size_t>(remaining / SECTOR_SIZE, UINT32_MAX));
+                bool ok = isWrite ? backend->writeSectors(sector, data + done, whole)
+                                  : backend->readSectors(sector, data + done, whole);
+                if (!ok) break;
+                done += static_cast<size_t>(whole) * SECTOR_SIZE;
+                continue;
+            }
+
+            size_t piece = std::min(remaining, SECTOR_SIZE - inSector);
+            if (!backend->readSectors(sector, bounce, 1)) break;
+            if (isWrite) {
+                std::memcpy(bounce + inSector, data + done, piece);
+                if (!backend->writeSectors(sector, bounce, 1)) break;
+            } else {
+                std::memcpy(data + done, bounce + inSector, piece);
+            }
+            done += piece;
+        }
+        return done;
+    }
+
+    std::unique_ptr<BlockBackend> backend;
+    std::shared_ptr<DataPort> dataPort_;
+
+    // Programmed registers
+    uint64_t lba = 0;
+    uint32_t count = 0;
+    uint32_t buffer = 0;
+    uint8_t selected = CMD_SELECT_LBA;
+    uint8_t byteIndex = 0;
+    std::atomic<uint8_t> lastError{ERR_NONE};
+    std::atomic<bool> irqEnabled{false};
+
+    std::atomic<uint8_t> status{0};
+    AsyncIo* asyncIo = nullptr;
+    bool inFlight = false;
+    std::mutex idleMutex;
+    std::condition_variable idleCv;
+    std::mutex backendMutex;  // The DMA worker may reach the backend through readBlock/writeBlock
+};
+
+} // namespace vhw
@@ -1,13 +1,25 @@
 #pragma once
 
 #include "../device.hpp"
+#include "../interrupt_controller.hpp"
+#include "../../config.hpp"
 #include "../../debug/logger.hpp"
 
 #include <fmt/format.h>
 #include <iostream>
 #include <cstdint>
 #include <string>
+#include <vector>
 #include <deque>
+#include <mutex>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+#endif
 
 using Logging::Logger;
 
@@ -16,17 +28,35 @@ namespace vhw {
 /**
  * A simple virtual console device for text I/O
  * Reading will get a character from the input buffer (or 0 if empty)
- * Writing will output the character to the console
+ * Writing buffers the character and outputs it according to the flush policy.
+ * Buffered output is always flushed at HALT, on reset and on destruction.
  */
 class ConsoleDevice : public VirtualDevice {
 public:
     static constexpr uint8_t DEFAULT_PORT = 0x01;
 
+    // Flush triggers (combine with |)
+    static constexpr uint8_t FLUSH_ON_NEWLINE = 1 << 0;    // After every '\n'
+    static constexpr uint8_t FLUSH_ON_THRESHOLD = 1 << 1;  // Once flushThreshold bytes are buffered
+    static constexpr uint8_t FLUSH_ON_INPUT = 1 << 2;      // Before the guest reads input (prompts)
+    static constexpr uint8_t FLUSH_DEFAULT = FLUSH_ON_NEWLINE | FLUSH_ON_THRESHOLD | FLUSH_ON_INPUT;
+
+    static constexpr size_t DEFAULT_FLUSH_THRESHOLD = 4096;
+    static constexpr size_t MAX_BUFFERED = 1024 * 1024;  // Hard cap when the threshold trigger is off
+    static constexpr size_t SEGMENT_SIZE = 4096;
+
     ConsoleDevice() = default;
-    ~ConsoleDevice() override = default;
+
+    ~ConsoleDevice() override {
+        flush();
+    }
 
     uint8_t read() override {
-        std::lock_guard<std::mutex> lock(bufferMutex);
+        if (flushPolicy & FLUSH_ON_INPUT) {
+            flush();
+        }
+
+        std::lock_guard<DeviceMutex> lock(bufferMutex);
         if (inputBuffer.empty()) {
             return 0;
         }
@@ -37,15 +67,54 @@ public:
     }
 
     void write(uint8_t value) override {
-        // Output the character to stdout
-        std::cout << static_cast<char>(value) << std::flush;
-
-        // Also log it
-        Logger::instance().debug() << fmt::format(
-            "Console output: {} ('{}')",
-            value,
-            value >= 32 && value < 127 ? fmt::format("{}", static_cast<char>(value)) : "."
-        ) << std::endl;
+        append(static_cast<char>(value));
+
+        size_t limit = (flushPolicy & FLUSH_ON_THRESHOLD) ? flushThreshold : MAX_BUFFERED;
+        // In debug mode write through so output interleaves correctly with the trace
+        if (Config::debug || buffered >= limit ||
+            (value == '\n' && (flushPolicy & FLUSH_ON_NEWLINE))) {
+            flush();
+        }
+
+        if (Config::debug) {
+            Logger::instance().debug() << fmt::format(
+                "Console output: {} ('{}')",
+                value,
+                value >= 32 && value < 127 ? fmt::format("{}", static_cast<char>(value)) : "."
+            ) << std::endl;
+        }
+    }
+
+    /**
+     * Write all buffered output with a single gathered write
+     */
+    void flush() override {
+        if (buffered == 0) {
+            return;
+        }
+
+        // Anything already queued on std::cout must come out first
+        std::cout.flush();
+
+        #ifndef _WIN32
+        std::vector<struct iovec> iov;
+        iov.reserve(activeSegments);
+        for (size_t i = 0; i < activeSegments; ++i) {
+            iov.push_back({segments[i].data(), segments[i].size()});
+        }
+        writeAll(iov);
+        #else
+        for (size_t i = 0; i < activeSegments; ++i) {
+            std::cout.write(segments[i].data(), static_cast<std::streamsize>(segments[i].size()));
+        }
+        std::cout.flush();
+        #endif
+
+        for (size_t i = 0; i < activeSegments; ++i) {
+            segments[i].clear();
+        }
+        activeSegments = 0;
+        buffered = 0;
     }
 
     std::string getName() const override {
@@ -53,17 +122,65 @@ public:
     }
 
     void reset() override {
-        std::lock_guard<std::mutex> lock(bufferMutex);
+        flush();
+        std::lock_guard<DeviceMutex> lock(bufferMutex);
         inputBuffer.clear();
     }
 
+    /**
+     * Set which events flush buffered output (see FLUSH_* constants)
+     */
+    void setFlushPolicy(uint8_t policy) {
+        flushPolicy = policy;
+    }
+
+    uint8_t getFlushPolicy() const {
+        return flushPolicy;
+    }
+
+    /**
+     * Set the number of buffered bytes that triggers a flush
+     */
+    void setFlushThreshold(size_t bytes) {
+        flushThreshold = std::clamp<size_t>(bytes, 1, MAX_BUFFERED);
+    }
+
+    /**
+     * Number of output bytes waiting to be flushed
+     */
+    size_t bufferedBytes() const {
+        return buffered;
+    }
+
+    /**
+     * Parse a flush policy name as used by --console-flush
+     * @return The policy, or FLUSH_DEFAULT for unknown names
+     */
+    static uint8_t parseFlushPolicy(const std::string& name) {
+        if (name == "newline") return FLUSH_DEFAULT;
+        if (name == "threshold") return FLUSH_ON_THRESHOLD | FLUSH_ON_INPUT;
+        if (name == "halt") return FLUSH_ON_INPUT;
+        Logger::instance().warn() << fmt::format(
+            "Unknown console flush policy '{}', using 'newline'", name
+        ) << std::endl;
+        return FLUSH_DEFAULT;
+    }
+
+    void markShared() override {
+        bufferMutex.share();
+    }
+
     /**
      * Add a character to the input buffer
      * This would be called by the system when a key is pressed
+     * (call markShared() first if that happens on another thread)
      */
     void addInput(uint8_t value) {
-        std::lock_guard<std::mutex> lock(bufferMutex);
-        inputBuffer.push_back(value);
+        {
+            std::lock_guard<DeviceMutex> lock(bufferMutex);
+            inputBuffer.push_back(value);
+        }
+        InterruptController::instance().raise(InterruptController::IRQ_CONSOLE);
     }
 
     /**
@@ -71,15 +188,63 @@ public:
      * This is a convenience method for testing
      */
     void addInput(const std::string& input) {
-        std::lock_guard<std::mutex> lock(bufferMutex);
-        for (char c : input) {
-            inputBuffer.push_back(static_cast<uint8_t>(c));
+        {
+            std::lock_guard<DeviceMutex> lock(bufferMutex);
+            for (char c : input) {
+                inputBuffer.push_back(static_cast<uint8_t>(c));
+            }
         }
+        InterruptController::instance().raise(InterruptController::IRQ_CONSOLE);
     }
 
 private:
+    // Output is kept in fixed-size segments so growing the buffer never
+    // copies what is already there; flush() hands all of them to writev
+    void append(char c) {
+        if (activeSegments == 0 || segments[activeSegments - 1].size() == SEGMENT_SIZE) {
+            if (activeSegments == segments.size()) {
+                segments.emplace_back();
+                segments.back().reserve(SEGMENT_SIZE);
+            }
+            ++activeSegments;
+        }
+        segments[activeSegments - 1].push_back(c);
+        ++buffered;
+    }
+
+    #ifndef _WIN32
+    static void writeAll(std::vector<struct iovec>& iov) {
+        size_t first = 0;
+        while (first < iov.size()) {
+            int count = static_cast<int>(std::min<size_t>(iov.size() - first, IOV_MAX));
+            ssize_t written = ::writev(STDOUT_FILENO, iov.data() + first, count);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return;  // stdout is gone; nothing useful left to do
+            }
+
+            // Skip fully written segments and trim a partially written one
+            size_t remaining = static_cast<size_t>(written);
+            while (first < iov.size() && remaining >= iov[first].iov_len) {
+                remaining -= iov[first].iov_len;
+                ++first;
+            }
+            if (first < iov.size() && remaining > 0) {
+                iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + remaining;
+                iov[first].iov_len -= remaining;
+            }
+        }
+    }
+    #endif
+
     std::deque<uint8_t> inputBuffer;
-    std::mutex bufferMutex;
+    DeviceMutex bufferMutex;  // Input may be fed from another thread once shared
+
+    std::vector<std::vector<char>> segments;
+    size_t activeSegments = 0;
+    size_t buffered = 0;
+    uint8_t flushPolicy = FLUSH_DEFAULT;
+    size_t flushThreshold = DEFAULT_FLUSH_THRESHOLD;
 };
 
 } // namespace vhw
@@ -0,0 +1,577 @@
+#pragma once
+
+#include "block_backend.hpp"
+#include "../../debug/logger.hpp"
+
+#include <fmt/format.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+using Logging::Logger;
+
+namespace vhw {
+
+/**
+ * Disk image formats for BlockDevice
+ *
+ *   raw   Plain sector image (SparseFileBackend, or ReadOnlyFileBackend as a base)
+ *   DCMP  Read-only compressed image: per-cluster index, zero clusters take no space
+ *   DCOW  Copy-on-write overlay: clusters written by this VM, everything else
+ *         is read from a shared read-only base image
+ *
+ * A golden disk is kept as a raw or DCMP base and every VM gets its own DCOW
+ * overlay, which is created in O(1) (header plus a sparse cluster table).
+ * All multi-byte fields are stored little-endian, in host order.
+ */
+namespace DiskImage {
+
+static constexpr uint32_t DEFAULT_CLUSTER_SIZE = 64 * 1024;
+
+inline bool preadAll(int fd, void* buffer, size_t length, uint64_t offset) {
+    auto* out = static_cast<uint8_t*>(buffer);
+    while (length > 0) {
+        ssize_t done = ::pread(fd, out, length, static_cast<off_t>(offset));
+        if (done < 0 && errno == EINTR) continue;
+        if (done <= 0) return false;
+        out += done;
+        offset += static_cast<uint64_t>(done);
+        length -= static_cast<size_t>(done);
+    }
+    return true;
+}
+
+inline bool pwriteAll(int fd, const void* buffer, size_t length, uint64_t offset) {
+    auto* in = static_cast<const uint8_t*>(buffer);
+    while (length > 0) {
+        ssize_t done = ::pwrite(fd, in, length, static_cast<off_t>(offset));
+        if (done < 0 && errno == EINTR) continue;
+        if (done <= 0) return false;
+        in += done;
+        offset += static_cast<uint64_t>(done);
+        length -= static_cast<size_t>(done);
+    }
+    return true;
+}
+
+// Make written data durable before metadata that points at it is written
+inline bool syncData(int fd) {
+#ifdef __linux__
+    return ::fdatasync(fd) == 0;
+#else
+    return ::fsync(fd) == 0;
+#endif
+}
+
+inline int openChecked(const std::string& path, int flags) {
+    int fd = ::open(path.c_str(), flags | O_NOFOLLOW | O_CLOEXEC, 0644);
+    struct stat st;
+    if (fd >= 0 && (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))) {
+        ::close(fd);
+        fd = -1;
+    }
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open disk image: " + path);
+    }
+    return fd;
+}
+
+inline std::string readMagic(const std::string& path) {
+    char magic[4] = {};
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return "";
+    bool ok = preadAll(fd, magic, sizeof(magic), 0);
+    ::close(fd);
+    return ok ? std::string(magic, sizeof(magic)) : "";
+}
+
+} // namespace DiskImage
+
+/**
+ * Read-only raw image, used as the base of an overlay
+ */
+class ReadOnlyFileBackend : public BlockBackend {
+public:
+    explicit ReadOnlyFileBackend(const std::string& path)
+        : path(path), fd(DiskImage::openChecked(path, O_RDONLY)) {
+        struct stat st;
+        fstat(fd, &st);
+        sectors = static_cast<uint64_t>(st.st_size) / SECTOR_SIZE;
+    }
+
+    ~ReadOnlyFileBackend() override {
+        ::close(fd);
+    }
+
+    uint64_t sectorCount() const override {
+        return sectors;
+    }
+
+    bool readSectors(uint64_t lba, uint8_t* dest, uint32_t count) override {
+        return DiskImage::preadAll(fd, dest, static_cast<size_t>(count) * SECTOR_SIZE, lba * SECTOR_SIZE);
+    }
+
+    bool writeSectors(uint64_t, const uint8_t*, uint32_t) override {
+        return false;
+    }
+
+    std::string describe() const override {
+        return fmt::format("read-only raw image '{}'", path);
+    }
+
+private:
+    std::string path;
+    int fd;
+    uint64_t sectors = 0;
+};
+
+/**
+ * Read-only compressed image (DCMP)
+ *
+ * Layout: 32-byte header, then one index entry per cluster, then cluster data.
+ * Clusters are stored as all-zero (no data), run-length encoded, or raw,
+ * whichever is smallest. The last decoded cluster is cached, so sequential
+ * sector reads decode each cluster once.
+ */
+class CompressedImageBackend : public BlockBackend {
+public:
+    static constexpr char MAGIC[4] = {'D', 'C', 'M', 'P'};
+    static constexpr uint32_t VERSION = 1;
+
+    // Cluster encodings
+    static constexpr uint32_t CLUSTER_ZERO = 0;
+    static constexpr uint32_t CLUSTER_RAW = 1;
+    static constexpr uint32_t CLUSTER_RLE = 2;
+
+    explicit CompressedImageBackend(const std::string& path)
+        : path(path), fd(DiskImage::openChecked(path, O_RDONLY)) {
+        Header header;
+        if (!DiskImage::preadAll(fd, &header, sizeof(header), 0) ||
+            std::memcmp(header.magic, MAGIC, 4) != 0 || header.version != VERSION ||
+            header.clusterSize == 0 || header.clusterSize % SECTOR_SIZE != 0) {
+            ::close(fd);
+            throw std::runtime_error("Not a compressed disk image: " + path);
+        }
+
+        clusterSize = header.clusterSize;
+        sectors = header.sectorCount;
+        index.resize(clusterCount(sectors, clusterSize));
+        if (!DiskImage::preadAll(fd, index.data(), index.size() * sizeof(IndexEntry), sizeof(Header))) {
+            ::close(fd);
+            throw std::runtime_error("Truncated compressed disk image: " + path);
+        }
+        cluster.resize(clusterSize);
+        scratch.resize(clusterSize);
+    }
+
+    ~CompressedImageBackend() override {
+        ::close(fd);
+    }
+
+    uint64_t sectorCount() const override {
+        return sectors;
+    }
+
+    bool readSectors(uint64_t lba, uint8_t* dest, uint32_t count) override {
+        uint64_t offset = lba * SECTOR_SIZE;
+        uint64_t remaining = static_cast<uint64_t>(count) * SECTOR_SIZE;
+        while (remaining > 0) {
+            uint64_t which = offset / clusterSize;
+            size_t inCluster = static_cast<size_t>(offset % clusterSize);
+            size_t bytes = static_cast<size_t>(std::min<uint64_t>(remaining, clusterSize - inCluster));
+            if (!loadCluster(which)) {
+                return false;
+            }
+            std::memcpy(dest, cluster.data() + inCluster, bytes);
+            dest += bytes;
+            offset += bytes;
+            remaining -= bytes;
+        }
+        return true;
+    }
+
+    bool writeSectors(uint64_t, const uint8_t*, uint32_t) override {
+        return false;
+    }
+
+    std::string describe() const override {
+        return fmt::format("compressed image '{}'", path);
+    }
+
+    /**
+     * Build a compressed image from a raw image
+     * @return false if either file could not be processed
+     */
+    static bool compress(const std::string& rawPath, const std::string& outPath,
+                         uint32_t clusterSize = DiskImage::DEFAULT_CLUSTER_SIZE) {
+        int in = ::open(rawPath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (in < 0) return false;
+        int out = ::open(outPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0644);
+        if (out < 0) {
+            ::close(in);
+            return false;
+        }
+
+        struct stat st;
+        fstat(in, &st);
+        Header header;
+        std::memcpy(header.magic, MAGIC, 4);
+        header.version = VERSION;
+        header.clusterSize = clusterSize;
+        header.sectorCount = static_cast<uint64_t>(st.st_size) / SECTOR_SIZE;
+
+        std::vector<IndexEntry> entries(clusterCount(header.sectorCount, clusterSize));
+        uint64_t dataOffset = sizeof(Header) + entries.size() * sizeof(IndexEntry);
+        uint64_t diskBytes = header.sectorCount * SECTOR_SIZE;
+        std::vector<uint8_t> raw(clusterSize), encoded;
+        bool ok = true;
+
+        for (size_t i = 0; i < entries.size() && ok; ++i) {
+            uint64_t start = static_cast<uint64_t>(i) * clusterSize;
+            size_t length = static_cast<size_t>(std::min<uint64_t>(clusterSize, diskBytes - start));
+            std::fill(raw.begin(), raw.end(), 0);
+            ok = DiskImage::preadAll(in, raw.data(), length, start);
+
+            if (std::all_of(raw.begin(), raw.end(), [](uint8_t b) { return b == 0; })) {
+                entries[i] = {0, 0, CLUSTER_ZERO};
+                continue;
+            }
+
+            encodeRle(raw, encoded);
+            const std::vector<uint8_t>& payload = encoded.size() < raw.size() ? encoded : raw;
+            entries[i] = {dataOffset, static_cast<uint32_t>(payload.size()),
+                          encoded.size() < raw.size() ? CLUSTER_RLE : CLUSTER_RAW};
+            ok = ok && DiskImage::pwriteAll(out, payload.data(), payload.size(), dataOffset);
+            dataOffset += payload.size();
+        }
+
+        ok = ok && DiskImage::syncData(out) &&
+             DiskImage::pwriteAll(out, &header, sizeof(header), 0) &&
+             DiskImage::pwriteAll(out, entries.data(), entries.size() * sizeof(IndexEntry), sizeof(Header));
+        ::close(in);
+        ::close(out);
+        return ok;
+    }
+
+private:
+    struct Header {
+        char magic[4] = {};
+        uint32_t version = 0;
+        uint32_t clusterSize = 0;
+        uint32_t reserved = 0;
+        uint64_t sectorCount = 0;
+        uint64_t reserved2 = 0;
+    };
+    static_assert(sizeof(Header) == 32, "DCMP header layout");
+
+    struct IndexEntry {
+        uint64_t offset;
+        uint32_t length;
+        uint32_t encoding;
+    };
+    static_assert(sizeof(IndexEntry) == 16, "DCMP index entry layout");
+
+    static size_t clusterCount(uint64_t sectors, uint32_t clusterSize) {
+        return static_cast<size_t>((sectors * SECTOR_SIZE + clusterSize - 1) / clusterSize);
+    }
+
+    // Runs are (count, byte) pairs with count in 1..255
+    static void encodeRle(const std::vector<uint8_t>& in, std::vector<uint8_t>& out) {
+        out.clear();
+        for (size_t i = 0; i < in.size() && out.size() < in.size();) {
+            size_t run = 1;
+            while (i + run < in.size() && run < 255 && in[i + run] == in[i]) ++run;
+            out.push_back(static_cast<uint8_t>(run));
+            out.push_back(in[i]);
+            i += run;
+        }
+    }
+
+    bool loadCluster(uint64_t which) {
+        if (which == cachedCluster) {
+            return true;
+        }
+        const IndexEntry& entry = index[which];
+        switch (entry.encoding) {
+            case CLUSTER_ZERO:
+                std::fill(cluster.begin(), cluster.end(), 0);
+                break;
+            case CLUSTER_RAW:
+                if (entry.length != clusterSize ||
+                    !DiskImage::preadAll(fd, cluster.data(), clusterSize, entry.offset)) {
+                    return false;
+                }
+                break;
+            case CLUSTER_RLE: {
+                if (entry.length > scratch.size() || entry.length % 2 != 0 ||
+                    !DiskImage::preadAll(fd, scratch.data(), entry.length, entry.offset)) {
+                    return false;
+                }
+                size_t pos = 0;
+                for (size_t i = 0; i < entry.length; i += 2) {
+                    size_t run = std::min<size_t>(scratch[i], clusterSize - pos);
+                    std::memset(cluster.data() + pos, scratch[i + 1], run);
+                    pos += run;
+                }
+                if (pos != clusterSize) {
+                    return false;
+                }
+                break;
+            }
+            default:
+                return false;
+        }
+        cachedCluster = which;
+        return true;
+    }
+
+    std::string path;
+    int fd;
+    uint32_t clusterSize = 0;
+    uint64_t sectors = 0;
+    std::vector<IndexEntry> index;
+    std::vector<uint8_t> cluster;   // Decoded cache of cachedCluster
+    std::vector<uint8_t> scratch;   // Encoded bytes being decoded
+    uint64_t cachedCluster = UINT64_MAX;
+};
+
+/**
+ * Copy-on-write overlay (DCOW) on top of a read-only base image
+ *
+ * Layout: 4KB header (including the absolute base path), a table with one
+ * 64-bit file offset per cluster (0 = not yet copied), then cluster data
+ * appended in allocation order. The table is created sparse, so a new
+ * overlay costs one header write regardless of disk size.
+ *
+ * The first write to a cluster copies it from the base, applies the write,
+ * appends it and only then records it in the table, so a crash can leak a
+ * cluster but never expose a half-written one.
+ */
+class OverlayBackend : public BlockBackend {
+public:
+    static constexpr char MAGIC[4] = {'D', 'C', 'O', 'W'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 4096;
+
+    /**
+     * Open an existing overlay together with the base it was created over
+     */
+    explicit OverlayBackend(const std::string& path)
+        : path(path), fd(DiskImage::openChecked(path, O_RDWR)) {
+        Header header;
+        if (!DiskImage::preadAll(fd, &header, sizeof(header), 0) ||
+            std::memcmp(header.magic, MAGIC, 4) != 0 || header.version != VERSION ||
+            header.clusterSize == 0 || header.clusterSize % SECTOR_SIZE != 0) {
+            ::close(fd);
+            throw std::runtime_error("Not a copy-on-write overlay: " + path);
+        }
+
+        clusterSize = header.clusterSize;
+        sectors = header.sectorCount;
+        basePath = std::string(header.basePath, strnlen(header.basePath, sizeof(header.basePath)));
+        try {
+            base = openBase(basePath);
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        if (base->sectorCount() < sectors) {
+            ::close(fd);
+            throw std::runtime_error("Overlay base image is smaller than the overlay: " + basePath);
+        }
+
+        table.resize(static_cast<size_t>((sectors * SECTOR_SIZE + clusterSize - 1) / clusterSize));
+        if (!DiskImage::preadAll(fd, table.data(), table.size() * sizeof(uint64_t), HEADER_SIZE)) {
+            ::close(fd);
+            throw std::runtime_error("Truncated overlay cluster table: " + path);
+        }
+
+        struct stat st;
+        fstat(fd, &st);
+        uint64_t dataStart = alignUp(HEADER_SIZE + table.size() * sizeof(uint64_t), clusterSize);
+        nextCluster = std::max(dataStart, alignUp(static_cast<uint64_t>(st.st_size), clusterSize));
+        copyBuffer.resize(clusterSize);
+    }
+
+    ~OverlayBackend() override {
+        ::close(fd);
+    }
+
+    /**
+     * Create an empty overlay over basePath
+     * @return false if the base could not be opened or the overlay not written
+     */
+    static bool create(const std::string& overlayPath, const std::string& basePath,
+                       uint32_t clusterSize = DiskImage::DEFAULT_CLUSTER_SIZE) {
+        Header header;
+        std::string absoluteBase = std::filesystem::absolute(basePath).string();
+        if (absoluteBase.size() >= sizeof(header.basePath) || clusterSize % SECTOR_SIZE != 0) {
+            return false;
+        }
+
+        uint64_t baseSectors;
+        try {
+            baseSectors = openBase(absoluteBase)->sectorCount();
+        } catch (const std::exception& e) {
+            Logger::instance().error() << e.what() << std::endl;
+            return false;
+        }
+
+        std::memcpy(header.magic, MAGIC, 4);
+        header.version = VERSION;
+        header.clusterSize = clusterSize;
+        header.sectorCount = baseSectors;
+        std::memcpy(header.basePath, absoluteBase.data(), absoluteBase.size());
+
+        int out = ::open(overlayPath.c_str(), O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0644);
+        if (out < 0) {
+            return false;
+        }
+        uint64_t tableBytes = (baseSectors * SECTOR_SIZE + clusterSize - 1) / clusterSize * sizeof(uint64_t);
+        bool ok = DiskImage::pwriteAll(out, &header, sizeof(header), 0) &&
+                  ftruncate(out, static_cast<off_t>(HEADER_SIZE + tableBytes)) == 0;
+        ::close(out);
+        return ok;
+    }
+
+    uint64_t sectorCount() const override {
+        return sectors;
+    }
+
+    bool readSectors(uint64_t lba, uint8_t* dest, uint32_t count) override {
+        return forEachCluster(lba, count, [&](size_t index, uint64_t pieceLba, size_t inCluster, size_t bytes) {
+            bool ok = table[index] != 0
+                ? DiskImage::preadAll(fd, dest, bytes, table[index] + inCluster)
+                : base->readSectors(pieceLba, dest, static_cast<uint32_t>(bytes / SECTOR_SIZE));
+            dest += bytes;
+            return ok;
+        });
+    }
+
+    bool writeSectors(uint64_t lba, const uint8_t* src, uint32_t count) override {
+        return forEachCluster(lba, count, [&](size_t index, uint64_t, size_t inCluster, size_t bytes) {
+            bool ok = table[index] != 0
+                ? DiskImage::pwriteAll(fd, src, bytes, table[index] + inCluster)
+                : copyUp(index, src, inCluster, bytes);
+            src += bytes;
+            return ok;
+        });
+    }
+
+    bool flush() override {
+        return fsync(fd) == 0;
+    }
+
+    std::string describe() const override {
+        return fmt::format("overlay '{}' over {}, {} of {} clusters copied",
+                           path, base->describe(), allocatedClusters(), table.size());
+    }
+
+    size_t allocatedClusters() const {
+        return static_cast<size_t>(std::count_if(table.begin(), table.end(), [](uint64_t o) { return o != 0; }));
+    }
+
+private:
+    struct Header {
+        char magic[4] = {};
+        uint32_t version = 0;
+        uint32_t clusterSize = 0;
+        uint32_t reserved = 0;
+        uint64_t sectorCount = 0;
+        char basePath[HEADER_SIZE - 24] = {};
+    };
+    static_assert(sizeof(Header) == HEADER_SIZE, "DCOW header layout");
+
+    static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    static std::unique_ptr<BlockBackend> openBase(const std::string& basePath) {
+        if (DiskImage::readMagic(basePath) == std::string(CompressedImageBackend::MAGIC, 4)) {
+            return std::make_unique<CompressedImageBackend>(basePath);
+        }
+        return std::make_unique<ReadOnlyFileBackend>(basePath);
+    }
+
+    // Split a sector range per cluster: fn(clusterIndex, pieceLba, offsetInCluster, bytes)
+    template <typename Fn>
+    bool forEachCluster(uint64_t lba, uint32_t count, Fn&& fn) {
+        uint64_t offset = lba * SECTOR_SIZE;
+        uint64_t remaining = static_cast<uint64_t>(count) * SECTOR_SIZE;
+        while (remaining > 0) {
+            size_t index = static_cast<size_t>(offset / clusterSize);
+            size_t inCluster = static_cast<size_t>(offset % clusterSize);
+            size_t bytes = static_cast<size_t>(std::min<uint64_t>(remaining, clusterSize - inCluster));
+            if (!fn(index, offset / SECTOR_SIZE, inCluster, bytes)) {
+                return false;
+            }
+            offset += bytes;
+            remaining -= bytes;
+        }
+        return true;
+    }
+
+    bool copyUp(size_t index, const uint8_t* src, size_t inCluster, size_t bytes) {
+        uint64_t firstSector = static_cast<uint64_t>(index) * (clusterSize / SECTOR_SIZE);
+        uint64_t baseSectors = std::min<uint64_t>(clusterSize / SECTOR_SIZE, sectors - firstSector);
+
+        std::fill(copyBuffer.begin(), copyBuffer.end(), 0);
+        if (bytes < clusterSize &&
+            !base->readSectors(firstSector, copyBuffer.data(), static_cast<uint32_t>(baseSectors))) {
+            return false;
+        }
+        std::memcpy(copyBuffer.data() + inCluster, src, bytes);
+
+        // The cluster must be on disk before the table points at it, or a crash
+        // in between leaves the entry referring to garbage
+        uint64_t offset = nextCluster;
+        if (!DiskImage::pwriteAll(fd, copyBuffer.data(), clusterSize, offset) ||
+            !DiskImage::syncData(fd) ||
+            !DiskImage::pwriteAll(fd, &offset, sizeof(offset), HEADER_SIZE + index * sizeof(uint64_t))) {
+            return false;
+        }
+        table[index] = offset;
+        nextCluster += clusterSize;
+        return true;
+    }
+
+    std::string path;
+    std::string basePath;
+    int fd;
+    std::unique_ptr<BlockBackend> base;
+    uint32_t clusterSize = 0;
+    uint64_t sectors = 0;
+    std::vector<uint64_t> table;      // File offset of each copied cluster, 0 if still in the base
+    uint64_t nextCluster = 0;         // File offset for the next copied cluster
+    std::vector<uint8_t> copyBuffer;
+};
+
+namespace DiskImage {
+
+/**
+ * Open a disk image for a BlockDevice, detecting its format
+ * Raw images (and missing paths) are opened read-write and sized to at least sectors.
+ */
+inline std::unique_ptr<BlockBackend> open(const std::string& path, uint64_t sectors) {
+    std::string magic = readMagic(path);
+    if (magic == std::string(OverlayBackend::MAGIC, 4)) {
+        return std::make_unique<OverlayBackend>(path);
+    }
+    if (magic == std::string(CompressedImageBackend::MAGIC, 4)) {
+        return std::make_unique<CompressedImageBackend>(path);
+    }
+    return std::make_unique<SparseFileBackend>(path, sectors);
+}
+
+} // namespace DiskImage
+
+} // namespace vhw
@@ -0,0 +1,424 @@
+#pragma once
+
+#include "../device.hpp"
+#include "../device_manager.hpp"
+#include "../interrupt_controller.hpp"
+#include "../../debug/logger.hpp"
+
+#include <fmt/format.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+
+using Logging::Logger;
+
+namespace vhw {
+
+/**
+ * A virtual DMA controller that moves blocks of data between guest memory
+ * and block storage devices (RamDisk, File) on a host worker thread.
+ *
+ * This device uses two ports: one for control/status and one for data.
+ * The guest selects a transfer register with a control command and then
+ * writes its value to the data port, one byte at a time, little-endian.
+ *
+ * Control commands:
+ *   0x00: Select source address register
+ *   0x01: Select destination address register
+ *   0x02: Select length register
+ *   0x03: Select device register (port of the storage device)
+ *   0x04: Select mode register (see MODE_* constants)
+ *   0x10: Start the programmed transfer
+ *   0x11: Acknowledge completion (clears DONE, ERROR and IRQ)
+ *   0x12: Wait until the current transfer has finished
+ *   0x13: Enable completion interrupt (raises InterruptController::IRQ_DMA)
+ *   0x14: Disable completion interrupt
+ *
+ * Reading the control port returns the status byte (see STATUS_* bits).
+ * Reading the data port returns the last error code (see ERR_* constants).
+ */
+class DmaDevice : public VirtualDevice {
+public:
+    static constexpr uint8_t DEFAULT_DATA_PORT = 0x07;
+    static constexpr uint8_t DEFAULT_CTRL_PORT = 0x08;
+
+    // Commands
+    static constexpr uint8_t CMD_SELECT_SRC = 0x00;
+    static constexpr uint8_t CMD_SELECT_DST = 0x01;
+    static constexpr uint8_t CMD_SELECT_LEN = 0x02;
+    static constexpr uint8_t CMD_SELECT_DEVICE = 0x03;
+    static constexpr uint8_t CMD_SELECT_MODE = 0x04;
+    static constexpr uint8_t CMD_START = 0x10;
+    static constexpr uint8_t CMD_ACK = 0x11;
+    static constexpr uint8_t CMD_WAIT = 0x12;
+    static constexpr uint8_t CMD_IRQ_ENABLE = 0x13;
+    static constexpr uint8_t CMD_IRQ_DISABLE = 0x14;
+
+    // Transfer modes
+    static constexpr uint8_t MODE_DEVICE_TO_MEMORY = 0x00;
+    static constexpr uint8_t MODE_MEMORY_TO_DEVICE = 0x01;
+    static constexpr uint8_t MODE_MEMORY_TO_MEMORY = 0x02;
+
+    // Status bits
+    static constexpr uint8_t STATUS_BUSY = 0x01;
+    static constexpr uint8_t STATUS_DONE = 0x02;
+    static constexpr uint8_t STATUS_ERROR = 0x04;
+    static constexpr uint8_t STATUS_IRQ_PENDING = 0x80;
+
+    // Error codes
+    static constexpr uint8_t ERR_NONE = 0x00;
+    static constexpr uint8_t ERR_BUSY = 0x01;
+    static constexpr uint8_t ERR_NO_MEMORY = 0x02;
+    static constexpr uint8_t ERR_NO_DEVICE = 0x03;
+    static constexpr uint8_t ERR_OUT_OF_BOUNDS = 0x04;
+    static constexpr uint8_t ERR_BAD_MODE = 0x05;
+
+    /**
+     * Facade registered at the data port; forwards to the owning controller
+     */
+    class DataPort : public VirtualDevice {
+    public:
+        explicit DataPort(DmaDevice* owner) : owner(owner) {}
+
+        uint8_t read() override {
+            return owner ? owner->readData() : 0;
+        }
+
+        void write(uint8_t value) override {
+            if (owner) owner->writeData(value);
+        }
+
+        std::string getName() const override {
+            return "DMA Controller (data)";
+        }
+
+        // The controller owns all state; resetting it resets the data port too
+        void reset() override {}
+
+    private:
+        friend class DmaDevice;
+        DmaDevice* owner;
+    };
+
+    DmaDevice() : dataPort_(std::make_shared<DataPort>(this)) {
+        worker = std::thread([this] { workerLoop(); });
+    }
+
+    ~DmaDevice() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        workCv.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+        dataPort_->owner = nullptr;
+    }
+
+    uint8_t read() override {
+        return status.load(std::memory_order_acquire);
+    }
+
+    void write(uint8_t value) override {
+        switch (value) {
+            case CMD_SELECT_SRC:
+            case CMD_SELECT_DST:
+            case CMD_SELECT_LEN:
+            case CMD_SELECT_DEVICE:
+            case CMD_SELECT_MODE: {
+                std::lock_guard<std::mutex> lock(mutex);
+                selected = value;
+                byteIndex = 0;
+                break;
+            }
+            case CMD_START:
+                start();
+                break;
+            case CMD_ACK:
+                status.fetch_and(static_cast<uint8_t>(~(STATUS_DONE | STATUS_ERROR | STATUS_IRQ_PENDING)),
+                                 std::memory_order_acq_rel);
+                break;
+            case CMD_WAIT:
+                waitIdle();
+                break;
+            case CMD_IRQ_ENABLE:
+                irqEnabled.store(true, std::memory_order_release);
+                break;
+            case CMD_IRQ_DISABLE:
+                irqEnabled.store(false, std::memory_order_release);
+                break;
+            default:
+                Logger::instance().warn() << fmt::format(
+                    "DMA: Unknown control command 0x{:02X}", value
+                ) << std::endl;
+                break;
+        }
+    }
+
+    std::string getName() const override {
+        return "DMA Controller";
+    }
+
+    void reset() override {
+        waitIdle();
+        std::lock_guard<std::mutex> lock(mutex);
+        src = dst = length = 0;
+        devicePort = 0;
+        mode = MODE_DEVICE_TO_MEMORY;
+        selected = CMD_SELECT_SRC;
+        byteIndex = 0;
+        lastError = ERR_NONE;
+        irqEnabled.store(false, std::memory_order_release);
+        status.store(0, std::memory_order_release);
+    }
+
+    // The worker copies through raw pointers into guest memory
+    void releaseMemory() override {
+        waitIdle();
+    }
+
+    bool mayInterrupt() const override {
+        return (status.load(std::memory_order_acquire) & STATUS_BUSY) &&
+               irqEnabled.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Get the device to register at the data port
+     */
+    std::shared_ptr<DataPort> dataPort() const {
+        return dataPort_;
+    }
+
+    /**
+     * Check whether a completion interrupt is waiting to be acknowledged
+     */
+    bool interruptPending() const {
+        return (status.load(std::memory_order_acquire) & STATUS_IRQ_PENDING) != 0;
+    }
+
+    /**
+     * Block the calling thread until no transfer is in flight
+     */
+    void waitIdle() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idleCv.wait(lock, [this] { return !pending && !active; });
+    }
+
+    /**
+     * Program a transfer from the host side (equivalent to the guest's port writes)
+     */
+    void program(uint32_t source, uint32_t destination, uint32_t len,
+                 uint8_t transferMode, uint8_t port = 0) {
+        std::lock_guard<std::mutex> lock(mutex);
+        src = source;
+        dst = destination;
+        length = len;
+        mode = transferMode;
+        devicePort = port;
+    }
+
+    /**
+     * Start the programmed transfer
+     * @return false if the transfer was rejected (see the data port error code)
+     */
+    bool start() {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (pending || active) {
+            // Leave the in-flight transfer's status alone
+            lastError = ERR_BUSY;
+            Logger::instance().warn() << "DMA: Start ignored, transfer already in progress" << std::endl;
+            return false;
+        }
+
+        job = Job{};
+        job.mode = mode;
+        job.length = length;
+
+        std::vector<uint8_t>* memory = DeviceManager::instance().getMemory();
+        if (!memory) {
+            return fail(ERR_NO_MEMORY, "no guest memory attached");
+        }
+
+        switch (mode) {
+            case MODE_DEVICE_TO_MEMORY:
+            case MODE_MEMORY_TO_DEVICE: {
+                auto device = DeviceManager::instance().getDevice(devicePort);
+                auto storage = std::dynamic_pointer_cast<BlockStorage>(device);
+                if (!storage) {
+                    return fail(ERR_NO_DEVICE, fmt::format(
+                        "port {} has no block storage device", devicePort));
+                }
+                // The worker thread is about to touch the device; make it lock from now on
+                device->markShared();
+                uint32_t memAddr = (mode == MODE_DEVICE_TO_MEMORY) ? dst : src;
+                if (static_cast<uint64_t>(memAddr) + length > memory->size()) {
+                    return fail(ERR_OUT_OF_BOUNDS, fmt::format(
+                        "memory range 0x{:X}+{} exceeds guest memory ({} bytes)",
+                        memAddr, length, memory->size()));
+                }
+                job.storage = storage;
+                job.memory = memory->data() + memAddr;
+                job.deviceOffset = (mode == MODE_DEVICE_TO_MEMORY) ? src : dst;
+                break;
+            }
+            case MODE_MEMORY_TO_MEMORY:
+                if (static_cast<uint64_t>(src) + length > memory->size() ||
+                    static_cast<uint64_t>(dst) + length > memory->size()) {
+                    return fail(ERR_OUT_OF_BOUNDS, fmt::format(
+                        "copy 0x{:X} -> 0x{:X} ({} bytes) exceeds guest memory ({} bytes)",
+                        src, dst, length, memory->size()));
+                }
+                job.source = memory->data() + src;
+                job.memory = memory->data() + dst;
+                break;
+            default:
+                return fail(ERR_BAD_MODE, fmt::format("invalid mode 0x{:02X}", mode));
+        }
+
+        Logger::instance().debug() << fmt::format(
+            "{:22} │ DMA: Starting mode {} transfer of {} bytes (src=0x{:X}, dst=0x{:X})",
+            "", mode, length, src, dst
+        ) << std::endl;
+
+        lastError = ERR_NONE;
+        status.store(STATUS_BUSY, std::memory_order_release);
+        pending = true;
+        lock.unlock();
+        workCv.notify_one();
+        return true;
+    }
+
+private:
+    struct Job {
+        uint8_t mode = MODE_DEVICE_TO_MEMORY;
+        uint32_t length = 0;
+        size_t deviceOffset = 0;
+        uint8_t* memory = nullptr;         // Guest memory side of the transfer
+        const uint8_t* source = nullptr;   // Source for memory-to-memory copies
+        std::shared_ptr<BlockStorage> storage;
+    };
+
+    uint8_t readData() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return lastError;
+    }
+
+    void writeData(uint8_t value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint32_t shift = 8 * byteIndex;
+        switch (selected) {
+            case CMD_SELECT_SRC:
+                src = (byteIndex == 0 ? 0 : src) | (static_cast<uint32_t>(value) << shift);
+                break;
+            case CMD_SELECT_DST:
+                dst = (byteIndex == 0 ? 0 : dst) | (static_cast<uint32_t>(value) << shift);
+                break;
+            case CMD_SELECT_LEN:
+                length = (byteIndex == 0 ? 0 : length) | (static_cast<uint32_t>(value) << shift);
+                break;
+            case CMD_SELECT_DEVICE:
+                devicePort = value;
+                break;
+            case CMD_SELECT_MODE:
+                mode = value;
+                break;
+        }
+        byteIndex = (byteIndex + 1) & 3;
+    }
+
+    // Called with mutex held
+    bool fail(uint8_t error, const std::string& reason) {
+        lastError = error;
+        uint8_t newStatus = STATUS_DONE | STATUS_ERROR;
+        bool interrupt = irqEnabled.load(std::memory_order_acquire);
+        if (interrupt) {
+            newStatus |= STATUS_IRQ_PENDING;
+        }
+        status.store(newStatus, std::memory_order_release);
+        if (interrupt) {
+            InterruptController::instance().raise(InterruptController::IRQ_DMA);
+        }
+        Logger::instance().error() << fmt::format("DMA: Transfer rejected, {}", reason) << std::endl;
+        return false;
+    }
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            workCv.wait(lock, [this] { return pending || stopping; });
+            if (stopping) {
+                return;
+            }
+
+            Job current = std::move(job);
+            pending = false;
+            active = true;
+            lock.unlock();
+
+            // The copy itself runs without the controller lock held
+            size_t transferred = current.length;
+            switch (current.mode) {
+                case MODE_DEVICE_TO_MEMORY:
+                    transferred = current.storage->readBlock(current.deviceOffset, current.memory, current.length);
+                    break;
+                case MODE_MEMORY_TO_DEVICE:
+                    transferred = current.storage->writeBlock(current.deviceOffset, current.memory, current.length);
+                    break;
+                case MODE_MEMORY_TO_MEMORY:
+                    std::memmove(current.memory, current.source, current.length);
+                    break;
+            }
+
+            lock.lock();
+            active = false;
+            uint8_t newStatus = STATUS_DONE;
+            if (transferred != current.length) {
+                lastError = ERR_OUT_OF_BOUNDS;
+                newStatus |= STATUS_ERROR;
+            }
+            bool interrupt = irqEnabled.load(std::memory_order_acquire);
+            if (interrupt) {
+                newStatus |= STATUS_IRQ_PENDING;
+            }
+            status.store(newStatus, std::memory_order_release);
+            idleCv.notify_all();
+            if (interrupt) {
+                InterruptController::instance().raise(InterruptController::IRQ_DMA);
+            }
+        }
+    }
+
+    std::shared_ptr<DataPort> dataPort_;
+
+    // Programmed registers
+    uint32_t src = 0;
+    uint32_t dst = 0;
+    uint32_t length = 0;
+    uint8_t devicePort = 0;
+    uint8_t mode = MODE_DEVICE_TO_MEMORY;
+    uint8_t selected = CMD_SELECT_SRC;
+    uint8_t byteIndex = 0;
+    uint8_t lastError = ERR_NONE;
+
+    std::atomic<uint8_t> status{0};
+    std::atomic<bool> irqEnabled{false};
+
+    // Worker state
+    Job job;
+    bool pending = false;
+    bool active = false;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable workCv;
+    std::condition_variable idleCv;
+    std::thread worker;
+};
+
+} // namespace vhw
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../device.hpp"
+#include "../async_io.hpp"
 #include "../../debug/logger.hpp"
 
 #include <fmt/format.h>
@@ -8,13 +9,21 @@
 #include <string>
 #include <fstream>
 #include <vector>
+#include <memory>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
 #include <filesystem>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <string.h>
+#include <errno.h>
 #include <limits.h>
 #include <stdexcept>
 #include <algorithm>
+#include <cstring>
 
 using Logging::Logger;
 
@@ -25,26 +34,67 @@ namespace vhw {
  * A virtual device that reads/writes to a file
  * Reading will get a byte from the file
  * Writing will append a byte to the file
+ *
+ * In Buffered mode the whole file is loaded into memory and, by default,
+ * rewritten after every write, so a write is on disk once it returns.
+ * setWriteBehind() opts out of that: changes stay in memory until more than
+ * the given number of bytes is dirty or the device is flushed, reset or
+ * destroyed, and are written from a snapshot on the AsyncIo engine when one
+ * is set so the CPU thread does not wait for the disk. Changes not yet written
+ * back are lost if the process dies.
+ *
+ * In Mapped mode the file is mmap'd: opening is O(1) regardless
+ * of size, reads and writes go straight to the mapping, and dirty ranges are
+ * written back with msync on flush, reset and destruction.
  */
-class FileDevice : public VirtualDevice {
+class FileDevice : public VirtualDevice, public BlockStorage {
 public:
     static constexpr uint8_t DEFAULT_PORT = 0x04;
+    static constexpr size_t MAX_BUFFER_SIZE = 100 * 1024 * 1024; // 100MB limit
+    static constexpr size_t MIN_MAPPING_SIZE = 64 * 1024;        // Initial mapping for empty files
 
-    explicit FileDevice(const std::string& filepath)
-        : filepath(filepath), position(0) {
+    enum class Mode {
+        Buffered,  // Load the whole file into memory
+        Mapped     // mmap the file and sync dirty ranges
+    };
+
+    explicit FileDevice(const std::string& filepath, Mode mode = Mode::Buffered)
+        : filepath(filepath), position(0), mapped(mode == Mode::Mapped) {
         // Validate file path for security before proceeding
         if (!validateFilePath(filepath)) {
             throw std::runtime_error("Invalid or unsafe file path: " + filepath);
         }
 
+        if (mapped) {
+            if (!openMapping()) {
+                throw std::runtime_error("Failed to map file: " + filepath);
+            }
+            return;
+        }
+
         // Try to open the file for reading
         loadFromFile();
     }
 
-    ~FileDevice() override = default;
+    ~FileDevice() override {
+        if (mapped) {
+            closeMapping();
+            return;
+        }
+        // The engine may already be gone at exit; write what is left directly
+        waitIdle();
+        reportWriteBackFailure();
+        if (dirty) {
+            saveToFile();
+        }
+    }
 
     uint8_t read() override {
-        std::lock_guard<std::mutex> lock(mutex);
+        std::lock_guard<DeviceMutex> lock(mutex);
+
+        if (mapped) {
+            return position < fileSize ? mapping[position++] : 0;
+        }
 
         // If position is at the end of the buffer or beyond, return 0
         if (position >= fileBuffer.size()) {
@@ -84,7 +134,14 @@ public:
     }
 
     void write(uint8_t value) override {
-        std::lock_guard<std::mutex> lock(mutex);
+        std::lock_guard<DeviceMutex> lock(mutex);
+
+        if (mapped) {
+            if (writeMapped(position, &value, 1) == 1) {
+                ++position;
+            }
+            return;
+        }
 
         // Check for position overflow before any operations
         if (position == SIZE_MAX) {
@@ -97,7 +154,6 @@ public:
         // If writing at the current position or beyond the end, append
         if (position >= fileBuffer.size()) {
             // Check for reasonable buffer size limits to prevent memory exhaustion
-            constexpr size_t MAX_BUFFER_SIZE = 100 * 1024 * 1024; // 100MB limit
             if (fileBuffer.size() >= MAX_BUFFER_SIZE) {
                 Logger::instance().error() << fmt::format(
                     "File device buffer size limit reached ({}), cannot append",
@@ -123,8 +179,7 @@ public:
             ++position;
         }
 
-        // Save to file
-        saveToFile();
+        markDirty(1);
     }
 
     std::string getName() const override {
@@ -132,17 +187,120 @@ public:
     }
 
     void reset() override {
-        std::lock_guard<std::mutex> lock(mutex);
+        std::lock_guard<DeviceMutex> lock(mutex);
         position = 0;
+        if (mapped) {
+            // The mapping is the file; only pending writes need to reach disk
+            syncDirty();
+            return;
+        }
+        // Reload what the guest last wrote, so everything must reach the file first
+        waitIdle();
+        reportWriteBackFailure();
+        if (dirty) {
+            saveToFile();
+            dirty = false;
+            dirtyBytes = 0;
+        }
         loadFromFile();
     }
 
+    /**
+     * Write dirty mapped pages or the changed buffer back to the file
+     */
+    void flush() override {
+        std::lock_guard<DeviceMutex> lock(mutex);
+        if (mapped) {
+            syncDirty();
+        } else {
+            writeBack();
+        }
+    }
+
+    /**
+     * Keep buffered-mode changes in memory until more than maxDirtyBytes are
+     * dirty, instead of saving on every write (0 = write through, the default)
+     */
+    void setWriteBehind(size_t maxDirtyBytes) {
+        std::lock_guard<DeviceMutex> lock(mutex);
+        writeBehindLimit = maxDirtyBytes;
+        if (writeBehindLimit == 0) {
+            writeBack();
+            waitIdle();
+        }
+    }
+
+    /**
+     * Write write-behind changes back on the given engine (nullptr = synchronously)
+     */
+    void setAsyncIo(AsyncIo* io) {
+        waitIdle();
+        asyncIo = io;
+    }
+
+    /**
+     * Block the calling thread until no write-back is in flight
+     */
+    void waitIdle() {
+        std::unique_lock<std::mutex> lock(writeBackMutex);
+        writeBackDone.wait(lock, [this] { return !writeBackPending; });
+    }
+
+    /**
+     * Check whether the file is served from an mmap'd view
+     */
+    bool isMapped() const {
+        return mapped;
+    }
+
+    size_t readBlock(size_t offset, uint8_t* dest, size_t length) override {
+        std::lock_guard<DeviceMutex> lock(mutex);
+        size_t available = size();
+        if (offset >= available) {
+            return 0;
+        }
+        size_t count = std::min(length, available - offset);
+        std::memcpy(dest, (mapped ? mapping : fileBuffer.data()) + offset, count);
+        return count;
+    }
+
+    /**
+     * Writes past the end of the file grow it (up to MAX_BUFFER_SIZE)
+     */
+    size_t writeBlock(size_t offset, const uint8_t* src, size_t length) override {
+        std::lock_guard<DeviceMutex> lock(mutex);
+        if (mapped) {
+            return writeMapped(offset, src, length);
+        }
+        if (offset > MAX_BUFFER_SIZE || length > MAX_BUFFER_SIZE - offset) {
+            Logger::instance().error() << fmt::format(
+                "File device block write at {} ({} bytes) exceeds buffer size limit ({})",
+                offset, length, MAX_BUFFER_SIZE
+            ) << std::endl;
+            return 0;
+        }
+        if (offset + length > fileBuffer.size()) {
+            fileBuffer.resize(offset + length, 0);
+        }
+        std::memcpy(fileBuffer.data() + offset, src, length);
+        markDirty(length);
+        return length;
+    }
+
+    size_t capacity() const override {
+        return size();
+    }
+
+    void markShared() override {
+        mutex.share();
+    }
+
     /**
      * Set the file position
      */
     void seek(size_t newPosition) {
-        std::lock_guard<std::mutex> lock(mutex);
-        position = std::min(newPosition, fileBuffer.size());
+        std::lock_guard<DeviceMutex> lock(mutex);
+        position = std::min(newPosition, size());
     }
 
     /**
@@ -156,7 +314,7 @@ public:
      * Get the file size
      */
     size_t size() const {
-        return fileBuffer.size();
+        return mapped ? fileSize : fileBuffer.size();
     }
 
 private:
@@ -328,13 +486,13 @@ private:
         }
     }
 
-    void saveToFile() {
-        // Validate file path for security before writing
+    // Validate the path and create its directories before the file is rewritten
+    bool prepareSave() {
         if (!validateFilePath(filepath)) {
             Logger::instance().error() << fmt::format(
                 "Invalid or unsafe file path for writing: '{}'", filepath
             ) << std::endl;
-            return;
+            return false;
         }
 
         // Create directories if needed (but validate the path first)
@@ -346,14 +504,27 @@ private:
                 Logger::instance().error() << fmt::format(
                     "Failed to create directories for '{}': {}", filepath, e.what()
                 ) << std::endl;
-                return;
+                return false;
             }
         }
+        return true;
+    }
+
+    // Runs on an I/O thread for write-backs; the caller reports failures
+    static bool writeFile(const std::string& path, const std::vector<uint8_t>& contents) {
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+        file.flush();
+        return static_cast<bool>(file);
+    }
+
+    void saveToFile() {
+        if (!prepareSave()) {
+            return;
+        }
 
         // Write buffer to file
-        std::ofstream file(filepath, std::ios::binary);
-        if (file) {
-            file.write(reinterpret_cast<const char*>(fileBuffer.data()), fileBuffer.size());
+        if (writeFile(filepath, fileBuffer)) {
             Logger::instance().debug() << fmt::format(
             "{:22} │ Wrote {} bytes to file '{}'",
             "", fileBuffer.size(), filepath
@@ -366,10 +537,212 @@ private:
         }
     }
 
+    // Save now when writing through; with write-behind, once the limit is passed
+    void markDirty(size_t bytes) {
+        dirty = true;
+        dirtyBytes += bytes;
+        if (writeBehindLimit == 0) {
+            saveToFile();
+            dirty = false;
+            dirtyBytes = 0;
+        } else if (dirtyBytes > writeBehindLimit) {
+            writeBack();
+        }
+    }
+
+    // Rewrite the file from a snapshot of the buffer on the I/O engine, one
+    // write-back at a time so they land in order (synchronously without one)
+    void writeBack() {
+        reportWriteBackFailure();
+        if (!dirty) {
+            return;
+        }
+        dirty = false;
+        dirtyBytes = 0;
+        if (!asyncIo) {
+            saveToFile();
+            return;
+        }
+        if (!prepareSave()) {
+            return;
+        }
+
+        auto snapshot = std::make_shared<std::vector<uint8_t>>(fileBuffer);
+        waitIdle();
+        {
+            std::lock_guard<std::mutex> lock(writeBackMutex);
+            writeBackPending = true;
+        }
+        asyncIo->submitJob([path = filepath, snapshot] { return writeFile(path, *snapshot); },
+                           [this](bool ok) {
+            if (!ok) {
+                writeBackFailed.store(true, std::memory_order_relaxed);
+            }
+            std::lock_guard<std::mutex> lock(writeBackMutex);
+            writeBackPending = false;
+            writeBackDone.notify_all();
+        });
+    }
+
+    // Failures are recorded on the I/O thread and reported from the device's own
+    void reportWriteBackFailure() {
+        if (writeBackFailed.exchange(false, std::memory_order_relaxed)) {
+            Logger::instance().error() << fmt::format(
+                "Failed to write back file '{}'", filepath
+            ) << std::endl;
+        }
+    }
+
+    // ==== Mapped mode ====
+
+    bool openMapping() {
+        fs::path path(filepath);
+        if (path.has_parent_path()) {
+            std::error_code ec;
+            fs::create_directories(path.parent_path(), ec);
+        }
+
+        fd = ::open(filepath.c_str(), O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            Logger::instance().error() << fmt::format(
+                "Failed to open '{}' for mapping: {}", filepath, strerror(errno)
+            ) << std::endl;
+            return false;
+        }
+
+        // Re-check the opened descriptor so a swapped-in special file cannot be mapped
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            Logger::instance().error() << fmt::format(
+                "Mapped file '{}' is not a regular file", filepath
+            ) << std::endl;
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+
+        fileSize = static_cast<size_t>(st.st_size);
+        if (fileSize > 0 && !remap(fileSize)) {
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+
+        Logger::instance().info() << fmt::format(
+            "Mapped {} bytes from file '{}'", fileSize, filepath
+        ) << std::endl;
+        return true;
+    }
+
+    // Map the file at newCapacity bytes, extending it on disk if needed
+    bool remap(size_t newCapacity) {
+        if (static_cast<size_t>(lseek(fd, 0, SEEK_END)) < newCapacity &&
+            ftruncate(fd, static_cast<off_t>(newCapacity)) != 0) {
+            Logger::instance().error() << fmt::format(
+                "Failed to grow '{}' to {} bytes: {}", filepath, newCapacity, strerror(errno)
+            ) << std::endl;
+            return false;
+        }
+
+        void* view = mmap(nullptr, newCapacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (view == MAP_FAILED) {
+            Logger::instance().error() << fmt::format(
+                "Failed to mmap '{}' ({} bytes): {}", filepath, newCapacity, strerror(errno)
+            ) << std::endl;
+            return false;
+        }
+
+        // Shared mappings write through the page cache, so dropping the old view loses nothing
+        if (mapping) {
+            munmap(mapping, mappingCapacity);
+        }
+        mapping = static_cast<uint8_t*>(view);
+        mappingCapacity = newCapacity;
+        return true;
+    }
+
+    size_t writeMapped(size_t offset, const uint8_t* src, size_t length) {
+        if (length == 0) {
+            return 0;
+        }
+        if (offset > fileSize) {
+            return 0;  // Same as buffered mode: no holes past the end
+        }
+
+        size_t end = offset + length;
+        if (end > mappingCapacity) {
+            // Grow geometrically; the file is trimmed back to its real size on close
+            size_t newCapacity = std::max({end, mappingCapacity * 2, MIN_MAPPING_SIZE});
+            if (!remap(newCapacity)) {
+                return 0;
+            }
+        }
+
+        std::memcpy(mapping + offset, src, length);
+        fileSize = std::max(fileSize, end);
+        dirtyBegin = std::min(dirtyBegin, offset);
+        dirtyEnd = std::max(dirtyEnd, end);
+        return length;
+    }
+
+    void syncDirty() {
+        if (!mapping || dirtyBegin >= dirtyEnd) {
+            return;
+        }
+
+        // msync needs a page-aligned start address
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t start = dirtyBegin - (dirtyBegin % page);
+        if (msync(mapping + start, dirtyEnd - start, MS_SYNC) != 0) {
+            Logger::instance().error() << fmt::format(
+                "Failed to sync '{}': {}", filepath, strerror(errno)
+            ) << std::endl;
+        }
+        dirtyBegin = SIZE_MAX;
+        dirtyEnd = 0;
+    }
+
+    void closeMapping() {
+        syncDirty();
+        if (mapping) {
+            munmap(mapping, mappingCapacity);
+            mapping = nullptr;
+        }
+        if (fd >= 0) {
+            // Drop the slack left by geometric growth
+            if (ftruncate(fd, static_cast<off_t>(fileSize)) != 0) {
+                Logger::instance().warn() << fmt::format(
+                    "Failed to trim '{}' to {} bytes: {}", filepath, fileSize, strerror(errno)
+                ) << std::endl;
+            }
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
     std::string filepath;
     std::vector<uint8_t> fileBuffer;
     size_t position;
-    std::mutex mutex;
+    DeviceMutex mutex;
+
+    // Buffered mode write-back
+    bool dirty = false;                 // Buffer has changes the file doesn't
+    size_t dirtyBytes = 0;              // Bytes written since the last write-back
+    size_t writeBehindLimit = 0;        // Dirty bytes kept in memory; 0 = write through
+    AsyncIo* asyncIo = nullptr;
+    std::mutex writeBackMutex;
+    std::condition_variable writeBackDone;
+    bool writeBackPending = false;
+    std::atomic<bool> writeBackFailed{false};
+
+    // Mapped mode state
+    bool mapped = false;
+    int fd = -1;
+    uint8_t* mapping = nullptr;
+    size_t mappingCapacity = 0;
+    size_t fileSize = 0;        // Logical file size (mapping may be larger)
+    size_t dirtyBegin = SIZE_MAX;
+    size_t dirtyEnd = 0;
 };
 
 } // namespace vhw
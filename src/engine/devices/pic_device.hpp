@@ -0,0 +1,135 @@
+#pragma once
+
+#include "../device.hpp"
+#include "../interrupt_controller.hpp"
+#include "../../debug/logger.hpp"
+
+#include <fmt/format.h>
+#include <cstdint>
+#include <string>
+#include <memory>
+
+using Logging::Logger;
+
+namespace vhw {
+
+/**
+ * Port interface for programming the InterruptController
+ * This device uses two ports: one for control/status and one for data.
+ * The data port writes the register selected by the last control command,
+ * one byte at a time, little-endian.
+ *
+ * Control commands:
+ *   0x00: Select mask register (bit set = line masked)
+ *   0x01: Select vector table base address register
+ *   0x02: End of interrupt (clears the highest priority in-service line)
+ *
+ * Reading the control port returns the pending lines.
+ * Reading the data port returns the in-service lines.
+ */
+class PicDevice : public VirtualDevice {
+public:
+    static constexpr uint8_t DEFAULT_DATA_PORT = 0x20;
+    static constexpr uint8_t DEFAULT_CTRL_PORT = 0x21;
+
+    // Commands
+    static constexpr uint8_t CMD_SELECT_MASK = 0x00;
+    static constexpr uint8_t CMD_SELECT_VECTOR_BASE = 0x01;
+    static constexpr uint8_t CMD_EOI = 0x02;
+
+    /**
+     * Facade registered at the data port; forwards to the owning control port
+     */
+    class DataPort : public VirtualDevice {
+    public:
+        explicit DataPort(PicDevice* owner) : owner(owner) {}
+
+        uint8_t read() override {
+            return InterruptController::instance().getInService();
+        }
+
+        void write(uint8_t value) override {
+            if (owner) owner->writeData(value);
+        }
+
+        std::string getName() const override {
+            return "Interrupt Controller (data)";
+        }
+
+        void reset() override {}
+
+    private:
+        friend class PicDevice;
+        PicDevice* owner;
+    };
+
+    PicDevice() : dataPort_(std::make_shared<DataPort>(this)) {}
+
+    ~PicDevice() override {
+        dataPort_->owner = nullptr;
+    }
+
+    uint8_t read() override {
+        return InterruptController::instance().getPending();
+    }
+
+    void write(uint8_t value) override {
+        switch (value) {
+            case CMD_SELECT_MASK:
+            case CMD_SELECT_VECTOR_BASE:
+                selected = value;
+                byteIndex = 0;
+                break;
+            case CMD_EOI:
+                InterruptController::instance().endOfInterrupt();
+                break;
+            default:
+                Logger::instance().warn() << fmt::format(
+                    "PIC: Unknown control command 0x{:02X}", value
+                ) << std::endl;
+                break;
+        }
+    }
+
+    std::string getName() const override {
+        return "Interrupt Controller";
+    }
+
+    void reset() override {
+        selected = CMD_SELECT_MASK;
+        byteIndex = 0;
+        InterruptController::instance().reset();
+    }
+
+    /**
+     * Get the device to register at the data port
+     */
+    std::shared_ptr<DataPort> dataPort() const {
+        return dataPort_;
+    }
+
+private:
+    void writeData(uint8_t value) {
+        auto& controller = InterruptController::instance();
+        if (selected == CMD_SELECT_MASK) {
+            controller.setMask(value);
+            return;
+        }
+
+        uint32_t shift = 8 * byteIndex;
+        uint32_t base = byteIndex == 0 ? 0 : controller.getVectorBase();
+        controller.setVectorBase(base | (static_cast<uint32_t>(value) << shift));
+        byteIndex = (byteIndex + 1) & 3;
+
+        Logger::instance().debug() << fmt::format(
+            "{:14} PIC │ Vector table base now 0x{:X}",
+            "", controller.getVectorBase()
+        ) << std::endl;
+    }
+
+    std::shared_ptr<DataPort> dataPort_;
+    uint8_t selected = CMD_SELECT_MASK;
+    uint8_t byteIndex = 0;
+};
+
+} // namespace vhw
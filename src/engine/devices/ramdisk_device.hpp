@@ -9,6 +9,7 @@
 #include <vector>
 #include <mutex>
 #include <algorithm>
+#include <cstring>
 
 namespace vhw {
 
@@ -23,7 +24,7 @@ namespace vhw {
  *   0x04: Get size low byte
  *   0x05: Get size high byte
  */
-class RamDiskDevice : public VirtualDevice {
+class RamDiskDevice : public VirtualDevice, public BlockStorage {
 public:
     static constexpr uint8_t DEFAULT_DATA_PORT = 0x05;
     static constexpr uint8_t DEFAULT_CTRL_PORT = 0x06;
@@ -43,7 +44,7 @@ public:
     ~RamDiskDevice() override = default;
     
     uint8_t read() override {
-        std::lock_guard<std::mutex> lock(mutex);
+        std::lock_guard<DeviceMutex> lock(mutex);
         
         // Handle read based on last command
         if (lastCommand == CMD_READ) {
@@ -74,7 +75,7 @@ public:
     }
     
     void write(uint8_t value) override {
-        std::lock_guard<std::mutex> lock(mutex);
+        std::lock_guard<DeviceMutex> lock(mutex);
         lastData = value;
         
         // If this is the control port, interpret as command
@@ -105,13 +106,41 @@ public:
     }
     
     void reset() override {
-        std::lock_guard<std::mutex> lock(mutex);
+        std::lock_guard<DeviceMutex> lock(mutex);
         std::fill(storage.begin(), storage.end(), 0);
         currentAddress = 0;
         lastCommand = 0;
         lastData = 0;
     }
     
+    size_t readBlock(size_t offset, uint8_t* dest, size_t length) override {
+        std::lock_guard<DeviceMutex> lock(mutex);
+        if (offset >= storage.size()) {
+            return 0;
+        }
+        size_t count = std::min(length, storage.size() - offset);
+        std::memcpy(dest, storage.data() + offset, count);
+        return count;
+    }
+
+    size_t writeBlock(size_t offset, const uint8_t* src, size_t length) override {
+        std::lock_guard<DeviceMutex> lock(mutex);
+        if (offset >= storage.size()) {
+            return 0;
+        }
+        size_t count = std::min(length, storage.size() - offset);
+        std::memcpy(storage.data() + offset, src, count);
+        return count;
+    }
+
+    size_t capacity() const override {
+        return storage.size();
+    }
+
+    void markShared() override {
+        mutex.share();
+    }
+
     /**
      * Set whether this instance is used as a control port
      */
@@ -123,7 +152,7 @@ public:
      * Get the current storage content
      */
     std::vector<uint8_t> getStorage() const {
-        std::lock_guard<std::mutex> lock(mutex);
+        std::lock_guard<DeviceMutex> lock(mutex);
         return storage;
     }
     
@@ -131,7 +160,7 @@ public:
      * Set the storage content
      */
     void setStorage(const std::vector<uint8_t>& newStorage) {
-        std::lock_guard<std::mutex> lock(mutex);
+        std::lock_guard<DeviceMutex> lock(mutex);
         
         // Copy as much data as fits
         size_t copySize = std::min(storage.size(), newStorage.size());
@@ -189,7 +218,7 @@ private:
     uint8_t lastCommand;
     uint8_t lastData;
     bool isControlPort = false;
-    mutable std::mutex mutex;
+    mutable DeviceMutex mutex;
 };
 
 } // namespace vhw
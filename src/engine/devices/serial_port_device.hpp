@@ -1,14 +1,15 @@
 #pragma once
 
 #include "../device.hpp"
+#include "../interrupt_controller.hpp"
+#include "../spsc_ring.hpp"
 #include "../../debug/logger.hpp"
 
 #include <fmt/format.h>
 #include <cstdint>
 #include <string>
 #include <vector>
-#include <deque>
-#include <mutex>
+#include <memory>
 #include <thread>
 #include <atomic>
 
@@ -22,6 +23,10 @@
 #include <sys/stat.h>
 #include <limits.h>
 #include <libgen.h>
+#include <poll.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
 #endif
 
 using Logging::Logger;
@@ -30,17 +35,23 @@ namespace vhw {
 
 /**
  * A real device that communicates with a serial port
- * This is a basic implementation - real application would need more error handling
+ * A reader thread blocks in poll() on the port and a wakeup descriptor
+ * (eventfd on Linux, a pipe elsewhere) and hands received bytes to the
+ * guest through a lock-free single-producer/single-consumer ring.
  */
 class SerialPortDevice : public RealDevice {
 public:
     static constexpr uint8_t DEFAULT_PORT = 0x03;
 
+    static constexpr size_t RX_BUFFER_SIZE = 4096;  // 4KB, must be a power of two
+
     explicit SerialPortDevice(const std::string& portName)
-        : portName(portName), fd(-1), connected(false), readThread(nullptr), running(false) {}
+        : portName(portName), fd(-1), wakeFd(-1), wakeWriteFd(-1), connected(false),
+          readThread(nullptr), running(false), droppedBytes(0), reportedDrops(0) {}
 
     ~SerialPortDevice() override {
-        if (isConnected()) {
+        // A reader that stopped on a hangup still has to be joined
+        if (isConnected() || readThread) {
             disconnect();
         }
     }
@@ -59,6 +70,11 @@ public:
             return false;
         }
 
+        // Clean up after a hangup before opening the port again
+        if (readThread) {
+            disconnect();
+        }
+
         // Unix implementation using termios
         // Open port with secure flags (O_NOFOLLOW prevents symlink attacks)
         fd = ::open(portName.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_NOFOLLOW);
@@ -124,6 +140,13 @@ public:
             return false;
         }
 
+        // Wakeup descriptor used to interrupt poll() on disconnect
+        if (!openWakeup()) {
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+
         // Start read thread
         running = true;
         readThread = std::make_unique<std::thread>(&SerialPortDevice::readLoop, this);
@@ -143,10 +166,12 @@ public:
         #else
         // Stop read thread
         running = false;
+        signalWakeup();
         if (readThread && readThread->joinable()) {
             readThread->join();
             readThread.reset();
         }
+        closeWakeup();
 
         // Close port
         if (fd >= 0) {
@@ -166,14 +191,24 @@ public:
         return connected;
     }
 
+    // The reader thread raises IRQ_SERIAL whenever data arrives
+    bool mayInterrupt() const override {
+        return connected;
+    }
+
     uint8_t read() override {
-        std::lock_guard<std::mutex> lock(bufferMutex);
-        if (rxBuffer.empty()) {
-            return 0;
+        // Overflow is counted by the reader thread and reported from the guest's thread
+        uint64_t dropped = droppedBytes.load(std::memory_order_relaxed);
+        if (dropped != reportedDrops) {
+            Logger::instance().warn() << fmt::format(
+                "Serial port RX buffer full ({} bytes), dropped {} incoming bytes",
+                RX_BUFFER_SIZE, dropped - reportedDrops
+            ) << std::endl;
+            reportedDrops = dropped;
         }
 
-        uint8_t value = rxBuffer.front();
-        rxBuffer.pop_front();
+        uint8_t value = 0;
+        rxBuffer.pop(value);
         return value;
     }
 
@@ -205,10 +240,23 @@ public:
     }
 
     void reset() override {
-        std::lock_guard<std::mutex> lock(bufferMutex);
         rxBuffer.clear();
     }
 
+    /**
+     * Number of received bytes waiting to be read by the guest
+     */
+    size_t available() const {
+        return rxBuffer.size();
+    }
+
+    /**
+     * Total bytes dropped because the guest did not drain the RX buffer
+     */
+    uint64_t getDroppedBytes() const {
+        return droppedBytes.load(std::memory_order_relaxed);
+    }
+
 private:
     /**
      * Validate opened file descriptor for security (prevents TOCTOU race conditions)
@@ -298,7 +346,8 @@ private:
             "/dev/ttyAMA",   // ARM serial ports
             "/dev/ttymxc",   // i.MX serial ports
             "/dev/serial/by-id/",  // Persistent names by ID
-            "/dev/serial/by-path/" // Persistent names by path
+            "/dev/serial/by-path/", // Persistent names by path
+            "/dev/pts/"      // Pseudo-terminals (local testing without hardware)
         };
 
         bool isAllowed = false;
@@ -356,50 +405,115 @@ private:
         #endif
     }
 
+    bool openWakeup() {
+        #ifndef _WIN32
+        #ifdef __linux__
+        wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        wakeWriteFd = wakeFd;
+        #else
+        int fds[2];
+        if (::pipe(fds) == 0) {
+            fcntl(fds[0], F_SETFL, O_NONBLOCK);
+            fcntl(fds[1], F_SETFL, O_NONBLOCK);
+            wakeFd = fds[0];
+            wakeWriteFd = fds[1];
+        }
+        #endif
+        if (wakeFd < 0) {
+            Logger::instance().error() << fmt::format(
+                "Failed to create serial port wakeup descriptor: {}",
+                strerror(errno)
+            ) << std::endl;
+            return false;
+        }
+        #endif
+        return true;
+    }
+
+    void signalWakeup() {
+        #ifndef _WIN32
+        if (wakeWriteFd >= 0) {
+            uint64_t one = 1;
+            [[maybe_unused]] ssize_t n = ::write(wakeWriteFd, &one, sizeof(one));
+        }
+        #endif
+    }
+
+    void closeWakeup() {
+        #ifndef _WIN32
+        if (wakeWriteFd >= 0 && wakeWriteFd != wakeFd) {
+            ::close(wakeWriteFd);
+        }
+        if (wakeFd >= 0) {
+            ::close(wakeFd);
+        }
+        wakeFd = -1;
+        wakeWriteFd = -1;
+        #endif
+    }
+
     void readLoop() {
         #ifndef _WIN32
         uint8_t buffer[256];
+        struct pollfd fds[2];
+        fds[0].fd = fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = wakeFd;
+        fds[1].events = POLLIN;
+
         while (running) {
+            // Block until data arrives or disconnect() signals the wakeup descriptor
+            int ready = ::poll(fds, 2, -1);
+            if (ready < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            if (fds[1].revents & POLLIN) {
+                break;
+            }
+            if (fds[0].revents & (POLLERR | POLLNVAL)) {
+                break;
+            }
+            if (!(fds[0].revents & (POLLIN | POLLHUP))) {
+                continue;
+            }
+
             ssize_t bytesRead = ::read(fd, buffer, sizeof(buffer));
             if (bytesRead > 0) {
-                std::lock_guard<std::mutex> lock(bufferMutex);
-
-                // Prevent buffer overflow by limiting rxBuffer size
-                constexpr size_t MAX_RX_BUFFER_SIZE = 4096;  // 4KB limit
-
-                for (ssize_t i = 0; i < bytesRead; ++i) {
-                    if (rxBuffer.size() >= MAX_RX_BUFFER_SIZE) {
-                        // Buffer full, drop oldest data to make room
-                        Logger::instance().warn() << fmt::format(
-                            "Serial port RX buffer full ({} bytes), dropping oldest data",
-                            MAX_RX_BUFFER_SIZE
-                        ) << std::endl;
-                        rxBuffer.pop_front();
-                    }
-                    rxBuffer.push_back(buffer[i]);
+                size_t pushed = rxBuffer.pushBulk(buffer, static_cast<size_t>(bytesRead));
+                if (pushed < static_cast<size_t>(bytesRead)) {
+                    droppedBytes.fetch_add(static_cast<size_t>(bytesRead) - pushed, std::memory_order_relaxed);
                 }
-            } else if (bytesRead < 0 && errno != EAGAIN) {
-                Logger::instance().error() << fmt::format(
-                    "Error reading from serial port: {}",
-                    strerror(errno)
-                ) << std::endl;
+                InterruptController::instance().raise(InterruptController::IRQ_SERIAL);
+            } else if (bytesRead == 0 || (errno != EAGAIN && errno != EINTR)) {
+                // Hangup (e.g. the other end of a pty closed) or a hard error;
+                // stop reading rather than spinning on a descriptor that stays ready
+                break;
             }
+        }
 
-            // Sleep a bit to prevent 100% CPU usage
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        // Still running means the port went away rather than disconnect() stopping us
+        if (running) {
+            connected = false;
+            Logger::instance().warn() << fmt::format(
+                "Serial port '{}' hung up, disconnected", portName
+            ) << std::endl;
         }
         #endif
     }
 
     std::string portName;
     int fd;  // File descriptor for the serial port
+    int wakeFd;  // Read side of the wakeup descriptor polled by readLoop
+    int wakeWriteFd;  // Write side (same as wakeFd for an eventfd)
     std::atomic<bool> connected;
 
-    std::deque<uint8_t> rxBuffer;
-    std::mutex bufferMutex;
+    SpscRing<uint8_t, RX_BUFFER_SIZE> rxBuffer;
 
     std::unique_ptr<std::thread> readThread;
     std::atomic<bool> running;
+    std::atomic<uint64_t> droppedBytes;
+    uint64_t reportedDrops;
 };
 
 } // namespace vhw
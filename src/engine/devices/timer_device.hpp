@@ -0,0 +1,368 @@
+#pragma once
+
+#include "../device.hpp"
+#include "../interrupt_controller.hpp"
+#include "../virtual_clock.hpp"
+#include "../timer_wheel.hpp"
+#include "../../debug/logger.hpp"
+
+#include <fmt/format.h>
+#include <cstdint>
+#include <string>
+#include <array>
+#include <memory>
+#include <chrono>
+
+using Logging::Logger;
+
+namespace vhw {
+
+/**
+ * Bank of programmable one-shot and periodic timers
+ *
+ * This device uses two ports: one for control/status and one for data.
+ * The guest selects a register with a control command and then writes its
+ * value to the data port one byte at a time, little-endian.
+ *
+ * Control commands:
+ *   0x00: Select timer register (8-bit timer id, 0-254)
+ *   0x01: Select interval register (32-bit; cycles, or microseconds with MODE_HOST_CLOCK)
+ *   0x02: Select mode register (8-bit, see MODE_* bits)
+ *   0x10: Arm the selected timer (re-arming restarts it)
+ *   0x11: Cancel the selected timer
+ *   0x12: Acknowledge the selected timer's expiration
+ *
+ * Reading the control port returns the status byte (see STATUS_* bits).
+ * Reading the data port returns the lowest expired timer id and
+ * acknowledges it, or NO_TIMER if none has expired.
+ *
+ * Virtual timers count CPU cycles from the VirtualClock, so they are exact
+ * and deterministic; host timers follow the host monotonic clock. Each kind
+ * lives in a TimerWheel, so arming, cancelling and expiring are O(1) no
+ * matter how many timers are active, and a guest sitting in WAIT skips
+ * straight to the next virtual deadline instead of spinning.
+ */
+class TimerDevice : public VirtualDevice {
+public:
+    static constexpr uint8_t DEFAULT_DATA_PORT = 0x0D;
+    static constexpr uint8_t DEFAULT_CTRL_PORT = 0x0E;
+    static constexpr unsigned MAX_TIMERS = 255;
+    static constexpr uint8_t NO_TIMER = 0xFF;
+
+    // Commands
+    static constexpr uint8_t CMD_SELECT_TIMER = 0x00;
+    static constexpr uint8_t CMD_SELECT_INTERVAL = 0x01;
+    static constexpr uint8_t CMD_SELECT_MODE = 0x02;
+    static constexpr uint8_t CMD_ARM = 0x10;
+    static constexpr uint8_t CMD_CANCEL = 0x11;
+    static constexpr uint8_t CMD_ACK = 0x12;
+
+    // Mode bits
+    static constexpr uint8_t MODE_PERIODIC = 0x01;
+    static constexpr uint8_t MODE_HOST_CLOCK = 0x02;
+    static constexpr uint8_t MODE_IRQ = 0x04;  // Raise InterruptController::IRQ_TIMER on expiry
+
+    // Status bits
+    static constexpr uint8_t STATUS_EXPIRED = 0x01;  // At least one timer has expired
+    static constexpr uint8_t STATUS_ARMED = 0x02;    // The selected timer is armed
+
+    /**
+     * Facade registered at the data port; forwards to the owning control port
+     */
+    class DataPort : public VirtualDevice {
+    public:
+        explicit DataPort(TimerDevice* owner) : owner(owner) {}
+
+        uint8_t read() override {
+            return owner ? owner->popExpired() : NO_TIMER;
+        }
+
+        void write(uint8_t value) override {
+            if (owner) owner->writeData(value);
+        }
+
+        std::string getName() const override {
+            return "Timer (data)";
+        }
+
+        void reset() override {}
+
+    private:
+        friend class TimerDevice;
+        TimerDevice* owner;
+    };
+
+    TimerDevice() : dataPort_(std::make_shared<DataPort>(this)) {
+        reset();
+    }
+
+    ~TimerDevice() override {
+        dataPort_->owner = nullptr;
+    }
+
+    uint8_t read() override {
+        uint8_t value = expiredCount > 0 ? STATUS_EXPIRED : 0;
+        if (selected < MAX_TIMERS && timers[selected].armed) {
+            value |= STATUS_ARMED;
+        }
+        return value;
+    }
+
+    void write(uint8_t value) override {
+        switch (value) {
+            case CMD_SELECT_TIMER:
+            case CMD_SELECT_INTERVAL:
+            case CMD_SELECT_MODE:
+                selectedRegister = value;
+                byteIndex = 0;
+                break;
+            case CMD_ARM:
+                arm(selected, pendingInterval, pendingMode);
+                break;
+            case CMD_CANCEL:
+                cancel(selected);
+                break;
+            case CMD_ACK:
+                acknowledge(selected);
+                break;
+            default:
+                Logger::instance().warn() << fmt::format(
+                    "Timer: Unknown control command 0x{:02X}", value
+                ) << std::endl;
+                break;
+        }
+    }
+
+    std::string getName() const override {
+        return "Timer";
+    }
+
+    void reset() override {
+        for (auto& timer : timers) {
+            timer.armed = false;
+            timer.expired = false;
+            timer.expirations = 0;
+        }
+        expiredCount = 0;
+        armedHostTimers = 0;
+        virtualWheel.clear(VirtualClock::instance().now());
+        hostEpoch = std::chrono::steady_clock::now();
+        hostWheel.clear(0);
+        selectedRegister = CMD_SELECT_TIMER;
+        byteIndex = 0;
+        selected = 0;
+        pendingInterval = 0;
+        pendingMode = 0;
+    }
+
+    // Armed virtual timers keep the time they had left; host timers are unaffected
+    void clockReset(uint64_t previous) override {
+        virtualWheel.clear(0);
+        for (unsigned id = 0; id < MAX_TIMERS; ++id) {
+            Timer& timer = timers[id];
+            if (!timer.armed || (timer.mode & MODE_HOST_CLOCK)) {
+                continue;
+            }
+            timer.deadline = timer.deadline > previous ? timer.deadline - previous : 0;
+            virtualWheel.schedule(timer.deadline, id, timer.generation);
+        }
+        if (!virtualWheel.empty()) {
+            VirtualClock::instance().requestTickAt(virtualWheel.nextExpiry());
+        }
+    }
+
+    bool isTicking() const override {
+        return true;
+    }
+
+    void tick(uint64_t cycles) override {
+        (void)cycles;
+        auto& clock = VirtualClock::instance();
+        virtualWheel.advance(clock.now(), [this](const TimerWheel::Entry& entry) { fire(entry, false); });
+        if (!virtualWheel.empty()) {
+            clock.requestTickAt(virtualWheel.nextExpiry());
+        }
+
+        // One host clock read per batch, and none at all without host timers
+        if (armedHostTimers == 0) {
+            hostWheel.clear(hostWheel.now());  // Anything left is cancelled
+            return;
+        }
+        hostNow = hostMicros();
+        hostWheel.advance(hostNow, [this](const TimerWheel::Entry& entry) { fire(entry, true); });
+        if (!hostWheel.empty()) {
+            clock.requestHostWakeAt(hostEpoch + std::chrono::microseconds(hostWheel.nextExpiry()));
+        }
+    }
+
+    /**
+     * Get the device to register at the data port
+     */
+    std::shared_ptr<DataPort> dataPort() const {
+        return dataPort_;
+    }
+
+    /**
+     * Arm a timer from the host side (equivalent to the guest's port writes)
+     * @param id The timer to arm (0-254); an armed timer is restarted
+     * @param interval Cycles, or microseconds with MODE_HOST_CLOCK; 0 is treated as 1
+     * @param mode A combination of MODE_* bits
+     */
+    void arm(uint8_t id, uint32_t interval, uint8_t mode) {
+        if (id >= MAX_TIMERS) {
+            Logger::instance().warn() << fmt::format("Timer: No timer {}", id) << std::endl;
+            return;
+        }
+        cancel(id);
+        Timer& timer = timers[id];
+        timer.interval = interval == 0 ? 1 : interval;
+        timer.mode = mode;
+        timer.armed = true;
+
+        if (mode & MODE_HOST_CLOCK) {
+            ++armedHostTimers;
+            timer.deadline = hostMicros() + timer.interval;
+            hostWheel.schedule(timer.deadline, id, timer.generation);
+            VirtualClock::instance().requestHostWakeAt(hostEpoch + std::chrono::microseconds(timer.deadline));
+        } else {
+            timer.deadline = VirtualClock::instance().now() + timer.interval;
+            virtualWheel.schedule(timer.deadline, id, timer.generation);
+            VirtualClock::instance().requestTickAt(timer.deadline);
+        }
+    }
+
+    /**
+     * Disarm a timer; its wheel entry is dropped lazily when it comes due
+     */
+    void cancel(uint8_t id) {
+        if (id >= MAX_TIMERS || !timers[id].armed) {
+            return;
+        }
+        Timer& timer = timers[id];
+        timer.armed = false;
+        ++timer.generation;
+        if (timer.mode & MODE_HOST_CLOCK) {
+            --armedHostTimers;
+        }
+    }
+
+    void acknowledge(uint8_t id) {
+        if (id < MAX_TIMERS && timers[id].expired) {
+            timers[id].expired = false;
+            --expiredCount;
+        }
+    }
+
+    /**
+     * Take the lowest expired timer id
+     * @return The timer id, or NO_TIMER if none has expired
+     */
+    uint8_t popExpired() {
+        if (expiredCount == 0) {
+            return NO_TIMER;
+        }
+        for (unsigned id = 0; id < MAX_TIMERS; ++id) {
+            if (timers[id].expired) {
+                acknowledge(static_cast<uint8_t>(id));
+                return static_cast<uint8_t>(id);
+            }
+        }
+        return NO_TIMER;
+    }
+
+    bool isArmed(uint8_t id) const {
+        return id < MAX_TIMERS && timers[id].armed;
+    }
+
+    /**
+     * Total expirations of a timer since reset, including periods a host timer missed
+     */
+    uint64_t getExpirations(uint8_t id) const {
+        return id < MAX_TIMERS ? timers[id].expirations : 0;
+    }
+
+private:
+    struct Timer {
+        uint64_t deadline = 0;
+        uint64_t expirations = 0;
+        uint32_t interval = 0;
+        uint32_t generation = 0;
+        uint8_t mode = 0;
+        bool armed = false;
+        bool expired = false;
+    };
+
+    void fire(const TimerWheel::Entry& entry, bool host) {
+        Timer& timer = timers[entry.id];
+        if (!timer.armed || timer.generation != entry.generation) {
+            return;  // Cancelled or re-armed since this entry was scheduled
+        }
+
+        uint64_t periods = 1;
+        if (timer.mode & MODE_PERIODIC) {
+            // Reschedule from the old deadline so periods don't drift
+            timer.deadline += timer.interval;
+            if (host && timer.deadline <= hostNow) {
+                // The host fell behind; fold the missed periods into one expiry
+                uint64_t missed = (hostNow - timer.deadline) / timer.interval + 1;
+                periods += missed;
+                timer.deadline += missed * timer.interval;
+            }
+            (host ? hostWheel : virtualWheel).schedule(timer.deadline, entry.id, timer.generation);
+        } else {
+            timer.armed = false;
+            if (host) {
+                --armedHostTimers;
+            }
+        }
+
+        timer.expirations += periods;
+        if (!timer.expired) {
+            timer.expired = true;
+            ++expiredCount;
+        }
+        if (timer.mode & MODE_IRQ) {
+            InterruptController::instance().raise(InterruptController::IRQ_TIMER);
+        }
+    }
+
+    void writeData(uint8_t value) {
+        switch (selectedRegister) {
+            case CMD_SELECT_TIMER:
+                selected = value;
+                break;
+            case CMD_SELECT_MODE:
+                pendingMode = value;
+                break;
+            case CMD_SELECT_INTERVAL: {
+                uint32_t shift = 8 * byteIndex;
+                uint32_t base = byteIndex == 0 ? 0 : pendingInterval;
+                pendingInterval = base | (static_cast<uint32_t>(value) << shift);
+                byteIndex = (byteIndex + 1) & 3;
+                break;
+            }
+        }
+    }
+
+    uint64_t hostMicros() const {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - hostEpoch).count());
+    }
+
+    std::array<Timer, MAX_TIMERS> timers;
+    TimerWheel virtualWheel;
+    TimerWheel hostWheel;  // Keyed by microseconds since hostEpoch
+    std::chrono::steady_clock::time_point hostEpoch;
+    uint64_t hostNow = 0;
+    unsigned expiredCount = 0;
+    unsigned armedHostTimers = 0;
+
+    std::shared_ptr<DataPort> dataPort_;
+    uint8_t selectedRegister = CMD_SELECT_TIMER;
+    uint8_t byteIndex = 0;
+    uint8_t selected = 0;
+    uint32_t pendingInterval = 0;
+    uint8_t pendingMode = 0;
+};
+
+} // namespace vhw
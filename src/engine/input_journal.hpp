@@ -0,0 +1,282 @@
+#pragma once
+
+#include "interrupt_controller.hpp"
+#include "virtual_clock.hpp"
+#include "../debug/logger.hpp"
+
+#include <fmt/format.h>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using Logging::Logger;
+
+namespace vhw {
+
+/**
+ * Journal of everything nondeterministic the guest observes, for record/replay
+ *
+ * In record mode every value a device returns to the guest is appended
+ * together with the virtual cycle at which it was read, and so is every
+ * interrupt the CPU takes. Since the clock only advances as instructions
+ * retire, those two streams are all that varies between runs of the same
+ * program.
+ *
+ * In replay mode port reads are answered from the journal without touching
+ * the devices, device interrupts are ignored and the recorded ones are
+ * injected at their original cycle, so a captured workload runs again
+ * bit-for-bit at full interpreter speed. A read that does not match the
+ * journal (different port or cycle) is reported once as a divergence.
+ *
+ * File format: "DJNL", a 16-bit version, then one event per read or
+ * interrupt: a kind byte, the cycle delta since the previous event as a
+ * LEB128 varint, and the port and value (reads) or line (interrupts). A
+ * typical event takes four bytes.
+ *
+ * Only the CPU thread records or replays.
+ */
+class InputJournal {
+public:
+    enum class Mode { Off, Record, Replay };
+
+    static constexpr uint16_t VERSION = 1;
+
+    static InputJournal& instance() {
+        static InputJournal instance;
+        return instance;
+    }
+
+    /**
+     * Start recording into a file (truncating it)
+     * @return false if the file cannot be created
+     */
+    bool startRecording(const std::string& path) {
+        stop();
+        out.open(path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            Logger::instance().error() << fmt::format("Cannot create input journal: {}", path) << std::endl;
+            return false;
+        }
+        out.write(MAGIC, sizeof(MAGIC));
+        putByte(static_cast<uint8_t>(VERSION));
+        putByte(static_cast<uint8_t>(VERSION >> 8));
+        lastCycle = VirtualClock::instance().now();
+        mode = Mode::Record;
+        return true;
+    }
+
+    /**
+     * Load a journal and start replaying it
+     * The clock should be at the cycle recording started from (normally 0).
+     * @return false if the file is missing or not a journal
+     */
+    bool startReplay(const std::string& path) {
+        stop();
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            Logger::instance().error() << fmt::format("Cannot open input journal: {}", path) << std::endl;
+            return false;
+        }
+        std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (!load(bytes)) {
+            reads.clear();
+            interrupts.clear();
+            Logger::instance().error() << fmt::format("Not an input journal: {}", path) << std::endl;
+            return false;
+        }
+        mode = Mode::Replay;
+        InterruptController::instance().setReplaying(true);
+        scheduleInterrupt();
+        return true;
+    }
+
+    /**
+     * Finish recording (flushing the file) or replaying
+     */
+    void stop() {
+        if (out.is_open()) {
+            out.close();
+        }
+        if (mode == Mode::Replay) {
+            InterruptController::instance().setReplaying(false);
+        }
+        mode = Mode::Off;
+        reads.clear();
+        interrupts.clear();
+        nextRead = 0;
+        nextInterrupt = 0;
+        diverged = false;
+    }
+
+    Mode getMode() const { return mode; }
+    bool isRecording() const { return mode == Mode::Record; }
+    bool isReplaying() const { return mode == Mode::Replay; }
+
+    /**
+     * Record a value a device returned to the guest
+     */
+    void recordRead(uint8_t port, uint8_t value) {
+        putEvent(EVENT_READ);
+        putByte(port);
+        putByte(value);
+    }
+
+    /**
+     * Record an interrupt the CPU is about to take
+     */
+    void recordInterrupt(uint8_t line) {
+        putEvent(EVENT_INTERRUPT);
+        putByte(line);
+    }
+
+    /**
+     * Answer a port read from the journal
+     * @return The recorded value, or 0 once replay has diverged or run out
+     */
+    uint8_t replayRead(uint8_t port) {
+        if (diverged) {
+            return 0;
+        }
+        uint64_t now = VirtualClock::instance().now();
+        if (nextRead == reads.size()) {
+            diverge(fmt::format("read from port {} at cycle {} past the end of the journal", port, now));
+            return 0;
+        }
+        const Read& read = reads[nextRead];
+        if (read.port != port || read.cycle != now) {
+            diverge(fmt::format("read from port {} at cycle {}, journal has port {} at cycle {}",
+                port, now, read.port, read.cycle));
+            return 0;
+        }
+        ++nextRead;
+        return read.value;
+    }
+
+    /**
+     * Inject recorded interrupts that are due; called on every device tick
+     */
+    void tick() {
+        uint64_t now = VirtualClock::instance().now();
+        auto& controller = InterruptController::instance();
+        while (nextInterrupt < interrupts.size() && interrupts[nextInterrupt].cycle <= now) {
+            controller.inject(interrupts[nextInterrupt].line);
+            ++nextInterrupt;
+        }
+        scheduleInterrupt();
+    }
+
+    /**
+     * End a WAIT by skipping straight to the next recorded interrupt
+     * WAIT retires one more cycle before the CPU polls for interrupts, so the
+     * clock stops one short of the recorded cycle.
+     * @return false if the journal has no interrupts left to wake the guest
+     */
+    bool wakeFromWait() {
+        if (nextInterrupt == interrupts.size()) {
+            return false;
+        }
+        const Interrupt& next = interrupts[nextInterrupt++];
+        VirtualClock::instance().skipTo(next.cycle > 0 ? next.cycle - 1 : 0);
+        InterruptController::instance().inject(next.line);
+        return true;
+    }
+
+    bool hasDiverged() const { return diverged; }
+    size_t readsReplayed() const { return nextRead; }
+    size_t readsRecorded() const { return reads.size(); }
+
+private:
+    static constexpr char MAGIC[4] = {'D', 'J', 'N', 'L'};
+    static constexpr uint8_t EVENT_READ = 0;
+    static constexpr uint8_t EVENT_INTERRUPT = 1;
+
+    struct Read {
+        uint64_t cycle;
+        uint8_t port;
+        uint8_t value;
+    };
+
+    struct Interrupt {
+        uint64_t cycle;
+        uint8_t line;
+    };
+
+    InputJournal() = default;
+    InputJournal(const InputJournal&) = delete;
+    InputJournal& operator=(const InputJournal&) = delete;
+
+    void putByte(uint8_t value) {
+        out.put(static_cast<char>(value));
+    }
+
+    void putEvent(uint8_t kind) {
+        uint64_t now = VirtualClock::instance().now();
+        uint64_t delta = now - lastCycle;
+        lastCycle = now;
+        putByte(kind);
+        do {
+            uint8_t byte = delta & 0x7F;
+            delta >>= 7;
+            putByte(delta ? (byte | 0x80) : byte);
+        } while (delta);
+    }
+
+    bool load(const std::vector<uint8_t>& bytes) {
+        if (bytes.size() < sizeof(MAGIC) + 2 || std::memcmp(bytes.data(), MAGIC, sizeof(MAGIC)) != 0
+            || (bytes[4] | (bytes[5] << 8)) != VERSION) {
+            return false;
+        }
+        uint64_t cycle = VirtualClock::instance().now();
+        size_t pos = sizeof(MAGIC) + 2;
+        while (pos < bytes.size()) {
+            uint8_t kind = bytes[pos++];
+            uint64_t delta = 0;
+            for (unsigned shift = 0; ; shift += 7) {
+                if (pos == bytes.size() || shift > 63) return false;
+                uint8_t byte = bytes[pos++];
+                delta |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) break;
+            }
+            cycle += delta;
+            if (kind == EVENT_READ && pos + 2 <= bytes.size()) {
+                reads.push_back({cycle, bytes[pos], bytes[pos + 1]});
+                pos += 2;
+            } else if (kind == EVENT_INTERRUPT && pos + 1 <= bytes.size()) {
+                interrupts.push_back({cycle, bytes[pos]});
+                pos += 1;
+            } else {
+                return false;  // Unknown event or truncated file
+            }
+        }
+        return true;
+    }
+
+    void scheduleInterrupt() {
+        if (nextInterrupt < interrupts.size()) {
+            VirtualClock::instance().requestTickAt(interrupts[nextInterrupt].cycle);
+        }
+    }
+
+    void diverge(const std::string& what) {
+        diverged = true;
+        Logger::instance().error() << "Replay diverged from the journal: " << what << std::endl;
+    }
+
+    Mode mode = Mode::Off;
+
+    // Record state
+    std::ofstream out;
+    uint64_t lastCycle = 0;
+
+    // Replay state
+    std::vector<Read> reads;
+    std::vector<Interrupt> interrupts;
+    size_t nextRead = 0;
+    size_t nextInterrupt = 0;
+    bool diverged = false;
+};
+
+} // namespace vhw
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+namespace vhw {
+
+/**
+ * Programmable interrupt controller shared by all devices and the CPU
+ *
+ * Devices raise one of eight interrupt lines from any thread. The CPU checks
+ * a single pending word between instructions and, when interrupts are
+ * enabled, vectors to the guest handler whose 32-bit address is stored at
+ * vectorBase + 4 * line. Lower line numbers have higher priority.
+ *
+ * The mask, vector base and in-service bits are only touched from the CPU
+ * thread (through the PIC ports), so only the pending word is atomic.
+ */
+class InterruptController {
+public:
+    static constexpr uint8_t LINE_COUNT = 8;
+
+    // Interrupt line assignments
+    static constexpr uint8_t IRQ_TIMER = 0;
+    static constexpr uint8_t IRQ_CONSOLE = 1;
+    static constexpr uint8_t IRQ_SERIAL = 2;
+    static constexpr uint8_t IRQ_DMA = 3;
+    static constexpr uint8_t IRQ_STORAGE = 4;
+
+    static InterruptController& instance() {
+        static InterruptController instance;
+        return instance;
+    }
+
+    /**
+     * Raise an interrupt line (safe to call from device worker threads)
+     * Ignored while replaying an input journal, which injects the recorded interrupts instead.
+     * @param line The line to raise (0-7)
+     */
+    void raise(uint8_t line) {
+        if (replaying.load(std::memory_order_relaxed)) {
+            return;
+        }
+        inject(line);
+    }
+
+    /**
+     * Raise an interrupt line even while replaying
+     * @param line The line to raise (0-7)
+     */
+    void inject(uint8_t line) {
+        if (line >= LINE_COUNT) {
+            return;
+        }
+        pending.fetch_or(1u << line, std::memory_order_release);
+        {
+            // Pairs with the predicate check in waitForInterrupt()
+            std::lock_guard<std::mutex> lock(waitMutex);
+        }
+        waitCv.notify_all();
+    }
+
+    /**
+     * Get the lines that are raised, unmasked and not already in service
+     */
+    uint8_t deliverable() const {
+        return static_cast<uint8_t>(pending.load(std::memory_order_acquire)) & ~(mask | inService);
+    }
+
+    /**
+     * Take the highest priority deliverable line and mark it in service
+     * @return The line number, or -1 if nothing is deliverable
+     */
+    int acknowledge() {
+        uint8_t ready = deliverable();
+        if (ready == 0) {
+            return -1;
+        }
+        int line = __builtin_ctz(ready);
+        pending.fetch_and(~(1u << line), std::memory_order_acq_rel);
+        inService |= static_cast<uint8_t>(1u << line);
+        return line;
+    }
+
+    /**
+     * End of interrupt: clear the highest priority in-service line
+     */
+    void endOfInterrupt() {
+        inService &= static_cast<uint8_t>(inService - 1);
+    }
+
+    /**
+     * Park the calling thread until an interrupt becomes deliverable
+     */
+    void waitForInterrupt() {
+        std::unique_lock<std::mutex> lock(waitMutex);
+        waitCv.wait(lock, [this] { return deliverable() != 0; });
+    }
+
+    /**
+     * Park the calling thread until an interrupt becomes deliverable or the deadline passes
+     * @return true if an interrupt is deliverable
+     */
+    bool waitForInterruptUntil(std::chrono::steady_clock::time_point deadline) {
+        std::unique_lock<std::mutex> lock(waitMutex);
+        return waitCv.wait_until(lock, deadline, [this] { return deliverable() != 0; });
+    }
+
+    /**
+     * Check whether any line could still be delivered (i.e. not all masked or in service)
+     */
+    bool canDeliver() const {
+        return static_cast<uint8_t>(mask | inService) != 0xFF;
+    }
+
+    uint8_t getPending() const { return static_cast<uint8_t>(pending.load(std::memory_order_acquire)); }
+    uint8_t getMask() const { return mask; }
+    void setMask(uint8_t value) { mask = value; }
+    uint8_t getInService() const { return inService; }
+    uint32_t getVectorBase() const { return vectorBase; }
+    void setVectorBase(uint32_t value) { vectorBase = value; }
+    void setReplaying(bool enabled) { replaying.store(enabled, std::memory_order_relaxed); }
+
+    void reset() {
+        pending.store(0, std::memory_order_release);
+        mask = 0;
+        inService = 0;
+        vectorBase = 0;
+    }
+
+private:
+    InterruptController() = default;
+    InterruptController(const InterruptController&) = delete;
+    InterruptController& operator=(const InterruptController&) = delete;
+
+    std::atomic<uint32_t> pending{0};
+    std::atomic<bool> replaying{false};
+    uint8_t mask = 0;
+    uint8_t inService = 0;
+    uint32_t vectorBase = 0;
+
+    std::mutex waitMutex;
+    std::condition_variable waitCv;
+};
+
+} // namespace vhw
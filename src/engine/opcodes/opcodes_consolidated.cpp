@@ -8,6 +8,7 @@
 #include "../../assembler/opcodes.hpp"
 #include "../../debug/logger.hpp"
 #include <fmt/core.h>
+#include <chrono>
 #include <iomanip>
 
 using Logging::Logger;
@@ -16,6 +17,7 @@ using Logging::Logger;
 #include "add.hpp"
 #include "and.hpp"
 #include "call.hpp"
+#include "cli.hpp"
 #include "cmp.hpp"
 #include "db.hpp"
 #include "dec.hpp"
@@ -27,6 +29,7 @@ using Logging::Logger;
 #include "inl.hpp"
 #include "instr.hpp"
 #include "inw.hpp"
+#include "iret.hpp"
 #include "jmp.hpp"
 #include "jns.hpp"
 #include "jnz.hpp"
@@ -59,9 +62,11 @@ using Logging::Logger;
 #include "ret.hpp"
 #include "shl.hpp"
 #include "shr.hpp"
+#include "sti.hpp"
 #include "store.hpp"
 #include "sub.hpp"
 #include "swap.hpp"
+#include "wait.hpp"
 #include "xor.hpp"
 
 // Extended 64-bit register operation headers
@@ -213,6 +218,7 @@ void handle_db(CPU& cpu, const std::vector<uint8_t>& program, bool& running) {
         // Copy data bytes to memory starting at target_addr
         for (uint8_t i = 0; i < length && (pc + 3 + i) < program.size() && (target_addr + i) < cpu.get_memory().size(); ++i) {
             cpu.get_memory()[target_addr + i] = program[pc + 3 + i];
+            cpu.note_store(target_addr + i, program[pc + 3 + i]);
 
             Logger::instance().debug() << fmt::format(
                 "[PC=0x{:04X}] [DB] memory[0x{:02X}] = 0x{:02X} ('{}')",
@@ -280,6 +286,102 @@ void handle_halt(CPU& cpu, [[maybe_unused]] const std::vector<uint8_t>& program,
     cpu.print_state("HALT");
 }
 
+// Implementation for IRET opcode - return from interrupt handler
+void handle_iret(CPU& cpu, [[maybe_unused]] const std::vector<uint8_t>& program, [[maybe_unused]] bool& running) {
+    uint32_t sp = cpu.get_sp();
+
+    // Frame pushed on interrupt entry: SP = return address, SP+4 = flags
+    uint32_t ret_addr = cpu.read_mem32(sp);
+    uint32_t flags = cpu.read_mem32(sp + 4);
+    cpu.set_sp(sp + 8);
+
+    Logger::instance().debug() << fmt::format(
+        "[PC=0x{:04X}] [IRET] Returning to 0x{:04X}, FLAGS={:08X}",
+        cpu.get_pc(), ret_addr, flags
+    ) << std::endl;
+
+    cpu.set_flags(flags & ~FLAG_INTERRUPT);
+    cpu.set_interrupts_enabled((flags & FLAG_INTERRUPT) != 0);
+    cpu.set_pc(ret_addr);
+    cpu.print_state("IRET");
+}
+
+// Implementation for STI opcode - enable interrupts
+void handle_sti(CPU& cpu, [[maybe_unused]] const std::vector<uint8_t>& program, [[maybe_unused]] bool& running) {
+    Logger::instance().debug() << fmt::format("[PC=0x{:04X}] [STI] Interrupts enabled", cpu.get_pc()) << std::endl;
+    cpu.set_interrupts_enabled(true);
+    cpu.set_pc(cpu.get_pc() + 1);
+    cpu.print_state("STI");
+}
+
+// Implementation for CLI opcode - disable interrupts
+void handle_cli(CPU& cpu, [[maybe_unused]] const std::vector<uint8_t>& program, [[maybe_unused]] bool& running) {
+    Logger::instance().debug() << fmt::format("[PC=0x{:04X}] [CLI] Interrupts disabled", cpu.get_pc()) << std::endl;
+    cpu.set_interrupts_enabled(false);
+    cpu.set_pc(cpu.get_pc() + 1);
+    cpu.print_state("CLI");
+}
+
+// Implementation for WAIT opcode - park the host thread until an interrupt arrives
+// How often WAIT rechecks devices that might still interrupt from a host thread
+constexpr auto WAIT_POLL_INTERVAL = std::chrono::milliseconds(10);
+
+void handle_wait(CPU& cpu, [[maybe_unused]] const std::vector<uint8_t>& program, bool& running) {
+    auto& controller = vhw::InterruptController::instance();
+
+    // Nothing could ever wake us; fail loudly instead of hanging the host
+    if (!cpu.get_interrupts_enabled() || !controller.canDeliver()) {
+        Logger::instance().error() << fmt::format(
+            "WAIT │ Interrupts are disabled or all lines masked, would never resume at PC={}",
+            cpu.get_pc()
+        ) << std::endl;
+        running = false;
+        return;
+    }
+
+    Logger::instance().debug() << fmt::format("[PC=0x{:04X}] [WAIT] Waiting for interrupt", cpu.get_pc()) << std::endl;
+
+    // Bring devices up to date, then let idle time pass without executing anything:
+    // virtual deadlines are skipped to directly, host deadlines bound the sleep
+    auto& clock = vhw::VirtualClock::instance();
+    auto& devices = vhw::DeviceManager::instance();
+    auto& journal = vhw::InputJournal::instance();
+    devices.tickDevices();
+    while (controller.deliverable() == 0) {
+        if (journal.isReplaying()) {
+            // Device interrupts are ignored during replay; jump to the recorded one
+            if (!journal.wakeFromWait()) {
+                Logger::instance().error() << fmt::format(
+                    "WAIT │ Input journal has no interrupts left to resume PC={}", cpu.get_pc()
+                ) << std::endl;
+                running = false;
+                return;
+            }
+            devices.tickDevices();
+        } else if (clock.nextDeadline() != vhw::VirtualClock::NO_DEADLINE) {
+            clock.skipTo(clock.nextDeadline());
+            devices.tickDevices();
+        } else if (clock.hasHostWake()) {
+            controller.waitForInterruptUntil(clock.getHostWake());
+            devices.tickDevices();
+        } else if (devices.interruptsPossible()) {
+            // Only a host thread can wake us now; look again now and then in
+            // case its transfer finishes without raising anything
+            controller.waitForInterruptUntil(std::chrono::steady_clock::now() + WAIT_POLL_INTERVAL);
+            devices.tickDevices();
+        } else {
+            Logger::instance().error() << fmt::format(
+                "WAIT │ No timer armed and no device can raise an interrupt, would never resume at PC={}",
+                cpu.get_pc()
+            ) << std::endl;
+            running = false;
+            return;
+        }
+    }
+    cpu.set_pc(cpu.get_pc() + 1);
+    cpu.print_state("WAIT");
+}
+
 // Implementation from inb.cpp
 void handle_inb(CPU& cpu, const std::vector<uint8_t>& program, bool& running) {
     uint32_t pc = cpu.get_pc();
@@ -1040,6 +1142,7 @@ void handle_store(CPU& cpu, const std::vector<uint8_t>& program, bool& running)
         uint8_t addr = program[cpu.get_pc() + 2];
         if (reg < cpu.get_registers().size() && addr < cpu.get_memory().size()) {
             cpu.get_memory()[addr] = cpu.get_registers()[reg];
+            cpu.note_store(addr, cpu.get_memory()[addr]);
         }
         cpu.set_pc(cpu.get_pc() + 3);
     } else {
@@ -1102,6 +1205,7 @@ void handle_swap(CPU& cpu, const std::vector<uint8_t>& program, bool& running) {
             uint32_t temp = cpu.get_registers()[reg];
             cpu.get_registers()[reg] = cpu.get_memory()[addr];
             cpu.get_memory()[addr] = temp;
+            cpu.note_store(addr, cpu.get_memory()[addr]);
             Logger::instance().debug() << fmt::format("[PC=0x{:04X}] [SWAP] R{} = {}, memory[{}] = {}", cpu.get_pc(), reg, cpu.get_registers()[reg], addr, cpu.get_memory()[addr]) << std::endl;
         }
         cpu.set_pc(cpu.get_pc() + 3);
@@ -1417,6 +1521,18 @@ void dispatch_opcode(CPU& cpu, const std::vector<uint8_t>& program, bool& runnin
         case Opcode::HALT:
             handle_halt(cpu, program, running);
             break;
+        case Opcode::IRET:
+            handle_iret(cpu, program, running);
+            break;
+        case Opcode::STI:
+            handle_sti(cpu, program, running);
+            break;
+        case Opcode::CLI:
+            handle_cli(cpu, program, running);
+            break;
+        case Opcode::WAIT:
+            handle_wait(cpu, program, running);
+            break;
         case Opcode::AND:
             handle_and(cpu, program, running);
             break;
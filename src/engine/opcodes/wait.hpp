@@ -0,0 +1,4 @@
+#pragma once
+#include "opcode_handler.hpp"
+
+void handle_wait(CPU& cpu, const std::vector<uint8_t>& program, bool& running);
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace vhw {
+
+/**
+ * Bounded single-producer/single-consumer lock-free ring buffer
+ *
+ * Exactly one thread may call the producer side (push/pushBulk) and exactly
+ * one other thread the consumer side (pop/clear). Capacity must be a power of
+ * two; one slot is not wasted since head/tail are free-running counters.
+ */
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+
+public:
+    static constexpr size_t CAPACITY = Capacity;
+
+    /**
+     * Producer: append one element
+     * @return false if the ring is full
+     */
+    bool push(const T& value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head - cachedTail_ == Capacity) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (head - cachedTail_ == Capacity) {
+                return false;
+            }
+        }
+        slots_[head & MASK] = value;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Producer: append up to count elements with a single publish
+     * @return The number of elements actually appended
+     */
+    size_t pushBulk(const T* values, size_t count) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t space = Capacity - (head - cachedTail_);
+        if (space < count) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            space = Capacity - (head - cachedTail_);
+        }
+        size_t n = count < space ? count : space;
+        for (size_t i = 0; i < n; ++i) {
+            slots_[(head + i) & MASK] = values[i];
+        }
+        head_.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    /**
+     * Consumer: remove the oldest element
+     * @return false if the ring is empty
+     */
+    bool pop(T& out) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == cachedHead_) {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if (tail == cachedHead_) {
+                return false;
+            }
+        }
+        out = slots_[tail & MASK];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Consumer: drop everything currently queued
+     */
+    void clear() {
+        cachedHead_ = head_.load(std::memory_order_acquire);
+        tail_.store(cachedHead_, std::memory_order_release);
+    }
+
+    /**
+     * Approximate number of queued elements (exact when called from either side while the other is idle)
+     */
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+private:
+    static constexpr size_t MASK = Capacity - 1;
+    static constexpr size_t CACHE_LINE = 64;
+
+    // Producer-owned line: head plus its cached view of tail
+    alignas(CACHE_LINE) std::atomic<size_t> head_{0};
+    size_t cachedTail_ = 0;
+
+    // Consumer-owned line: tail plus its cached view of head
+    alignas(CACHE_LINE) std::atomic<size_t> tail_{0};
+    size_t cachedHead_ = 0;
+
+    alignas(CACHE_LINE) std::array<T, Capacity> slots_{};
+};
+
+} // namespace vhw
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <array>
+#include <utility>
+
+namespace vhw {
+
+/**
+ * Hierarchical timer wheel keyed by absolute 64-bit times
+ *
+ * Four levels of 64 slots cover 2^24 time units ahead of the current time;
+ * anything further out waits in an overflow list. An entry in level L
+ * shares all bits above 6 * (L + 1) with the current time, so when time
+ * reaches the start of its slot it is cascaded one level down, and level 0
+ * slots hold entries that expire exactly at that time. Scheduling is O(1)
+ * and advancing jumps straight to the next occupied slot, so long idle
+ * stretches cost nothing.
+ *
+ * Entries carry a caller-defined id and generation; cancelling is done by
+ * the caller bumping its generation and ignoring stale expirations.
+ */
+class TimerWheel {
+public:
+    static constexpr unsigned LEVELS = 4;
+    static constexpr unsigned SLOT_BITS = 6;
+    static constexpr unsigned SLOTS = 1u << SLOT_BITS;
+    static constexpr uint64_t NONE = UINT64_MAX;
+
+    struct Entry {
+        uint64_t deadline;
+        uint32_t id;
+        uint32_t generation;
+    };
+
+    /**
+     * Add an entry; deadlines at or before the current time fire on the next advance()
+     */
+    void schedule(uint64_t deadline, uint32_t id, uint32_t generation) {
+        insert({deadline, id, generation});
+        ++count;
+    }
+
+    /**
+     * Move time forward to now, calling fire(entry) for every expired entry in deadline order
+     * fire may schedule new entries (e.g. to re-arm periodic timers).
+     */
+    template <typename Fn>
+    void advance(uint64_t now, Fn&& fire) {
+        fireList(due, fire);
+        if (now < current) {
+            return;
+        }
+        while (true) {
+            fireList(levels[0][current & (SLOTS - 1)], fire);
+            uint64_t next = nextStop();
+            if (next == NONE || next > now) {
+                current = now;
+                return;
+            }
+            current = next;
+            cascade();
+        }
+    }
+
+    /**
+     * Earliest time at which advance() may have work to do (a lower bound
+     * on the next expiry), or NONE if the wheel is empty
+     */
+    uint64_t nextExpiry() const {
+        if (!due.empty()) {
+            return current;
+        }
+        if (!levels[0][current & (SLOTS - 1)].empty()) {
+            return current;
+        }
+        return nextStop();
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    /**
+     * Number of scheduled entries, including stale ones not yet expired
+     */
+    size_t size() const {
+        return count;
+    }
+
+    uint64_t now() const {
+        return current;
+    }
+
+    void clear(uint64_t time = 0) {
+        for (auto& level : levels) {
+            for (auto& slot : level) slot.clear();
+        }
+        overflow.clear();
+        due.clear();
+        count = 0;
+        current = time;
+    }
+
+private:
+    using Slot = std::vector<Entry>;
+
+    void insert(const Entry& entry) {
+        if (entry.deadline <= current) {
+            due.push_back(entry);
+            return;
+        }
+        for (unsigned level = 0; level < LEVELS; ++level) {
+            unsigned shift = SLOT_BITS * (level + 1);
+            if ((entry.deadline >> shift) == (current >> shift)) {
+                levels[level][(entry.deadline >> (SLOT_BITS * level)) & (SLOTS - 1)].push_back(entry);
+                return;
+            }
+        }
+        overflow.push_back(entry);
+    }
+
+    template <typename Fn>
+    void fireList(Slot& slot, Fn& fire) {
+        if (slot.empty()) {
+            return;
+        }
+        // Swap out first so fire() can schedule into the wheel safely
+        Slot expired;
+        expired.swap(slot);
+        count -= expired.size();
+        for (const Entry& entry : expired) {
+            fire(entry);
+        }
+    }
+
+    // Start of the earliest occupied slot after the current time
+    uint64_t nextStop() const {
+        for (unsigned level = 0; level < LEVELS; ++level) {
+            unsigned shift = SLOT_BITS * level;
+            unsigned index = static_cast<unsigned>((current >> shift) & (SLOTS - 1));
+            for (unsigned slot = index + 1; slot < SLOTS; ++slot) {
+                if (!levels[level][slot].empty()) {
+                    uint64_t blockBase = (current >> (shift + SLOT_BITS)) << (shift + SLOT_BITS);
+                    return blockBase + (static_cast<uint64_t>(slot) << shift);
+                }
+            }
+        }
+        if (!overflow.empty()) {
+            unsigned top = SLOT_BITS * LEVELS;
+            return ((current >> top) + 1) << top;
+        }
+        return NONE;
+    }
+
+    // Called when current lands on a slot start: pull entries down from higher levels
+    void cascade() {
+        unsigned top = SLOT_BITS * LEVELS;
+        if ((current & ((1ull << top) - 1)) == 0 && !overflow.empty()) {
+            Slot pending;
+            pending.swap(overflow);
+            for (const Entry& entry : pending) insert(entry);
+        }
+        for (unsigned level = LEVELS - 1; level >= 1; --level) {
+            unsigned shift = SLOT_BITS * level;
+            if ((current & ((1ull << shift) - 1)) != 0) {
+                continue;
+            }
+            Slot& slot = levels[level][(current >> shift) & (SLOTS - 1)];
+            if (slot.empty()) {
+                continue;
+            }
+            Slot pending;
+            pending.swap(slot);
+            for (const Entry& entry : pending) insert(entry);
+        }
+    }
+
+    std::array<std::array<Slot, SLOTS>, LEVELS> levels;
+    Slot overflow;
+    Slot due;
+    uint64_t current = 0;
+    size_t count = 0;
+};
+
+} // namespace vhw
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+
+namespace vhw {
+
+/**
+ * Virtual time base shared by the CPU and all devices
+ *
+ * Time is measured in cycles and advances only as the CPU retires
+ * instructions (one cycle each), so device timing is deterministic and the
+ * hot loop never reads a host clock. Retired cycles accumulate as pending
+ * time and are handed to DeviceManager::tickDevices() in batches; a batch
+ * ends early when a device has asked to run at a specific cycle, so
+ * deadlines are hit exactly rather than up to a batch late.
+ *
+ * Devices that track host time (e.g. host-clock timers) can also leave a
+ * host wake-up time, which WAIT uses to bound how long it sleeps.
+ *
+ * Only the CPU thread advances the clock or schedules deadlines.
+ */
+class VirtualClock {
+public:
+    static constexpr uint64_t CYCLES_PER_INSTRUCTION = 1;
+    static constexpr uint64_t NOMINAL_HZ = 10'000'000;  // Virtual cycles per simulated second
+    static constexpr uint32_t DEFAULT_BATCH = 256;
+    static constexpr uint64_t NO_DEADLINE = UINT64_MAX;
+
+    static VirtualClock& instance() {
+        static VirtualClock instance;
+        return instance;
+    }
+
+    using HostTime = std::chrono::steady_clock::time_point;
+
+    /**
+     * Current virtual time in cycles, including cycles not yet ticked
+     */
+    uint64_t now() const {
+        return cycles + pending;
+    }
+
+    /**
+     * Account for one retired instruction
+     * @return true when devices are due a tick
+     */
+    bool retire() {
+        pending += CYCLES_PER_INSTRUCTION;
+        return pending >= limit;
+    }
+
+    /**
+     * Account for several instructions retired at once (compiled code)
+     * @return true when devices are due a tick
+     */
+    bool retire(uint64_t instructions) {
+        pending += instructions * CYCLES_PER_INSTRUCTION;
+        return pending >= limit;
+    }
+
+    /**
+     * Instructions that can retire before devices are due a tick
+     */
+    uint64_t budget() const {
+        return pending < limit ? (limit - pending) / CYCLES_PER_INSTRUCTION : 0;
+    }
+
+    /**
+     * Skip idle time forward to the given cycle (no-op if already past it)
+     */
+    void skipTo(uint64_t cycle) {
+        if (cycle > now()) {
+            pending += cycle - now();
+        }
+    }
+
+    uint64_t pendingCycles() const {
+        return pending;
+    }
+
+    /**
+     * Fold pending cycles into the committed time and clear all deadlines;
+     * devices re-request theirs while being ticked
+     * @return The number of cycles committed
+     */
+    uint64_t commit() {
+        uint64_t elapsed = pending;
+        cycles += pending;
+        pending = 0;
+        deadline = NO_DEADLINE;
+        hostWake = HostTime::max();
+        updateLimit();
+        return elapsed;
+    }
+
+    /**
+     * Ask for devices to be ticked no later than the given cycle
+     */
+    void requestTickAt(uint64_t cycle) {
+        deadline = std::min(deadline, std::max(cycle, now() + 1));
+        updateLimit();
+    }
+
+    uint64_t nextDeadline() const {
+        return deadline;
+    }
+
+    /**
+     * Ask for devices to be ticked once the host clock reaches the given time
+     * The CPU still ticks every batch; this only bounds how long WAIT sleeps.
+     */
+    void requestHostWakeAt(HostTime time) {
+        hostWake = std::min(hostWake, time);
+    }
+
+    bool hasHostWake() const {
+        return hostWake != HostTime::max();
+    }
+
+    HostTime getHostWake() const {
+        return hostWake;
+    }
+
+    void setBatchSize(uint32_t size) {
+        batchSize = std::max<uint32_t>(1, size);
+        updateLimit();
+    }
+
+    uint32_t getBatchSize() const {
+        return batchSize;
+    }
+
+    static constexpr uint64_t fromMicroseconds(uint64_t us) {
+        return us * (NOMINAL_HZ / 1'000'000);
+    }
+
+    static constexpr uint64_t toNanoseconds(uint64_t cycleCount) {
+        return cycleCount * (1'000'000'000 / NOMINAL_HZ);
+    }
+
+    void reset() {
+        cycles = 0;
+        pending = 0;
+        deadline = NO_DEADLINE;
+        hostWake = HostTime::max();
+        updateLimit();
+    }
+
+private:
+    VirtualClock() = default;
+    VirtualClock(const VirtualClock&) = delete;
+    VirtualClock& operator=(const VirtualClock&) = delete;
+
+    // Pending cycles that end the current batch
+    void updateLimit() {
+        uint64_t untilDeadline = deadline == NO_DEADLINE ? batchSize : deadline - cycles;
+        limit = std::max<uint64_t>(1, std::min<uint64_t>(batchSize, untilDeadline));
+    }
+
+    uint64_t cycles = 0;   // Time already handed to devices
+    uint64_t pending = 0;  // Retired since the last tick
+    uint64_t deadline = NO_DEADLINE;
+    uint64_t limit = DEFAULT_BATCH;
+    HostTime hostWake = HostTime::max();
+    uint32_t batchSize = DEFAULT_BATCH;
+};
+
+} // namespace vhw
@@ -9,6 +9,7 @@
 #include <sstream>
 #include <chrono>
 #include <memory>
+#include <map>
 
 #if __cplusplus >= 201703L
 namespace fs = std::filesystem;
@@ -20,10 +21,17 @@ namespace fs = std::experimental::filesystem;
 #include "config.hpp"
 #include "engine/cpu.hpp"
 #include "engine/device_factory.hpp"
+#include "engine/input_journal.hpp"
 
 // Include the debug framework
 #include "debug/logger.hpp"
 #include "debug/gui.hpp"
+#include "debug/trace.hpp"
+#include "debug/profiler.hpp"
+#include "debug/instruction_stats.hpp"
+#include "debug/block_profiler.hpp"
+#include "codegen/jit.hpp"
+#include "codegen/aot_compiler.hpp"
 
 // Include the test framework
 #include "test/test.hpp"
@@ -35,11 +43,6 @@ namespace fs = std::experimental::filesystem;
 #include "assembler/parser.hpp"
 #include "assembler/assembler.hpp"
 
-// For POSIX process execution instead of system()
-#include <sys/types.h>
-#include <sys/wait.h>
-#include <unistd.h>
-
 
 using Logging::Logger;
 
@@ -50,6 +53,7 @@ void initialize_devices() {
 
     DeviceManager::instance().reset();  // Reset device manager to clear any previous state
     auto console = DeviceFactory::createConsoleDevice(0x01);  // Console on port 0x01
+    console->setFlushPolicy(ConsoleDevice::parseFlushPolicy(Config::console_flush));
 
     auto counter = DeviceFactory::createCounterDevice(0x02);  // Counter on port 0x02
 
@@ -57,11 +61,33 @@ void initialize_devices() {
     counter->setCounter(42);
 
     // Create a file device for virtual file I/O
-    auto file = DeviceFactory::createFileDevice("virtual_storage/vhd.dat", 0x04);    // Create a RAM disk device for block storage
+    auto file = DeviceFactory::createFileDevice("virtual_storage/vhd.dat", 0x04,
+        Config::mmap_storage ? FileDevice::Mode::Mapped : FileDevice::Mode::Buffered);
+    file->setAsyncIo(&AsyncIo::shared());
+
+    // Create a RAM disk device for block storage
     Logger::instance().debug() << "About to create RAMDisk..." << std::endl;
     auto ramdisk = DeviceFactory::createRamDiskDevice(8192, 0x05, 0x06);
     Logger::instance().debug() << "RAMDisk created successfully" << std::endl;
 
+    // DMA controller for bulk transfers between storage devices and memory
+    auto dma = DeviceFactory::createDmaDevice(0x07, 0x08);
+
+    // Interrupt controller so devices can wake the guest instead of being polled;
+    // away from the low ports the I/O smoke tests write to freely
+    auto pic = DeviceFactory::createPicDevice(0x20, 0x21);
+
+    // Sector-addressed disk; sparse, so the 4GB default costs nothing until written
+    auto disk = (!Config::block_base.empty() && !Config::block_image.empty())
+        ? DeviceFactory::createOverlayBlockDevice(Config::block_image, Config::block_base, 0x0B, 0x0C)
+        : DeviceFactory::createBlockDevice(Config::block_image, 8ull * 1024 * 1024, 0x0B, 0x0C);
+
+    // Let guest compute overlap with host disk I/O
+    disk->setAsyncIo(&AsyncIo::shared());
+
+    // One-shot and periodic timers on virtual or host time
+    auto timer = DeviceFactory::createTimerDevice(0x0D, 0x0E);
+
     // Optionally, create a real serial port device if available
     // Uncomment and modify the port name as needed for your system
     // auto serial = DeviceFactory::createSerialPortDevice("/dev/ttyUSB0", 0x03);
@@ -244,6 +270,78 @@ public:
         parser.add_bool_arg("extended_registers", "--extended-registers", "-er", "Show extended register output (50 registers)",
             [this](bool value) { Config::extended_registers = value; });
 
+        // Storage mapping argument
+        parser.add_bool_arg("mmap_storage", "--mmap-storage", "-ms", "Map virtual storage files with mmap instead of loading them",
+            [this](bool value) { Config::mmap_storage = value; });
+
+        // Block device image argument
+        parser.add_value_arg("block_image", "--block-image", "-bi", "Backing image file for the block device on ports 0x0B/0x0C",
+            [this](const std::string& value) { Config::block_image = value; });
+
+        // Block device base image argument
+        parser.add_value_arg("block_base", "--block-base", "-bb", "Read-only base image; --block-image becomes a copy-on-write overlay of it",
+            [this](const std::string& value) { Config::block_base = value; });
+
+        // Asynchronous logging argument
+        parser.add_bool_arg("async_log", "--async-log", "-al", "Write log output from a background thread (fast --debug runs)",
+            [this](bool value) { Config::async_log = value; });
+
+        // Binary trace arguments
+        parser.add_value_arg("trace", "--trace", "-T", "Record a binary execution trace to this file",
+            [this](const std::string& value) { Config::trace_file = value; });
+        parser.add_value_arg("trace_decode", "--trace-decode", "-td", "Print a binary execution trace and exit",
+            [this](const std::string& value) { Config::trace_decode = value; });
+        parser.add_value_arg("trace_filter", "--trace-filter", "-tf", "Only decode instructions in this symbol or PC range (0xA-0xB)",
+            [this](const std::string& value) { Config::trace_filter = value; });
+
+        // Sampling profiler arguments
+        parser.add_value_arg("profile", "--profile", "-p", "Sample guest call stacks; write folded stacks to this file and print a flat profile",
+            [this](const std::string& value) { Config::profile_file = value; });
+        parser.add_value_arg("profile_interval", "--profile-interval", "-ps", "Virtual cycles between profiler samples (default 1000)",
+            [this](const std::string& value) {
+                try {
+                    Config::profile_interval = std::stoull(value);
+                } catch (const std::exception&) {
+                    std::cerr << "Error: Invalid profile interval: " << value << std::endl;
+                }
+            });
+
+        // Instruction mix arguments
+        parser.add_bool_arg("stats", "--stats", "-S", "Count executions, host time and I/O per opcode and print the instruction mix",
+            [this](bool value) { Config::instruction_stats = value; });
+        parser.add_value_arg("stats_json", "--stats-json", "-sj", "Export the instruction mix as JSON to this file (implies --stats)",
+            [this](const std::string& value) { Config::stats_json = value; Config::instruction_stats = true; });
+        parser.add_value_arg("stats_prometheus", "--stats-prometheus", "-sp", "Export the instruction mix in Prometheus text format (implies --stats)",
+            [this](const std::string& value) { Config::stats_prometheus = value; Config::instruction_stats = true; });
+
+        // Basic-block profiling argument
+        parser.add_value_arg("hot_blocks", "--hot-blocks", "-hb", "Count basic-block executions and list this many hot blocks with loop nesting",
+            [this](const std::string& value) {
+                try {
+                    Config::hot_blocks = static_cast<unsigned>(std::stoul(value));
+                } catch (const std::exception&) {
+                    std::cerr << "Error: Invalid hot block count: " << value << std::endl;
+                }
+            });
+
+        // Baseline JIT argument
+        parser.add_bool_arg("jit", "--jit", "-j", "Compile basic blocks to native x86-64 code (I/O and interrupts stay interpreted)",
+            [this](bool value) { Config::jit = value; });
+        parser.add_value_arg("jit_threshold", "--jit-threshold", "-jt", "Interpreted entries before a block is compiled (0 = compile everything up front)",
+            [this](const std::string& value) {
+                try {
+                    Config::jit_threshold = static_cast<unsigned>(std::stoul(value));
+                } catch (const std::exception&) {
+                    std::cerr << "Error: Invalid JIT threshold: " << value << std::endl;
+                }
+            });
+
+        // Input record/replay arguments
+        parser.add_value_arg("record_input", "--record-input", "-ri", "Journal device input and interrupts to this file",
+            [this](const std::string& value) { Config::record_input = value; });
+        parser.add_value_arg("replay_input", "--replay-input", "-pi", "Replay device input and interrupts from this journal",
+            [this](const std::string& value) { Config::replay_input = value; });
+
         // Debug File argument
         parser.add_value_arg("debug_file", "--debug-file", "-f", "Debug file path",
             [this](const std::string& value) { Config::debug_file = value; });
@@ -268,12 +366,16 @@ public:
             });
 
         // Compile argument
-        parser.add_value_arg("compile", "--compile", "-o", "Compile program into a standalone executable (optionally specify output name)",
+        parser.add_value_arg("compile", "--compile", "-o", "Compile program into a native x86-64 executable (optionally specify output name)",
             [this](const std::string& value) {
                 Config::compile_only = true;
                 Config::output_name = value;
             });
 
+        // Console flush policy argument
+        parser.add_value_arg("console_flush", "--console-flush", "-cf", "Console output flush policy: newline (default), threshold or halt",
+            [this](const std::string& value) { Config::console_flush = value; });
+
         parser.parse(argc, argv);
     }
 
@@ -284,7 +386,7 @@ public:
 
         if (Config::output_name.empty()) {
             // Generate a name if none provided
-            output_name = generate_executable_name(Config::program_file);
+            output_name = generate_executable_name(Config::assembly_mode ? Config::assembly_file : Config::program_file);
         } else {
             // Use provided name and sanitize it
             output_name = sanitize_filename(Config::output_name);
@@ -367,194 +469,46 @@ public:
         return sanitized;
     }
 
-    // Create a standalone executable with the program embedded
+    // Translate the program to native code and write it out as an executable
     bool create_standalone_executable(const std::vector<uint8_t>& program,
                                       const std::string& output_name) {
         // Note: output_name is already sanitized by run_compiled()
-
-        // 1. Generate program_data.hpp with the program bytes
-        if (!generate_program_data_header(program)) {
-            std::cerr << "Failed to generate program data header" << std::endl;
-            return false;
-        } else {
-            std::cout << "Generated program data header with " << program.size() << " bytes" << std::endl;
+        CodeGen::AotCompiler compiler;
+        std::vector<uint8_t> image = compiler.compile(program);
+        for (const std::string& warning : compiler.warnings()) {
+            std::cerr << "Warning: " << warning << std::endl;
         }
-
-        // 2. Compile the standalone main
-        if (!compile_standalone_main(output_name)) {
-            std::cerr << "Failed to compile standalone executable" << std::endl;
+        if (image.empty()) {
+            std::cerr << "Failed to compile program to native code" << std::endl;
             return false;
-        } else {
-            std::cout << "Compiled standalone main to: " << output_name << std::endl;
         }
 
-        return true;
-    }
-
-    // Generate program_data.hpp with the program bytes
-    bool generate_program_data_header(const std::vector<uint8_t>& program) {
-        std::ofstream outfile("src/program_data.hpp");
-        if (!outfile) {
-            std::cerr << "Error: Cannot create program_data.hpp" << std::endl;
+        if (!CodeGen::AotCompiler::write_executable(output_name, image)) {
+            std::cerr << "Error: Cannot write executable: " << output_name << std::endl;
             return false;
         }
-
-        // Get current time for timestamp
-        auto now = std::chrono::system_clock::now();
-        auto in_time_t = std::chrono::system_clock::to_time_t(now);
-        std::stringstream timestamp;
-        timestamp << std::put_time(std::localtime(&in_time_t), "%Y-%m-%d %H:%M:%S");
-
-        // Write the header file
-        outfile << "// Auto-generated from program file\n";
-        outfile << "// Generated on: " << timestamp.str() << "\n\n";
-        outfile << "#ifndef PROGRAM_DATA_HPP\n";
-        outfile << "#define PROGRAM_DATA_HPP\n\n";
-        outfile << "#include <vector>\n";
-        outfile << "#include <cstdint>\n\n";
-        outfile << "// Program binary data\n";
-        outfile << "const std::vector<uint8_t> PROGRAM_DATA = {\n    ";
-
-        // Write the program bytes in a nicely formatted array
-        const int ITEMS_PER_LINE = 12;
-        for (size_t i = 0; i < program.size(); ++i) {
-            outfile << "0x" << std::hex << std::setw(2) << std::setfill('0')
-                    << static_cast<int>(program[i]);
-
-            if (i < program.size() - 1) {
-                outfile << ", ";
-                if ((i + 1) % ITEMS_PER_LINE == 0) {
-                    outfile << "\n    ";
-                }
-            }
-        }
-
-        outfile << "\n};\n\n";
-        outfile << "#endif // PROGRAM_DATA_HPP\n";
+        compiler.write_stats(std::cout);
 
         return true;
     }
 
-    // Securely compile standalone executable using execvp (no system())
-    bool compile_standalone_main(const std::string& output_name) {
-        // Create a simplified standalone main that doesn't include imgui
-        std::string temp_file = "build/tmp_standalone.cpp";
+    void run() {
+        if (show_help) return;
 
-        // Write a simplified version of standalone_main.cpp to a temporary file
-        std::ofstream outfile(temp_file);
-        if (!outfile) {
-            std::cerr << "Error: Cannot create temporary file" << std::endl;
-            return false;
+        if (Config::async_log) {
+            Logger::instance().set_async(true);
         }
 
-        outfile << "#include <iostream>\n";
-        outfile << "#include <vector>\n";
-        outfile << "#include <cstdint>\n";
-        outfile << "#include \"config.hpp\"\n";
-        outfile << "#include \"vhardware/cpu.hpp\"\n";
-        outfile << "#include \"vhardware/device_factory.hpp\"\n\n";
-        outfile << "// Include the generated program data\n";
-        outfile << "#include \"program_data.hpp\"\n\n";
-        outfile << "// Basic device initialization without logging\n";
-        outfile << "void silent_initialize_devices() {\n";
-        outfile << "    using namespace vhw;\n";
-        outfile << "    auto console = DeviceFactory::createConsoleDevice(0x01);\n";
-        outfile << "    auto counter = DeviceFactory::createCounterDevice(0x02);\n";
-        outfile << "    auto file = DeviceFactory::createFileDevice(\"virtual_storage/vhd.dat\", 0x04);\n";
-        outfile << "    auto ramdisk = DeviceFactory::createRamDiskDevice(8192, 0x05, 0x06);\n";
-        outfile << "}\n\n";
-        outfile << "int main(int, char**) {\n";
-        outfile << "    // No debug mode by default\n";
-        outfile << "    Config::debug = false;\n";
-        outfile << "    Config::verbose = false;\n\n";
-        outfile << "    // Initialize CPU\n";
-        outfile << "    CPU cpu;\n";
-        outfile << "    cpu.reset();\n\n";
-        outfile << "    // Initialize devices silently\n";
-        outfile << "    silent_initialize_devices();\n\n";
-        outfile << "    // Execute the program\n";
-        outfile << "    cpu.execute(PROGRAM_DATA);\n\n";
-        outfile << "    // Handle errors if any\n";
-        outfile << "    if (Config::error_count > 0) {\n";
-        outfile << "        std::cerr << \"Execution failed with \" << Config::error_count << \" errors.\" << std::endl;\n";
-        outfile << "        return 1;\n";
-        outfile << "    }\n";
-        outfile << "    return 0;\n";
-        outfile << "}\n";
-        outfile.close();
-
-        // Create bin directory if it doesn't exist
-        fs::path bin_dir("bin");
-        if (!fs::exists(bin_dir)) {
-            fs::create_directory(bin_dir);
-        }        // Propietary files
-        // Note: fmt library is included in extern/fmt
-        // Note: imgui not included
-        std::vector<std::string> extra_files = {
-            "src/debug/logger.cpp",
-            "src/vhardware/cpu.cpp",
-            "src/vhardware/device_manager.cpp",
-            // Use consolidated opcodes file for faster compilation
-            "src/vhardware/opcodes/opcodes_consolidated.cpp",
-            // "src/vhardware/device_factory.cpp",
-            // "src/vhardware/devices/console_device.cpp",
-            // "src/vhardware/devices/counter_device.cpp",
-            // "src/vhardware/devices/file_device.cpp",
-            // "src/vhardware/devices/ramdisk_device.cpp",
-            "extern/fmt/src/format.cc"
-        };
-
-        // Prepare argument vector
-        std::vector<std::string> args = {
-            "g++", "-std=c++17", "-I./src",
-            "-Iextern/fmt/include", "-Iextern",
-            "-std=c++17",
-            "-o", output_name,
-            temp_file
-        };
-        // Add all extra source files
-        args.insert(args.end(), extra_files.begin(), extra_files.end());
-
-        // Convert args to char* array
-        std::vector<char*> c_args;
-        for (auto& arg : args) c_args.push_back(const_cast<char*>(arg.c_str()));
-        c_args.push_back(nullptr);
-
-        std::cout << "Building standalone executable..." << std::endl;
-
-        pid_t pid = fork();
-        if (pid == -1) {
-            std::cerr << "Failed to fork for compile" << std::endl;
-            return false;
-        } else if (pid == 0) {
-            // child process
-            execvp("g++", c_args.data());
-            // If execvp fails
-            std::cerr << "Failed to execute g++" << std::endl;
-            _exit(127);
-        }
-        // parent process
-        int status = 0;
-        if (waitpid(pid, &status, 0) == -1) {
-            std::cerr << "Failed during waitpid" << std::endl;
-            return false;
-        } else {
-        }
-        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
-            return false;
+        if (!Config::trace_decode.empty()) {
+            try {
+                Tracing::decode_trace(Config::trace_decode, Config::trace_filter, std::cout);
+            } catch (const std::exception& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                Config::error_count++;
+            }
+            return;
         }
 
-        // Make the executable file executable
-        fs::permissions(output_name,
-            fs::perms::owner_exec | fs::perms::group_exec | fs::perms::others_exec,
-            fs::perm_options::add);
-
-        return true;
-    }
-
-    void run() {
-        if (show_help) return;
-
         // Handle test mode first
         if (Config::running_tests) {
             // Validate conflicting flags for test mode
@@ -612,7 +566,21 @@ public:
         // Initialize the device system
         initialize_devices();
 
+        auto tracer = open_tracer(cpu);
+        auto profiler = open_profiler(cpu);
+        auto stats = open_stats(cpu);
+        auto blocks = open_blocks(cpu, program);
+        auto jit = open_jit(cpu, program);
+        if (!open_journal()) {
+            return;
+        }
         cpu.execute(program);
+        cpu.set_tracer(nullptr);
+        close_journal();
+        close_profiler(cpu, profiler.get());
+        close_stats(cpu, stats.get());
+        close_blocks(cpu, blocks.get());
+        close_jit(cpu, jit.get());
 
         // Print CPU state
         cpu.print_state("End");
@@ -637,6 +605,156 @@ private:
     std::string data;
     bool show_help = false;
 
+    // Defined labels by address, for the tracer and profilers to name code with
+    static std::map<uint32_t, std::string> symbol_names(const Assembler::AssemblerEngine& assembler) {
+        std::map<uint32_t, std::string> names;
+        for (const auto& [name, symbol] : assembler.get_symbols()) {
+            if (symbol.defined) names[symbol.address] = name;
+        }
+        return names;
+    }
+
+    // Start a binary trace if --trace was given; stops when the writer goes out of scope
+    std::unique_ptr<Tracing::TraceWriter> open_tracer(CPU& cpu) {
+        if (Config::trace_file.empty()) {
+            return nullptr;
+        }
+        try {
+            auto tracer = std::make_unique<Tracing::TraceWriter>(Config::trace_file);
+            cpu.set_tracer(tracer.get());
+            return tracer;
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return nullptr;
+        }
+    }
+
+    // Start sampling guest stacks if --profile was given
+    std::unique_ptr<Profiling::SamplingProfiler> open_profiler(CPU& cpu) {
+        if (Config::profile_file.empty()) {
+            return nullptr;
+        }
+        auto profiler = std::make_unique<Profiling::SamplingProfiler>(Config::profile_interval);
+        cpu.set_profiler(profiler.get());
+        return profiler;
+    }
+
+    // Detach the profiler, print the flat profile and write the folded stacks
+    void close_profiler(CPU& cpu, Profiling::SamplingProfiler* profiler) {
+        cpu.set_profiler(nullptr);
+        if (!profiler) {
+            return;
+        }
+        std::cout << "\n";
+        profiler->write_flat(std::cout);
+        std::ofstream folded(Config::profile_file);
+        if (!folded) {
+            std::cerr << "Error: Cannot write profile: " << Config::profile_file << std::endl;
+            return;
+        }
+        profiler->write_folded(folded);
+    }
+
+    // Start counting the instruction mix if --stats was given
+    std::unique_ptr<Profiling::InstructionStats> open_stats(CPU& cpu) {
+        if (!Config::instruction_stats) {
+            return nullptr;
+        }
+        auto stats = std::make_unique<Profiling::InstructionStats>();
+        cpu.set_stats(stats.get());
+        return stats;
+    }
+
+    // Detach the counters, print the summary and write the requested exports
+    void close_stats(CPU& cpu, Profiling::InstructionStats* stats) {
+        cpu.set_stats(nullptr);
+        if (!stats) {
+            return;
+        }
+        std::cout << "\n";
+        stats->write_summary(std::cout);
+        if (!Config::stats_json.empty()) {
+            std::ofstream json(Config::stats_json);
+            if (json) {
+                stats->write_json(json);
+            } else {
+                std::cerr << "Error: Cannot write stats: " << Config::stats_json << std::endl;
+            }
+        }
+        if (!Config::stats_prometheus.empty()) {
+            std::ofstream metrics(Config::stats_prometheus);
+            if (metrics) {
+                stats->write_prometheus(metrics);
+            } else {
+                std::cerr << "Error: Cannot write stats: " << Config::stats_prometheus << std::endl;
+            }
+        }
+    }
+
+    // Start counting basic blocks if --hot-blocks was given
+    std::unique_ptr<Profiling::BlockProfiler> open_blocks(CPU& cpu, const std::vector<uint8_t>& program) {
+        if (Config::hot_blocks == 0) {
+            return nullptr;
+        }
+        auto blocks = std::make_unique<Profiling::BlockProfiler>(program);
+        cpu.set_block_profiler(blocks.get());
+        return blocks;
+    }
+
+    void close_blocks(CPU& cpu, Profiling::BlockProfiler* blocks) {
+        cpu.set_block_profiler(nullptr);
+        if (blocks) {
+            std::cout << "\n";
+            blocks->write_hot(std::cout, Config::hot_blocks);
+        }
+    }
+
+    // Compile the program to native code if --jit was given
+    std::unique_ptr<CodeGen::Jit> open_jit(CPU& cpu, const std::vector<uint8_t>& program) {
+        if (!Config::jit) {
+            return nullptr;
+        }
+        auto jit = std::make_unique<CodeGen::Jit>(program, Config::jit_threshold);
+        cpu.set_jit(jit.get());
+        return jit;
+    }
+
+    void close_jit(CPU& cpu, CodeGen::Jit* jit) {
+        cpu.set_jit(nullptr);
+        if (jit && Config::verbose) {
+            std::cout << "\n";
+            jit->write_stats(std::cout);
+        }
+    }
+
+    // Start recording or replaying device input if --record-input/--replay-input was given
+    bool open_journal() {
+        auto& journal = vhw::InputJournal::instance();
+        if (!Config::record_input.empty() && !Config::replay_input.empty()) {
+            std::cerr << "Error: --record-input and --replay-input cannot be used together" << std::endl;
+            return false;
+        }
+        if (!Config::record_input.empty()) {
+            return journal.startRecording(Config::record_input);
+        }
+        if (!Config::replay_input.empty()) {
+            return journal.startReplay(Config::replay_input);
+        }
+        return true;
+    }
+
+    void close_journal() {
+        auto& journal = vhw::InputJournal::instance();
+        if (journal.isReplaying()) {
+            if (journal.hasDiverged()) {
+                Config::error_count++;
+            }
+            Logger::instance().info() << fmt::format("Replayed {} of {} journaled reads",
+                journal.readsReplayed(), journal.readsRecorded()) << std::endl;
+        }
+        journal.stop();
+    }
+
     // Helper to load hex bytes from file
     bool load_program_file(const std::string& path, std::vector<uint8_t>& out) {
         std::ifstream file(path);
@@ -733,6 +851,11 @@ private:
             }
         }
 
+        if (Config::compile_only) {
+            run_compiled(bytecode);
+            return;
+        }
+
         // Initialize CPU and devices
         CPU cpu;
         cpu.reset();
@@ -745,9 +868,32 @@ private:
             std::cout << "\033[36m└─────────────────────────────────────────────────────────────┘\033[0m" << std::endl;
         }
 
+        auto tracer = open_tracer(cpu);
+        if (tracer) {
+            tracer->set_symbols(symbol_names(assembler));
+        }
+        auto profiler = open_profiler(cpu);
+        if (profiler) {
+            profiler->set_symbols(symbol_names(assembler));
+        }
+        auto stats = open_stats(cpu);
+        auto blocks = open_blocks(cpu, bytecode);
+        if (blocks) {
+            blocks->set_symbols(symbol_names(assembler));
+        }
+        auto jit = open_jit(cpu, bytecode);
+        if (!open_journal()) {
+            return;
+        }
+
         try {
             // Execute the assembled bytecode
             cpu.execute(bytecode);
+            close_journal();
+            close_profiler(cpu, profiler.get());
+            close_stats(cpu, stats.get());
+            close_blocks(cpu, blocks.get());
+            close_jit(cpu, jit.get());
 
             // Print CPU state and registers (same as regular program mode)
             cpu.print_state("End");
@@ -766,6 +912,7 @@ private:
                 Logger::instance().success() << "Assembly program completed successfully." << std::endl;
             }
         } catch (const std::exception& e) {
+            vhw::InputJournal::instance().stop();
             std::cerr << "Runtime error: " << e.what() << std::endl;
             Config::error_count++;
         }
@@ -1,5 +1,24 @@
 #include "test_framework.hpp"
 #include "../engine/cpu_flags.hpp"
+#include "../engine/device_factory.hpp"
+#include "../engine/input_journal.hpp"
+#include "../debug/trace.hpp"
+#include "../debug/profiler.hpp"
+#include "../debug/instruction_stats.hpp"
+#include "../debug/block_profiler.hpp"
+#include "../codegen/jit.hpp"
+#include "../codegen/aot_compiler.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 // Example unit tests using the new framework
 
@@ -812,4 +831,1158 @@ TEST_CASE(register_type_boundaries, "register_validation") {
     ctx.assert_eq(true, RegisterNames::is_mmx(Register::MM0), "MM0 should be MMX");
     ctx.assert_eq(true, RegisterNames::is_mmx(Register::MM7), "MM7 should be MMX");
     ctx.assert_eq(false, RegisterNames::is_mmx(Register::XMM0), "XMM0 should not be MMX");
-}
\ No newline at end of file
+}
+TEST_CASE(dma_device_to_memory, "devices") {
+    // Preload the RAM disk and let the DMA controller copy it into guest memory
+    auto ramdisk = std::dynamic_pointer_cast<vhw::RamDiskDevice>(
+        vhw::DeviceManager::instance().getDevice(vhw::RamDiskDevice::DEFAULT_DATA_PORT));
+    ctx.assert_eq(true, ramdisk != nullptr, "RAM disk should be registered");
+
+    std::vector<uint8_t> contents(0x20, 0);
+    for (uint8_t i = 0; i < 8; ++i) {
+        contents[0x10 + i] = static_cast<uint8_t>(0xA0 + i);
+    }
+    ramdisk->setStorage(contents);
+
+    ctx.load_program({
+        0x01, 0x00, 0x00,  // LOAD_IMM R0, CMD_SELECT_SRC
+        0x31, 0x00, 0x08,  // OUT R0, DMA ctrl
+        0x01, 0x01, 0x10,  // LOAD_IMM R1, 0x10 (RAM disk offset)
+        0x31, 0x01, 0x07,  // OUT R1, DMA data
+        0x01, 0x00, 0x01,  // LOAD_IMM R0, CMD_SELECT_DST
+        0x31, 0x00, 0x08,  // OUT R0, DMA ctrl
+        0x01, 0x01, 0x80,  // LOAD_IMM R1, 0x80 (guest address)
+        0x31, 0x01, 0x07,  // OUT R1, DMA data
+        0x01, 0x00, 0x02,  // LOAD_IMM R0, CMD_SELECT_LEN
+        0x31, 0x00, 0x08,  // OUT R0, DMA ctrl
+        0x01, 0x01, 0x08,  // LOAD_IMM R1, 8
+        0x31, 0x01, 0x07,  // OUT R1, DMA data
+        0x01, 0x00, 0x03,  // LOAD_IMM R0, CMD_SELECT_DEVICE
+        0x31, 0x00, 0x08,  // OUT R0, DMA ctrl
+        0x01, 0x01, 0x05,  // LOAD_IMM R1, RAM disk port
+        0x31, 0x01, 0x07,  // OUT R1, DMA data
+        0x01, 0x00, 0x10,  // LOAD_IMM R0, CMD_START
+        0x31, 0x00, 0x08,  // OUT R0, DMA ctrl
+        0x01, 0x00, 0x12,  // LOAD_IMM R0, CMD_WAIT
+        0x31, 0x00, 0x08,  // OUT R0, DMA ctrl
+        0x30, 0x02, 0x08,  // IN R2, DMA ctrl (status)
+        0xFF               // HALT
+    });
+
+    ctx.execute_program();
+
+    // Transfer finished without error and the data landed at 0x80
+    ctx.assert_register_eq(2, vhw::DmaDevice::STATUS_DONE);
+    ctx.assert_memory_range_eq(0x80, {0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7});
+}
+
+namespace {
+// Block storage whose reads are still running when the test moves on
+class SlowStorage : public vhw::VirtualDevice, public vhw::BlockStorage {
+public:
+    uint8_t read() override { return 0; }
+    void write(uint8_t) override {}
+    std::string getName() const override { return "Slow Storage"; }
+    void reset() override {}
+    size_t readBlock(size_t, uint8_t* dest, size_t length) override {
+        started = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        std::memset(dest, 0xAB, length);
+        finished = true;
+        return length;
+    }
+    size_t writeBlock(size_t, const uint8_t*, size_t length) override { return length; }
+    size_t capacity() const override { return 1024 * 1024; }
+
+    std::atomic<bool> started{false};
+    std::atomic<bool> finished{false};
+};
+} // namespace
+
+TEST_CASE(dma_detach_waits_for_transfer, "devices") {
+    // Destroying a CPU mid-transfer must not leave the worker writing into freed memory
+    auto& devices = vhw::DeviceManager::instance();
+    auto storage = std::make_shared<SlowStorage>();
+    devices.registerDevice(0x40, storage);
+    auto dma = std::dynamic_pointer_cast<vhw::DmaDevice>(
+        devices.getDevice(vhw::DmaDevice::DEFAULT_CTRL_PORT));
+    ctx.assert_eq(true, dma != nullptr, "DMA controller should be registered");
+
+    {
+        CPU cpu;
+        devices.attachMemory(&cpu.get_memory());
+        dma->program(0, 0x100, 0x1000, vhw::DmaDevice::MODE_DEVICE_TO_MEMORY, 0x40);
+        ctx.assert_eq(true, dma->start(), "Transfer should start");
+        while (!storage->started) {
+            std::this_thread::yield();
+        }
+    }
+
+    ctx.assert_eq(true, storage->finished.load(), "CPU destruction should wait for the transfer");
+    ctx.assert_eq(true, devices.getMemory() == nullptr, "Memory should be detached");
+}
+
+TEST_CASE(interrupt_wait_and_iret, "interrupts") {
+    // Console input raises IRQ 1; WAIT parks until it is deliverable and the
+    // handler reads the character, acknowledges it and returns with IRET
+    auto console = std::dynamic_pointer_cast<vhw::ConsoleDevice>(
+        vhw::DeviceManager::instance().getDevice(vhw::ConsoleDevice::DEFAULT_PORT));
+    ctx.assert_eq(true, console != nullptr, "Console should be registered");
+
+    std::vector<uint8_t> program(0x5A, 0x00);
+    const std::vector<uint8_t> main_code = {
+        0x01, 0x00, 0x01,  // LOAD_IMM R0, CMD_SELECT_VECTOR_BASE
+        0x31, 0x00, 0x21,  // OUT R0, PIC ctrl
+        0x01, 0x01, 0x40,  // LOAD_IMM R1, 0x40
+        0x31, 0x01, 0x20,  // OUT R1, PIC data (vector table at 0x40)
+        0x2A,              // STI
+        0x2C,              // WAIT
+        0xFF               // HALT
+    };
+    const std::vector<uint8_t> handler = {
+        0x30, 0x02, 0x01,  // IN R2, console
+        0x01, 0x00, 0x02,  // LOAD_IMM R0, CMD_EOI
+        0x31, 0x00, 0x21,  // OUT R0, PIC ctrl
+        0x29               // IRET
+    };
+    std::copy(main_code.begin(), main_code.end(), program.begin());
+    program[0x44] = 0x50;  // Vector for IRQ 1 -> handler at 0x50
+    std::copy(handler.begin(), handler.end(), program.begin() + 0x50);
+    ctx.load_program(program);
+
+    console->addInput('A');
+    ctx.execute_program();
+
+    ctx.assert_register_eq(2, 'A');
+    ctx.assert_eq(0x0Eu, ctx.cpu.get_pc() - 1, "Execution should resume after WAIT and reach HALT");
+    ctx.assert_eq(static_cast<uint32_t>(ctx.cpu.get_memory().size() - 4), ctx.cpu.get_sp(), "Interrupt frame should be popped");
+    ctx.assert_eq(true, ctx.cpu.get_interrupts_enabled(), "IRET should restore the interrupt flag");
+    ctx.assert_eq(static_cast<uint8_t>(0), vhw::InterruptController::instance().getInService(), "EOI should clear the in-service line");
+}
+
+TEST_CASE_EXPECT_ERROR(wait_without_wake_source, "interrupts") {
+    // With no timer armed and nothing in flight WAIT could never resume;
+    // it must stop the program with an error rather than hang
+    ctx.load_program({
+        0x2A,  // STI
+        0x2C,  // WAIT
+        0xFF   // HALT
+    });
+    ctx.execute_program();
+}
+
+TEST_CASE(serial_pty_loopback, "devices") {
+    // Drive the serial device through a local pseudo-terminal pair
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    ctx.assert_eq(true, master >= 0 && grantpt(master) == 0 && unlockpt(master) == 0,
+                  "A pty pair should be available");
+
+    vhw::SerialPortDevice serial(ptsname(master));
+    ctx.assert_eq(true, serial.connect(), "Serial device should connect to the pty slave");
+
+    // Host -> guest: bytes written to the master show up in the RX ring
+    const std::string message = "ping";
+    ctx.assert_eq(static_cast<ssize_t>(message.size()), ::write(master, message.data(), message.size()),
+                  "Write to pty master");
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (serial.available() < message.size() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    std::string received;
+    for (size_t i = 0; i < message.size(); ++i) {
+        received.push_back(static_cast<char>(serial.read()));
+    }
+    ctx.assert_eq(message, received, "Serial RX");
+    ctx.assert_eq(static_cast<uint8_t>(0), serial.read(), "Empty RX buffer should read as 0");
+
+    // Guest -> host: device writes arrive at the master
+    serial.write('x');
+    struct pollfd pfd = {master, POLLIN, 0};
+    char echoed = 0;
+    ctx.assert_eq(1, ::poll(&pfd, 1, 2000), "pty master should become readable");
+    ctx.assert_eq(static_cast<ssize_t>(1), ::read(master, &echoed, 1), "Read from pty master");
+    ctx.assert_eq('x', echoed, "Serial TX");
+
+    serial.disconnect();
+    ctx.assert_eq(false, serial.isConnected(), "Serial device should disconnect promptly");
+
+    // Hangup: once the master goes away the device reports itself disconnected
+    ctx.assert_eq(true, serial.connect(), "Serial device should reconnect");
+    ::close(master);
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (serial.isConnected() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    ctx.assert_eq(false, serial.isConnected(), "Serial device should notice the hangup");
+}
+
+TEST_CASE(console_flush_policy, "devices") {
+    // Output is held back until a flush trigger fires
+    vhw::ConsoleDevice console;
+    console.setFlushPolicy(vhw::ConsoleDevice::FLUSH_ON_NEWLINE | vhw::ConsoleDevice::FLUSH_ON_THRESHOLD);
+    console.setFlushThreshold(8);
+
+    console.write('o');
+    console.write('k');
+    ctx.assert_eq(static_cast<size_t>(2), console.bufferedBytes(), "Bytes should be buffered");
+    console.write('\n');
+    ctx.assert_eq(static_cast<size_t>(0), console.bufferedBytes(), "Newline should flush");
+
+    for (int i = 0; i < 7; ++i) console.write('.');
+    ctx.assert_eq(static_cast<size_t>(7), console.bufferedBytes(), "Below threshold stays buffered");
+    console.write('.');
+    ctx.assert_eq(static_cast<size_t>(0), console.bufferedBytes(), "Reaching the threshold should flush");
+
+    // Halt-only policy ignores newlines until an explicit flush
+    console.setFlushPolicy(0);
+    console.write('\n');
+    console.write('\n');
+    ctx.assert_eq(static_cast<size_t>(2), console.bufferedBytes(), "Halt policy ignores newlines");
+    console.flush();
+    ctx.assert_eq(static_cast<size_t>(0), console.bufferedBytes(), "Explicit flush should drain the buffer");
+}
+
+TEST_CASE(file_device_mapped, "devices") {
+    const std::string path = "virtual_storage/mapped_test.dat";
+    ::unlink(path.c_str());
+
+    {
+        vhw::FileDevice file(path, vhw::FileDevice::Mode::Mapped);
+        ctx.assert_eq(true, file.isMapped(), "Device should be in mapped mode");
+        ctx.assert_eq(static_cast<size_t>(0), file.size(), "New file should be empty");
+
+        for (uint8_t c : std::string("mapped")) file.write(c);
+        ctx.assert_eq(static_cast<size_t>(6), file.size(), "Appends should grow the logical size");
+
+        // Overwrite in place and read back through the same position semantics
+        file.seek(1);
+        file.write('A');
+        ctx.assert_eq(static_cast<size_t>(2), file.tell(), "Write should advance the position");
+        file.seek(0);
+        std::string readBack;
+        for (int i = 0; i < 6; ++i) readBack += static_cast<char>(file.read());
+        ctx.assert_eq(std::string("mApped"), readBack, "Reads should see mapped writes");
+        ctx.assert_eq(static_cast<uint8_t>(0), file.read(), "Reading past the end returns 0");
+        file.flush();
+    }
+
+    // The file is trimmed to its logical size and readable by the buffered path
+    vhw::FileDevice reopened(path);
+    ctx.assert_eq(static_cast<size_t>(6), reopened.size(), "File should be trimmed on close");
+    ctx.assert_eq(static_cast<uint8_t>('m'), reopened.read(), "Contents should persist");
+    ::unlink(path.c_str());
+}
+
+TEST_CASE(file_device_write_behind, "devices") {
+    const std::string path = "virtual_storage/write_behind_test.dat";
+    ::unlink(path.c_str());
+    auto onDisk = [&] {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+
+    {
+        vhw::FileDevice file(path);
+        vhw::ThreadPoolIo io(1);
+        file.setAsyncIo(&io);
+
+        // By default every write is on disk when it returns
+        file.write('>');
+        ctx.assert_eq(std::string(">"), onDisk(), "Writes should go through unless write-behind is set");
+
+        // With write-behind, writes stay in the buffer until a flush hands a snapshot to the engine
+        file.setWriteBehind(8);
+        for (uint8_t c : std::string("behind")) file.write(c);
+        ctx.assert_eq(std::string(">"), onDisk(), "Writes should not touch the file before a flush");
+        file.flush();
+        file.waitIdle();
+        ctx.assert_eq(std::string(">behind"), onDisk(), "Flush should write the buffer back");
+
+        // Passing the dirty-byte limit starts a write-back without a flush
+        for (uint8_t c : std::string("123456789")) file.write(c);
+        file.waitIdle();
+        ctx.assert_eq(std::string(">behind123456789"), onDisk(), "The dirty limit should bound what a crash can lose");
+
+        // Whatever is still dirty is saved when the device goes away
+        file.write('!');
+        file.setAsyncIo(nullptr);
+    }
+    ctx.assert_eq(std::string(">behind123456789!"), onDisk(), "Destruction should save pending writes");
+    ::unlink(path.c_str());
+}
+
+TEST_CASE(block_device_burst_transfer, "devices") {
+    // 4TB disk; only the chunks actually written are allocated
+    auto backend = std::make_unique<vhw::SparseMemoryBackend>(8ull * 1024 * 1024 * 1024);
+    auto* sparse = backend.get();
+    vhw::BlockDevice disk(std::move(backend));
+    auto data = disk.dataPort();
+
+    std::vector<uint8_t> memory(8192, 0);
+    auto& manager = vhw::DeviceManager::instance();
+    manager.attachMemory(&memory);
+
+    for (size_t i = 0; i < 1024; ++i) memory[i] = static_cast<uint8_t>(i * 7);
+
+    // Program LBA 0x1_0000_0000 through the ports: 2 sectors from address 0
+    disk.write(vhw::BlockDevice::CMD_SELECT_LBA);
+    for (int i = 0; i < 8; ++i) data->write(i == 4 ? 1 : 0);
+    disk.write(vhw::BlockDevice::CMD_SELECT_COUNT);
+    for (uint8_t b : {2, 0, 0, 0}) data->write(b);
+    disk.write(vhw::BlockDevice::CMD_SELECT_BUFFER);
+    for (uint8_t b : {0, 0, 0, 0}) data->write(b);
+    disk.write(vhw::BlockDevice::CMD_WRITE);
+    ctx.assert_eq(static_cast<uint8_t>(vhw::BlockDevice::STATUS_DONE), disk.read(), "Write should complete");
+    ctx.assert_eq(vhw::SparseMemoryBackend::CHUNK_SIZE, sparse->allocatedBytes(), "Only one chunk should be allocated");
+
+    // Read it back elsewhere in guest memory
+    disk.write(vhw::BlockDevice::CMD_ACK);
+    disk.program(0x100000000ull, 2, 4096);
+    disk.write(vhw::BlockDevice::CMD_READ);
+    ctx.assert_eq(static_cast<uint8_t>(vhw::BlockDevice::STATUS_DONE), disk.read(), "Read should complete");
+    ctx.assert_eq(true, std::equal(memory.begin(), memory.begin() + 1024, memory.begin() + 4096),
+                  "Sectors should round-trip through the disk");
+
+    // Out of range requests fail without touching memory
+    disk.program(disk.getBackend().sectorCount() - 1, 2, 0);
+    disk.write(vhw::BlockDevice::CMD_READ);
+    ctx.assert_eq(vhw::BlockDevice::ERR_OUT_OF_BOUNDS, disk.getLastError(), "Reading past the end should fail");
+
+    manager.detachMemory(&memory);
+}
+
+TEST_CASE(block_overlay_copy_on_write, "devices") {
+    const std::string basePath = "virtual_storage/cow_base.img";
+    const std::string packedPath = "virtual_storage/cow_base.dcmp";
+    const std::string overlayPath = "virtual_storage/cow_overlay.img";
+    for (const auto& p : {basePath, packedPath, overlayPath}) ::unlink(p.c_str());
+
+    // 256KB golden disk: a recognisable first sector, zeros elsewhere
+    {
+        vhw::SparseFileBackend base(basePath, 512);
+        std::vector<uint8_t> sector(512, 0xAB);
+        base.writeSectors(0, sector.data(), 1);
+    }
+    ctx.assert_eq(true, vhw::CompressedImageBackend::compress(basePath, packedPath), "Base should compress");
+    ctx.assert_eq(true, vhw::OverlayBackend::create(overlayPath, packedPath), "Overlay should be created");
+
+    std::vector<uint8_t> buffer(1024);
+    {
+        vhw::OverlayBackend overlay(overlayPath);
+        ctx.assert_eq(static_cast<uint64_t>(512), overlay.sectorCount(), "Overlay inherits the base size");
+        overlay.readSectors(0, buffer.data(), 2);
+        ctx.assert_eq(static_cast<uint8_t>(0xAB), buffer[0], "Unwritten sectors come from the base");
+        ctx.assert_eq(static_cast<uint8_t>(0), buffer[600], "Zero clusters decompress to zeros");
+
+        // Writing one sector copies up only its cluster and keeps the rest of it
+        std::vector<uint8_t> sector(512, 0x5A);
+        overlay.writeSectors(1, sector.data(), 1);
+        ctx.assert_eq(static_cast<size_t>(1), overlay.allocatedClusters(), "One cluster should be copied");
+    }
+
+    // Changes persist in the overlay; the base is untouched
+    vhw::OverlayBackend reopened(overlayPath);
+    reopened.readSectors(0, buffer.data(), 2);
+    ctx.assert_eq(static_cast<uint8_t>(0xAB), buffer[0], "Copied cluster keeps base data");
+    ctx.assert_eq(static_cast<uint8_t>(0x5A), buffer[512], "Overlay write should persist");
+    vhw::CompressedImageBackend packed(packedPath);
+    packed.readSectors(1, buffer.data(), 1);
+    ctx.assert_eq(static_cast<uint8_t>(0), buffer[0], "Base image must not change");
+
+    for (const auto& p : {basePath, packedPath, overlayPath}) ::unlink(p.c_str());
+}
+
+TEST_CASE(block_device_async_io, "devices") {
+    const std::string path = "virtual_storage/async_test.img";
+    ::unlink(path.c_str());
+
+    std::vector<uint8_t> memory(64 * 1024, 0);
+    auto& manager = vhw::DeviceManager::instance();
+    manager.attachMemory(&memory);
+    {
+        vhw::BlockDevice disk(std::make_unique<vhw::SparseFileBackend>(path, 256));
+        auto io = vhw::AsyncIo::create();
+        disk.setAsyncIo(io.get());
+
+        for (size_t i = 0; i < 32 * 1024; ++i) memory[i] = static_cast<uint8_t>(i ^ (i >> 8));
+        disk.program(8, 64, 0);
+        disk.write(vhw::BlockDevice::CMD_WRITE);
+        disk.write(vhw::BlockDevice::CMD_WAIT);
+        ctx.assert_eq(static_cast<uint8_t>(vhw::BlockDevice::STATUS_DONE), disk.read(), "Async write should complete");
+
+        // Completion is reported through the status port while the guest keeps running
+        disk.write(vhw::BlockDevice::CMD_ACK);
+        disk.program(8, 64, 32 * 1024);
+        disk.write(vhw::BlockDevice::CMD_READ);
+        while (disk.read() & vhw::BlockDevice::STATUS_BUSY) {
+            std::this_thread::yield();
+        }
+        ctx.assert_eq(static_cast<uint8_t>(vhw::BlockDevice::STATUS_DONE), disk.read(), "Async read should complete");
+        ctx.assert_eq(true, std::equal(memory.begin(), memory.begin() + 32 * 1024, memory.begin() + 32 * 1024),
+                      fmt::format("Data should round-trip through {}", io->name()));
+    }
+    manager.detachMemory(&memory);
+    ::unlink(path.c_str());
+}
+
+TEST_CASE(device_mutex_policy, "devices") {
+    // Single-threaded devices never actually lock
+    vhw::DeviceMutex mutex;
+    ctx.assert_eq(false, mutex.isShared(), "Devices start single-threaded");
+    mutex.lock();
+    ctx.assert_eq(true, mutex.try_lock(), "Unshared mutex should not block");
+    mutex.unlock();
+    mutex.unlock();
+
+    // Once shared, it behaves like a real mutex
+    mutex.share();
+    mutex.lock();
+    bool acquired = true;
+    std::thread other([&] { acquired = mutex.try_lock(); });
+    other.join();
+    ctx.assert_eq(false, acquired, "Shared mutex should exclude other threads");
+    mutex.unlock();
+}
+
+namespace {
+// Records the virtual time of every tick it receives
+class TickProbe : public vhw::VirtualDevice {
+public:
+    uint8_t read() override { return 0; }
+    void write(uint8_t) override {}
+    std::string getName() const override { return "Tick Probe"; }
+    void reset() override {}
+    bool isTicking() const override { return true; }
+    void tick(uint64_t cycles) override {
+        total += cycles;
+        times.push_back(vhw::VirtualClock::instance().now());
+    }
+
+    uint64_t total = 0;
+    std::vector<uint64_t> times;
+};
+} // namespace
+
+TEST_CASE(virtual_clock_batched_ticks, "devices") {
+    auto probe = std::make_shared<TickProbe>();
+    vhw::DeviceManager::instance().registerDevice(0x40, probe);
+    auto& clock = vhw::VirtualClock::instance();
+    clock.setBatchSize(8);
+    clock.requestTickAt(5);
+
+    std::vector<uint8_t> program(20, 0x00);  // 20 x NOP
+    program.push_back(0xFF);                 // HALT
+    ctx.cpu.execute(program);
+    clock.setBatchSize(vhw::VirtualClock::DEFAULT_BATCH);
+
+    ctx.assert_eq(static_cast<uint64_t>(21), clock.now(), "Clock should count retired instructions");
+    ctx.assert_eq(static_cast<uint64_t>(21), probe->total, "Devices should see every cycle");
+    ctx.assert_eq(static_cast<size_t>(3), probe->times.size(), "Ticks should be batched");
+    ctx.assert_eq(static_cast<uint64_t>(5), probe->times[0], "The first batch should end at the deadline");
+    ctx.assert_eq(static_cast<uint64_t>(13), probe->times[1], "Later batches use the batch size");
+}
+
+TEST_CASE(timer_device_wheel, "devices") {
+    auto timer = std::dynamic_pointer_cast<vhw::TimerDevice>(
+        vhw::DeviceManager::instance().getDevice(vhw::TimerDevice::DEFAULT_CTRL_PORT));
+    ctx.assert_eq(true, timer != nullptr, "Timer should be registered");
+    auto& clock = vhw::VirtualClock::instance();
+
+    // A one-shot IRQ timer a million cycles out; WAIT should skip straight to it
+    std::vector<uint8_t> program(0x80, 0x00);
+    const std::vector<uint8_t> main_code = {
+        0x01, 0x00, 0x00,  // LOAD_IMM R0, CMD_SELECT_TIMER
+        0x31, 0x00, 0x0E,  // OUT R0, timer ctrl
+        0x01, 0x01, 0x05,  // LOAD_IMM R1, 5
+        0x31, 0x01, 0x0D,  // OUT R1, timer data
+        0x01, 0x00, 0x01,  // LOAD_IMM R0, CMD_SELECT_INTERVAL
+        0x31, 0x00, 0x0E,  // OUT R0, timer ctrl
+        0x01, 0x01, 0x40,  // LOAD_IMM R1, 0x40
+        0x31, 0x01, 0x0D,  // OUT R1, timer data (interval = 1,000,000)
+        0x01, 0x01, 0x42,  // LOAD_IMM R1, 0x42
+        0x31, 0x01, 0x0D,  // OUT R1, timer data
+        0x01, 0x01, 0x0F,  // LOAD_IMM R1, 0x0F
+        0x31, 0x01, 0x0D,  // OUT R1, timer data
+        0x01, 0x01, 0x00,  // LOAD_IMM R1, 0x00
+        0x31, 0x01, 0x0D,  // OUT R1, timer data
+        0x01, 0x00, 0x02,  // LOAD_IMM R0, CMD_SELECT_MODE
+        0x31, 0x00, 0x0E,  // OUT R0, timer ctrl
+        0x01, 0x01, 0x04,  // LOAD_IMM R1, MODE_IRQ
+        0x31, 0x01, 0x0D,  // OUT R1, timer data
+        0x01, 0x00, 0x10,  // LOAD_IMM R0, CMD_ARM
+        0x31, 0x00, 0x0E,  // OUT R0, timer ctrl
+        0x01, 0x00, 0x01,  // LOAD_IMM R0, CMD_SELECT_VECTOR_BASE
+        0x31, 0x00, 0x21,  // OUT R0, PIC ctrl
+        0x01, 0x01, 0x60,  // LOAD_IMM R1, 0x60
+        0x31, 0x01, 0x20,  // OUT R1, PIC data (vector table at 0x60)
+        0x2A,              // STI
+        0x2C,              // WAIT
+        0xFF               // HALT
+    };
+    const std::vector<uint8_t> handler = {
+        0x30, 0x02, 0x0D,  // IN R2, timer data (expired timer id)
+        0x01, 0x00, 0x02,  // LOAD_IMM R0, CMD_EOI
+        0x31, 0x00, 0x21,  // OUT R0, PIC ctrl
+        0x29               // IRET
+    };
+    std::copy(main_code.begin(), main_code.end(), program.begin());
+    program[0x60] = 0x70;  // Vector for IRQ 0 -> handler at 0x70
+    std::copy(handler.begin(), handler.end(), program.begin() + 0x70);
+    ctx.load_program(program);
+    ctx.execute_program();
+
+    ctx.assert_register_eq(2, 5);
+    ctx.assert_eq(true, clock.now() >= 1'000'000, "WAIT should skip virtual time to the deadline");
+    ctx.assert_eq(static_cast<uint64_t>(1), timer->getExpirations(5), "One-shot timer should fire once");
+    ctx.assert_eq(false, timer->isArmed(5), "One-shot timer should disarm itself");
+
+    // Periodic timers keep firing; cancelled and far-off timers don't
+    timer->arm(1, 20, vhw::TimerDevice::MODE_PERIODIC);
+    timer->arm(2, 30'000'000, 0);
+    timer->arm(3, 20'000'000, 0);
+    timer->cancel(2);
+    std::vector<uint8_t> nops(200, 0x00);
+    nops.push_back(0xFF);
+    ctx.cpu.execute(nops);
+    ctx.assert_eq(static_cast<uint64_t>(10), timer->getExpirations(1), "Periodic timer should fire every interval");
+    ctx.assert_eq(static_cast<uint8_t>(1), timer->popExpired(), "Lowest expired timer should be reported first");
+    ctx.assert_eq(vhw::TimerDevice::NO_TIMER, timer->popExpired(), "Nothing else should have expired yet");
+
+    timer->cancel(1);
+    clock.skipTo(clock.now() + 40'000'000);
+    vhw::DeviceManager::instance().tickDevices();
+    ctx.assert_eq(static_cast<uint64_t>(1), timer->getExpirations(3), "Timers beyond the wheel should fire");
+    ctx.assert_eq(static_cast<uint64_t>(0), timer->getExpirations(2), "Cancelled timers should not fire");
+    ctx.assert_eq(static_cast<uint64_t>(10), timer->getExpirations(1), "Cancelled periodic timer should stop");
+
+    // A CPU reset restarts virtual time; timers armed afterwards still wait their full interval
+    ctx.cpu.reset();
+    timer->arm(4, 100, 0);
+    std::vector<uint8_t> short_run(50, 0x00);
+    short_run.push_back(0xFF);
+    ctx.cpu.execute(short_run);
+    ctx.assert_eq(static_cast<uint64_t>(0), timer->getExpirations(4), "Timers should not fire early after a clock reset");
+}
+
+TEST_CASE(logger_async_backend, "logging") {
+    auto& logger = Logging::Logger::instance();
+    logger.clear_gui_log_buffer();
+    logger.set_async(true);
+    for (int i = 0; i < 8; ++i) {
+        logger.success() << "async record " << i << std::endl;
+    }
+    logger.flush();
+    std::vector<std::string> lines = logger.get_gui_log_buffer();
+    logger.set_async(false);
+
+    ctx.assert_eq(static_cast<size_t>(8), lines.size(), "Every queued record should be written by flush()");
+    for (int i = 0; i < 8; ++i) {
+        ctx.assert_eq(true, lines[i].find(fmt::format("async record {}", i)) != std::string::npos,
+            "Records should be written in order");
+    }
+    ctx.assert_eq(false, logger.is_async(), "Switching back should stop the writer");
+
+    // Records queued while another thread switches back must not be lost
+    logger.clear_gui_log_buffer();
+    logger.set_async(true);
+    std::atomic<bool> started{false};
+    std::thread producer([&] {
+        for (int i = 0; i < 64; ++i) {
+            logger.success() << "switch record " << i << std::endl;
+            started = true;
+        }
+    });
+    while (!started) {
+        std::this_thread::yield();
+    }
+    logger.set_async(false);
+    producer.join();
+    lines = logger.get_gui_log_buffer();
+    ctx.assert_eq(static_cast<size_t>(64), lines.size(), "No record should be lost while switching back");
+    for (size_t i = 0; i < lines.size(); ++i) {
+        ctx.assert_eq(true, lines[i].find(fmt::format("switch record {}", i)) != std::string::npos,
+            "Records should stay in order across the switch");
+    }
+}
+
+TEST_CASE(logger_thread_local_staging, "logging") {
+    // Messages built concurrently must not interleave or pick up another thread's level
+    auto& logger = Logging::Logger::instance();
+    logger.clear_gui_log_buffer();
+    auto worker = [&logger](const std::string& name) {
+        for (int i = 0; i < 20; ++i) {
+            logger.success() << name << " part " << i << " of " << name << std::endl;
+        }
+    };
+    std::thread first(worker, "alpha");
+    std::thread second(worker, "omega");
+    first.join();
+    second.join();
+
+    std::vector<std::string> lines = logger.get_gui_log_buffer();
+    ctx.assert_eq(static_cast<size_t>(40), lines.size(), "Every message should arrive once");
+    for (const std::string& line : lines) {
+        bool alpha = line.find("alpha part") != std::string::npos && line.find("of alpha") != std::string::npos;
+        bool omega = line.find("omega part") != std::string::npos && line.find("of omega") != std::string::npos;
+        ctx.assert_eq(true, alpha != omega, "Each message should come from exactly one thread");
+        ctx.assert_eq(true, line.find("[SUCCESS]") != std::string::npos, "Each message should keep its own level");
+    }
+}
+
+TEST_CASE(binary_trace_roundtrip, "tracing") {
+    std::string path = "/tmp/demi-trace-test.dtrc";
+    {
+        Tracing::TraceWriter tracer(path);
+        tracer.set_symbols({{0x00, "start"}, {0x06, "store"}});
+        ctx.cpu.set_tracer(&tracer);
+        ctx.load_program({
+            0x01, 0x02, 0x2A,  // start: LOAD_IMM R2, 0x2A
+            0x12, 0x02, 0x00,  // INC R2; NOP
+            0x07, 0x02, 0x80,  // store: STORE R2, 0x80
+            0xFF               // HALT
+        });
+        ctx.execute_program();
+        ctx.cpu.set_tracer(nullptr);
+    }
+
+    Tracing::TraceReader trace(path);
+    ctx.assert_eq(static_cast<size_t>(5), trace.size(), "Every retired instruction should be recorded");
+    ctx.assert_eq(static_cast<uint8_t>(0x01), trace[0].opcode, "Opcode should be recorded");
+    ctx.assert_eq(static_cast<uint8_t>(2), trace[0].reg, "Changed register should be recorded");
+    ctx.assert_eq(static_cast<uint32_t>(0x2A), trace[0].reg_value, "New register value should be recorded");
+    ctx.assert_eq(static_cast<uint32_t>(0x80), trace[3].mem_addr, "Store address should be recorded");
+    ctx.assert_eq(static_cast<uint32_t>(0x2B), trace[3].mem_value, "Stored value should be recorded");
+    ctx.assert_eq(Tracing::TraceRecord::NO_ADDRESS, trace[1].mem_addr, "Non-stores should have no address");
+    ctx.assert_eq(std::string("store+0x3"), trace.symbolize(trace[4].pc), "PCs should map to symbols");
+
+    std::ostringstream out;
+    size_t printed = Tracing::decode_trace(path, "store", out);
+    ctx.assert_eq(static_cast<size_t>(2), printed, "Symbol filter should keep only that symbol");
+    ctx.assert_eq(true, out.str().find("STORE") != std::string::npos, "Decoder should print mnemonics");
+    ::unlink(path.c_str());
+}
+
+TEST_CASE(input_journal_replay, "tracing") {
+    std::string path = "/tmp/demi-input-test.djnl";
+    auto timer = std::dynamic_pointer_cast<vhw::TimerDevice>(
+        vhw::DeviceManager::instance().getDevice(vhw::TimerDevice::DEFAULT_CTRL_PORT));
+    auto& clock = vhw::VirtualClock::instance();
+    auto& journal = vhw::InputJournal::instance();
+
+    // Arm an IRQ timer, WAIT for it, and read the expired id in the handler
+    std::vector<uint8_t> program(0x80, 0x00);
+    const std::vector<uint8_t> main_code = {
+        0x01, 0x00, 0x00,  // LOAD_IMM R0, CMD_SELECT_TIMER
+        0x31, 0x00, 0x0E,  // OUT R0, timer ctrl
+        0x01, 0x01, 0x05,  // LOAD_IMM R1, 5
+        0x31, 0x01, 0x0D,  // OUT R1, timer data (timer 5)
+        0x01, 0x00, 0x01,  // LOAD_IMM R0, CMD_SELECT_INTERVAL
+        0x31, 0x00, 0x0E,  // OUT R0, timer ctrl
+        0x01, 0x01, 0x40,  // LOAD_IMM R1, 0x40
+        0x31, 0x01, 0x0D,  // OUT R1, timer data (interval = 64)
+        0x01, 0x00, 0x02,  // LOAD_IMM R0, CMD_SELECT_MODE
+        0x31, 0x00, 0x0E,  // OUT R0, timer ctrl
+        0x01, 0x01, 0x04,  // LOAD_IMM R1, MODE_IRQ
+        0x31, 0x01, 0x0D,  // OUT R1, timer data
+        0x01, 0x00, 0x10,  // LOAD_IMM R0, CMD_ARM
+        0x31, 0x00, 0x0E,  // OUT R0, timer ctrl
+        0x01, 0x00, 0x01,  // LOAD_IMM R0, CMD_SELECT_VECTOR_BASE
+        0x31, 0x00, 0x21,  // OUT R0, PIC ctrl
+        0x01, 0x01, 0x60,  // LOAD_IMM R1, 0x60
+        0x31, 0x01, 0x20,  // OUT R1, PIC data (vector table at 0x60)
+        0x2A,              // STI
+        0x2C,              // WAIT
+        0xFF               // HALT
+    };
+    const std::vector<uint8_t> handler = {
+        0x30, 0x02, 0x0D,  // IN R2, timer data (expired timer id)
+        0x01, 0x00, 0x02,  // LOAD_IMM R0, CMD_EOI
+        0x31, 0x00, 0x21,  // OUT R0, PIC ctrl
+        0x29               // IRET
+    };
+    std::copy(main_code.begin(), main_code.end(), program.begin());
+    program[0x60] = 0x70;  // Vector for IRQ 0 -> handler at 0x70
+    std::copy(handler.begin(), handler.end(), program.begin() + 0x70);
+    ctx.load_program(program);
+
+    ctx.assert_eq(true, journal.startRecording(path), "Journal should be created");
+    ctx.execute_program();
+    journal.stop();
+    ctx.assert_register_eq(2, 5);
+    uint64_t recordedCycles = clock.now();
+
+    // Replay: the handler's read comes from the journal, so the timer keeps its expiration
+    ctx.cpu.reset();  // Replay starts from the cycle recording did
+    ctx.assert_eq(true, journal.startReplay(path), "Journal should load");
+    ctx.execute_program();
+    ctx.assert_eq(false, journal.hasDiverged(), "Replay of the same program should not diverge");
+    ctx.assert_eq(static_cast<size_t>(1), journal.readsReplayed(), "Every journaled read should be replayed");
+    journal.stop();
+    ctx.assert_register_eq(2, 5);
+    ctx.assert_eq(recordedCycles, clock.now(), "Replay should retire exactly the recorded cycles");
+    ctx.assert_eq(static_cast<uint8_t>(5), timer->popExpired(), "Replay should not read the real device");
+
+    // Reading a different port than was recorded is a divergence
+    program[0x72] = 0x0E;
+    ctx.load_program(program);
+    ctx.cpu.reset();
+    journal.startReplay(path);
+    ctx.execute_program();
+    ctx.assert_eq(true, journal.hasDiverged(), "A mismatched read should be reported");
+    journal.stop();
+    ::unlink(path.c_str());
+}
+
+TEST_CASE(sampling_profiler_stacks, "tracing") {
+    Profiling::SamplingProfiler profiler(10);
+    profiler.set_symbols({{0x00, "main"}, {0x08, "work"}});
+    ctx.cpu.set_profiler(&profiler);
+
+    std::vector<uint8_t> program(0x16, 0x00);
+    const std::vector<uint8_t> code = {
+        0x1A, 0x08,        // main: CALL work
+        0xFF               // HALT
+    };
+    const std::vector<uint8_t> work = {
+        0x01, 0x00, 0x64,  // work: LOAD_IMM R0, 100
+        0x01, 0x01, 0x00,  // LOAD_IMM R1, 0
+        0x13, 0x00,        // loop: DEC R0
+        0x0A, 0x00, 0x01,  // CMP R0, R1
+        0x0C, 0x0E,        // JNZ loop
+        0x1B               // RET
+    };
+    std::copy(code.begin(), code.end(), program.begin());
+    std::copy(work.begin(), work.end(), program.begin() + 0x08);
+    ctx.cpu.execute(program);
+    ctx.cpu.set_profiler(nullptr);
+
+    ctx.assert_eq(static_cast<size_t>(30), profiler.sample_count(), "One sample per interval");
+    std::ostringstream folded;
+    profiler.write_folded(folded);
+    ctx.assert_eq(std::string("main;work 30\n"), folded.str(), "Stacks should unwind through CALL frames");
+
+    std::ostringstream flat;
+    profiler.write_flat(flat);
+    ctx.assert_eq(true, flat.str().find("100.00%       30  work") != std::string::npos,
+        "Flat profile should attribute self time to the leaf");
+}
+
+TEST_CASE(instruction_mix_counters, "tracing") {
+    Profiling::InstructionStats stats;
+    ctx.cpu.set_stats(&stats);
+    ctx.load_program({
+        0x01, 0x00, 0x03,  // LOAD_IMM R0, 3
+        0x01, 0x01, 0x00,  // LOAD_IMM R1, 0
+        0x13, 0x00,        // loop: DEC R0
+        0x07, 0x00, 0x80,  // STORE R0, 0x80
+        0x06, 0x02, 0x80,  // LOAD R2, 0x80
+        0x30, 0x03, 0x02,  // IN R3, counter
+        0x0A, 0x00, 0x01,  // CMP R0, R1
+        0x0C, 0x06,        // JNZ loop
+        0xFF               // HALT
+    });
+    ctx.execute_program();
+    ctx.cpu.set_stats(nullptr);
+
+    ctx.assert_eq(static_cast<uint64_t>(21), stats.instructions(), "Every dispatched instruction should be counted");
+    ctx.assert_eq(static_cast<uint64_t>(3), stats.opcode(static_cast<uint8_t>(Opcode::DEC)).count, "Per-opcode counts");
+    ctx.assert_eq(static_cast<uint64_t>(2), stats.branches_taken(), "Taken branches");
+    ctx.assert_eq(static_cast<uint64_t>(1), stats.branches_not_taken(), "Fall-through branches");
+    ctx.assert_eq(static_cast<uint64_t>(3), stats.loads(), "Memory loads");
+    ctx.assert_eq(static_cast<uint64_t>(3), stats.stores(), "Memory stores");
+    ctx.assert_eq(static_cast<uint64_t>(3), stats.port_reads(0x02), "Port reads should be counted per port");
+
+    std::ostringstream json;
+    stats.write_json(json);
+    ctx.assert_eq(true, json.str().find("\"DEC\": {\"opcode\": 19, \"count\": 3") != std::string::npos,
+        "JSON export should list opcodes by mnemonic");
+    std::ostringstream metrics;
+    stats.write_prometheus(metrics);
+    ctx.assert_eq(true, metrics.str().find("demi_branches_total{outcome=\"taken\"} 2\n") != std::string::npos,
+        "Prometheus export should label branch outcomes");
+}
+
+TEST_CASE(basic_block_hot_loops, "tracing") {
+    const std::vector<uint8_t> program = {
+        0x01, 0x00, 0x03,  // LOAD_IMM R0, 3
+        0x01, 0x02, 0x00,  // LOAD_IMM R2, 0
+        0x01, 0x01, 0x04,  // outer: LOAD_IMM R1, 4
+        0x13, 0x01,        // inner: DEC R1
+        0x0A, 0x01, 0x02,  // CMP R1, R2
+        0x0C, 0x09,        // JNZ inner
+        0x13, 0x00,        // DEC R0
+        0x0A, 0x00, 0x02,  // CMP R0, R2
+        0x0C, 0x06,        // JNZ outer
+        0xFF               // HALT
+    };
+    Profiling::BlockProfiler blocks(program);
+    ctx.assert_eq(static_cast<size_t>(5), blocks.blocks().size(), "Blocks split at jump targets and after jumps");
+    ctx.assert_eq(static_cast<size_t>(2), blocks.loops().size(), "Both backward jumps form loops");
+    ctx.assert_eq(static_cast<uint32_t>(2), blocks.loops()[1].depth, "Inner loop nests inside the outer one");
+
+    ctx.cpu.set_block_profiler(&blocks);
+    ctx.load_program(program);
+    ctx.execute_program();
+    ctx.cpu.set_block_profiler(nullptr);
+
+    auto hot = blocks.hot_blocks(2);
+    ctx.assert_eq(static_cast<size_t>(2), hot.size(), "Hot list honours its limit");
+    ctx.assert_eq(static_cast<uint32_t>(0x09), hot[0]->start, "Inner loop body is hottest");
+    ctx.assert_eq(static_cast<uint64_t>(12), hot[0]->count, "Inner body runs 3 x 4 times");
+    ctx.assert_eq(static_cast<uint32_t>(2), hot[0]->loop_depth, "Inner body is two loops deep");
+    ctx.assert_eq(static_cast<uint32_t>(0x10), hot[1]->start, "Outer loop latch is next");
+    ctx.assert_eq(static_cast<uint32_t>(0x06), hot[1]->loop_header, "Latch belongs to the outer loop");
+    ctx.assert_eq(static_cast<uint64_t>(1), blocks.block_containing(0x17)->count, "Exit block runs once");
+}
+
+TEST_CASE(jit_matches_interpreter, "codegen") {
+    const std::vector<uint8_t> program = {
+        0x01, 0x00, 0x0C,  // LOAD_IMM R0, 12
+        0x01, 0x01, 0x01,  // LOAD_IMM R1, 1
+        0x01, 0x02, 0x00,  // LOAD_IMM R2, 0
+        0x01, 0x03, 0x99,  // LOAD_IMM R3, 153
+        0x10, 0x01, 0x03,  // loop: MUL R1, R3
+        0x22, 0x13,        // JNC counted
+        0x12, 0x06,        // INC R6
+        0x1A, 0x32,        // counted: CALL mix
+        0x13, 0x00,        // DEC R0
+        0x0A, 0x00, 0x02,  // CMP R0, R2
+        0x0C, 0x0C,        // JNZ loop
+        0x07, 0x01, 0x80,  // STORE R1, 0x80
+        0x11, 0x01, 0x03,  // DIV R1, R3
+        0x21, 0x01, 0x80,  // SWAP R1, 0x80
+        0x0A, 0x05, 0x04,  // CMP R5, R4
+        0x26, 0x2C,        // JL less
+        0x17, 0x06,        // NOT R6
+        0x27, 0x31,        // less: JGE done
+        0x19, 0x01, 0x04,  // SHR R1, 4
+        0xFF,              // done: HALT
+        0x08, 0x01,        // mix: PUSH R1
+        0x02, 0x04, 0x01,  // ADD R4, R1
+        0x24, 0x3B,        // JNO no_overflow
+        0x12, 0x07,        // INC R7
+        0x03, 0x05, 0x01,  // no_overflow: SUB R5, R1
+        0x09, 0x02,        // POP R2
+        0x18, 0x02, 0x03,  // SHL R2, 3
+        0x16, 0x02, 0x04,  // XOR R2, R4
+        0x15, 0x02, 0x00,  // OR R2, R0
+        0x14, 0x02, 0x03,  // AND R2, R3
+        0x07, 0x02, 0x81,  // STORE R2, 0x81
+        0x01, 0x02, 0x00,  // LOAD_IMM R2, 0
+        0x1B               // RET
+    };
+    auto& clock = vhw::VirtualClock::instance();
+    auto run = [&](CodeGen::Jit* jit) {
+        ctx.cpu.reset();
+        ctx.cpu.set_jit(jit);
+        uint64_t start = clock.now();
+        ctx.cpu.execute(program);
+        ctx.cpu.set_jit(nullptr);
+        return clock.now() - start;
+    };
+
+    uint64_t interpreted = run(nullptr);
+    std::vector<uint32_t> registers = ctx.cpu.get_registers();
+    std::vector<uint8_t> memory = ctx.cpu.get_memory();
+    uint32_t flags = ctx.cpu.get_flags();
+    uint32_t sp = ctx.cpu.get_sp();
+
+    CodeGen::Jit jit(program);
+    uint64_t compiled = run(&jit);
+    ctx.assert_eq(true, jit.instructions() > 0, "Compiled blocks should run");
+    ctx.assert_eq(interpreted, compiled, "Both engines retire the same instructions");
+    for (size_t reg = 0; reg < registers.size(); ++reg) {
+        ctx.assert_eq(registers[reg], ctx.cpu.get_registers()[reg], fmt::format("R{}", reg));
+    }
+    ctx.assert_eq(true, registers[6] != 0 && registers[7] != 0, "Carry and overflow paths are exercised");
+    ctx.assert_eq(flags, ctx.cpu.get_flags(), "FLAGS");
+    ctx.assert_eq(sp, ctx.cpu.get_sp(), "SP");
+    ctx.assert_eq(true, memory == ctx.cpu.get_memory(), "Memory, including the stack");
+}
+
+TEST_CASE(jit_tiers_up_running_loop, "codegen") {
+    std::vector<uint8_t> program = {
+        0x01, 0x00, 0x00,  // LOAD_IMM R0, 0
+        0x01, 0x01, 0x01,  // LOAD_IMM R1, 1
+        0x01, 0x02, 0x28,  // LOAD_IMM R2, 40
+        0x02, 0x00, 0x01,  // loop: ADD R0, R1
+        0x12, 0x01,        // INC R1
+        0x0A, 0x01, 0x02,  // CMP R1, R2
+        0x26, 0x09,        // JL loop
+        0x04, 0x03, 0x00,  // MOV R3, R0
+        0xFF               // HALT
+    };
+    CodeGen::Jit jit(program, 5);
+    ctx.cpu.reset();
+    ctx.cpu.set_jit(&jit);
+    ctx.cpu.execute(program);
+    ctx.cpu.set_jit(nullptr);
+
+    ctx.assert_eq(780u, ctx.cpu.get_registers()[0], "Sum of 1..39");
+    ctx.assert_eq(780u, ctx.cpu.get_registers()[3], "Code after the loop is interpreted");
+    ctx.assert_eq(size_t{1}, jit.transitions().size(), "Only the loop turns hot");
+    ctx.assert_eq(0x09u, jit.transitions()[0].start, "Promoted at the loop header");
+    ctx.assert_eq(true, jit.transitions()[0].loop, "Promotion covers the loop");
+    ctx.assert_eq(size_t{1}, jit.blocks(), "Cold blocks are not compiled");
+    // Four iterations interpreted, the fifth entry promotes and the rest run natively
+    ctx.assert_eq(uint64_t{35 * 4}, jit.instructions(), "Native instructions after tier-up");
+
+    // The JIT cuts the blocks and finds the loops the block profiler reports
+    // (HALT stays with the interpreter, so leave it out)
+    std::vector<uint8_t> body(program.begin(), program.end() - 1);
+    CodeGen::DISAToX86Compiler compiler;
+    compiler.compile_program(body);
+    Profiling::BlockProfiler profiler(body);
+    ctx.assert_eq(profiler.blocks().size(), compiler.candidate_blocks().size(), "Same number of blocks");
+    for (size_t i = 0; i < profiler.blocks().size() && i < compiler.candidate_blocks().size(); ++i) {
+        ctx.assert_eq(profiler.blocks()[i].start, compiler.candidate_blocks()[i].start, "Same block starts");
+        ctx.assert_eq(profiler.blocks()[i].end, compiler.candidate_blocks()[i].end, "Same block ends");
+    }
+    ctx.assert_eq(size_t{1}, compiler.loops().size(), "One loop for the JIT");
+    ctx.assert_eq(size_t{1}, profiler.loops().size(), "One loop for the profiler");
+    ctx.assert_eq(profiler.loops()[0].header, compiler.loops()[0].header, "Same loop header");
+}
+
+TEST_CASE(linear_scan_reuses_registers_and_spill_slots, "codegen") {
+    using CodeGen::X86Register;
+    using Instruction = CodeGen::RegisterAllocator::Instruction;
+
+    // One host register for two pairs of overlapping values: one of each pair spills
+    CodeGen::RegisterAllocator straight({X86Register::RSI}, 0);
+    straight.allocate({
+        Instruction{{}, {1}, {1}},      // 0: v1 =
+        Instruction{{}, {2}, {2}},      // 1: v2 =
+        Instruction{{1, 2}, {}, {3}},   // 2: = v1, v2
+        Instruction{{}, {3}, {4}},      // 3: v3 =
+        Instruction{{}, {4}, {5}},      // 4: v4 =
+        Instruction{{3, 4}, {}, {}},    // 5: = v3, v4
+    });
+    ctx.assert_eq(size_t{2}, straight.get_spill_count(), "Spills");
+    ctx.assert_eq(size_t{2}, straight.get_allocation_count(), "Intervals in registers");
+    ctx.assert_eq(size_t{1}, straight.get_spill_slot_count(), "The second spill reuses the first slot");
+    ctx.assert_eq(true, straight.get_physical_register(3, 5) == X86Register::RSI, "Expired register is reused");
+
+    // A value carried around a loop stays live up to the back edge
+    CodeGen::RegisterAllocator loop({X86Register::RSI}, 8);
+    loop.allocate({
+        Instruction{{}, {0}, {1}},      // 0: v0 =
+        Instruction{{0}, {0}, {2}},     // 1: loop: v0 = v0 + ...
+        Instruction{{}, {}, {1, 3}},    // 2: branch back to the loop
+        Instruction{{}, {5}, {}},       // 3: v5 =
+    });
+    ctx.assert_eq(true, loop.live_in(2).test(0), "Live across the back edge");
+    ctx.assert_eq(true, loop.get_physical_register(0, 2) == X86Register::RSI, "Held to the end of the loop");
+    ctx.assert_eq(true, loop.get_physical_register(5, 3) == X86Register::RSI, "Disjoint intervals share a register");
+    ctx.assert_eq(size_t{0}, loop.get_spill_count(), "No spills");
+}
+
+TEST_CASE(x86_encoder_matches_reference_bytes, "codegen") {
+    using namespace CodeGen;
+    using R = X86Register;
+    struct Encoding {
+        const char* text;
+        std::function<void(X86Encoder&)> emit;
+        std::vector<uint8_t> bytes;  // As assembled by GNU as
+    };
+    const std::vector<Encoding> table = {
+        {"mov eax, ecx", [](X86Encoder& e) { e.emit_mov_reg32_reg32(R::RAX, R::RCX); }, {0x89, 0xC8}},
+        {"mov r9d, r10d", [](X86Encoder& e) { e.emit_mov_reg32_reg32(R::R9, R::R10); }, {0x45, 0x89, 0xD1}},
+        {"add rax, r8", [](X86Encoder& e) { e.emit_alu_reg_reg(AluOp::ADD, R::RAX, R::R8); }, {0x4C, 0x01, 0xC0}},
+        {"xor r11d, esi", [](X86Encoder& e) { e.emit_alu_reg32_reg32(AluOp::XOR, R::R11, R::RSI); }, {0x41, 0x31, 0xF3}},
+        {"and edi, 0x7f", [](X86Encoder& e) { e.emit_alu_reg32_imm32(AluOp::AND, R::RDI, 0x7F); }, {0x83, 0xE7, 0x7F}},
+        {"sub rsp, 0x1000", [](X86Encoder& e) { e.emit_alu_reg_imm32(AluOp::SUB, R::RSP, 0x1000); },
+            {0x48, 0x81, 0xEC, 0x00, 0x10, 0x00, 0x00}},
+        {"adc edx, ebx", [](X86Encoder& e) { e.emit_alu_reg32_reg32(AluOp::ADC, R::RDX, R::RBX); }, {0x11, 0xDA}},
+        {"test r8d, r9d", [](X86Encoder& e) { e.emit_test_reg32_reg32(R::R8, R::R9); }, {0x45, 0x85, 0xC8}},
+        {"test rax, rax", [](X86Encoder& e) { e.emit_test_reg_reg(R::RAX, R::RAX); }, {0x48, 0x85, 0xC0}},
+        {"test r15d, 0x200", [](X86Encoder& e) { e.emit_test_reg32_imm32(R::R15, 0x200); },
+            {0x41, 0xF7, 0xC7, 0x00, 0x02, 0x00, 0x00}},
+        {"shl eax, 1", [](X86Encoder& e) { e.emit_shl_reg32_imm(R::RAX, 1); }, {0xD1, 0xE0}},
+        {"sar r10d, 5", [](X86Encoder& e) { e.emit_shift_reg32_imm(ShiftOp::SAR, R::R10, 5); }, {0x41, 0xC1, 0xFA, 0x05}},
+        {"shr edx, cl", [](X86Encoder& e) { e.emit_shift_reg32_cl(ShiftOp::SHR, R::RDX); }, {0xD3, 0xEA}},
+        {"rol rbx, 3", [](X86Encoder& e) { e.emit_shift_reg_imm(ShiftOp::ROL, R::RBX, 3); }, {0x48, 0xC1, 0xC3, 0x03}},
+        {"shl r9, cl", [](X86Encoder& e) { e.emit_shift_reg_cl(ShiftOp::SHL, R::R9); }, {0x49, 0xD3, 0xE1}},
+        {"inc esi", [](X86Encoder& e) { e.emit_inc_reg32(R::RSI); }, {0xFF, 0xC6}},
+        {"dec r12d", [](X86Encoder& e) { e.emit_dec_reg32(R::R12); }, {0x41, 0xFF, 0xCC}},
+        {"neg eax", [](X86Encoder& e) { e.emit_neg_reg32(R::RAX); }, {0xF7, 0xD8}},
+        {"not r15d", [](X86Encoder& e) { e.emit_not_reg32(R::R15); }, {0x41, 0xF7, 0xD7}},
+        {"inc rax", [](X86Encoder& e) { e.emit_inc_reg(R::RAX); }, {0x48, 0xFF, 0xC0}},
+        {"imul ecx, r8d", [](X86Encoder& e) { e.emit_imul_reg32_reg32(R::RCX, R::R8); }, {0x41, 0x0F, 0xAF, 0xC8}},
+        {"imul eax, edx, 100", [](X86Encoder& e) { e.emit_imul_reg32_reg32_imm32(R::RAX, R::RDX, 100); }, {0x6B, 0xC2, 0x64}},
+        {"imul esi, edi, 1000", [](X86Encoder& e) { e.emit_imul_reg32_reg32_imm32(R::RSI, R::RDI, 1000); },
+            {0x69, 0xF7, 0xE8, 0x03, 0x00, 0x00}},
+        {"imul rax, r9", [](X86Encoder& e) { e.emit_imul_reg_reg(R::RAX, R::R9); }, {0x49, 0x0F, 0xAF, 0xC1}},
+        {"mul r11d", [](X86Encoder& e) { e.emit_mul_reg32(R::R11); }, {0x41, 0xF7, 0xE3}},
+        {"div ecx", [](X86Encoder& e) { e.emit_div_reg32(R::RCX); }, {0xF7, 0xF1}},
+        {"idiv esi", [](X86Encoder& e) { e.emit_idiv_reg32(R::RSI); }, {0xF7, 0xFE}},
+        {"cdq", [](X86Encoder& e) { e.emit_cdq(); }, {0x99}},
+        {"sete al", [](X86Encoder& e) { e.emit_setcc(Condition::E, R::RAX); }, {0x0F, 0x94, 0xC0}},
+        {"setl sil", [](X86Encoder& e) { e.emit_setcc(Condition::L, R::RSI); }, {0x40, 0x0F, 0x9C, 0xC6}},
+        {"setb r9b", [](X86Encoder& e) { e.emit_setcc(Condition::B, R::R9); }, {0x41, 0x0F, 0x92, 0xC1}},
+        {"cmovne eax, r10d", [](X86Encoder& e) { e.emit_cmov_reg32_reg32(Condition::NE, R::RAX, R::R10); },
+            {0x41, 0x0F, 0x45, 0xC2}},
+        {"cmovg rdx, rsi", [](X86Encoder& e) { e.emit_cmov_reg_reg(Condition::G, R::RDX, R::RSI); }, {0x48, 0x0F, 0x4F, 0xD6}},
+        {"movzx eax, sil", [](X86Encoder& e) { e.emit_movzx_reg32_reg8(R::RAX, R::RSI); }, {0x40, 0x0F, 0xB6, 0xC6}},
+        {"mov eax, [r13+rcx]", [](X86Encoder& e) { e.emit_mov_reg32_mem(R::RAX, MemOperand(R::R13, R::RCX, 1)); },
+            {0x41, 0x8B, 0x44, 0x0D, 0x00}},
+        {"mov [rax+r12*4+0x10], edx", [](X86Encoder& e) { e.emit_mov_mem_reg32(MemOperand(R::RAX, R::R12, 4, 0x10), R::RDX); },
+            {0x42, 0x89, 0x54, 0xA0, 0x10}},
+        {"movzx edi, byte [rbp+rbx*8-4]", [](X86Encoder& e) { e.emit_movzx_reg32_mem8(R::RDI, MemOperand(R::RBP, R::RBX, 8, -4)); },
+            {0x0F, 0xB6, 0x7C, 0xDD, 0xFC}},
+        {"mov [r13+rcx+7], sil", [](X86Encoder& e) { e.emit_mov_mem8_reg8(MemOperand(R::R13, R::RCX, 1, 7), R::RSI); },
+            {0x41, 0x88, 0x74, 0x0D, 0x07}},
+        {"lea rdx, [rcx+rcx*2]", [](X86Encoder& e) { e.emit_lea_reg_mem(R::RDX, MemOperand(R::RCX, R::RCX, 2)); },
+            {0x48, 0x8D, 0x14, 0x49}},
+        {"lea eax, [rsp+8]", [](X86Encoder& e) { e.emit_lea_reg32_mem(R::RAX, R::RSP, 8); }, {0x8D, 0x44, 0x24, 0x08}},
+        {"mov [r12], rax", [](X86Encoder& e) { e.emit_mov_mem_reg(R::R12, 0, R::RAX); }, {0x49, 0x89, 0x04, 0x24}},
+        {"mov rax, [rbp]", [](X86Encoder& e) { e.emit_mov_reg_mem(R::RAX, R::RBP); }, {0x48, 0x8B, 0x45, 0x00}},
+        {"mov dword [rbx+rdi*2+0x12345], 0xdeadbeef",
+            [](X86Encoder& e) { e.emit_mov_mem_imm32(MemOperand(R::RBX, R::RDI, 2, 0x12345), 0xDEADBEEF); },
+            {0xC7, 0x84, 0x7B, 0x45, 0x23, 0x01, 0x00, 0xEF, 0xBE, 0xAD, 0xDE}},
+        {"mov rcx, -1", [](X86Encoder& e) { e.emit_mov_reg_imm(R::RCX, ~uint64_t{0}); },
+            {0x48, 0xC7, 0xC1, 0xFF, 0xFF, 0xFF, 0xFF}},
+        {"mov eax, 0x12345678", [](X86Encoder& e) { e.emit_mov_reg_imm(R::RAX, 0x12345678); }, {0xB8, 0x78, 0x56, 0x34, 0x12}},
+        {"movabs r8, 0x123456789", [](X86Encoder& e) { e.emit_mov_reg_imm(R::R8, 0x123456789); },
+            {0x49, 0xB8, 0x89, 0x67, 0x45, 0x23, 0x01, 0x00, 0x00, 0x00}},
+        {"cmp r14, [rbx+24]", [](X86Encoder& e) { e.emit_alu_reg_mem(AluOp::CMP, R::R14, R::RBX, 24); },
+            {0x4C, 0x3B, 0x73, 0x18}},
+        {"call rax", [](X86Encoder& e) { e.emit_call_reg(R::RAX); }, {0xFF, 0xD0}},
+        {"call r14", [](X86Encoder& e) { e.emit_call_reg(R::R14); }, {0x41, 0xFF, 0xD6}},
+        {"syscall", [](X86Encoder& e) { e.emit_syscall(); }, {0x0F, 0x05}},
+        // Jumps in reach are short, backward or forward
+        {"top: nop; jmp top; jne top; jl ahead; ahead:", [](X86Encoder& e) {
+                X86Encoder::Label top = e.create_label();
+                X86Encoder::Label ahead = e.create_label();
+                e.bind_label(top);
+                e.emit_nop();
+                e.emit_jmp_label(top);
+                e.emit_jcc_label(Condition::NE, top);
+                e.emit_jcc_label(Condition::L, ahead);
+                e.bind_label(ahead);
+            },
+            {0x90, 0xEB, 0xFD, 0x75, 0xFB, 0x7C, 0x00}},
+        {"jmp skip; int3; skip: nop", [](X86Encoder& e) {
+                X86Encoder::Label skip = e.create_label();
+                e.emit_jmp_label(skip);
+                e.emit_int3();
+                e.bind_label(skip);
+                e.emit_nop();
+            },
+            {0xEB, 0x01, 0xCC, 0x90}},
+        // Only the last jump to a label can shrink; the earlier one is patched
+        // with the distance after the shrink
+        {"je done; nop; jmp done; nop; done:", [](X86Encoder& e) {
+                X86Encoder::Label done = e.create_label();
+                e.emit_jcc_label(Condition::E, done);
+                e.emit_nop();
+                e.emit_jmp_label(done);
+                e.emit_nop();
+                e.bind_label(done);
+            },
+            {0x0F, 0x84, 0x04, 0x00, 0x00, 0x00, 0x90, 0xEB, 0x01, 0x90}},
+    };
+    for (const Encoding& encoding : table) {
+        X86Encoder encoder;
+        encoding.emit(encoder);
+        ctx.assert_eq(true, encoder.get_code() == encoding.bytes, encoding.text);
+    }
+
+    // Out of rel8 reach
+    X86Encoder far;
+    X86Encoder::Label top = far.create_label();
+    far.bind_label(top);
+    for (int i = 0; i < 200; ++i) {
+        far.emit_nop();
+    }
+    far.emit_jmp_label(top);
+    std::vector<uint8_t> jump(far.get_code().end() - 5, far.get_code().end());
+    ctx.assert_eq(true, jump == std::vector<uint8_t>{0xE9, 0x33, 0xFF, 0xFF, 0xFF}, "jmp back over 200 bytes is rel32");
+
+    // Forward jumps stay rel32 out of reach, or once the code after them was measured
+    X86Encoder ahead;
+    X86Encoder::Label over = ahead.create_label();
+    ahead.emit_jmp_label(over);
+    for (int i = 0; i < 200; ++i) {
+        ahead.emit_nop();
+    }
+    ahead.bind_label(over);
+    jump.assign(ahead.get_code().begin(), ahead.get_code().begin() + 5);
+    ctx.assert_eq(true, jump == std::vector<uint8_t>{0xE9, 0xC8, 0x00, 0x00, 0x00}, "jmp over 200 bytes is rel32");
+
+    X86Encoder measured;
+    X86Encoder::Label next = measured.create_label();
+    measured.emit_jcc_label(Condition::NE, next);
+    size_t recorded = measured.size();
+    measured.bind_label(next);
+    ctx.assert_eq(static_cast<size_t>(6), recorded, "measured jump size");
+    ctx.assert_eq(true, measured.get_code() == std::vector<uint8_t>{0x0F, 0x85, 0x00, 0x00, 0x00, 0x00},
+                  "jne after size() stays rel32");
+}
+
+TEST_CASE(aot_executable_runs_natively, "codegen") {
+    std::vector<uint8_t> program = {
+        0x01, 0x00, 0x41,  // LOAD_IMM R0, 'A'
+        0x01, 0x01, 0x46,  // LOAD_IMM R1, 'F'
+        0x31, 0x00, 0x01,  // loop: OUT R0, 1
+        0x12, 0x00,        // INC R0
+        0x0A, 0x00, 0x01,  // CMP R0, R1
+        0x26, 0x06,        // JL loop
+        0x1C, 0x00,        // PUSH_ARG R0
+        0x1D, 0x03,        // POP_ARG R3
+        0x31, 0x03, 0x01,  // OUT R3, 1
+        0x01, 0x02, 0x0A,  // LOAD_IMM R2, '\n'
+        0x31, 0x02, 0x01,  // OUT R2, 1
+        0x04, 0x00, 0x0A,  // MOV R0, R10: skipped, as the engine skips it
+        0xFF               // HALT
+    };
+    CodeGen::AotCompiler compiler;
+    std::vector<uint8_t> image = compiler.compile(program);
+    ctx.assert_eq(true, image.size() > 64 && std::memcmp(image.data(), "\x7F" "ELF", 4) == 0, "ELF magic");
+    ctx.assert_eq(uint8_t{2}, image[4], "64-bit");
+    ctx.assert_eq(uint8_t{62}, image[18], "x86-64 (EM_X86_64)");
+    ctx.assert_eq(size_t{0}, compiler.warnings().size(), "Console I/O needs no warnings");
+
+    std::vector<uint8_t> divide = {
+        0x01, 0x00, 0x07,  // LOAD_IMM R0, 7
+        0x01, 0x01, 0x00,  // LOAD_IMM R1, 0
+        0x11, 0x00, 0x01,  // DIV R0, R1
+        0xFF               // HALT
+    };
+    CodeGen::AotCompiler faulting;
+    std::vector<uint8_t> faulting_image = faulting.compile(divide);
+
+#if defined(__x86_64__) && defined(__linux__)
+    // A fresh file in $TMPDIR for each run, so parallel test runs cannot collide
+    auto run = [](const std::vector<uint8_t>& bytes, int& status) {
+        std::string output;
+        const char* tmp = std::getenv("TMPDIR");
+        std::string path = std::string(tmp ? tmp : "/tmp") + "/demi-aot-XXXXXX";
+        int fd = ::mkstemp(path.data());
+        if (fd < 0) {
+            status = -1;
+            return output;
+        }
+        ::close(fd);
+        if (!CodeGen::AotCompiler::write_executable(path, bytes)) {
+            std::remove(path.c_str());
+            status = -1;
+            return output;
+        }
+        FILE* pipe = popen((path + " 2>&1").c_str(), "r");
+        char buffer[256];
+        size_t count;
+        while (pipe && (count = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+            output.append(buffer, count);
+        }
+        status = pipe ? pclose(pipe) : -1;
+        std::remove(path.c_str());
+        return output;
+    };
+    int status = 0;
+    ctx.assert_eq(std::string("ABCDEF\n"), run(image, status), "Console output of the native build");
+    ctx.assert_eq(0, status, "HALT exits with 0");
+    ctx.assert_eq(std::string("Error: division by zero at PC=0x0006\n"), run(faulting_image, status),
+        "Division by zero is reported at its pc");
+    ctx.assert_eq(true, status != 0, "A fault exits with an error");
+#endif
+}